@@ -0,0 +1,99 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       bench.h
+ *
+ ***************************************************************************/
+
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include <windows.h>
+
+#include <winutilz.h>
+
+/***************************************************************************
+ *  platform.c
+ ***************************************************************************/
+
+typedef struct tagBENCHHEAPSTATS {
+    ULONGLONG   cAllocations;       /* HeapAlloc calls since the reset */
+    ULONGLONG   cbPeak;             /* peak of bytes allocated since it */
+} BENCHHEAPSTATS, *PBENCHHEAPSTATS;
+
+ULONGLONG
+BenchGetTimeNs(
+    VOID
+    );
+
+/* Peak resident set of the whole process, in KiB */
+ULONGLONG
+BenchGetPeakRssKb(
+    VOID
+    );
+
+VOID
+BenchResetHeapStats(
+    VOID
+    );
+
+/* FALSE where the library heap cannot be observed */
+BOOL
+BenchQueryHeapStats(
+    OUT PBENCHHEAPSTATS pStats
+    );
+
+/***************************************************************************
+ *  corpus.c
+ ***************************************************************************/
+
+typedef enum {
+    BENCH_CONTENT_PHOTO = 0x0,      /* smooth gradients, fine grain */
+    BENCH_CONTENT_UI    = 0x1,      /* flat fills, borders, text runs */
+    BENCH_CONTENT_NOISE = 0x2,      /* uniform random bytes */
+    BENCH_CONTENT_MAX
+} BENCH_CONTENT;
+
+/* Same seed, same corpus: results stay comparable between runs */
+#define BENCH_CORPUS_SEED   0x57A7E5u
+
+LPCSTR
+BenchGetContentName(
+    IN BENCH_CONTENT    content
+    );
+
+PWUIMAGEDATA
+BenchGenerateImage(
+    IN BENCH_CONTENT    content,
+    IN UINT             uWidth,
+    IN UINT             uHeight
+    );
+
+/***************************************************************************
+ *  cases.c
+ ***************************************************************************/
+
+typedef struct tagBENCHCONTEXT {
+    PWUIMAGEDATA    pSource;        /* corpus image, never modified */
+    PWUIMAGEDATA    pWork;          /* copy of pSource, may be modified */
+    LPVOID          pState;         /* owned by the case */
+} BENCHCONTEXT, *PBENCHCONTEXT;
+
+typedef BOOL (*BENCHPROC)(PBENCHCONTEXT pContext);
+
+typedef struct tagBENCHCASE {
+    LPCSTR      szName;
+    LPCSTR      szCategory;
+    BENCHPROC   pfnSetup;           /* optional, not timed */
+    BENCHPROC   pfnRun;
+    BENCHPROC   pfnTeardown;        /* optional, not timed */
+} BENCHCASE, *PBENCHCASE;
+
+extern CONST BENCHCASE g_aBenchCases[];
+extern CONST UINT      g_cBenchCases;
+
+#endif /* BENCH_H_INCLUDED */
@@ -0,0 +1,1516 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       cases.c
+ *
+ ***************************************************************************/
+
+#include "bench.h"
+
+typedef struct tagYCBCRPLANES {
+    BYTE*   abY;
+    BYTE*   abCb;
+    BYTE*   abCr;
+} YCBCRPLANES, *PYCBCRPLANES;
+
+/***************************************************************************
+ *  Allocation
+ ***************************************************************************/
+
+static BOOL
+RunAllocEmpty(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+
+    pImageData = WuCreateEmptyImageData(
+        pContext->pSource->uWidth,
+        pContext->pSource->uHeight);
+
+    if (NULL == pImageData)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pImageData);
+
+    return TRUE;
+}
+
+static BOOL
+SetupImageHandle(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+
+    pImageData = WuCreateEmptyImageData(
+        pContext->pSource->uWidth,
+        pContext->pSource->uHeight);
+
+    if (NULL == pImageData)
+    {
+        return FALSE;
+    }
+
+    pContext->pState = WuCreateImageHandle(pImageData);
+
+    if (NULL == pContext->pState)
+    {
+        WuDestroyImageData(pImageData);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOL
+RunHandleCopyOnWrite(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    HWUIMAGE hShared = NULL;
+    BOOL     bResult = FALSE;
+
+    hShared = WuShareImageHandle((HWUIMAGE) pContext->pState);
+
+    if (NULL == hShared)
+    {
+        return FALSE;
+    }
+
+    bResult = (WuImageHandleGetWritableData(hShared) != NULL);
+
+    WuReleaseImageHandle(hShared);
+
+    return bResult;
+}
+
+static BOOL
+TeardownImageHandle(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuReleaseImageHandle((HWUIMAGE) pContext->pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Conversion
+ ***************************************************************************/
+
+static BOOL
+RunGrayscaleBt601(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuConvertImageDataToGrayscale(pContext->pWork, WU_LUMA_BT601, 0);
+}
+
+static BOOL
+RunGrayscaleLinearBt709(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuConvertImageDataToGrayscale(
+        pContext->pWork,
+        WU_LUMA_BT709,
+        WU_COLOR_LINEAR_LIGHT);
+}
+
+static BOOL
+SetupYCbCr(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PYCBCRPLANES pPlanes = NULL;
+    SIZE_T       cPixels = 0;
+
+    cPixels = (SIZE_T) pContext->pSource->uWidth * pContext->pSource->uHeight;
+
+    pPlanes = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(YCBCRPLANES));
+
+    if (NULL == pPlanes)
+    {
+        return FALSE;
+    }
+
+    pContext->pState = pPlanes;
+
+    pPlanes->abY  = HeapAlloc(GetProcessHeap(), 0, cPixels);
+    pPlanes->abCb = HeapAlloc(GetProcessHeap(), 0, cPixels);
+    pPlanes->abCr = HeapAlloc(GetProcessHeap(), 0, cPixels);
+
+    if ((NULL == pPlanes->abY) || (NULL == pPlanes->abCb)
+        || (NULL == pPlanes->abCr))
+    {
+        return FALSE;
+    }
+
+    return WuImageDataToYCbCr(
+        pContext->pSource,
+        WU_LUMA_BT601,
+        pPlanes->abY,
+        pPlanes->abCb,
+        pPlanes->abCr);
+}
+
+static BOOL
+RunToYCbCr(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PYCBCRPLANES pPlanes = (PYCBCRPLANES) pContext->pState;
+
+    return WuImageDataToYCbCr(
+        pContext->pSource,
+        WU_LUMA_BT601,
+        pPlanes->abY,
+        pPlanes->abCb,
+        pPlanes->abCr);
+}
+
+static BOOL
+RunFromYCbCr(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PYCBCRPLANES pPlanes    = (PYCBCRPLANES) pContext->pState;
+    PWUIMAGEDATA pImageData = NULL;
+
+    pImageData = WuImageDataFromYCbCr(
+        pPlanes->abY,
+        pPlanes->abCb,
+        pPlanes->abCr,
+        pContext->pSource->uWidth,
+        pContext->pSource->uHeight,
+        WU_LUMA_BT601);
+
+    if (NULL == pImageData)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pImageData);
+
+    return TRUE;
+}
+
+static BOOL
+TeardownYCbCr(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PYCBCRPLANES pPlanes = (PYCBCRPLANES) pContext->pState;
+
+    if (NULL == pPlanes)
+    {
+        return TRUE;
+    }
+
+    HeapFree(GetProcessHeap(), 0, pPlanes->abY);
+    HeapFree(GetProcessHeap(), 0, pPlanes->abCb);
+    HeapFree(GetProcessHeap(), 0, pPlanes->abCr);
+    HeapFree(GetProcessHeap(), 0, pPlanes);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Transform
+ ***************************************************************************/
+
+static BOOL
+RunRotate90(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pRotated = NULL;
+
+    pRotated = WuRotateImageData(pContext->pSource, WU_IMAGE_ROTATE_90);
+
+    if (NULL == pRotated)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pRotated);
+
+    return TRUE;
+}
+
+static BOOL
+RunRotate180InPlace(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuRotateImageDataInPlace(pContext->pWork, WU_IMAGE_ROTATE_180);
+}
+
+static BOOL
+RunFlipHorizontalInPlace(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuFlipImageDataInPlace(pContext->pWork, WU_IMAGE_FLIP_HORIZONTAL);
+}
+
+/***************************************************************************
+ *  Scaling
+ ***************************************************************************/
+
+static BOOL
+BuildPyramid(
+    IN PBENCHCONTEXT        pContext,
+    IN WU_PYRAMID_FILTER    filter,
+    IN DWORD                dwFlags
+    )
+{
+    PWUIMAGEPYRAMID pPyramid = NULL;
+
+    pPyramid = WuBuildImagePyramid(pContext->pSource, filter, 0, dwFlags);
+
+    if (NULL == pPyramid)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImagePyramid(pPyramid);
+
+    return TRUE;
+}
+
+static BOOL
+RunPyramidBox(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return BuildPyramid(pContext, WU_PYRAMID_FILTER_BOX, 0);
+}
+
+static BOOL
+RunPyramidKaiserLinear(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return BuildPyramid(
+        pContext,
+        WU_PYRAMID_FILTER_KAISER,
+        WU_COLOR_LINEAR_LIGHT);
+}
+
+/*
+    Pipeline cases build the chain inside the timed region on purpose:
+    recording is part of the cost a caller pays.
+*/
+static BOOL
+ExecutePipeline(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN BOOL             bRecorded
+    )
+{
+    PWUIMAGEDATA pOutput = NULL;
+
+    if (bRecorded != FALSE)
+    {
+        pOutput = WuExecuteImagePipeline(pPipeline);
+    }
+
+    WuDestroyImagePipeline(pPipeline);
+
+    if (NULL == pOutput)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pOutput);
+
+    return TRUE;
+}
+
+static BOOL
+RunResizeHalfBilinear(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEPIPELINE pPipeline = NULL;
+
+    pPipeline = WuCreateImagePipeline(pContext->pSource);
+
+    if (NULL == pPipeline)
+    {
+        return FALSE;
+    }
+
+    return ExecutePipeline(pPipeline, WuPipelineResize(
+        pPipeline,
+        (pContext->pSource->uWidth + 1) / 2,
+        (pContext->pSource->uHeight + 1) / 2));
+}
+
+static BOOL
+RunBoxBlurRadius4(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEPIPELINE pPipeline = NULL;
+
+    pPipeline = WuCreateImagePipeline(pContext->pSource);
+
+    if (NULL == pPipeline)
+    {
+        return FALSE;
+    }
+
+    return ExecutePipeline(pPipeline, WuPipelineBoxBlur(pPipeline, 4));
+}
+
+/***************************************************************************
+ *  Dithering
+ ***************************************************************************/
+
+static BOOL
+RunGrayscaleDither(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEPIPELINE pPipeline = NULL;
+
+    pPipeline = WuCreateImagePipeline(pContext->pSource);
+
+    if (NULL == pPipeline)
+    {
+        return FALSE;
+    }
+
+    return ExecutePipeline(pPipeline,
+        WuPipelineGrayscale(pPipeline, WU_LUMA_BT601, 0)
+        && WuPipelineDither(pPipeline));
+}
+
+static BOOL
+RunResizeGrayscaleDither(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEPIPELINE pPipeline = NULL;
+
+    pPipeline = WuCreateImagePipeline(pContext->pSource);
+
+    if (NULL == pPipeline)
+    {
+        return FALSE;
+    }
+
+    return ExecutePipeline(pPipeline,
+        WuPipelineResize(
+            pPipeline,
+            (pContext->pSource->uWidth + 1) / 2,
+            (pContext->pSource->uHeight + 1) / 2)
+        && WuPipelineGrayscale(pPipeline, WU_LUMA_BT601, 0)
+        && WuPipelineDither(pPipeline));
+}
+
+/***************************************************************************
+ *  Statistics
+ ***************************************************************************/
+
+#define REGION_QUERIES  4096
+#define REGION_SIZE     32
+
+static BOOL
+BuildIntegral(
+    IN PBENCHCONTEXT    pContext,
+    IN DWORD            dwFlags
+    )
+{
+    PWUINTEGRALIMAGE pIntegral = NULL;
+
+    pIntegral = WuBuildIntegralImage(pContext->pSource, dwFlags);
+
+    if (NULL == pIntegral)
+    {
+        return FALSE;
+    }
+
+    WuDestroyIntegralImage(pIntegral);
+
+    return TRUE;
+}
+
+static BOOL
+RunIntegralImage(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return BuildIntegral(pContext, 0);
+}
+
+static BOOL
+RunIntegralImageSquared(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return BuildIntegral(pContext, WU_INTEGRAL_SQUARED);
+}
+
+static BOOL
+SetupRegionQueries(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    pContext->pState = WuBuildIntegralImage(
+        pContext->pSource,
+        WU_INTEGRAL_SQUARED);
+
+    return (pContext->pState != NULL);
+}
+
+/* Region variance on a grid of small blocks, as a blank-area check does */
+static BOOL
+RunRegionVariance(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUINTEGRALIMAGE pIntegral = (PWUINTEGRALIMAGE) pContext->pState;
+    UINT             uWidth    = 0;
+    UINT             uHeight   = 0;
+    UINT             cColumns  = 0;
+    UINT             i         = 0;
+    WUCOLORF         variance;
+
+    uWidth   = min(REGION_SIZE, pContext->pSource->uWidth);
+    uHeight  = min(REGION_SIZE, pContext->pSource->uHeight);
+    cColumns = pContext->pSource->uWidth / uWidth;
+
+    for (i = 0; i < REGION_QUERIES; ++i)
+    {
+        if (WuRegionVariance(
+                pIntegral,
+                (i % cColumns) * uWidth,
+                ((i / cColumns) * uHeight) % (pContext->pSource->uHeight
+                    - uHeight + 1),
+                uWidth,
+                uHeight,
+                &variance) == FALSE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+TeardownRegionQueries(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuDestroyIntegralImage((PWUINTEGRALIMAGE) pContext->pState);
+
+    return TRUE;
+}
+
+static BOOL
+RunHistogram(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WUHISTOGRAM histogram;
+
+    return WuImageHistogram(
+        pContext->pSource,
+        NULL,
+        WU_LUMA_BT601,
+        0,
+        &histogram);
+}
+
+static BOOL
+RunHistogramLuma(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WUHISTOGRAM histogram;
+
+    return WuImageHistogram(
+        pContext->pSource,
+        NULL,
+        WU_LUMA_BT601,
+        WU_HISTOGRAM_LUMA,
+        &histogram);
+}
+
+static BOOL
+RunDominantColor(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WUCOLOR color;
+
+    return WuImageDominantColor(pContext->pSource, NULL, &color);
+}
+
+/***************************************************************************
+ *  Drawing
+ ***************************************************************************/
+
+/* Translucent, so every span goes through the blend path */
+#define DRAW_COLOR  WU_RGBA(0xE0, 0x30, 0x30, 0xA0)
+
+static BOOL
+RunFillRectangle(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pWork = pContext->pWork;
+
+    return WuFillRectangle(
+        pWork,
+        pWork->uWidth * 0.1f + 0.25f,
+        pWork->uHeight * 0.1f + 0.25f,
+        pWork->uWidth * 0.8f,
+        pWork->uHeight * 0.8f,
+        DRAW_COLOR);
+}
+
+static BOOL
+RunFillEllipse(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pWork = pContext->pWork;
+
+    return WuFillEllipse(
+        pWork,
+        pWork->uWidth * 0.5f,
+        pWork->uHeight * 0.5f,
+        pWork->uWidth * 0.4f,
+        pWork->uHeight * 0.4f,
+        DRAW_COLOR);
+}
+
+/* Many short strokes, the annotation case */
+static BOOL
+RunDrawLines(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pWork   = pContext->pWork;
+    FLOAT        fWidth  = (FLOAT) pWork->uWidth;
+    FLOAT        fHeight = (FLOAT) pWork->uHeight;
+    UINT         i       = 0;
+
+    for (i = 0; i < 256; ++i)
+    {
+        if (WuDrawLine(
+                pWork,
+                fWidth * ((i * 37) % 256) / 256.0f,
+                fHeight * ((i * 101) % 256) / 256.0f,
+                fWidth * ((i * 53 + 17) % 256) / 256.0f,
+                fHeight * ((i * 29 + 91) % 256) / 256.0f,
+                3.0f,
+                DRAW_COLOR) == FALSE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Masks
+ ***************************************************************************/
+
+static BOOL
+RunDetectEdgesSobel(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEMASK pMask = NULL;
+
+    pMask = WuDetectEdges(pContext->pSource, WU_GRADIENT_SOBEL, 64, 0);
+
+    if (NULL == pMask)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageMask(pMask);
+
+    return TRUE;
+}
+
+static BOOL
+RunThresholdOtsuPacked(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEMASK pMask = NULL;
+
+    pMask = WuThresholdImage(
+        pContext->pSource,
+        0,
+        WU_THRESHOLD_OTSU | WU_MASK_PACKED);
+
+    if (NULL == pMask)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageMask(pMask);
+
+    return TRUE;
+}
+
+static BOOL
+RunAdaptiveThreshold(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEMASK pMask = NULL;
+
+    pMask = WuAdaptiveThreshold(pContext->pSource, 15, 8, 0);
+
+    if (NULL == pMask)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageMask(pMask);
+
+    return TRUE;
+}
+
+static BOOL
+SetupMask(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    pContext->pState = WuThresholdImage(pContext->pSource, 0,
+        WU_THRESHOLD_OTSU);
+
+    return (pContext->pState != NULL);
+}
+
+/* Large element on purpose, the cost should match a small one */
+static BOOL
+RunMorphClose(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuMorphImageMask(
+        (PWUIMAGEMASK) pContext->pState,
+        WU_MORPH_CLOSE,
+        15,
+        15);
+}
+
+static BOOL
+TeardownMask(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuDestroyImageMask((PWUIMAGEMASK) pContext->pState);
+
+    return TRUE;
+}
+
+#define MAX_COMPONENTS  1024
+
+static BOOL
+RunLabelComponents(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    static WUCOMPONENT aComponents[MAX_COMPONENTS];
+    UINT               cComponents = 0;
+
+    return WuLabelComponents(
+        (PWUIMAGEMASK) pContext->pState,
+        WU_CONNECTIVITY_8,
+        NULL,
+        aComponents,
+        MAX_COMPONENTS,
+        &cComponents);
+}
+
+static BOOL
+RunFloodSelect(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEMASK pMask = NULL;
+
+    pMask = WuFloodSelect(
+        pContext->pSource,
+        pContext->pSource->uWidth / 2,
+        pContext->pSource->uHeight / 2,
+        32,
+        0);
+
+    if (NULL == pMask)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageMask(pMask);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Cropping
+ ***************************************************************************/
+
+/*
+    Source pasted in the middle of a transparent frame an eighth of the
+    size wide on every side, like a window capture with its DWM shadow.
+*/
+static BOOL
+SetupFramedImage(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pSource  = pContext->pSource;
+    PWUIMAGEDATA pFramed  = NULL;
+    UINT         uMarginX = pSource->uWidth / 8;
+    UINT         uMarginY = pSource->uHeight / 8;
+    SIZE_T       cbRow    = 0;
+    UINT         y        = 0;
+
+    pFramed = WuCreateEmptyImageData(pSource->uWidth, pSource->uHeight);
+
+    if (NULL == pFramed)
+    {
+        return FALSE;
+    }
+
+    cbRow = (SIZE_T) (pSource->uWidth - 2 * uMarginX)
+        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (y = uMarginY; y < pSource->uHeight - uMarginY; ++y)
+    {
+        CopyMemory(
+            pFramed->abData + ((SIZE_T) y * pSource->uWidth + uMarginX)
+                * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            pSource->abData + ((SIZE_T) y * pSource->uWidth + uMarginX)
+                * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            cbRow);
+    }
+
+    pContext->pState = pFramed;
+
+    return TRUE;
+}
+
+static BOOL
+RunContentBounds(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    UINT uX      = 0;
+    UINT uY      = 0;
+    UINT uWidth  = 0;
+    UINT uHeight = 0;
+
+    return WuImageContentBounds(
+        (PWUIMAGEDATA) pContext->pState,
+        0,
+        0,
+        WU_CONTENT_TRANSPARENT,
+        &uX,
+        &uY,
+        &uWidth,
+        &uHeight);
+}
+
+static BOOL
+TeardownFramedImage(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuDestroyImageData((PWUIMAGEDATA) pContext->pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Frame differencing
+ ***************************************************************************/
+
+typedef struct tagFRAMEDIFFSTATE {
+    PWUFRAMEDIFF    pDiff;
+    PWUIMAGEDATA    pChanged;       /* source with a small block altered */
+    BOOL            bChanged;       /* frame compared last */
+} FRAMEDIFFSTATE, *PFRAMEDIFFSTATE;
+
+/* A caret-sized block, the typical change on an idle desktop */
+#define CHANGE_WIDTH    96
+#define CHANGE_HEIGHT   24
+
+static BOOL
+SetupFrameDiff(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA    pSource = pContext->pSource;
+    PFRAMEDIFFSTATE pState  = NULL;
+    DWORD*          pdwRow  = NULL;
+    UINT            uLeft   = pSource->uWidth / 3;
+    UINT            uTop    = pSource->uHeight / 3;
+    UINT            x       = 0;
+    UINT            y       = 0;
+
+    pState = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        sizeof(FRAMEDIFFSTATE));
+
+    if (NULL == pState)
+    {
+        return FALSE;
+    }
+
+    pContext->pState = pState;
+
+    pState->pDiff    = WuCreateFrameDiff(0);
+    pState->pChanged = WuCreateEmptyImageData(
+        pSource->uWidth,
+        pSource->uHeight);
+
+    if ((NULL == pState->pDiff) || (NULL == pState->pChanged))
+    {
+        return FALSE;
+    }
+
+    CopyMemory(pState->pChanged->abData, pSource->abData,
+        (SIZE_T) pSource->uWidth * pSource->uHeight
+            * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+    for (y = uTop; y < min(uTop + CHANGE_HEIGHT, pSource->uHeight); ++y)
+    {
+        pdwRow = (DWORD*) pState->pChanged->abData
+            + (SIZE_T) y * pSource->uWidth;
+
+        for (x = uLeft; x < min(uLeft + CHANGE_WIDTH, pSource->uWidth); ++x)
+        {
+            pdwRow[x] = ~pdwRow[x];
+        }
+    }
+
+    /* the first frame always comes out whole, keep it out of the timing */
+    return (WuFrameDiffCompare(pState->pDiff, pSource, 0) != NULL);
+}
+
+static BOOL
+RunFrameDiffStatic(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PFRAMEDIFFSTATE pState = (PFRAMEDIFFSTATE) pContext->pState;
+
+    return (WuFrameDiffCompare(pState->pDiff, pContext->pSource, 0)
+        != NULL);
+}
+
+static BOOL
+RunFrameDiffSmallChange(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PFRAMEDIFFSTATE pState = (PFRAMEDIFFSTATE) pContext->pState;
+
+    pState->bChanged = !pState->bChanged;
+
+    return (WuFrameDiffCompare(
+        pState->pDiff,
+        (TRUE == pState->bChanged) ? pState->pChanged : pContext->pSource,
+        0) != NULL);
+}
+
+static BOOL
+TeardownFrameDiff(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PFRAMEDIFFSTATE pState = (PFRAMEDIFFSTATE) pContext->pState;
+
+    if (NULL == pState)
+    {
+        return TRUE;
+    }
+
+    WuDestroyFrameDiff(pState->pDiff);
+    WuDestroyImageData(pState->pChanged);
+
+    HeapFree(GetProcessHeap(), 0, pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Color grading
+ ***************************************************************************/
+
+#define LUT_SIZE    33
+
+/* Contrast S-curve with a warm shift, far enough from identity */
+static PWUCOLORLUT
+CreateGradingLut(
+    VOID
+    )
+{
+    PWUCOLORLUT pLut    = NULL;
+    FLOAT*      afTable = NULL;
+    FLOAT       fValue  = 0.0f;
+    SIZE_T      i       = 0;
+    UINT        r       = 0;
+    UINT        g       = 0;
+    UINT        b       = 0;
+
+    afTable = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        LUT_SIZE * LUT_SIZE * LUT_SIZE * 3 * sizeof(FLOAT));
+
+    if (NULL == afTable)
+    {
+        return NULL;
+    }
+
+    for (b = 0; b < LUT_SIZE; ++b)
+    {
+        for (g = 0; g < LUT_SIZE; ++g)
+        {
+            for (r = 0; r < LUT_SIZE; ++r)
+            {
+                fValue = (FLOAT) r / (LUT_SIZE - 1);
+                afTable[i++] = fValue * fValue * (3.0f - 2.0f * fValue)
+                    * 1.05f;
+
+                fValue = (FLOAT) g / (LUT_SIZE - 1);
+                afTable[i++] = fValue * fValue * (3.0f - 2.0f * fValue);
+
+                fValue = (FLOAT) b / (LUT_SIZE - 1);
+                afTable[i++] = fValue * fValue * (3.0f - 2.0f * fValue)
+                    * 0.9f + 0.02f;
+            }
+        }
+    }
+
+    pLut = WuCreateColorLut(LUT_SIZE, afTable, NULL, NULL);
+
+    HeapFree(GetProcessHeap(), 0, afTable);
+
+    return pLut;
+}
+
+static BOOL
+SetupColorLut(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    pContext->pState = CreateGradingLut();
+
+    return (pContext->pState != NULL);
+}
+
+/* The 64 MB table is built once, only the lookups are timed */
+static BOOL
+SetupPrecomputedColorLut(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    if (SetupColorLut(pContext) == FALSE)
+    {
+        return FALSE;
+    }
+
+    return WuPrecomputeColorLut(
+        (PWUCOLORLUT) pContext->pState,
+        WU_LUT_INTERPOLATION_TETRAHEDRAL,
+        8);
+}
+
+static BOOL
+RunColorLutTrilinear(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuApplyColorLut(
+        pContext->pWork,
+        (PWUCOLORLUT) pContext->pState,
+        WU_LUT_INTERPOLATION_TRILINEAR);
+}
+
+static BOOL
+RunColorLutTetrahedral(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return WuApplyColorLut(
+        pContext->pWork,
+        (PWUCOLORLUT) pContext->pState,
+        WU_LUT_INTERPOLATION_TETRAHEDRAL);
+}
+
+static BOOL
+TeardownColorLut(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuDestroyColorLut((PWUCOLORLUT) pContext->pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Search
+ ***************************************************************************/
+
+#define NEEDLE_SIZE 64
+
+/* The needle is cut from the source, so at least one match must exist */
+static BOOL
+SetupNeedle(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PWUIMAGEDATA pSource = pContext->pSource;
+    PWUIMAGEDATA pNeedle = NULL;
+    UINT         uWidth  = min(NEEDLE_SIZE, pSource->uWidth);
+    UINT         uHeight = min(NEEDLE_SIZE, pSource->uHeight);
+    UINT         uLeft   = (pSource->uWidth - uWidth) * 3 / 7;
+    UINT         uTop    = (pSource->uHeight - uHeight) * 5 / 9;
+    UINT         y       = 0;
+
+    pNeedle = WuCreateEmptyImageData(uWidth, uHeight);
+
+    if (NULL == pNeedle)
+    {
+        return FALSE;
+    }
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        CopyMemory(
+            pNeedle->abData + (SIZE_T) y * uWidth
+                * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            pSource->abData + ((SIZE_T) (uTop + y) * pSource->uWidth
+                + uLeft) * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            (SIZE_T) uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL);
+    }
+
+    pContext->pState = pNeedle;
+
+    return TRUE;
+}
+
+static BOOL
+FindNeedle(
+    IN PBENCHCONTEXT    pContext,
+    IN WU_MATCH_METRIC  metric,
+    IN FLOAT            fThreshold
+    )
+{
+    WUIMAGEMATCH aMatches[4];
+
+    return WuFindImageData(
+        pContext->pSource,
+        (PWUIMAGEDATA) pContext->pState,
+        NULL,
+        metric,
+        fThreshold,
+        0,
+        aMatches,
+        sizeof(aMatches) / sizeof(aMatches[0])) > 0;
+}
+
+static BOOL
+RunFindNeedleSad(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return FindNeedle(pContext, WU_MATCH_SAD, 1.0f);
+}
+
+static BOOL
+RunFindNeedleNcc(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return FindNeedle(pContext, WU_MATCH_NCC, 0.99f);
+}
+
+static BOOL
+TeardownNeedle(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    WuDestroyImageData((PWUIMAGEDATA) pContext->pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Packed DIB
+ ***************************************************************************/
+
+typedef struct tagPACKEDDIBSTATE {
+    BYTE*   pbDib;
+    SIZE_T  cbDib;
+} PACKEDDIBSTATE, *PPACKEDDIBSTATE;
+
+/* Lays the source out the way CF_DIB usually holds it: bottom-up rows */
+static BOOL
+SetupPackedDib(
+    IN PBENCHCONTEXT    pContext,
+    IN WORD             wBitCount
+    )
+{
+    PWUIMAGEDATA     pSource  = pContext->pSource;
+    PPACKEDDIBSTATE  pState   = NULL;
+    BITMAPINFOHEADER bmiHeader;
+    CONST BYTE*      pbSrc    = NULL;
+    BYTE*            pbDst    = NULL;
+    SIZE_T           cbStride = 0;
+    UINT             uBytes   = wBitCount / 8;
+    UINT             x        = 0;
+    UINT             y        = 0;
+
+    pState = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        sizeof(PACKEDDIBSTATE));
+
+    if (NULL == pState)
+    {
+        return FALSE;
+    }
+
+    pContext->pState = pState;
+
+    cbStride      = (((SIZE_T) pSource->uWidth * wBitCount + 31) / 32) * 4;
+    pState->cbDib = sizeof(BITMAPINFOHEADER) + cbStride * pSource->uHeight;
+    pState->pbDib = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        pState->cbDib);
+
+    if (NULL == pState->pbDib)
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(&bmiHeader, sizeof(BITMAPINFOHEADER));
+
+    bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmiHeader.biWidth       = pSource->uWidth;
+    bmiHeader.biHeight      = pSource->uHeight;
+    bmiHeader.biPlanes      = 1;
+    bmiHeader.biBitCount    = wBitCount;
+    bmiHeader.biCompression = BI_RGB;
+
+    CopyMemory(pState->pbDib, &bmiHeader, sizeof(BITMAPINFOHEADER));
+
+    for (y = 0; y < pSource->uHeight; ++y)
+    {
+        pbSrc = pSource->abData + (SIZE_T) y * pSource->uWidth * 4;
+        pbDst = pState->pbDib + sizeof(BITMAPINFOHEADER)
+            + cbStride * (pSource->uHeight - 1 - y);
+
+        for (x = 0; x < pSource->uWidth; ++x)
+        {
+            CopyMemory(pbDst + x * uBytes, pbSrc + x * 4, uBytes);
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+SetupPackedDib32(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return SetupPackedDib(pContext, 32);
+}
+
+static BOOL
+SetupPackedDib24(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return SetupPackedDib(pContext, 24);
+}
+
+static BOOL
+RunPackedDib(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PPACKEDDIBSTATE pState     = (PPACKEDDIBSTATE) pContext->pState;
+    PWUIMAGEDATA    pImageData = NULL;
+
+    pImageData = WuImageDataFromPackedDib(pState->pbDib, pState->cbDib);
+
+    if (NULL == pImageData)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pImageData);
+
+    return TRUE;
+}
+
+static BOOL
+TeardownPackedDib(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PPACKEDDIBSTATE pState = (PPACKEDDIBSTATE) pContext->pState;
+
+    if (NULL == pState)
+    {
+        return TRUE;
+    }
+
+    if (pState->pbDib != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pState->pbDib);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pState);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Codecs (WIC, Windows only)
+ ***************************************************************************/
+
+#ifdef _WIN32
+
+typedef struct tagCODECSTATE {
+    WCHAR           szFilePath[MAX_PATH];
+    WU_IMAGE_FORMAT format;
+} CODECSTATE, *PCODECSTATE;
+
+static BOOL
+SetupCodec(
+    IN PBENCHCONTEXT    pContext,
+    IN WU_IMAGE_FORMAT  format
+    )
+{
+    PCODECSTATE pState = NULL;
+    WCHAR       szTempDirectory[MAX_PATH];
+
+    pState = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(CODECSTATE));
+
+    if (NULL == pState)
+    {
+        return FALSE;
+    }
+
+    pContext->pState = pState;
+    pState->format   = format;
+
+    if (GetTempPathW(MAX_PATH, szTempDirectory) == 0)
+    {
+        return FALSE;
+    }
+
+    if (GetTempFileNameW(szTempDirectory, L"wub", 0, pState->szFilePath) == 0)
+    {
+        return FALSE;
+    }
+
+    /* decode cases read this file back */
+    return WuSaveImageDataToFileW(
+        pContext->pSource,
+        pState->szFilePath,
+        format);
+}
+
+static BOOL
+SetupPng(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return SetupCodec(pContext, WU_IMAGE_FORMAT_PNG);
+}
+
+static BOOL
+SetupJpeg(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return SetupCodec(pContext, WU_IMAGE_FORMAT_JPEG);
+}
+
+static BOOL
+SetupBmp(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    return SetupCodec(pContext, WU_IMAGE_FORMAT_BMP);
+}
+
+static BOOL
+RunEncode(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PCODECSTATE pState = (PCODECSTATE) pContext->pState;
+
+    return WuSaveImageDataToFileW(
+        pContext->pSource,
+        pState->szFilePath,
+        pState->format);
+}
+
+static BOOL
+RunDecode(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PCODECSTATE  pState     = (PCODECSTATE) pContext->pState;
+    PWUIMAGEDATA pImageData = NULL;
+
+    pImageData = WuLoadImageDataFromFileW(pState->szFilePath);
+
+    if (NULL == pImageData)
+    {
+        return FALSE;
+    }
+
+    WuDestroyImageData(pImageData);
+
+    return TRUE;
+}
+
+static BOOL
+TeardownCodec(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    PCODECSTATE pState = (PCODECSTATE) pContext->pState;
+
+    if (NULL == pState)
+    {
+        return TRUE;
+    }
+
+    DeleteFileW(pState->szFilePath);
+    HeapFree(GetProcessHeap(), 0, pState);
+
+    return TRUE;
+}
+
+#endif /* _WIN32 */
+
+CONST BENCHCASE g_aBenchCases[] = {
+    { "alloc_empty", "allocation",
+        NULL, RunAllocEmpty, NULL },
+    { "handle_copy_on_write", "allocation",
+        SetupImageHandle, RunHandleCopyOnWrite, TeardownImageHandle },
+    { "grayscale_bt601", "conversion",
+        NULL, RunGrayscaleBt601, NULL },
+    { "grayscale_linear_bt709", "conversion",
+        NULL, RunGrayscaleLinearBt709, NULL },
+    { "to_ycbcr_bt601", "conversion",
+        SetupYCbCr, RunToYCbCr, TeardownYCbCr },
+    { "from_ycbcr_bt601", "conversion",
+        SetupYCbCr, RunFromYCbCr, TeardownYCbCr },
+    { "rotate_90", "transform",
+        NULL, RunRotate90, NULL },
+    { "rotate_180_in_place", "transform",
+        NULL, RunRotate180InPlace, NULL },
+    { "flip_horizontal_in_place", "transform",
+        NULL, RunFlipHorizontalInPlace, NULL },
+    { "pyramid_box", "scaling",
+        NULL, RunPyramidBox, NULL },
+    { "pyramid_kaiser_linear", "scaling",
+        NULL, RunPyramidKaiserLinear, NULL },
+    { "resize_half_bilinear", "scaling",
+        NULL, RunResizeHalfBilinear, NULL },
+    { "box_blur_r4", "filtering",
+        NULL, RunBoxBlurRadius4, NULL },
+    { "grayscale_dither", "dithering",
+        NULL, RunGrayscaleDither, NULL },
+    { "resize_grayscale_dither", "dithering",
+        NULL, RunResizeGrayscaleDither, NULL },
+    { "integral_image", "statistics",
+        NULL, RunIntegralImage, NULL },
+    { "integral_image_squared", "statistics",
+        NULL, RunIntegralImageSquared, NULL },
+    { "region_variance_4096", "statistics",
+        SetupRegionQueries, RunRegionVariance, TeardownRegionQueries },
+    { "histogram", "statistics",
+        NULL, RunHistogram, NULL },
+    { "histogram_luma", "statistics",
+        NULL, RunHistogramLuma, NULL },
+    { "dominant_color", "statistics",
+        NULL, RunDominantColor, NULL },
+    { "fill_rectangle", "drawing",
+        NULL, RunFillRectangle, NULL },
+    { "fill_ellipse", "drawing",
+        NULL, RunFillEllipse, NULL },
+    { "draw_lines_256", "drawing",
+        NULL, RunDrawLines, NULL },
+    { "edges_sobel", "masks",
+        NULL, RunDetectEdgesSobel, NULL },
+    { "threshold_otsu_packed", "masks",
+        NULL, RunThresholdOtsuPacked, NULL },
+    { "adaptive_threshold_r15", "masks",
+        NULL, RunAdaptiveThreshold, NULL },
+    { "morph_close_r15", "masks",
+        SetupMask, RunMorphClose, TeardownMask },
+    { "label_components", "masks",
+        SetupMask, RunLabelComponents, TeardownMask },
+    { "flood_select", "masks",
+        NULL, RunFloodSelect, NULL },
+    { "content_bounds_framed", "statistics",
+        SetupFramedImage, RunContentBounds, TeardownFramedImage },
+    { "frame_diff_static", "capture",
+        SetupFrameDiff, RunFrameDiffStatic, TeardownFrameDiff },
+    { "frame_diff_small_change", "capture",
+        SetupFrameDiff, RunFrameDiffSmallChange, TeardownFrameDiff },
+    { "lut_trilinear_33", "grading",
+        SetupColorLut, RunColorLutTrilinear, TeardownColorLut },
+    { "lut_tetrahedral_33", "grading",
+        SetupColorLut, RunColorLutTetrahedral, TeardownColorLut },
+    { "lut_precomputed_8bit", "grading",
+        SetupPrecomputedColorLut, RunColorLutTetrahedral,
+        TeardownColorLut },
+    { "find_needle_64_sad", "search",
+        SetupNeedle, RunFindNeedleSad, TeardownNeedle },
+    { "find_needle_64_ncc", "search",
+        SetupNeedle, RunFindNeedleNcc, TeardownNeedle },
+    { "packed_dib_32", "conversion",
+        SetupPackedDib32, RunPackedDib, TeardownPackedDib },
+    { "packed_dib_24", "conversion",
+        SetupPackedDib24, RunPackedDib, TeardownPackedDib },
+#ifdef _WIN32
+    { "encode_png", "codec",
+        SetupPng, RunEncode, TeardownCodec },
+    { "decode_png", "codec",
+        SetupPng, RunDecode, TeardownCodec },
+    { "encode_jpeg", "codec",
+        SetupJpeg, RunEncode, TeardownCodec },
+    { "decode_jpeg", "codec",
+        SetupJpeg, RunDecode, TeardownCodec },
+    { "encode_bmp", "codec",
+        SetupBmp, RunEncode, TeardownCodec },
+    { "decode_bmp", "codec",
+        SetupBmp, RunDecode, TeardownCodec },
+#endif /* _WIN32 */
+};
+
+CONST UINT g_cBenchCases = sizeof(g_aBenchCases) / sizeof(g_aBenchCases[0]);
@@ -0,0 +1,419 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       compat.c
+ *
+ ***************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <windows.h>
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+    Every block carries its size in a header so HeapFree can keep the live
+    byte count. The header is 16 bytes so the returned pointer keeps
+    malloc's alignment.
+*/
+#define BLOCK_HEADER_SIZE   16
+
+static ULONGLONG volatile g_cAllocations = 0;
+static ULONGLONG volatile g_cbLive       = 0;
+static ULONGLONG volatile g_cbPeak       = 0;
+static ULONGLONG volatile g_cbBaseline   = 0;
+
+/* Only manual-reset events are needed by the kernels */
+typedef struct tagCOMPATEVENT {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    BOOL            bSignaled;
+} COMPATEVENT, *PCOMPATEVENT;
+
+typedef struct tagCOMPATWORKITEM {
+    LPTHREAD_START_ROUTINE  pfnFunction;
+    LPVOID                  pContext;
+} COMPATWORKITEM, *PCOMPATWORKITEM;
+
+static VOID
+TrackAllocation(
+    IN SIZE_T   cbBytes
+    )
+{
+    ULONGLONG cbLive = 0;
+    ULONGLONG cbPeak = 0;
+
+    __atomic_add_fetch(&g_cAllocations, 1, __ATOMIC_RELAXED);
+
+    cbLive = __atomic_add_fetch(&g_cbLive, cbBytes, __ATOMIC_RELAXED);
+    cbPeak = __atomic_load_n(&g_cbPeak, __ATOMIC_RELAXED);
+
+    while ((cbLive > cbPeak)
+        && !__atomic_compare_exchange_n(&g_cbPeak, &cbPeak, cbLive, FALSE,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        /* cbPeak was reloaded by the failed exchange */
+    }
+}
+
+HANDLE
+GetProcessHeap(
+    VOID
+    )
+{
+    static BYTE bProcessHeap;
+
+    return &bProcessHeap;
+}
+
+LPVOID
+HeapAlloc(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN SIZE_T   cbBytes
+    )
+{
+    BYTE* pbBlock = NULL;
+
+    UNREFERENCED_PARAMETER(hHeap);
+
+    if (cbBytes > MAXSIZE_T - BLOCK_HEADER_SIZE)
+    {
+        return NULL;
+    }
+
+    if (dwFlags & HEAP_ZERO_MEMORY)
+    {
+        pbBlock = calloc(1, cbBytes + BLOCK_HEADER_SIZE);
+    }
+    else
+    {
+        pbBlock = malloc(cbBytes + BLOCK_HEADER_SIZE);
+    }
+
+    if (NULL == pbBlock)
+    {
+        return NULL;
+    }
+
+    *(SIZE_T*) pbBlock = cbBytes;
+
+    TrackAllocation(cbBytes);
+
+    return pbBlock + BLOCK_HEADER_SIZE;
+}
+
+LPVOID
+HeapReAlloc(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN LPVOID   lpMem,
+    IN SIZE_T   cbBytes
+    )
+{
+    BYTE*  pbBlock = NULL;
+    SIZE_T cbOld   = 0;
+
+    if (NULL == lpMem)
+    {
+        return NULL;
+    }
+
+    cbOld = *(SIZE_T*) ((BYTE*) lpMem - BLOCK_HEADER_SIZE);
+
+    pbBlock = HeapAlloc(hHeap, dwFlags, cbBytes);
+
+    if (NULL == pbBlock)
+    {
+        return NULL;
+    }
+
+    CopyMemory(pbBlock, lpMem, min(cbOld, cbBytes));
+    HeapFree(hHeap, 0, lpMem);
+
+    return pbBlock;
+}
+
+BOOL
+HeapFree(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN LPVOID   lpMem
+    )
+{
+    BYTE* pbBlock = NULL;
+
+    UNREFERENCED_PARAMETER(hHeap);
+    UNREFERENCED_PARAMETER(dwFlags);
+
+    if (NULL == lpMem)
+    {
+        return TRUE;
+    }
+
+    pbBlock = (BYTE*) lpMem - BLOCK_HEADER_SIZE;
+
+    __atomic_sub_fetch(&g_cbLive, *(SIZE_T*) pbBlock, __ATOMIC_RELAXED);
+
+    free(pbBlock);
+
+    return TRUE;
+}
+
+LONG
+InterlockedIncrement(
+    IN LONG volatile*   plAddend
+    )
+{
+    return __atomic_add_fetch(plAddend, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG
+InterlockedDecrement(
+    IN LONG volatile*   plAddend
+    )
+{
+    return __atomic_sub_fetch(plAddend, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG
+InterlockedExchange(
+    IN LONG volatile*   plTarget,
+    IN LONG             lValue
+    )
+{
+    return __atomic_exchange_n(plTarget, lValue, __ATOMIC_SEQ_CST);
+}
+
+LONG
+InterlockedCompareExchange(
+    IN LONG volatile*   plDestination,
+    IN LONG             lExchange,
+    IN LONG             lComparand
+    )
+{
+    __atomic_compare_exchange_n(plDestination, &lComparand, lExchange, FALSE,
+        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+    /* on failure lComparand now holds the current value */
+    return lComparand;
+}
+
+VOID
+InitializeSRWLock(
+    OUT PSRWLOCK    pSRWLock
+    )
+{
+    __atomic_store_n(&pSRWLock->lLocked, 0, __ATOMIC_RELEASE);
+}
+
+VOID
+AcquireSRWLockExclusive(
+    IN OUT PSRWLOCK pSRWLock
+    )
+{
+    while (__atomic_exchange_n(&pSRWLock->lLocked, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        sched_yield();
+    }
+}
+
+VOID
+ReleaseSRWLockExclusive(
+    IN OUT PSRWLOCK pSRWLock
+    )
+{
+    __atomic_store_n(&pSRWLock->lLocked, 0, __ATOMIC_RELEASE);
+}
+
+VOID
+Sleep(
+    IN DWORD    dwMilliseconds
+    )
+{
+    struct timespec ts;
+
+    if (0 == dwMilliseconds)
+    {
+        sched_yield();
+        return;
+    }
+
+    ts.tv_sec  = dwMilliseconds / 1000;
+    ts.tv_nsec = (long) (dwMilliseconds % 1000) * 1000000L;
+
+    nanosleep(&ts, NULL);
+}
+
+HANDLE
+CreateEventW(
+    IN LPVOID   lpEventAttributes,
+    IN BOOL     bManualReset,
+    IN BOOL     bInitialState,
+    IN LPCWSTR  lpName
+    )
+{
+    PCOMPATEVENT pEvent = malloc(sizeof(COMPATEVENT));
+
+    /* every event is manual-reset, see COMPATEVENT */
+    UNREFERENCED_PARAMETER(lpEventAttributes);
+    UNREFERENCED_PARAMETER(bManualReset);
+    UNREFERENCED_PARAMETER(lpName);
+
+    if (NULL == pEvent)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pEvent->mutex, NULL);
+    pthread_cond_init(&pEvent->cond, NULL);
+
+    pEvent->bSignaled = bInitialState;
+
+    return pEvent;
+}
+
+BOOL
+SetEvent(
+    IN HANDLE   hEvent
+    )
+{
+    PCOMPATEVENT pEvent = (PCOMPATEVENT) hEvent;
+
+    pthread_mutex_lock(&pEvent->mutex);
+    pEvent->bSignaled = TRUE;
+    pthread_cond_broadcast(&pEvent->cond);
+    pthread_mutex_unlock(&pEvent->mutex);
+
+    return TRUE;
+}
+
+DWORD
+WaitForSingleObject(
+    IN HANDLE   hHandle,
+    IN DWORD    dwMilliseconds
+    )
+{
+    PCOMPATEVENT pEvent = (PCOMPATEVENT) hHandle;
+
+    if (dwMilliseconds != INFINITE)
+    {
+        return WAIT_FAILED;
+    }
+
+    pthread_mutex_lock(&pEvent->mutex);
+
+    while (FALSE == pEvent->bSignaled)
+    {
+        pthread_cond_wait(&pEvent->cond, &pEvent->mutex);
+    }
+
+    pthread_mutex_unlock(&pEvent->mutex);
+
+    return WAIT_OBJECT_0;
+}
+
+BOOL
+CloseHandle(
+    IN HANDLE   hObject
+    )
+{
+    PCOMPATEVENT pEvent = (PCOMPATEVENT) hObject;
+
+    pthread_cond_destroy(&pEvent->cond);
+    pthread_mutex_destroy(&pEvent->mutex);
+
+    free(pEvent);
+
+    return TRUE;
+}
+
+VOID
+GetSystemInfo(
+    OUT LPSYSTEM_INFO   lpSystemInfo
+    )
+{
+    long cProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    lpSystemInfo->dwNumberOfProcessors =
+        (cProcessors > 0) ? (DWORD) cProcessors : 1;
+}
+
+static void*
+WorkItemThreadProc(
+    IN void*    pParameter
+    )
+{
+    COMPATWORKITEM item = *(PCOMPATWORKITEM) pParameter;
+
+    free(pParameter);
+
+    item.pfnFunction(item.pContext);
+
+    return NULL;
+}
+
+BOOL
+QueueUserWorkItem(
+    IN LPTHREAD_START_ROUTINE   pfnFunction,
+    IN LPVOID                   pContext,
+    IN ULONG                    dwFlags
+    )
+{
+    PCOMPATWORKITEM pItem = malloc(sizeof(COMPATWORKITEM));
+    pthread_t       thread;
+
+    UNREFERENCED_PARAMETER(dwFlags);
+
+    if (NULL == pItem)
+    {
+        return FALSE;
+    }
+
+    pItem->pfnFunction = pfnFunction;
+    pItem->pContext    = pContext;
+
+    if (pthread_create(&thread, NULL, WorkItemThreadProc, pItem) != 0)
+    {
+        free(pItem);
+        return FALSE;
+    }
+
+    pthread_detach(thread);
+
+    return TRUE;
+}
+
+VOID
+BenchResetHeapStats(
+    VOID
+    )
+{
+    ULONGLONG cbLive = __atomic_load_n(&g_cbLive, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&g_cAllocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_cbBaseline, cbLive, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_cbPeak, cbLive, __ATOMIC_RELAXED);
+}
+
+BOOL
+BenchQueryHeapStats(
+    OUT PBENCHHEAPSTATS pStats
+    )
+{
+    pStats->cAllocations = __atomic_load_n(&g_cAllocations, __ATOMIC_RELAXED);
+    pStats->cbPeak       = __atomic_load_n(&g_cbPeak, __ATOMIC_RELAXED)
+        - __atomic_load_n(&g_cbBaseline, __ATOMIC_RELAXED);
+
+    return TRUE;
+}
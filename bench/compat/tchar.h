@@ -0,0 +1,17 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       tchar.h
+ *
+ ***************************************************************************/
+
+#ifndef COMPAT_TCHAR_H_INCLUDED
+#define COMPAT_TCHAR_H_INCLUDED
+
+/* winutilz.h only needs the header to exist */
+
+#endif /* COMPAT_TCHAR_H_INCLUDED */
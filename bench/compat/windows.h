@@ -0,0 +1,318 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       windows.h
+ *
+ ***************************************************************************/
+
+/*
+    Minimal stand-in for <windows.h> used to build the platform-independent
+    image kernels (and winutilz_bench) on non-Windows hosts. Only what
+    winutilz.h and those kernels need is declared here; the few functions
+    that need a body live in compat.c.
+*/
+
+#ifndef COMPAT_WINDOWS_H_INCLUDED
+#define COMPAT_WINDOWS_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/***************************************************************************
+ *  Annotations and calling conventions
+ ***************************************************************************/
+
+#define IN
+#define OUT
+#define CONST               const
+#define VOID                void
+#define WINAPI
+#define CALLBACK
+#define __declspec(x)
+
+#ifndef NULL
+    #define NULL            ((void*) 0)
+#endif
+
+#define TRUE                1
+#define FALSE               0
+
+/***************************************************************************
+ *  Basic types
+ ***************************************************************************/
+
+typedef int                 BOOL;
+typedef unsigned char       BYTE;
+typedef unsigned short      WORD;
+typedef uint32_t            DWORD;
+typedef short               SHORT;
+typedef int                 INT;
+typedef unsigned int        UINT;
+typedef int32_t             LONG;
+typedef uint32_t            ULONG;
+typedef int64_t             LONGLONG;
+typedef uint64_t            ULONGLONG;
+typedef float               FLOAT;
+typedef double              DOUBLE;
+typedef char                CHAR;
+typedef wchar_t             WCHAR;
+
+typedef intptr_t            INT_PTR;
+typedef uintptr_t           UINT_PTR;
+typedef intptr_t            LONG_PTR;
+typedef uintptr_t           ULONG_PTR;
+typedef uintptr_t           DWORD_PTR;
+typedef size_t              SIZE_T;
+
+typedef LONG                NTSTATUS;
+typedef LONG                HRESULT;
+
+typedef void*               PVOID;
+typedef void*               LPVOID;
+typedef CONST void*         LPCVOID;
+typedef BYTE*               PBYTE;
+typedef WORD*               PWORD;
+typedef DWORD*              PDWORD;
+typedef DWORD*              LPDWORD;
+typedef INT*                PINT;
+typedef UINT*               PUINT;
+typedef LONG*               PLONG;
+typedef ULONG*              PULONG;
+
+typedef CHAR*               LPSTR;
+typedef CONST CHAR*         LPCSTR;
+typedef WCHAR*              LPWSTR;
+typedef CONST WCHAR*        LPCWSTR;
+typedef LPCSTR              LPCTSTR;
+
+typedef DWORD               COLORREF;
+typedef DWORD*              LPCOLORREF;
+
+typedef void*               HANDLE;
+typedef HANDLE              HGLOBAL;
+typedef struct HWND__*      HWND;
+typedef struct HDC__*       HDC;
+typedef struct HBITMAP__*   HBITMAP;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef HINSTANCE           HMODULE;
+typedef struct HRSRC__*     HRSRC;
+
+typedef DWORD (*LPTHREAD_START_ROUTINE)(LPVOID);
+
+typedef struct tagRECT {
+    LONG    left;
+    LONG    top;
+    LONG    right;
+    LONG    bottom;
+} RECT, *PRECT, *LPRECT;
+
+#define BI_RGB              0
+#define BI_BITFIELDS        3
+
+typedef struct tagRGBQUAD {
+    BYTE    rgbBlue;
+    BYTE    rgbGreen;
+    BYTE    rgbRed;
+    BYTE    rgbReserved;
+} RGBQUAD;
+
+typedef struct tagBITMAPINFOHEADER {
+    DWORD   biSize;
+    LONG    biWidth;
+    LONG    biHeight;
+    WORD    biPlanes;
+    WORD    biBitCount;
+    DWORD   biCompression;
+    DWORD   biSizeImage;
+    LONG    biXPelsPerMeter;
+    LONG    biYPelsPerMeter;
+    DWORD   biClrUsed;
+    DWORD   biClrImportant;
+} BITMAPINFOHEADER, *PBITMAPINFOHEADER;
+
+/***************************************************************************
+ *  Limits and helpers
+ ***************************************************************************/
+
+#define MAXLONG             0x7FFFFFFF
+#define MAXUINT             ((UINT) ~((UINT) 0))
+#define MAXDWORD            0xFFFFFFFF
+#define MAXSIZE_T           ((SIZE_T) ~((SIZE_T) 0))
+
+#define min(a, b)           (((a) < (b)) ? (a) : (b))
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+
+#define LOBYTE(w)           ((BYTE) (((DWORD_PTR) (w)) & 0xFF))
+
+#define UNREFERENCED_PARAMETER(P)   ((void) (P))
+
+#define CopyMemory          memcpy
+#define MoveMemory          memmove
+#define FillMemory(p, l, b) memset((p), (b), (l))
+#define ZeroMemory(p, cb)   memset((p), 0, (cb))
+
+/***************************************************************************
+ *  Heap (backed by malloc, instrumented for winutilz_bench)
+ ***************************************************************************/
+
+#define HEAP_ZERO_MEMORY    0x00000008
+
+HANDLE
+GetProcessHeap(
+    VOID
+    );
+
+LPVOID
+HeapAlloc(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN SIZE_T   cbBytes
+    );
+
+LPVOID
+HeapReAlloc(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN LPVOID   lpMem,
+    IN SIZE_T   cbBytes
+    );
+
+BOOL
+HeapFree(
+    IN HANDLE   hHeap,
+    IN DWORD    dwFlags,
+    IN LPVOID   lpMem
+    );
+
+/***************************************************************************
+ *  Synchronization
+ ***************************************************************************/
+
+LONG
+InterlockedIncrement(
+    IN LONG volatile*   plAddend
+    );
+
+LONG
+InterlockedDecrement(
+    IN LONG volatile*   plAddend
+    );
+
+LONG
+InterlockedExchange(
+    IN LONG volatile*   plTarget,
+    IN LONG             lValue
+    );
+
+LONG
+InterlockedCompareExchange(
+    IN LONG volatile*   plDestination,
+    IN LONG             lExchange,
+    IN LONG             lComparand
+    );
+
+/* Shared acquisitions are exclusive too, which the kernels do not mind */
+typedef struct _RTL_SRWLOCK {
+    LONG volatile   lLocked;
+} SRWLOCK, *PSRWLOCK;
+
+#define SRWLOCK_INIT        { 0 }
+
+VOID
+InitializeSRWLock(
+    OUT PSRWLOCK    pSRWLock
+    );
+
+VOID
+AcquireSRWLockExclusive(
+    IN OUT PSRWLOCK pSRWLock
+    );
+
+VOID
+ReleaseSRWLockExclusive(
+    IN OUT PSRWLOCK pSRWLock
+    );
+
+#define AcquireSRWLockShared    AcquireSRWLockExclusive
+#define ReleaseSRWLockShared    ReleaseSRWLockExclusive
+
+VOID
+Sleep(
+    IN DWORD    dwMilliseconds
+    );
+
+#define INFINITE            0xFFFFFFFF
+#define WAIT_OBJECT_0       0x00000000
+#define WAIT_FAILED         0xFFFFFFFF
+
+HANDLE
+CreateEventW(
+    IN LPVOID   lpEventAttributes,
+    IN BOOL     bManualReset,
+    IN BOOL     bInitialState,
+    IN LPCWSTR  lpName
+    );
+
+BOOL
+SetEvent(
+    IN HANDLE   hEvent
+    );
+
+DWORD
+WaitForSingleObject(
+    IN HANDLE   hHandle,
+    IN DWORD    dwMilliseconds
+    );
+
+BOOL
+CloseHandle(
+    IN HANDLE   hObject
+    );
+
+/***************************************************************************
+ *  Thread pool (one detached thread per work item)
+ ***************************************************************************/
+
+#define WT_EXECUTEDEFAULT   0x00000000
+
+typedef struct _SYSTEM_INFO {
+    DWORD   dwNumberOfProcessors;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+
+VOID
+GetSystemInfo(
+    OUT LPSYSTEM_INFO   lpSystemInfo
+    );
+
+BOOL
+QueueUserWorkItem(
+    IN LPTHREAD_START_ROUTINE   pfnFunction,
+    IN LPVOID                   pContext,
+    IN ULONG                    dwFlags
+    );
+
+/***************************************************************************
+ *  Declared for the inline helpers of winutilz.h, never called
+ ***************************************************************************/
+
+#define COLOR_BACKGROUND    1
+#define COLOR_DESKTOP       1
+
+DWORD
+GetSysColor(
+    IN INT  nIndex
+    );
+
+HRSRC
+FindResource(
+    IN HMODULE  hModule,
+    IN LPCTSTR  lpName,
+    IN LPCTSTR  lpType
+    );
+
+#endif /* COMPAT_WINDOWS_H_INCLUDED */
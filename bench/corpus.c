@@ -0,0 +1,348 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       corpus.c
+ *
+ ***************************************************************************/
+
+#include "bench.h"
+
+#define PHOTO_CELL_SIZE     64
+#define PHOTO_GRAIN         12
+
+#define UI_PIXELS_PER_WINDOW    (256 * 256)
+#define UI_MAX_WINDOWS          64
+#define UI_TITLE_HEIGHT         24
+#define UI_LINE_HEIGHT          16
+#define UI_GLYPH_HEIGHT         9
+
+static CONST LPCSTR g_aszContentNames[BENCH_CONTENT_MAX] = {
+    "photo",
+    "ui",
+    "noise"
+};
+
+static CONST DWORD g_adwUiPalette[] = {
+    0xFFFFFFFF, 0xFFF3F3F3, 0xFF2B579A, 0xFF0078D7,
+    0xFF202020, 0xFFE81123, 0xFF107C10, 0xFFFFB900
+};
+
+#define UI_PALETTE_SIZE     (sizeof(g_adwUiPalette) / sizeof(DWORD))
+
+/* xorshift32, good enough for test content and identical everywhere */
+static DWORD
+NextRandom(
+    IN OUT DWORD*   pdwState
+    )
+{
+    DWORD dwState = *pdwState;
+
+    dwState ^= dwState << 13;
+    dwState ^= dwState >> 17;
+    dwState ^= dwState << 5;
+
+    *pdwState = dwState;
+
+    return dwState;
+}
+
+static DWORD
+GetSeed(
+    IN BENCH_CONTENT    content,
+    IN UINT             uWidth,
+    IN UINT             uHeight
+    )
+{
+    DWORD dwSeed = BENCH_CORPUS_SEED;
+
+    dwSeed ^= (DWORD) content * 0x9E3779B9u;
+    dwSeed ^= (DWORD) uWidth  * 73856093u;
+    dwSeed ^= (DWORD) uHeight * 19349663u;
+
+    return (0 == dwSeed) ? BENCH_CORPUS_SEED : dwSeed;
+}
+
+static VOID
+FillRect(
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         uLeft,
+    IN UINT         uTop,
+    IN UINT         uRight,
+    IN UINT         uBottom,
+    IN DWORD        dwColor         /* 0xAARRGGBB, stored as BGRA */
+    )
+{
+    DWORD* pdwRow = NULL;
+    UINT   x      = 0;
+    UINT   y      = 0;
+
+    uRight  = min(uRight, pImageData->uWidth);
+    uBottom = min(uBottom, pImageData->uHeight);
+
+    for (y = uTop; y < uBottom; ++y)
+    {
+        pdwRow = (DWORD*) pImageData->abData + (SIZE_T) y * pImageData->uWidth;
+
+        for (x = uLeft; x < uRight; ++x)
+        {
+            pdwRow[x] = dwColor;
+        }
+    }
+}
+
+static VOID
+GenerateNoise(
+    IN     PWUIMAGEDATA pImageData,
+    IN OUT DWORD*       pdwState
+    )
+{
+    SIZE_T cPixels = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+    SIZE_T i       = 0;
+
+    for (i = 0; i < cPixels; ++i)
+    {
+        ((DWORD*) pImageData->abData)[i] = NextRandom(pdwState) | 0xFF000000;
+    }
+}
+
+/*
+    Value noise: random colors on a coarse lattice, interpolated
+    bilinearly, plus per-pixel grain. Compresses and filters like a photo
+    rather than like noise or flat UI.
+*/
+static BOOL
+GeneratePhoto(
+    IN     PWUIMAGEDATA pImageData,
+    IN OUT DWORD*       pdwState
+    )
+{
+    UINT        cLatticeX = pImageData->uWidth / PHOTO_CELL_SIZE + 2;
+    UINT        cLatticeY = pImageData->uHeight / PHOTO_CELL_SIZE + 2;
+    BYTE*       abLattice = NULL;
+    BYTE*       pbPixel   = NULL;
+    CONST BYTE* pb00      = NULL;
+    CONST BYTE* pb01      = NULL;
+    CONST BYTE* pb10      = NULL;
+    CONST BYTE* pb11      = NULL;
+    UINT        uFracX    = 0;
+    UINT        uFracY    = 0;
+    INT         iValue    = 0;
+    UINT        x         = 0;
+    UINT        y         = 0;
+    UINT        c         = 0;
+    SIZE_T      i         = 0;
+
+    abLattice = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) cLatticeX * cLatticeY * 3);
+
+    if (NULL == abLattice)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < (SIZE_T) cLatticeX * cLatticeY * 3; ++i)
+    {
+        abLattice[i] = (BYTE) NextRandom(pdwState);
+    }
+
+    for (y = 0; y < pImageData->uHeight; ++y)
+    {
+        uFracY  = y % PHOTO_CELL_SIZE;
+        pbPixel = pImageData->abData
+            + (SIZE_T) y * pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        for (x = 0; x < pImageData->uWidth; ++x, pbPixel += 4)
+        {
+            uFracX = x % PHOTO_CELL_SIZE;
+
+            pb00 = abLattice + ((SIZE_T) (y / PHOTO_CELL_SIZE) * cLatticeX
+                + x / PHOTO_CELL_SIZE) * 3;
+            pb01 = pb00 + 3;
+            pb10 = pb00 + (SIZE_T) cLatticeX * 3;
+            pb11 = pb10 + 3;
+
+            for (c = 0; c < 3; ++c)
+            {
+                iValue = (INT) (
+                    (pb00[c] * (PHOTO_CELL_SIZE - uFracX) + pb01[c] * uFracX)
+                        * (PHOTO_CELL_SIZE - uFracY)
+                    + (pb10[c] * (PHOTO_CELL_SIZE - uFracX) + pb11[c] * uFracX)
+                        * uFracY)
+                    / (PHOTO_CELL_SIZE * PHOTO_CELL_SIZE);
+
+                iValue += (INT) (NextRandom(pdwState) % (2 * PHOTO_GRAIN + 1))
+                    - PHOTO_GRAIN;
+
+                pbPixel[c] = (BYTE) max(0, min(255, iValue));
+            }
+
+            pbPixel[3] = 0xFF;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, abLattice);
+
+    return TRUE;
+}
+
+static VOID
+DrawTextRuns(
+    IN     PWUIMAGEDATA pImageData,
+    IN     UINT         uLeft,
+    IN     UINT         uTop,
+    IN     UINT         uRight,
+    IN     UINT         uBottom,
+    IN OUT DWORD*       pdwState
+    )
+{
+    UINT x       = 0;
+    UINT y       = 0;
+    UINT uGlyph  = 0;
+    UINT uStroke = 0;
+
+    for (y = uTop + 4; y + UI_GLYPH_HEIGHT < uBottom; y += UI_LINE_HEIGHT)
+    {
+        x = uLeft + 6;
+
+        while (x + 8 < uRight)
+        {
+            uGlyph = 4 + NextRandom(pdwState) % 5;
+
+            /* word gap */
+            if (NextRandom(pdwState) % 6 == 0)
+            {
+                x += uGlyph;
+                continue;
+            }
+
+            for (uStroke = 0; uStroke < uGlyph - 1; ++uStroke)
+            {
+                if (NextRandom(pdwState) & 1)
+                {
+                    FillRect(pImageData, x + uStroke, y,
+                        x + uStroke + 1, y + UI_GLYPH_HEIGHT, 0xFF202020);
+                }
+            }
+
+            FillRect(pImageData, x, y + NextRandom(pdwState) % UI_GLYPH_HEIGHT,
+                x + uGlyph - 1, y + UI_GLYPH_HEIGHT, 0xFF202020);
+
+            x += uGlyph;
+        }
+    }
+}
+
+/* Desktop-like content: overlapping windows with title bars and text */
+static VOID
+GenerateUi(
+    IN     PWUIMAGEDATA pImageData,
+    IN OUT DWORD*       pdwState
+    )
+{
+    UINT  cWindows = 0;
+    UINT  uLeft    = 0;
+    UINT  uTop     = 0;
+    UINT  uRight   = 0;
+    UINT  uBottom  = 0;
+    DWORD dwAccent = 0;
+    UINT  i        = 0;
+
+    FillRect(pImageData, 0, 0, pImageData->uWidth, pImageData->uHeight,
+        0xFF3A6EA5);
+
+    cWindows = (UINT) min(UI_MAX_WINDOWS,
+        (SIZE_T) pImageData->uWidth * pImageData->uHeight
+            / UI_PIXELS_PER_WINDOW + 1);
+
+    for (i = 0; i < cWindows; ++i)
+    {
+        uLeft   = NextRandom(pdwState) % pImageData->uWidth;
+        uTop    = NextRandom(pdwState) % pImageData->uHeight;
+        uRight  = uLeft + 48
+            + NextRandom(pdwState) % (pImageData->uWidth / 2 + 1);
+        uBottom = uTop + 48
+            + NextRandom(pdwState) % (pImageData->uHeight / 2 + 1);
+
+        dwAccent = g_adwUiPalette[NextRandom(pdwState) % UI_PALETTE_SIZE];
+
+        /* border, client area, title bar */
+        FillRect(pImageData, uLeft, uTop, uRight, uBottom, 0xFF808080);
+        FillRect(pImageData, uLeft + 1, uTop + 1, uRight - 1, uBottom - 1,
+            g_adwUiPalette[NextRandom(pdwState) % 2]);
+        FillRect(pImageData, uLeft + 1, uTop + 1, uRight - 1,
+            uTop + UI_TITLE_HEIGHT, dwAccent);
+
+        DrawTextRuns(
+            pImageData,
+            uLeft + 1,
+            uTop + UI_TITLE_HEIGHT,
+            min(uRight - 1, pImageData->uWidth),
+            min(uBottom - 1, pImageData->uHeight),
+            pdwState);
+    }
+}
+
+LPCSTR
+BenchGetContentName(
+    IN BENCH_CONTENT    content
+    )
+{
+    if (content >= BENCH_CONTENT_MAX)
+    {
+        return "unknown";
+    }
+
+    return g_aszContentNames[content];
+}
+
+PWUIMAGEDATA
+BenchGenerateImage(
+    IN BENCH_CONTENT    content,
+    IN UINT             uWidth,
+    IN UINT             uHeight
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    DWORD        dwState    = GetSeed(content, uWidth, uHeight);
+    BOOL         bResult    = TRUE;
+
+    pImageData = WuCreateEmptyImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    switch (content)
+    {
+        case BENCH_CONTENT_PHOTO:
+            bResult = GeneratePhoto(pImageData, &dwState);
+            break;
+
+        case BENCH_CONTENT_UI:
+            GenerateUi(pImageData, &dwState);
+            break;
+
+        case BENCH_CONTENT_NOISE:
+            GenerateNoise(pImageData, &dwState);
+            break;
+
+        default:
+            bResult = FALSE;
+            break;
+    }
+
+    if (FALSE == bResult)
+    {
+        WuDestroyImageData(pImageData);
+        return NULL;
+    }
+
+    return pImageData;
+}
@@ -0,0 +1,356 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       main.c
+ *
+ ***************************************************************************/
+
+/*
+    winutilz_bench [--quick] [--filter SUBSTRING] [--min-time MS]
+                   [--output FILE]
+
+    Runs every case on every corpus image and prints one JSON document.
+    Each case is repeated until it has run for --min-time milliseconds
+    (and at least MIN_RUNS times); the reported time is the median run.
+*/
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_RUNS                3
+#define MAX_RUNS                1000
+#define DEFAULT_MIN_TIME_MS     200
+
+#define QUICK_MAX_PIXELS        (1024 * 768)
+
+typedef struct tagBENCHSIZE {
+    UINT    uWidth;
+    UINT    uHeight;
+} BENCHSIZE;
+
+typedef struct tagBENCHOPTIONS {
+    BOOL        bQuick;
+    LPCSTR      szFilter;
+    ULONGLONG   uMinTimeNs;
+    LPCSTR      szOutputPath;
+} BENCHOPTIONS, *PBENCHOPTIONS;
+
+static CONST BENCHSIZE g_aSizes[] = {
+    {   64,   64 },
+    {  256,  256 },
+    { 1024,  768 },
+    { 1920, 1080 },
+    { 3840, 2160 },
+    { 7680, 4320 }
+};
+
+#define SIZE_COUNT  (sizeof(g_aSizes) / sizeof(g_aSizes[0]))
+
+static ULONGLONG g_auRunTimesNs[MAX_RUNS];
+
+static INT
+CompareRunTimes(
+    IN CONST VOID*  pLeft,
+    IN CONST VOID*  pRight
+    )
+{
+    ULONGLONG uLeft  = *(CONST ULONGLONG*) pLeft;
+    ULONGLONG uRight = *(CONST ULONGLONG*) pRight;
+
+    return (uLeft > uRight) - (uLeft < uRight);
+}
+
+static BOOL
+ParseOptions(
+    IN  INT             argc,
+    IN  CHAR**          argv,
+    OUT PBENCHOPTIONS   pOptions
+    )
+{
+    INT i = 0;
+
+    pOptions->bQuick       = FALSE;
+    pOptions->szFilter     = NULL;
+    pOptions->uMinTimeNs   = (ULONGLONG) DEFAULT_MIN_TIME_MS * 1000000;
+    pOptions->szOutputPath = NULL;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            pOptions->bQuick = TRUE;
+        }
+        else if ((strcmp(argv[i], "--filter") == 0) && (i + 1 < argc))
+        {
+            pOptions->szFilter = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--min-time") == 0) && (i + 1 < argc))
+        {
+            pOptions->uMinTimeNs = (ULONGLONG) strtoul(argv[++i], NULL, 10)
+                * 1000000;
+        }
+        else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            pOptions->szOutputPath = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr,
+                "usage: %s [--quick] [--filter SUBSTRING] [--min-time MS] "
+                "[--output FILE]\n", argv[0]);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+ResetWorkImage(
+    IN PBENCHCONTEXT    pContext
+    )
+{
+    CopyMemory(
+        pContext->pWork->abData,
+        pContext->pSource->abData,
+        (SIZE_T) pContext->pSource->uWidth * pContext->pSource->uHeight
+            * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+    return TRUE;
+}
+
+static BOOL
+RunCase(
+    IN     CONST BENCHCASE*     pCase,
+    IN     PBENCHCONTEXT        pContext,
+    IN     BENCH_CONTENT        content,
+    IN     CONST BENCHOPTIONS*  pOptions,
+    IN OUT FILE*                pOutput,
+    IN OUT BOOL*                pbFirstResult
+    )
+{
+    BENCHHEAPSTATS stats;
+    BOOL           bHeapStats = FALSE;
+    BOOL           bResult    = TRUE;
+    ULONGLONG      uStart     = 0;
+    ULONGLONG      uTotalNs   = 0;
+    ULONGLONG      uMedianNs  = 0;
+    UINT           cRuns      = 0;
+    DOUBLE         dbPixels   = 0.0;
+    DOUBLE         dbBytes    = 0.0;
+
+    ResetWorkImage(pContext);
+    pContext->pState = NULL;
+
+    if (pCase->pfnSetup != NULL)
+    {
+        bResult = pCase->pfnSetup(pContext);
+    }
+
+    /* warm-up: page in the buffers, build lazy tables */
+    if (TRUE == bResult)
+    {
+        bResult = pCase->pfnRun(pContext);
+    }
+
+    BenchResetHeapStats();
+
+    while ((TRUE == bResult) && (cRuns < MAX_RUNS)
+        && ((cRuns < MIN_RUNS) || (uTotalNs < pOptions->uMinTimeNs)))
+    {
+        uStart  = BenchGetTimeNs();
+        bResult = pCase->pfnRun(pContext);
+
+        g_auRunTimesNs[cRuns] = BenchGetTimeNs() - uStart;
+        uTotalNs += g_auRunTimesNs[cRuns++];
+    }
+
+    bHeapStats = BenchQueryHeapStats(&stats);
+
+    if (pCase->pfnTeardown != NULL)
+    {
+        pCase->pfnTeardown(pContext);
+    }
+
+    fprintf(pOutput, "%s\n    {\"case\": \"%s\", \"category\": \"%s\", "
+        "\"corpus\": \"%s\", \"width\": %u, \"height\": %u, ",
+        (TRUE == *pbFirstResult) ? "" : ",",
+        pCase->szName,
+        pCase->szCategory,
+        BenchGetContentName(content),
+        pContext->pSource->uWidth,
+        pContext->pSource->uHeight);
+
+    *pbFirstResult = FALSE;
+
+    if ((FALSE == bResult) || (0 == cRuns))
+    {
+        fprintf(pOutput, "\"ok\": false}");
+        fprintf(stderr, "%s on %s %ux%u failed\n", pCase->szName,
+            BenchGetContentName(content), pContext->pSource->uWidth,
+            pContext->pSource->uHeight);
+        return FALSE;
+    }
+
+    qsort(g_auRunTimesNs, cRuns, sizeof(ULONGLONG), CompareRunTimes);
+
+    uMedianNs = g_auRunTimesNs[cRuns / 2];
+    dbPixels  = (DOUBLE) pContext->pSource->uWidth
+        * pContext->pSource->uHeight;
+    dbBytes   = dbPixels * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    fprintf(pOutput, "\"ok\": true, \"runs\": %u, "
+        "\"ns_per_pixel\": %.4f, \"ns_per_pixel_min\": %.4f, "
+        "\"mb_per_s\": %.2f, ",
+        cRuns,
+        (DOUBLE) uMedianNs / dbPixels,
+        (DOUBLE) g_auRunTimesNs[0] / dbPixels,
+        (uMedianNs > 0) ? dbBytes * 1000.0 / (DOUBLE) uMedianNs : 0.0);
+
+    if (TRUE == bHeapStats)
+    {
+        fprintf(pOutput,
+            "\"allocs_per_run\": %.2f, \"peak_heap_bytes\": %lu, ",
+            (DOUBLE) stats.cAllocations / cRuns,
+            (unsigned long) stats.cbPeak);
+    }
+    else
+    {
+        fprintf(pOutput,
+            "\"allocs_per_run\": null, \"peak_heap_bytes\": null, ");
+    }
+
+    fprintf(pOutput, "\"peak_rss_kb\": %lu}",
+        (unsigned long) BenchGetPeakRssKb());
+
+    return TRUE;
+}
+
+static BOOL
+RunCorpusImage(
+    IN     BENCH_CONTENT        content,
+    IN     CONST BENCHSIZE*     pSize,
+    IN     CONST BENCHOPTIONS*  pOptions,
+    IN OUT FILE*                pOutput,
+    IN OUT BOOL*                pbFirstResult
+    )
+{
+    BENCHCONTEXT context;
+    BOOL         bResult = TRUE;
+    UINT         i       = 0;
+
+    ZeroMemory(&context, sizeof(context));
+
+    context.pSource = BenchGenerateImage(
+        content,
+        pSize->uWidth,
+        pSize->uHeight);
+
+    context.pWork = WuCreateEmptyImageData(pSize->uWidth, pSize->uHeight);
+
+    if ((NULL == context.pSource) || (NULL == context.pWork))
+    {
+        fprintf(stderr, "cannot generate the %s %ux%u corpus image\n",
+            BenchGetContentName(content), pSize->uWidth, pSize->uHeight);
+
+        WuDestroyImageData(context.pSource);
+        WuDestroyImageData(context.pWork);
+        return FALSE;
+    }
+
+    for (i = 0; i < g_cBenchCases; ++i)
+    {
+        if ((pOptions->szFilter != NULL)
+            && (strstr(g_aBenchCases[i].szName, pOptions->szFilter) == NULL))
+        {
+            continue;
+        }
+
+        fprintf(stderr, "%-28s %-6s %ux%u\n", g_aBenchCases[i].szName,
+            BenchGetContentName(content), pSize->uWidth, pSize->uHeight);
+
+        if (RunCase(&g_aBenchCases[i], &context, content, pOptions,
+                pOutput, pbFirstResult) == FALSE)
+        {
+            bResult = FALSE;
+        }
+    }
+
+    WuDestroyImageData(context.pSource);
+    WuDestroyImageData(context.pWork);
+
+    return bResult;
+}
+
+INT
+main(
+    INT     argc,
+    CHAR**  argv
+    )
+{
+    BENCHOPTIONS options;
+    FILE*        pOutput       = stdout;
+    BOOL         bFirstResult  = TRUE;
+    BOOL         bResult       = TRUE;
+    UINT         iSize         = 0;
+    UINT         iContent      = 0;
+
+    if (ParseOptions(argc, argv, &options) == FALSE)
+    {
+        return 2;
+    }
+
+    if (options.szOutputPath != NULL)
+    {
+        pOutput = fopen(options.szOutputPath, "w");
+
+        if (NULL == pOutput)
+        {
+            fprintf(stderr, "cannot open %s\n", options.szOutputPath);
+            return 2;
+        }
+    }
+
+    fprintf(pOutput, "{\n  \"schema\": 1,\n  \"platform\": \"%s\",\n"
+        "  \"corpus_seed\": %lu,\n  \"results\": [",
+#ifdef _WIN32
+        "windows",
+#else /* _WIN32 */
+        "compat",
+#endif /* _WIN32 */
+        (unsigned long) BENCH_CORPUS_SEED);
+
+    for (iSize = 0; iSize < SIZE_COUNT; ++iSize)
+    {
+        if ((TRUE == options.bQuick) && ((ULONGLONG) g_aSizes[iSize].uWidth
+                * g_aSizes[iSize].uHeight > QUICK_MAX_PIXELS))
+        {
+            break;
+        }
+
+        for (iContent = 0; iContent < BENCH_CONTENT_MAX; ++iContent)
+        {
+            if (RunCorpusImage((BENCH_CONTENT) iContent, &g_aSizes[iSize],
+                    &options, pOutput, &bFirstResult) == FALSE)
+            {
+                bResult = FALSE;
+            }
+        }
+    }
+
+    fprintf(pOutput, "\n  ]\n}\n");
+
+    if (pOutput != stdout)
+    {
+        fclose(pOutput);
+    }
+
+    return (TRUE == bResult) ? 0 : 1;
+}
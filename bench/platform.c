@@ -0,0 +1,121 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       platform.c
+ *
+ ***************************************************************************/
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200112L
+#endif /* _WIN32 */
+
+#include "bench.h"
+
+#ifdef _WIN32
+    #include <psapi.h>
+#else /* _WIN32 */
+    #include <time.h>
+    #include <sys/resource.h>
+#endif /* _WIN32 */
+
+#ifdef _WIN32
+
+ULONGLONG
+BenchGetTimeNs(
+    VOID
+    )
+{
+    static LARGE_INTEGER liFrequency;
+    LARGE_INTEGER        liCounter;
+
+    if (0 == liFrequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&liFrequency);
+    }
+
+    QueryPerformanceCounter(&liCounter);
+
+    /* split to avoid overflowing the multiplication */
+    return (ULONGLONG) (liCounter.QuadPart / liFrequency.QuadPart)
+            * 1000000000ULL
+        + (ULONGLONG) (liCounter.QuadPart % liFrequency.QuadPart)
+            * 1000000000ULL / liFrequency.QuadPart;
+}
+
+ULONGLONG
+BenchGetPeakRssKb(
+    VOID
+    )
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+
+    ZeroMemory(&pmc, sizeof(pmc));
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) == FALSE)
+    {
+        return 0;
+    }
+
+    return pmc.PeakWorkingSetSize / 1024;
+}
+
+/*
+    The library allocates from the process heap directly, which cannot be
+    hooked from the outside. Allocation counts are only available in the
+    compat build (see compat/compat.c).
+*/
+VOID
+BenchResetHeapStats(
+    VOID
+    )
+{
+}
+
+BOOL
+BenchQueryHeapStats(
+    OUT PBENCHHEAPSTATS pStats
+    )
+{
+    ZeroMemory(pStats, sizeof(BENCHHEAPSTATS));
+
+    return FALSE;
+}
+
+#else /* _WIN32 */
+
+ULONGLONG
+BenchGetTimeNs(
+    VOID
+    )
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ULONGLONG) ts.tv_sec * 1000000000ULL + (ULONGLONG) ts.tv_nsec;
+}
+
+ULONGLONG
+BenchGetPeakRssKb(
+    VOID
+    )
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    return (ULONGLONG) usage.ru_maxrss / 1024;    /* bytes on macOS */
+#else /* __APPLE__ */
+    return (ULONGLONG) usage.ru_maxrss;
+#endif /* __APPLE__ */
+}
+
+#endif /* _WIN32 */
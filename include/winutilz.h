@@ -235,6 +235,16 @@ WuSaveImageDataToFileA(
     #define WuSaveImageDataToFile WuSaveImageDataToFileA
 #endif /* UNICODE */
 
+/*
+    Encodes into a moveable block of exactly the encoded size, as clipboard
+    formats expect. Free it with GlobalFree unless it is handed over.
+*/
+WUAPI HGLOBAL
+WuSaveImageDataToHGlobal(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_FORMAT      format
+    );
+
 WUAPI PWUIMAGEDATA
 WuLoadImageDataFromFileW(
     IN LPCWSTR  szFilePath
@@ -251,6 +261,34 @@ WuLoadImageDataFromFileA(
     #define WuLoadImageDataFromFile WuLoadImageDataFromFileA
 #endif /* UNICODE */
 
+#define WU_IMAGE_LOAD_APPLY_ORIENTATION 0x00000001  /* EXIF Orientation */
+
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileExW(
+    IN LPCWSTR  szFilePath,
+    IN DWORD    dwFlags
+    );
+
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileExA(
+    IN LPCSTR   szFilePath,
+    IN DWORD    dwFlags
+    );
+
+#ifdef UNICODE
+    #define WuLoadImageDataFromFileEx WuLoadImageDataFromFileExW
+#else /* UNICODE */
+    #define WuLoadImageDataFromFileEx WuLoadImageDataFromFileExA
+#endif /* UNICODE */
+
+/* Decodes an encoded image (any WIC format) held in memory */
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromMemory(
+    IN CONST BYTE*  pbData,
+    IN SIZE_T       cbData,
+    IN DWORD        dwFlags
+    );
+
 WUAPI VOID
 WuDestroyImageData(
     IN PWUIMAGEDATA pImageData
@@ -277,7 +315,8 @@ WuImageDataSetPixel(
     }
 
     pbPixel = pImageData->abData
-        + ((y * pImageData->uWidth + x) * WU_IMAGEDATA_BYTES_PER_PIXEL);
+        + (((SIZE_T) y * pImageData->uWidth + x)
+            * WU_IMAGEDATA_BYTES_PER_PIXEL);
 
     pbPixel[0] = WuGetColorB(color);
     pbPixel[1] = WuGetColorG(color);
@@ -305,71 +344,1472 @@ WuImageDataGetPixel(
     }
 
     pbPixel = pImageData->abData
-        + ((y * pImageData->uWidth + x) * WU_IMAGEDATA_BYTES_PER_PIXEL);
+        + (((SIZE_T) y * pImageData->uWidth + x)
+            * WU_IMAGEDATA_BYTES_PER_PIXEL);
 
     return WU_RGBA(pbPixel[2], pbPixel[1], pbPixel[0], pbPixel[3]);
 }
 
 /***************************************************************************
- *  capture.c
+ *  transform.c
  ***************************************************************************/
 
+typedef enum {
+    WU_IMAGE_ROTATE_90      = 0x0,      /* clockwise */
+    WU_IMAGE_ROTATE_180     = 0x1,
+    WU_IMAGE_ROTATE_270     = 0x2
+} WU_IMAGE_ROTATION;
+
+typedef enum {
+    WU_IMAGE_FLIP_HORIZONTAL    = 0x0,
+    WU_IMAGE_FLIP_VERTICAL      = 0x1
+} WU_IMAGE_FLIP;
+
 WUAPI PWUIMAGEDATA
-WuCaptureScreen(
-    VOID
+WuRotateImageData(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_ROTATION    rotation
+    );
+
+/*
+    Never reallocates abData, so it also works on views, capture frames
+    and pyramid levels. A quarter turn of a non-square image would change
+    its size and fails; use WuRotateImageData for it.
+*/
+WUAPI BOOL
+WuRotateImageDataInPlace(
+    IN PWUIMAGEDATA         pImageData,
+    IN WU_IMAGE_ROTATION    rotation
     );
 
 WUAPI PWUIMAGEDATA
-WuCaptureWindow(
-    IN HWND hWnd
+WuFlipImageData(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_FLIP        flip
+    );
+
+WUAPI BOOL
+WuFlipImageDataInPlace(
+    IN PWUIMAGEDATA     pImageData,
+    IN WU_IMAGE_FLIP    flip
     );
 
 /***************************************************************************
- *  clipboard.c
+ *  color.c
  ***************************************************************************/
 
+typedef enum {
+    WU_LUMA_BT601   = 0x0,
+    WU_LUMA_BT709   = 0x1
+} WU_LUMA_STANDARD;
+
+/* Kernels taking dwFlags do their maths on linear light instead of sRGB */
+#define WU_COLOR_LINEAR_LIGHT   0x00000001
+
+WUAPI FLOAT
+WuSrgbToLinear(
+    IN BYTE bSrgb
+    );
+
+WUAPI BYTE
+WuLinearToSrgb(
+    IN FLOAT    fLinear
+    );
+
 WUAPI BOOL
-WuSetClipboardTextW(
-    IN LPCWSTR  szClipboardText
+WuConvertImageDataToGrayscale(
+    IN PWUIMAGEDATA     pImageData,
+    IN WU_LUMA_STANDARD standard,
+    IN DWORD            dwFlags
     );
 
 WUAPI BOOL
-WuSetClipboardTextA(
-    IN LPCSTR   szClipboardText
+WuImageDataToYCbCr(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  WU_LUMA_STANDARD    standard,
+    OUT BYTE*               abY,
+    OUT BYTE*               abCb,
+    OUT BYTE*               abCr
     );
 
-#ifdef UNICODE
-    #define WuSetClipboardText WuSetClipboardTextW
-#else /* UNICODE */
-    #define WuSetClipboardText WuSetClipboardTextA
-#endif /* UNICODE */
+WUAPI PWUIMAGEDATA
+WuImageDataFromYCbCr(
+    IN CONST BYTE*      abY,
+    IN CONST BYTE*      abCb,
+    IN CONST BYTE*      abCr,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN WU_LUMA_STANDARD standard
+    );
+
+/***************************************************************************
+ *  pyramid.c
+ ***************************************************************************/
+
+#define WU_IMAGE_PYRAMID_MAX_LEVELS 32
+
+typedef enum {
+    WU_PYRAMID_FILTER_BOX       = 0x0,  /* 2x2 average                  */
+    WU_PYRAMID_FILTER_KAISER    = 0x1   /* 6-tap Kaiser-windowed sinc   */
+} WU_PYRAMID_FILTER;
+
+/*
+    aLevels[0] is a view of the source image, which must outlive the
+    pyramid. Levels 1..cLevels-1 halve the previous level (rounding up)
+    and all live in the single abData allocation.
+*/
+typedef struct tagWUIMAGEPYRAMID {
+    UINT        cLevels;
+    WUIMAGEDATA aLevels[WU_IMAGE_PYRAMID_MAX_LEVELS];
+    BYTE*       abData;
+} WUIMAGEPYRAMID, *PWUIMAGEPYRAMID;
+
+WUAPI PWUIMAGEPYRAMID
+WuBuildImagePyramid(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_PYRAMID_FILTER    filter,
+    IN UINT                 uMaxLevels,
+    IN DWORD                dwFlags
+    );
+
+/* Smallest level that is at least uMinWidth x uMinHeight (not a copy) */
+WUAPI PWUIMAGEDATA
+WuImagePyramidGetLevel(
+    IN PWUIMAGEPYRAMID  pPyramid,
+    IN UINT             uMinWidth,
+    IN UINT             uMinHeight
+    );
+
+WUAPI VOID
+WuDestroyImagePyramid(
+    IN PWUIMAGEPYRAMID  pPyramid
+    );
+
+/***************************************************************************
+ *  imagehandle.c
+ ***************************************************************************/
+
+/*
+    Reference-counted image. WuShareImageHandle hands out another handle to
+    the same pixels without copying them; the first handle to ask for
+    writable data gets a private copy if the pixels are still shared.
+
+    The PWUIMAGEDATA returned by the getters stays owned by the handle:
+    pass it to any function taking PWUIMAGEDATA, but never to
+    WuDestroyImageData. Data returned by WuImageHandleGetData or
+    WuLockImageHandleData must not be modified.
+
+    All functions may be called concurrently, on the same handle too, but
+    WuImageHandleGetData returns a bare pointer: a copy-on-write of the
+    handle followed by the release of the other handles sharing the pixels
+    frees them. If another thread may write through or release a handle
+    sharing the pixels, read them between WuLockImageHandleData and
+    WuUnlockImageHandleData instead, which keeps them alive and unchanged.
+    Locks nest; unlock with the pointer the lock returned, before the
+    handle is released.
+
+    Writes through WuImageHandleGetWritableData must be finished before
+    the handle is shared again, as the new handle would see them.
+*/
+typedef struct tagWUIMAGEHANDLE* HWUIMAGE;
+
+/* Takes ownership of pImageData on success */
+WUAPI HWUIMAGE
+WuCreateImageHandle(
+    IN PWUIMAGEDATA pImageData
+    );
+
+WUAPI HWUIMAGE
+WuRetainImageHandle(
+    IN HWUIMAGE hImage
+    );
+
+WUAPI VOID
+WuReleaseImageHandle(
+    IN HWUIMAGE hImage
+    );
+
+WUAPI HWUIMAGE
+WuShareImageHandle(
+    IN HWUIMAGE hImage
+    );
+
+WUAPI PWUIMAGEDATA
+WuImageHandleGetData(
+    IN HWUIMAGE hImage
+    );
+
+WUAPI PWUIMAGEDATA
+WuLockImageHandleData(
+    IN HWUIMAGE hImage
+    );
+
+WUAPI VOID
+WuUnlockImageHandleData(
+    IN HWUIMAGE             hImage,
+    IN CONST PWUIMAGEDATA   pImageData
+    );
+
+WUAPI PWUIMAGEDATA
+WuImageHandleGetWritableData(
+    IN HWUIMAGE hImage
+    );
+
+/***************************************************************************
+ *  tiled.c
+ ***************************************************************************/
+
+/*
+    Out-of-core image. The pixels live in a temporary file split into
+    WU_TILED_IMAGE_TILE_SIZE square tiles; only cMaxResidentTiles tiles
+    (0 for the default) are kept in memory and the least recently used one
+    is paged out when another tile is needed.
+
+    A locked tile is a regular WUIMAGEDATA whose size is the tile size
+    clipped to the image edge. It stays valid until it is unlocked.
+*/
+typedef struct tagWUTILEDIMAGE* PWUTILEDIMAGE;
+
+#define WU_TILED_IMAGE_TILE_SIZE    256
+
+#define WU_TILE_LOCK_WRITE          0x00000001
+
+WUAPI PWUTILEDIMAGE
+WuCreateTiledImage(
+    IN UINT uWidth,
+    IN UINT uHeight,
+    IN UINT cMaxResidentTiles
+    );
+
+WUAPI VOID
+WuTiledImageGetSize(
+    IN  PWUTILEDIMAGE   pTiledImage,
+    OUT PUINT           puWidth,
+    OUT PUINT           puHeight
+    );
+
+WUAPI PWUIMAGEDATA
+WuTiledImageLockTile(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN UINT             uTileX,
+    IN UINT             uTileY,
+    IN DWORD            dwFlags
+    );
+
+WUAPI VOID
+WuTiledImageUnlockTile(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN UINT             uTileX,
+    IN UINT             uTileY
+    );
 
 WUAPI BOOL
-WuGetClipboardTextW(
-    OUT LPWSTR  szClipboardText,
-    IN  ULONG   cchClipboardText
+WuTiledImageReadRect(
+    IN  PWUTILEDIMAGE   pTiledImage,
+    IN  UINT            uX,
+    IN  UINT            uY,
+    OUT PWUIMAGEDATA    pImageData
     );
 
 WUAPI BOOL
-WuGetClipboardTextA(
-    OUT LPSTR   szClipboardText,
-    IN  ULONG   cchClipboardText
+WuTiledImageWriteRect(
+    IN PWUTILEDIMAGE        pTiledImage,
+    IN UINT                 uX,
+    IN UINT                 uY,
+    IN CONST PWUIMAGEDATA   pImageData
     );
 
-#ifdef UNICODE
-    #define WuGetClipboardText WuGetClipboardTextW
-#else /* UNICODE */
-    #define WuGetClipboardText WuGetClipboardTextA
-#endif /* UNICODE */
+/* Writes every modified resident tile back to the file */
+WUAPI BOOL
+WuTiledImageFlush(
+    IN PWUTILEDIMAGE    pTiledImage
+    );
+
+WUAPI VOID
+WuDestroyTiledImage(
+    IN PWUTILEDIMAGE    pTiledImage
+    );
+
+/***************************************************************************
+ *  pipeline.c
+ ***************************************************************************/
+
+/*
+    Lazy chain of image operations. The Wu*Pipeline* calls only record the
+    operations; WuExecuteImagePipeline evaluates the whole chain tile by
+    tile, fusing consecutive per-pixel operations into a single pass, and
+    returns a new image (the source is left untouched and must stay alive
+    until the pipeline is executed).
+*/
+typedef struct tagWUIMAGEPIPELINE* PWUIMAGEPIPELINE;
+
+#define WU_IMAGE_PIPELINE_MAX_STAGES    32
+
+/* Per-pixel operation on cPixels BGRA pixels starting at (uX, uY) */
+typedef VOID (*WUPIXELROWPROC)(
+    BYTE*   pbPixels,
+    UINT    cPixels,
+    UINT    uX,
+    UINT    uY,
+    LPVOID  pUserData);
+
+WUAPI PWUIMAGEPIPELINE
+WuCreateImagePipeline(
+    IN CONST PWUIMAGEDATA   pSource
+    );
 
+/* Bilinear */
 WUAPI BOOL
-WuSetClipboardImageData(
-    IN PWUIMAGEDATA pImageData
+WuPipelineResize(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             uWidth,
+    IN UINT             uHeight
     );
 
 WUAPI BOOL
-WuGetClipboardImageData(
-    IN PWUIMAGEDATA*    ppImageData
+WuPipelineBoxBlur(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             uRadius
+    );
+
+WUAPI BOOL
+WuPipelineGrayscale(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN WU_LUMA_STANDARD standard,
+    IN DWORD            dwFlags
+    );
+
+WUAPI BOOL
+WuPipelineInvert(
+    IN PWUIMAGEPIPELINE pPipeline
+    );
+
+/* 4x4 ordered dither of each color channel to black or white */
+WUAPI BOOL
+WuPipelineDither(
+    IN PWUIMAGEPIPELINE pPipeline
+    );
+
+WUAPI BOOL
+WuPipelinePixelRowProc(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN WUPIXELROWPROC   fnPixelRowProc,
+    IN LPVOID           pUserData
+    );
+
+WUAPI PWUIMAGEDATA
+WuExecuteImagePipeline(
+    IN PWUIMAGEPIPELINE pPipeline
+    );
+
+WUAPI VOID
+WuDestroyImagePipeline(
+    IN PWUIMAGEPIPELINE pPipeline
+    );
+
+/***************************************************************************
+ *  search.c
+ ***************************************************************************/
+
+typedef enum {
+    WU_MATCH_SAD    = 0x0,  /* mean absolute difference, 0 is exact   */
+    WU_MATCH_SSD    = 0x1,  /* mean squared difference, 0 is exact    */
+    WU_MATCH_NCC    = 0x2   /* normalized cross-correlation, 1 is best */
+} WU_MATCH_METRIC;
+
+/* Ignore needle pixels whose alpha is below 128 */
+#define WU_FIND_USE_ALPHA   0x00000001
+
+typedef struct tagWUIMAGEMATCH {
+    UINT    x;
+    UINT    y;
+    FLOAT   fScore;
+} WUIMAGEMATCH, *PWUIMAGEMATCH;
+
+/*
+    Finds up to cMaxMatches non-overlapping occurrences of pNeedle in
+    pHaystack, best first, and returns how many were found. Only matches
+    with a score at or below fThreshold (SAD, SSD) or at or above it (NCC)
+    are returned. abMask is optional and holds one byte per needle pixel,
+    zero to ignore that pixel. The search runs coarse-to-fine on image
+    pyramids, so very small or noisy needles may be missed.
+*/
+WUAPI UINT
+WuFindImageData(
+    IN  CONST PWUIMAGEDATA  pHaystack,
+    IN  CONST PWUIMAGEDATA  pNeedle,
+    IN  CONST BYTE*         abMask,
+    IN  WU_MATCH_METRIC     metric,
+    IN  FLOAT               fThreshold,
+    IN  DWORD               dwFlags,
+    OUT PWUIMAGEMATCH       aMatches,
+    IN  UINT                cMaxMatches
+    );
+
+/***************************************************************************
+ *  integral.c
+ ***************************************************************************/
+
+/* Per-channel values, in the byte order of WUIMAGEDATA */
+typedef struct tagWUCOLORF {
+    FLOAT   fB;
+    FLOAT   fG;
+    FLOAT   fR;
+    FLOAT   fA;
+} WUCOLORF, *PWUCOLORF;
+
+/*
+    Summed-area tables of an image for constant-time region statistics.
+    The image is not referenced after WuBuildIntegralImage returns.
+*/
+typedef struct tagWUINTEGRALIMAGE* PWUINTEGRALIMAGE;
+
+/* Also build squared-sum tables (needed by WuRegionVariance) */
+#define WU_INTEGRAL_SQUARED 0x00000001
+
+WUAPI PWUINTEGRALIMAGE
+WuBuildIntegralImage(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN DWORD                dwFlags
+    );
+
+WUAPI BOOL
+WuRegionMean(
+    IN  CONST PWUINTEGRALIMAGE  pIntegral,
+    IN  UINT                    uX,
+    IN  UINT                    uY,
+    IN  UINT                    uWidth,
+    IN  UINT                    uHeight,
+    OUT PWUCOLORF               pMean
+    );
+
+/* A variance of zero on every channel means the region is a flat color */
+WUAPI BOOL
+WuRegionVariance(
+    IN  CONST PWUINTEGRALIMAGE  pIntegral,
+    IN  UINT                    uX,
+    IN  UINT                    uY,
+    IN  UINT                    uWidth,
+    IN  UINT                    uHeight,
+    OUT PWUCOLORF               pVariance
+    );
+
+WUAPI VOID
+WuDestroyIntegralImage(
+    IN PWUINTEGRALIMAGE pIntegral
+    );
+
+/***************************************************************************
+ *  histogram.c
+ ***************************************************************************/
+
+#define WU_HISTOGRAM_BINS   256
+
+/* Also fill adwLuma (dwFlags may add WU_COLOR_LINEAR_LIGHT) */
+#define WU_HISTOGRAM_LUMA   0x00000002
+
+typedef struct tagWUHISTOGRAM {
+    DWORD   adwB[WU_HISTOGRAM_BINS];
+    DWORD   adwG[WU_HISTOGRAM_BINS];
+    DWORD   adwR[WU_HISTOGRAM_BINS];
+    DWORD   adwA[WU_HISTOGRAM_BINS];
+    DWORD   adwLuma[WU_HISTOGRAM_BINS];
+    DWORD   cPixels;                /* pixels counted */
+} WUHISTOGRAM, *PWUHISTOGRAM;
+
+/*
+    abMask is optional and holds one byte per pixel, zero to leave that
+    pixel out. standard is only used with WU_HISTOGRAM_LUMA.
+*/
+WUAPI BOOL
+WuImageHistogram(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  CONST BYTE*         abMask,
+    IN  WU_LUMA_STANDARD    standard,
+    IN  DWORD               dwFlags,
+    OUT PWUHISTOGRAM        pHistogram
+    );
+
+/* Per-channel minimum, maximum and mean; any output may be NULL */
+WUAPI BOOL
+WuHistogramGetStats(
+    IN  CONST PWUHISTOGRAM  pHistogram,
+    OUT WUCOLOR*            pMin,
+    OUT WUCOLOR*            pMax,
+    OUT PWUCOLORF           pMean
+    );
+
+/* Most frequent color, e.g. for WuSetWallpaperBackgroundColor */
+WUAPI BOOL
+WuImageDominantColor(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  CONST BYTE*         abMask,
+    OUT WUCOLOR*            pColor
+    );
+
+/***************************************************************************
+ *  draw.c
+ ***************************************************************************/
+
+/*
+    Coordinates are in pixels, pixel (x, y) spans [x, x + 1) x [y, y + 1).
+    Edges are anti-aliased and the color is blended source-over using its
+    alpha. Self-overlapping polygons are filled as their union.
+*/
+typedef struct tagWUPOINTF {
+    FLOAT   x;
+    FLOAT   y;
+} WUPOINTF, *PWUPOINTF;
+
+WUAPI BOOL
+WuFillPolygon(
+    IN PWUIMAGEDATA     pImageData,
+    IN CONST WUPOINTF*  aPoints,
+    IN UINT             cPoints,
+    IN WUCOLOR          color
+    );
+
+WUAPI BOOL
+WuFillRectangle(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX,
+    IN FLOAT        fY,
+    IN FLOAT        fWidth,
+    IN FLOAT        fHeight,
+    IN WUCOLOR      color
+    );
+
+/* The frame is drawn inside the rectangle */
+WUAPI BOOL
+WuDrawRectangle(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX,
+    IN FLOAT        fY,
+    IN FLOAT        fWidth,
+    IN FLOAT        fHeight,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    );
+
+WUAPI BOOL
+WuFillEllipse(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fCenterX,
+    IN FLOAT        fCenterY,
+    IN FLOAT        fRadiusX,
+    IN FLOAT        fRadiusY,
+    IN WUCOLOR      color
+    );
+
+/* The outline is centered on the ellipse */
+WUAPI BOOL
+WuDrawEllipse(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fCenterX,
+    IN FLOAT        fCenterY,
+    IN FLOAT        fRadiusX,
+    IN FLOAT        fRadiusY,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    );
+
+/* Lines have square caps */
+WUAPI BOOL
+WuDrawLine(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX0,
+    IN FLOAT        fY0,
+    IN FLOAT        fX1,
+    IN FLOAT        fY1,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    );
+
+WUAPI BOOL
+WuDrawPolyline(
+    IN PWUIMAGEDATA     pImageData,
+    IN CONST WUPOINTF*  aPoints,
+    IN UINT             cPoints,
+    IN BOOL             bClosed,
+    IN FLOAT            fLineWidth,
+    IN WUCOLOR          color
+    );
+
+/***************************************************************************
+ *  mask.c
+ ***************************************************************************/
+
+/*
+    A mask holds one byte per pixel, 0 or 0xFF, with cbStride == uWidth,
+    so it can be passed as abMask to WuImageHistogram or WuFindImageData.
+    With WU_MASK_PACKED every row holds one bit per pixel instead: pixel
+    x is bit (x % 8) of byte x / 8. Kernels work on BT.601 luma.
+*/
+#define WU_MASK_PACKED          0x00000001
+
+typedef struct tagWUIMAGEMASK {
+    BYTE*   abData;
+    UINT    uWidth;
+    UINT    uHeight;
+    UINT    cbStride;               /* bytes per row */
+    DWORD   dwFlags;                /* WU_MASK_PACKED or 0 */
+} WUIMAGEMASK, *PWUIMAGEMASK;
+
+WUAPI PWUIMAGEMASK
+WuCreateImageMask(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwFlags
+    );
+
+WUAPI VOID
+WuDestroyImageMask(
+    IN PWUIMAGEMASK pMask
+    );
+
+static WU_INLINE BOOL
+WuImageMaskGetPixel(
+    IN CONST PWUIMAGEMASK   pMask,
+    IN UINT                 x,
+    IN UINT                 y
+    )
+{
+    CONST BYTE* pbRow = NULL;
+
+    if (pMask == NULL || pMask->abData == NULL)
+    {
+        return FALSE;
+    }
+
+    if (x >= pMask->uWidth || y >= pMask->uHeight)
+    {
+        return FALSE;
+    }
+
+    pbRow = pMask->abData + (SIZE_T) y * pMask->cbStride;
+
+    if (pMask->dwFlags & WU_MASK_PACKED)
+    {
+        return (pbRow[x / 8] >> (x % 8)) & 1;
+    }
+
+    return pbRow[x] != 0;
+}
+
+typedef enum {
+    WU_GRADIENT_SOBEL   = 0x0,
+    WU_GRADIENT_SCHARR  = 0x1
+} WU_GRADIENT_OPERATOR;
+
+/*
+    |gx| + |gy| of the luma, one byte per pixel into abMagnitude (uWidth *
+    uHeight bytes), scaled so that a black to white step gives 255.
+*/
+WUAPI BOOL
+WuImageGradient(
+    IN  CONST PWUIMAGEDATA      pImageData,
+    IN  WU_GRADIENT_OPERATOR    op,
+    OUT BYTE*                   abMagnitude
+    );
+
+/* Pixels whose gradient magnitude is above bThreshold */
+WUAPI PWUIMAGEMASK
+WuDetectEdges(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_GRADIENT_OPERATOR op,
+    IN BYTE                 bThreshold,
+    IN DWORD                dwFlags
+    );
+
+#define WU_THRESHOLD_OTSU       0x00000002  /* bLevel from WuOtsuThreshold */
+#define WU_THRESHOLD_INVERT     0x00000004  /* set the pixels not above */
+
+/* Level in [0, 255] that best splits the bins (e.g. WUHISTOGRAM adwLuma) */
+WUAPI BYTE
+WuOtsuThreshold(
+    IN CONST DWORD  adwBins[WU_HISTOGRAM_BINS]
+    );
+
+/* Pixels whose luma is above bLevel */
+WUAPI PWUIMAGEMASK
+WuThresholdImage(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN BYTE                 bLevel,
+    IN DWORD                dwFlags
+    );
+
+/*
+    Pixels whose luma is above the mean of the surrounding (2 * uRadius
+    + 1) square, minus iOffset. The cost does not depend on uRadius.
+*/
+WUAPI PWUIMAGEMASK
+WuAdaptiveThreshold(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN UINT                 uRadius,
+    IN INT                  iOffset,
+    IN DWORD                dwFlags
+    );
+
+typedef enum {
+    WU_MORPH_ERODE      = 0x0,
+    WU_MORPH_DILATE     = 0x1,
+    WU_MORPH_OPEN       = 0x2,      /* erode, then dilate */
+    WU_MORPH_CLOSE      = 0x3       /* dilate, then erode */
+} WU_MORPH_OPERATION;
+
+/*
+    In place, with a (2 * uRadiusX + 1) x (2 * uRadiusY + 1) rectangle.
+    The cost does not depend on the size of the rectangle.
+*/
+WUAPI BOOL
+WuMorphImageMask(
+    IN OUT PWUIMAGEMASK         pMask,
+    IN     WU_MORPH_OPERATION   operation,
+    IN     UINT                 uRadiusX,
+    IN     UINT                 uRadiusY
+    );
+
+/***************************************************************************
+ *  components.c
+ ***************************************************************************/
+
+/* Diagonal neighbours are connected too (default: 4-connectivity) */
+#define WU_CONNECTIVITY_8       0x00000008
+
+/*
+    Pixels connected to (uX, uY) whose channels all lie within bTolerance
+    of it. dwFlags may add WU_MASK_PACKED.
+*/
+WUAPI PWUIMAGEMASK
+WuFloodSelect(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN UINT                 uX,
+    IN UINT                 uY,
+    IN BYTE                 bTolerance,
+    IN DWORD                dwFlags
+    );
+
+/* Bucket fill: sets the pixels WuFloodSelect would select to color */
+WUAPI BOOL
+WuFloodFill(
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN BYTE         bTolerance,
+    IN DWORD        dwFlags,
+    IN WUCOLOR      color
+    );
+
+typedef struct tagWUCOMPONENT {
+    UINT    uX;                     /* bounding box */
+    UINT    uY;
+    UINT    uWidth;
+    UINT    uHeight;
+    DWORD   cPixels;
+    FLOAT   fCentroidX;
+    FLOAT   fCentroidY;
+} WUCOMPONENT, *PWUCOMPONENT;
+
+/*
+    Labels the set pixels of pMask. Components are numbered from 1 in the
+    raster order of their first pixel and *pcComponents receives their
+    count; adwLabels (optional, uWidth * uHeight) receives the label of
+    every pixel, 0 for clear ones. The first cMaxComponents components are
+    described in aComponents, aComponents[i] being label i + 1.
+*/
+WUAPI BOOL
+WuLabelComponents(
+    IN  CONST PWUIMAGEMASK  pMask,
+    IN  DWORD               dwFlags,
+    OUT DWORD*              adwLabels,
+    OUT PWUCOMPONENT        aComponents,
+    IN  UINT                cMaxComponents,
+    OUT UINT*               pcComponents
+    );
+
+/***************************************************************************
+ *  colorlut.c
+ ***************************************************************************/
+
+/*
+    3D color lookup table for grading. The lattice holds cSize^3 RGB
+    triplets with red moving fastest (the .cube order), 0..1 mapping to
+    0..255; values outside that range are clamped on output. Alpha is
+    never changed.
+*/
+typedef struct tagWUCOLORLUT* PWUCOLORLUT;
+
+#define WU_COLOR_LUT_MIN_SIZE       2
+#define WU_COLOR_LUT_MAX_SIZE       256
+
+/* A full 8-bit table has 2^24 entries (64 MB) */
+#define WU_COLOR_LUT_MIN_TABLE_BITS 4
+#define WU_COLOR_LUT_MAX_TABLE_BITS 8
+
+typedef enum {
+    WU_LUT_INTERPOLATION_TRILINEAR   = 0x0,
+    WU_LUT_INTERPOLATION_TETRAHEDRAL = 0x1
+} WU_LUT_INTERPOLATION;
+
+/*
+    afDomainMin and afDomainMax (R, G, B, optional) give the input values
+    mapped to the first and last lattice points, 0 and 1 by default.
+*/
+WUAPI PWUCOLORLUT
+WuCreateColorLut(
+    IN UINT         cSize,
+    IN CONST FLOAT* afTable,
+    IN CONST FLOAT* afDomainMin,
+    IN CONST FLOAT* afDomainMax
+    );
+
+/*
+    Evaluates the LUT once for every input color quantized to cBits per
+    channel, so that WuApplyColorLut with the same interpolation becomes a
+    single table lookup per pixel. Below 8 bits every channel is rounded
+    to the center of its 2^(8 - cBits) wide step. cBits 0 frees the table.
+    Not safe to call while the LUT is being applied.
+*/
+WUAPI BOOL
+WuPrecomputeColorLut(
+    IN PWUCOLORLUT          pLut,
+    IN WU_LUT_INTERPOLATION interpolation,
+    IN UINT                 cBits
+    );
+
+WUAPI BOOL
+WuApplyColorLut(
+    IN PWUIMAGEDATA         pImageData,
+    IN CONST PWUCOLORLUT    pLut,
+    IN WU_LUT_INTERPOLATION interpolation
+    );
+
+WUAPI VOID
+WuDestroyColorLut(
+    IN PWUCOLORLUT  pLut
+    );
+
+/***************************************************************************
+ *  cube.c
+ ***************************************************************************/
+
+/*
+    Adobe/Resolve .cube text: LUT_3D_SIZE, DOMAIN_MIN, DOMAIN_MAX and
+    LUT_3D_INPUT_RANGE are honoured, TITLE and unknown keywords ignored.
+    1D LUTs are rejected. szCube does not need to be null-terminated.
+*/
+WUAPI PWUCOLORLUT
+WuCreateColorLutFromCube(
+    IN LPCSTR   szCube,
+    IN SIZE_T   cchCube
+    );
+
+WUAPI PWUCOLORLUT
+WuLoadColorLutFromFileW(
+    IN LPCWSTR  szFilePath
+    );
+
+WUAPI PWUCOLORLUT
+WuLoadColorLutFromFileA(
+    IN LPCSTR   szFilePath
+    );
+
+#ifdef UNICODE
+    #define WuLoadColorLutFromFile WuLoadColorLutFromFileW
+#else /* UNICODE */
+    #define WuLoadColorLutFromFile WuLoadColorLutFromFileA
+#endif /* UNICODE */
+
+/***************************************************************************
+ *  crop.c
+ ***************************************************************************/
+
+/*
+    Rectangle of an image used in place: rows are cbStride bytes apart in
+    the parent, which must outlive the view. Pass the view where a copy
+    is needed through WuCopyImageView.
+*/
+typedef struct tagWUIMAGEVIEW {
+    BYTE*   abData;                 /* top-left pixel, BGRA order */
+    UINT    uWidth;
+    UINT    uHeight;
+    UINT    cbStride;               /* bytes per row */
+} WUIMAGEVIEW, *PWUIMAGEVIEW;
+
+/* Background is any pixel whose alpha is at most bTolerance */
+#define WU_CONTENT_TRANSPARENT          0x00000001
+
+/* Background is the color of the top-left pixel, background is ignored */
+#define WU_CONTENT_CORNER_BACKGROUND    0x00000002
+
+/*
+    Tight bounding box of the pixels that differ from the background by
+    more than bTolerance on any channel (window shadows, uniform borders).
+    An image made only of background gives an empty box.
+*/
+WUAPI BOOL
+WuImageContentBounds(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  WUCOLOR             background,
+    IN  BYTE                bTolerance,
+    IN  DWORD               dwFlags,
+    OUT PUINT               puX,
+    OUT PUINT               puY,
+    OUT PUINT               puWidth,
+    OUT PUINT               puHeight
+    );
+
+WUAPI BOOL
+WuGetImageView(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  UINT                uX,
+    IN  UINT                uY,
+    IN  UINT                uWidth,
+    IN  UINT                uHeight,
+    OUT PWUIMAGEVIEW        pView
+    );
+
+WUAPI PWUIMAGEDATA
+WuCopyImageView(
+    IN CONST PWUIMAGEVIEW   pView
+    );
+
+/***************************************************************************
+ *  delta.c
+ ***************************************************************************/
+
+/*
+    Change tracking between consecutive frames of the same source, e.g.
+    frames of a WuCreateCaptureSession. Frames are cut into square tiles
+    that are hashed (64-bit) and compared with the previous frame's; runs
+    of changed tiles are merged into rectangles and only their pixels are
+    copied out. The first frame, a frame of another size, or a frame
+    compared with WU_FRAME_DIFF_FULL comes out whole.
+*/
+typedef struct tagWUFRAMEDIFF* PWUFRAMEDIFF;
+
+#define WU_FRAME_DIFF_DEFAULT_TILE_SIZE 64
+
+/* Report every tile as changed (keyframe) */
+#define WU_FRAME_DIFF_FULL              0x00000001
+
+typedef struct tagWUDIRTYRECT {
+    UINT    uX;
+    UINT    uY;
+    UINT    uWidth;
+    UINT    uHeight;
+} WUDIRTYRECT, *PWUDIRTYRECT;
+
+/*
+    abPixels holds the pixels of aRects[0], then aRects[1] and so on, each
+    rectangle packed row by row (uWidth * 4 bytes per row).
+*/
+typedef struct tagWUFRAMEDELTA {
+    UINT            uWidth;         /* frame size */
+    UINT            uHeight;
+    UINT            cTiles;
+    UINT            cDirtyTiles;
+    UINT            cRects;
+    PWUDIRTYRECT    aRects;
+    BYTE*           abPixels;
+    SIZE_T          cbPixels;
+} WUFRAMEDELTA, *PWUFRAMEDELTA;
+
+/* uTileSize 0 selects WU_FRAME_DIFF_DEFAULT_TILE_SIZE */
+WUAPI PWUFRAMEDIFF
+WuCreateFrameDiff(
+    IN UINT uTileSize
+    );
+
+/*
+    The delta is owned by pDiff and valid until the next comparison. On
+    failure the next frame is reported whole.
+*/
+WUAPI PWUFRAMEDELTA
+WuFrameDiffCompare(
+    IN PWUFRAMEDIFF         pDiff,
+    IN CONST PWUIMAGEDATA   pFrame,
+    IN DWORD                dwFlags
+    );
+
+WUAPI VOID
+WuDestroyFrameDiff(
+    IN PWUFRAMEDIFF pDiff
+    );
+
+/* Copies the changed rectangles into an image of the same size */
+WUAPI BOOL
+WuApplyFrameDelta(
+    IN PWUIMAGEDATA         pImageData,
+    IN CONST PWUFRAMEDELTA  pDelta
+    );
+
+/***************************************************************************
+ *  recorder.c
+ ***************************************************************************/
+
+/*
+    Screen recorder. A capture thread grabs frames of a capture session at
+    a fixed rate, diffs them against the previous frame and queues the
+    changed rectangles in a ring of pooled buffers; encoder threads
+    compress them and the frames are written to the file in capture order.
+
+    File layout: a WURECORDERFILEHEADER, then for every frame a
+    WURECORDERFRAMEHEADER followed by cbPayload bytes. Uncompressed, the
+    payload is the frame's WUDIRTYRECT array followed by the pixels of the
+    rectangles, as in a WUFRAMEDELTA. Compressed payloads use the
+    RtlCompressBuffer format named in the file header.
+*/
+typedef struct tagWUSCREENRECORDER* PWUSCREENRECORDER;
+
+#define WU_RECORDER_FILE_MAGIC                  0x43525557  /* "WURC" */
+#define WU_RECORDER_FILE_VERSION                1
+
+#define WU_RECORDER_DEFAULT_FRAME_RATE          30
+#define WU_RECORDER_DEFAULT_BUFFER_COUNT        8
+#define WU_RECORDER_DEFAULT_KEY_FRAME_INTERVAL  60
+
+/* WURECORDERFRAMEHEADER flags */
+#define WU_RECORDER_FRAME_KEY           0x00000001  /* every tile present */
+#define WU_RECORDER_FRAME_COMPRESSED    0x00000002
+#define WU_RECORDER_FRAME_DEGRADED      0x00000004  /* 6 bits per channel */
+
+/* What the capture thread does when every buffer is still queued */
+typedef enum {
+    WU_RECORDER_BACKPRESSURE_DROP       = 0x0,  /* skip the frame          */
+    WU_RECORDER_BACKPRESSURE_BLOCK      = 0x1,  /* wait for a free buffer  */
+    WU_RECORDER_BACKPRESSURE_DEGRADE    = 0x2   /* lower the quality once
+                                                   half of the buffers are
+                                                   queued, then skip      */
+} WU_RECORDER_BACKPRESSURE;
+
+/* Zero members select the defaults */
+typedef struct tagWURECORDERCONFIG {
+    HWND                        hWnd;           /* NULL for the desktop */
+    UINT                        uFrameRate;
+    UINT                        cEncoders;      /* 0: one per processor */
+    UINT                        cBuffers;
+    UINT                        uKeyFrameInterval;  /* in frames */
+    UINT                        uTileSize;
+    WU_RECORDER_BACKPRESSURE    backpressure;
+} WURECORDERCONFIG, *PWURECORDERCONFIG;
+
+typedef struct tagWURECORDERFILEHEADER {
+    DWORD   dwMagic;
+    DWORD   dwVersion;
+    UINT    uFrameRate;
+    WORD    wCompressionFormat;     /* COMPRESSION_FORMAT_* */
+    WORD    wReserved;
+} WURECORDERFILEHEADER, *PWURECORDERFILEHEADER;
+
+typedef struct tagWURECORDERFRAMEHEADER {
+    ULONGLONG   ullTimestamp;       /* 100 ns units since the start */
+    DWORD       dwFlags;
+    UINT        uWidth;
+    UINT        uHeight;
+    UINT        cRects;
+    DWORD       cbRaw;              /* uncompressed payload size */
+    DWORD       cbPayload;
+} WURECORDERFRAMEHEADER, *PWURECORDERFRAMEHEADER;
+
+typedef struct tagWURECORDERSTAGESTATS {
+    ULONGLONG   cFrames;
+    ULONGLONG   ullTotalMicroseconds;
+    ULONGLONG   ullMaxMicroseconds;
+} WURECORDERSTAGESTATS, *PWURECORDERSTAGESTATS;
+
+/*
+    capture covers grabbing and diffing a frame, queue the time a frame
+    waits for an encoder, encode the compression and write the file I/O.
+    Throughput is the frame and byte counts over ullElapsedMicroseconds.
+*/
+typedef struct tagWURECORDERSTATS {
+    ULONGLONG               ullElapsedMicroseconds;
+    ULONGLONG               cFramesCaptured;
+    ULONGLONG               cFramesDropped;
+    ULONGLONG               cFramesDegraded;
+    ULONGLONG               cFramesWritten;
+    ULONGLONG               cbRaw;
+    ULONGLONG               cbWritten;
+    UINT                    cMaxQueued;
+    WURECORDERSTAGESTATS    capture;
+    WURECORDERSTAGESTATS    queue;
+    WURECORDERSTAGESTATS    encode;
+    WURECORDERSTAGESTATS    write;
+} WURECORDERSTATS, *PWURECORDERSTATS;
+
+/* Creates (or overwrites) the file and starts recording */
+WUAPI PWUSCREENRECORDER
+WuStartScreenRecorderW(
+    IN LPCWSTR                  szFilePath,
+    IN CONST PWURECORDERCONFIG  pConfig
+    );
+
+WUAPI PWUSCREENRECORDER
+WuStartScreenRecorderA(
+    IN LPCSTR                   szFilePath,
+    IN CONST PWURECORDERCONFIG  pConfig
+    );
+
+#ifdef UNICODE
+    #define WuStartScreenRecorder WuStartScreenRecorderW
+#else /* UNICODE */
+    #define WuStartScreenRecorder WuStartScreenRecorderA
+#endif /* UNICODE */
+
+/* Safe to call from any thread while the recorder runs */
+WUAPI BOOL
+WuGetScreenRecorderStats(
+    IN  PWUSCREENRECORDER   pRecorder,
+    OUT PWURECORDERSTATS    pStats
+    );
+
+/*
+    Stops capturing, waits for the queued frames to be written, closes the
+    file and frees the recorder. pStats (optional) receives the final
+    counters. FALSE if any frame could not be written.
+*/
+WUAPI BOOL
+WuStopScreenRecorder(
+    IN  PWUSCREENRECORDER   pRecorder,
+    OUT PWURECORDERSTATS    pStats
+    );
+
+/***************************************************************************
+ *  scheduler.c
+ ***************************************************************************/
+
+/*
+    Frame-paced capture. A thread captures a capture session at a fixed
+    frame rate, woken by a high-resolution waitable timer (a regular one,
+    bound to the system timer resolution, before Windows 10 1803). Every
+    deadline is computed from the start time, so a late frame does not
+    push the following ones back, and when capturing plus pfnFrame overrun
+    the frame budget the deadlines already missed are skipped instead of
+    being captured back to back.
+*/
+typedef struct tagWUCAPTURESCHEDULER* PWUCAPTURESCHEDULER;
+
+#define WU_CAPTURE_SCHEDULER_DEFAULT_FRAME_RATE     30
+#define WU_CAPTURE_SCHEDULER_DEFAULT_STATS_INTERVAL 1000    /* ms */
+
+/* Timings kept for WuGetCaptureSchedulerTimings */
+#define WU_CAPTURE_SCHEDULER_HISTORY                256
+
+typedef struct tagWUFRAMETIMING {
+    ULONGLONG   iFrame;             /* deadline index, skipped ones count */
+    ULONGLONG   ullDueTime;         /* 100 ns units since the start */
+    ULONGLONG   ullStartTime;
+    UINT        uJitterMicroseconds;        /* start - due */
+    UINT        uCaptureMicroseconds;
+    UINT        uProcessMicroseconds;       /* pfnFrame, 0 during it */
+    UINT        cSkippedBefore;
+} WUFRAMETIMING, *PWUFRAMETIMING;
+
+typedef struct tagWUCAPTURESCHEDULERSTATS {
+    ULONGLONG   ullElapsedMicroseconds;
+    ULONGLONG   cFrames;
+    ULONGLONG   cFailed;            /* the capture itself failed */
+    ULONGLONG   cSkipped;
+    ULONGLONG   ullTotalCaptureMicroseconds;
+    ULONGLONG   ullMaxCaptureMicroseconds;
+    ULONGLONG   ullTotalProcessMicroseconds;
+    ULONGLONG   ullMaxProcessMicroseconds;
+    ULONGLONG   ullTotalJitterMicroseconds;
+    ULONGLONG   ullMaxJitterMicroseconds;
+} WUCAPTURESCHEDULERSTATS, *PWUCAPTURESCHEDULERSTATS;
+
+/*
+    Runs on the scheduler thread. pFrame belongs to the scheduler and is
+    only valid during the call; returning FALSE stops capturing.
+*/
+typedef BOOL (*WUFRAMEPROC)(
+    PWUIMAGEDATA            pFrame,
+    CONST WUFRAMETIMING*    pTiming,
+    LPVOID                  pUserData);
+
+typedef VOID (*WUSCHEDULERSTATSPROC)(
+    CONST WUCAPTURESCHEDULERSTATS*  pStats,
+    LPVOID                          pUserData);
+
+/* Zero members select the defaults, both procedures are optional */
+typedef struct tagWUCAPTURESCHEDULERCONFIG {
+    HWND                    hWnd;               /* NULL for the desktop */
+    UINT                    uFrameRate;
+    WUFRAMEPROC             pfnFrame;
+    WUSCHEDULERSTATSPROC    pfnStats;
+    UINT                    uStatsInterval;     /* ms between pfnStats */
+    LPVOID                  pUserData;
+} WUCAPTURESCHEDULERCONFIG, *PWUCAPTURESCHEDULERCONFIG;
+
+WUAPI PWUCAPTURESCHEDULER
+WuStartCaptureScheduler(
+    IN CONST PWUCAPTURESCHEDULERCONFIG  pConfig
+    );
+
+/* Safe to call from any thread while the scheduler runs */
+WUAPI BOOL
+WuGetCaptureSchedulerStats(
+    IN  PWUCAPTURESCHEDULER         pScheduler,
+    OUT PWUCAPTURESCHEDULERSTATS    pStats
+    );
+
+/* Copies the timings of the most recent frames, oldest first */
+WUAPI UINT
+WuGetCaptureSchedulerTimings(
+    IN  PWUCAPTURESCHEDULER pScheduler,
+    OUT PWUFRAMETIMING      aTimings,
+    IN  UINT                cMaxTimings
+    );
+
+/* Waits for the scheduler thread, so never call it from the procedures */
+WUAPI VOID
+WuStopCaptureScheduler(
+    IN PWUCAPTURESCHEDULER  pScheduler
+    );
+
+/***************************************************************************
+ *  capture.c
+ ***************************************************************************/
+
+WUAPI PWUIMAGEDATA
+WuCaptureScreen(
+    VOID
+    );
+
+WUAPI PWUIMAGEDATA
+WuCaptureWindow(
+    IN HWND hWnd
+    );
+
+/*
+    Captures prcRect by blitting only that area, which must lie inside the
+    window (window coordinates, relative to its top-left corner) or, for
+    a NULL hWnd, inside the virtual screen (screen coordinates). What is
+    on screen gets captured: covered parts of the window show what covers
+    them, use WuCaptureWindow for those.
+
+    WuCaptureRectToView writes into a caller-owned view, e.g. a region of
+    a buffer reused between polls; its size must match prcRect.
+*/
+WUAPI PWUIMAGEDATA
+WuCaptureRect(
+    IN HWND         hWnd,
+    IN CONST RECT*  prcRect
+    );
+
+WUAPI BOOL
+WuCaptureRectToView(
+    IN HWND             hWnd,
+    IN CONST RECT*      prcRect,
+    IN PWUIMAGEVIEW     pView
+    );
+
+/*
+    Repeated captures of one window (the desktop if hWnd is NULL). The
+    window is rendered straight into a DIB section that is kept between
+    frames and only recreated when the window size changes.
+
+    The image returned by WuCaptureSessionCaptureFrame is a view of the
+    DIB section bits, owned by the session: it stays valid until the next
+    capture or WuDestroyCaptureSession and must never be passed to
+    WuDestroyImageData. A session must not be used by two threads at once.
+*/
+typedef struct tagWUCAPTURESESSION* PWUCAPTURESESSION;
+
+WUAPI PWUCAPTURESESSION
+WuCreateCaptureSession(
+    IN HWND hWnd
+    );
+
+WUAPI PWUIMAGEDATA
+WuCaptureSessionCaptureFrame(
+    IN PWUCAPTURESESSION    pSession
+    );
+
+WUAPI VOID
+WuDestroyCaptureSession(
+    IN PWUCAPTURESESSION    pSession
+    );
+
+/***************************************************************************
+ *  dib.c
+ ***************************************************************************/
+
+/*
+    Converts a packed DIB (a BITMAPINFOHEADER or a later version, then the
+    masks or palette, then the rows), as found in CF_DIB and CF_DIBV5
+    clipboard data or after the file header of a .bmp, without GDI.
+    Handles bottom-up and top-down rows, 1 to 8 bpp palettes, 16, 24 and
+    32 bpp and BI_BITFIELDS masks; compressed bitmaps are rejected. Alpha
+    is only kept when an alpha mask is given, otherwise the result is
+    opaque.
+*/
+WUAPI PWUIMAGEDATA
+WuImageDataFromPackedDib(
+    IN CONST BYTE*  pbDib,
+    IN SIZE_T       cbDib
+    );
+
+/***************************************************************************
+ *  clipboard.c
+ ***************************************************************************/
+
+WUAPI BOOL
+WuSetClipboardTextW(
+    IN LPCWSTR  szClipboardText
+    );
+
+WUAPI BOOL
+WuSetClipboardTextA(
+    IN LPCSTR   szClipboardText
+    );
+
+#ifdef UNICODE
+    #define WuSetClipboardText WuSetClipboardTextW
+#else /* UNICODE */
+    #define WuSetClipboardText WuSetClipboardTextA
+#endif /* UNICODE */
+
+WUAPI BOOL
+WuGetClipboardTextW(
+    OUT LPWSTR  szClipboardText,
+    IN  ULONG   cchClipboardText
+    );
+
+WUAPI BOOL
+WuGetClipboardTextA(
+    OUT LPSTR   szClipboardText,
+    IN  ULONG   cchClipboardText
+    );
+
+#ifdef UNICODE
+    #define WuGetClipboardText WuGetClipboardTextW
+#else /* UNICODE */
+    #define WuGetClipboardText WuGetClipboardTextA
+#endif /* UNICODE */
+
+/* Length in WCHARs of the clipboard text, without the '\0' */
+WUAPI BOOL
+WuGetClipboardTextLength(
+    OUT PULONG  pcchClipboardText
+    );
+
+/* Returned strings are freed with HeapFree(GetProcessHeap(), ...) */
+WUAPI LPWSTR
+WuGetClipboardTextHeapAllocW(
+    VOID
+    );
+
+WUAPI LPSTR
+WuGetClipboardTextHeapAllocA(
+    VOID
+    );
+
+#ifdef UNICODE
+    #define WuGetClipboardTextHeapAlloc WuGetClipboardTextHeapAllocW
+#else /* UNICODE */
+    #define WuGetClipboardTextHeapAlloc WuGetClipboardTextHeapAllocA
+#endif /* UNICODE */
+
+/* pcbClipboardText (optional) receives the size without the '\0' */
+WUAPI LPSTR
+WuGetClipboardTextUtf8HeapAlloc(
+    OUT PULONG  pcbClipboardText
+    );
+
+/* Publishes CF_DIB only, alpha is not kept by most readers */
+WUAPI BOOL
+WuSetClipboardImageData(
+    IN PWUIMAGEDATA pImageData
+    );
+
+#define WU_CLIPBOARD_IMAGE_DIB          0x00000001  /* CF_DIB */
+#define WU_CLIPBOARD_IMAGE_PNG          0x00000002  /* registered "PNG" */
+#define WU_CLIPBOARD_IMAGE_FORMATS      0x00000003
+
+/*
+    With WU_CLIPBOARD_IMAGE_DELAYED the formats are announced without data
+    and only encoded when an application asks for them. The clipboard is
+    then owned by a hidden window on a thread of the library, which keeps
+    the pixels until the clipboard changes hands; call WuFlushClipboard
+    before the process exits so the data outlives it.
+*/
+#define WU_CLIPBOARD_IMAGE_DELAYED      0x00000100
+
+WUAPI BOOL
+WuSetClipboardImageDataEx(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN DWORD                dwFlags
+    );
+
+/* Shares the pixels of hImage instead of copying them when delayed */
+WUAPI BOOL
+WuSetClipboardImageHandle(
+    IN HWUIMAGE hImage,
+    IN DWORD    dwFlags
+    );
+
+/* Renders the formats still delayed, if the clipboard is still ours */
+WUAPI BOOL
+WuFlushClipboard(
+    VOID
+    );
+
+/* Prefers "PNG", then CF_DIBV5 and CF_DIB, then CF_BITMAP */
+WUAPI BOOL
+WuGetClipboardImageData(
+    IN PWUIMAGEDATA*    ppImageData
+    );
+
+/*
+    A clipboard image is a CF_DIB block allocated and locked up front, so
+    the producer can render straight into pView (top-down, BGRA) without
+    holding the clipboard. WuCommitClipboardImage then opens the clipboard
+    only to hand the block over; it always consumes pImage, even on
+    failure, and puHoldMicroseconds (optional) receives how long the
+    clipboard was held. An image that will not be committed is freed with
+    WuDiscardClipboardImage.
+*/
+typedef struct tagWUCLIPBOARDIMAGE* PWUCLIPBOARDIMAGE;
+
+typedef struct tagWUCLIPBOARDSTATS {
+    ULONGLONG   cOpens;
+    ULONGLONG   cFailedOpens;       /* every retry was refused */
+    ULONGLONG   ullTotalHoldMicroseconds;
+    ULONGLONG   ullMaxHoldMicroseconds;
+    ULONGLONG   ullLastHoldMicroseconds;
+    ULONGLONG   cRetries;           /* refused OpenClipboard calls */
+    ULONGLONG   ullTotalWaitMicroseconds;
+    ULONGLONG   ullMaxWaitMicroseconds;
+    /* of whole accesses, wait included, rounded up to a power of two */
+    ULONGLONG   ullP50Microseconds;
+    ULONGLONG   ullP90Microseconds;
+    ULONGLONG   ullP99Microseconds;
+} WUCLIPBOARDSTATS, *PWUCLIPBOARDSTATS;
+
+WUAPI PWUCLIPBOARDIMAGE
+WuCreateClipboardImage(
+    IN  UINT            uWidth,
+    IN  UINT            uHeight,
+    OUT PWUIMAGEVIEW    pView
+    );
+
+WUAPI BOOL
+WuCommitClipboardImage(
+    IN  PWUCLIPBOARDIMAGE   pImage,
+    OUT PULONG              puHoldMicroseconds
+    );
+
+WUAPI VOID
+WuDiscardClipboardImage(
+    IN PWUCLIPBOARDIMAGE    pImage
+    );
+
+/* Process-wide, covers every clipboard access made by the library */
+WUAPI VOID
+WuGetClipboardStats(
+    OUT PWUCLIPBOARDSTATS   pStats
     );
 
 /***************************************************************************
@@ -862,12 +2302,12 @@ typedef struct tagWUVERSIONA {
     #define PWUVERSION  PWUVERSIONA
 #endif /* UNICODE */
 
-WUAPI CONST PWUVERSIONW
+WUAPI PWUVERSIONW
 WuGetVersionExW(
     LPVOID  lpReserved
     );
 
-WUAPI CONST PWUVERSIONA
+WUAPI PWUVERSIONA
 WuGetVersionExA(
     LPVOID  lpReserved
     );
@@ -14,10 +14,120 @@
 #include <versionhelpers.h>
 #include <dwmapi.h>
 
+#include "internal.h"
+
 #ifndef PW_RENDERFULLCONTENT
 #define PW_RENDERFULLCONTENT    0x00000002  /* definition for clang */
 #endif /* PW_RENDERFULLCONTENT */
 
+/*
+    The memory DC and the DIB section selected into it live as long as the
+    session; the DIB section is only recreated when the window is resized.
+    image describes the DIB bits themselves (top-down, BGRA).
+*/
+struct tagWUCAPTURESESSION {
+    HWND        hWnd;
+    HDC         hMemoryDC;
+    HBITMAP     hbmCapture;
+    HBITMAP     hbmOld;
+    WUIMAGEDATA image;
+    BOOL        bFullContent;       /* PW_RENDERFULLCONTENT available */
+};
+
+/* Renders the window into the bitmap selected into hMemoryDC */
+static BOOL
+RenderWindow(
+    IN HWND     hWnd,
+    IN HDC      hWindowDC,
+    IN HDC      hMemoryDC,
+    IN SIZE     windowSize,
+    IN BOOL     bFullContent
+    )
+{
+    BOOL bCaptured = FALSE;
+
+    if (TRUE == bFullContent)
+    {
+        bCaptured = PrintWindow(hWnd, hMemoryDC, PW_RENDERFULLCONTENT);
+    }
+
+    if (FALSE == bCaptured)
+    {
+        if (FAILED(DwmIsCompositionEnabled(&bCaptured)))
+        {
+            goto dwm_failed;
+        }
+
+        if (TRUE == bCaptured)
+        {
+            bCaptured = PrintWindow(hWnd, hMemoryDC, 0);
+        }
+    }
+
+dwm_failed:
+    if (FALSE == bCaptured)
+    {
+        bCaptured = BitBlt(
+            hMemoryDC, 0, 0,
+            windowSize.cx, windowSize.cy,
+            hWindowDC, 0, 0,
+            SRCCOPY);
+    }
+
+    return bCaptured;
+}
+
+/* Before Windows 8 GDI leaves garbage in the alpha channel */
+static VOID
+SetOpaqueAlpha(
+    IN PWUIMAGEDATA pImageData
+    )
+{
+    SIZE_T cbImage = 0;
+    SIZE_T i       = 0;
+
+    cbImage = (SIZE_T) pImageData->uHeight * pImageData->uWidth
+        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (i = 0; i < cbImage; i += WU_IMAGEDATA_BYTES_PER_PIXEL)
+    {
+        pImageData->abData[i + 3] = 0xFF; /* alpha offset */
+    }
+}
+
+/* Top-down 32-bit DIB section, NULL unless its bits were allocated */
+static HBITMAP
+CreateCaptureDib(
+    IN  HDC     hDC,
+    IN  SIZE    bitmapSize,
+    OUT VOID**  ppBits
+    )
+{
+    BITMAPINFO bmi;
+    HBITMAP    hbmDib = NULL;
+
+    ZeroMemory(&bmi, sizeof(BITMAPINFO));
+
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = bitmapSize.cx;
+    bmi.bmiHeader.biHeight      = -bitmapSize.cy;    /* top-down */
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    *ppBits = NULL;
+
+    hbmDib = CreateDIBSection(hDC, &bmi, DIB_RGB_COLORS, ppBits, NULL, 0);
+
+    if ((hbmDib != NULL) && (NULL == *ppBits))
+    {
+        DeleteObject(hbmDib);
+        return NULL;
+    }
+
+    return hbmDib;
+}
+
 WUAPI PWUIMAGEDATA
 WuCaptureScreen(
     VOID
@@ -39,8 +149,6 @@ WuCaptureWindow(
     HBITMAP      hbmOld     = NULL;
     PWUIMAGEDATA pImageData = NULL;
     BOOL         bCaptured  = FALSE;
-    SIZE_T       cbImage    = 0;
-    INT          i          = 0;
 
     if ((NULL == hWnd) || (IsWindow(hWnd) == FALSE))
     {
@@ -81,67 +189,383 @@ WuCaptureWindow(
 
     hbmOld = (HBITMAP) SelectObject(hMemoryDC, hbmCapture);
 
-    if (IsWindows8OrGreater() == TRUE)
+    bCaptured = RenderWindow(
+        hWnd,
+        hWindowDC,
+        hMemoryDC,
+        windowSize,
+        IsWindows8OrGreater());
+
+    if (FALSE == bCaptured)
     {
-        bCaptured = PrintWindow(hWnd, hMemoryDC, PW_RENDERFULLCONTENT);
+        DeleteObject(hbmCapture);
+        SelectObject(hMemoryDC, hbmOld);
+        hbmCapture = NULL;
+        goto cleanup;
     }
 
-    if (FALSE == bCaptured)
+    SelectObject(hMemoryDC, hbmOld);
+
+    pImageData = WuExtractImageDataFromHBITMAP(hbmCapture);
+
+    if ((pImageData != NULL) && (IsWindows8OrGreater() == FALSE))
     {
-        if (FAILED(DwmIsCompositionEnabled(&bCaptured)))
-        {
-            goto dwm_failed;
-        }
+        SetOpaqueAlpha(pImageData);
+    }
 
-        if (TRUE == bCaptured)
+cleanup:
+    if (hMemoryDC != NULL)
+    {
+        DeleteDC(hMemoryDC);
+    }
+
+    if (hWindowDC != NULL)
+    {
+        ReleaseDC(hWnd, hWindowDC);
+    }
+
+    return pImageData;
+}
+
+WUAPI BOOL
+WuCaptureRectToView(
+    IN HWND             hWnd,
+    IN CONST RECT*      prcRect,
+    IN PWUIMAGEVIEW     pView
+    )
+{
+    RECT         rcBounds;
+    SIZE         rectSize;
+    HDC          hSourceDC = NULL;
+    HDC          hMemoryDC = NULL;
+    HBITMAP      hbmRect   = NULL;
+    HBITMAP      hbmOld    = NULL;
+    VOID*        pBits     = NULL;
+    CONST DWORD* pdwSrc    = NULL;
+    DWORD*       pdwDst    = NULL;
+    DWORD        dwRop     = SRCCOPY;
+    BOOL         bResult   = FALSE;
+    LONG         x         = 0;
+    LONG         y         = 0;
+
+    if ((NULL == prcRect) || (NULL == pView) || (NULL == pView->abData))
+    {
+        return FALSE;
+    }
+
+    rectSize.cx = prcRect->right - prcRect->left;
+    rectSize.cy = prcRect->bottom - prcRect->top;
+
+    if ((rectSize.cx <= 0) || (rectSize.cy <= 0)
+        || ((UINT) rectSize.cx != pView->uWidth)
+        || ((UINT) rectSize.cy != pView->uHeight))
+    {
+        return FALSE;
+    }
+
+    if (NULL == hWnd)
+    {
+        rcBounds.left   = GetSystemMetrics(SM_XVIRTUALSCREEN);
+        rcBounds.top    = GetSystemMetrics(SM_YVIRTUALSCREEN);
+        rcBounds.right  = rcBounds.left
+            + GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        rcBounds.bottom = rcBounds.top
+            + GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+        /* layered windows only show up in screen blits with CAPTUREBLT */
+        dwRop |= CAPTUREBLT;
+    }
+    else
+    {
+        if ((IsWindow(hWnd) == FALSE)
+            || (GetWindowRect(hWnd, &rcBounds) == FALSE))
         {
-            bCaptured = PrintWindow(hWnd, hMemoryDC, 0);
+            return FALSE;
         }
+
+        OffsetRect(&rcBounds, -rcBounds.left, -rcBounds.top);
     }
 
-dwm_failed:
-    if (FALSE == bCaptured)
+    if ((prcRect->left < rcBounds.left) || (prcRect->top < rcBounds.top)
+        || (prcRect->right > rcBounds.right)
+        || (prcRect->bottom > rcBounds.bottom))
     {
-        bCaptured = BitBlt(
-            hMemoryDC, 0, 0,
-            windowSize.cx, windowSize.cy,
-            hWindowDC, 0, 0,
-            SRCCOPY);
+        return FALSE;
     }
 
-    if (FALSE == bCaptured)
+    hSourceDC = (NULL == hWnd) ? GetDC(NULL) : GetWindowDC(hWnd);
+
+    if (NULL == hSourceDC)
+    {
+        return FALSE;
+    }
+
+    hMemoryDC = CreateCompatibleDC(hSourceDC);
+
+    if (NULL == hMemoryDC)
     {
-        DeleteObject(hbmCapture);
-        SelectObject(hMemoryDC, hbmOld);
-        hbmCapture = NULL;
         goto cleanup;
     }
 
-    SelectObject(hMemoryDC, hbmOld);
+    hbmRect = CreateCaptureDib(hMemoryDC, rectSize, &pBits);
 
-    pImageData = WuExtractImageDataFromHBITMAP(hbmCapture);
+    if (NULL == hbmRect)
+    {
+        goto cleanup;
+    }
 
-    if (IsWindows8OrGreater() == FALSE)
+    hbmOld = (HBITMAP) SelectObject(hMemoryDC, hbmRect);
+
+    if (BitBlt(hMemoryDC, 0, 0, rectSize.cx, rectSize.cy,
+            hSourceDC, prcRect->left, prcRect->top, dwRop) == FALSE)
     {
-        cbImage = pImageData->uHeight * pImageData->uWidth
-            * WU_IMAGEDATA_BYTES_PER_PIXEL;
+        goto cleanup;
+    }
+
+    GdiFlush();
+
+    /* BitBlt leaves the alpha channel undefined */
+    for (y = 0; y < rectSize.cy; ++y)
+    {
+        pdwSrc = (CONST DWORD*) pBits + (SIZE_T) y * rectSize.cx;
+        pdwDst = (DWORD*) (pView->abData + (SIZE_T) y * pView->cbStride);
 
-        for (i = 0; i < cbImage; i += WU_IMAGEDATA_BYTES_PER_PIXEL)
+        for (x = 0; x < rectSize.cx; ++x)
         {
-            pImageData->abData[i + 3] = 0xFF; /* alpha offset */
+            pdwDst[x] = pdwSrc[x] | 0xFF000000;
         }
     }
 
+    bResult = TRUE;
+
 cleanup:
+    if (hbmRect != NULL)
+    {
+        SelectObject(hMemoryDC, hbmOld);
+        DeleteObject(hbmRect);
+    }
+
     if (hMemoryDC != NULL)
     {
         DeleteDC(hMemoryDC);
     }
 
-    if (hWindowDC != NULL)
+    ReleaseDC(hWnd, hSourceDC);
+
+    return bResult;
+}
+
+WUAPI PWUIMAGEDATA
+WuCaptureRect(
+    IN HWND         hWnd,
+    IN CONST RECT*  prcRect
+    )
+{
+    WUIMAGEVIEW  view;
+    PWUIMAGEDATA pImageData = NULL;
+
+    if ((NULL == prcRect) || (prcRect->right <= prcRect->left)
+        || (prcRect->bottom <= prcRect->top))
     {
-        ReleaseDC(hWnd, hWindowDC);
+        return NULL;
+    }
+
+    pImageData = _WuCreateUninitializedImageData(
+        (UINT) (prcRect->right - prcRect->left),
+        (UINT) (prcRect->bottom - prcRect->top));
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    if ((WuGetImageView(pImageData, 0, 0, pImageData->uWidth,
+            pImageData->uHeight, &view) == FALSE)
+        || (WuCaptureRectToView(hWnd, prcRect, &view) == FALSE))
+    {
+        WuDestroyImageData(pImageData);
+        return NULL;
     }
 
     return pImageData;
 }
+
+static VOID
+ReleaseCaptureBitmap(
+    IN PWUCAPTURESESSION    pSession
+    )
+{
+    if (pSession->hbmCapture != NULL)
+    {
+        SelectObject(pSession->hMemoryDC, pSession->hbmOld);
+        DeleteObject(pSession->hbmCapture);
+    }
+
+    pSession->hbmCapture = NULL;
+    pSession->hbmOld     = NULL;
+
+    ZeroMemory(&pSession->image, sizeof(WUIMAGEDATA));
+}
+
+static BOOL
+ResizeCaptureBitmap(
+    IN PWUCAPTURESESSION    pSession,
+    IN SIZE                 windowSize
+    )
+{
+    VOID* pBits = NULL;
+
+    if ((pSession->hbmCapture != NULL)
+        && (pSession->image.uWidth == (UINT) windowSize.cx)
+        && (pSession->image.uHeight == (UINT) windowSize.cy))
+    {
+        return TRUE;
+    }
+
+    ReleaseCaptureBitmap(pSession);
+
+    if ((windowSize.cx <= 0) || (windowSize.cy <= 0))
+    {
+        return FALSE;
+    }
+
+    pSession->hbmCapture = CreateCaptureDib(
+        pSession->hMemoryDC,
+        windowSize,
+        &pBits);
+
+    if (NULL == pSession->hbmCapture)
+    {
+        return FALSE;
+    }
+
+    pSession->hbmOld = (HBITMAP) SelectObject(
+        pSession->hMemoryDC,
+        pSession->hbmCapture);
+
+    pSession->image.abData  = (BYTE*) pBits;
+    pSession->image.uWidth  = (UINT) windowSize.cx;
+    pSession->image.uHeight = (UINT) windowSize.cy;
+
+    return TRUE;
+}
+
+WUAPI PWUCAPTURESESSION
+WuCreateCaptureSession(
+    IN HWND hWnd
+    )
+{
+    PWUCAPTURESESSION pSession = NULL;
+
+    if (NULL == hWnd)
+    {
+        hWnd = GetDesktopWindow();
+    }
+
+    if (IsWindow(hWnd) == FALSE)
+    {
+        return NULL;
+    }
+
+    pSession = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUCAPTURESESSION));
+
+    if (NULL == pSession)
+    {
+        return NULL;
+    }
+
+    /* a screen-compatible DC, a DIB section can be selected into it */
+    pSession->hMemoryDC = CreateCompatibleDC(NULL);
+
+    if (NULL == pSession->hMemoryDC)
+    {
+        HeapFree(GetProcessHeap(), 0, pSession);
+        return NULL;
+    }
+
+    pSession->hWnd         = hWnd;
+    pSession->bFullContent = IsWindows8OrGreater();
+
+    return pSession;
+}
+
+WUAPI PWUIMAGEDATA
+WuCaptureSessionCaptureFrame(
+    IN PWUCAPTURESESSION    pSession
+    )
+{
+    RECT rcWindow;
+    SIZE windowSize;
+    HDC  hWindowDC = NULL;
+    BOOL bCaptured = FALSE;
+
+    if (NULL == pSession)
+    {
+        return NULL;
+    }
+
+    if (GetWindowRect(pSession->hWnd, &rcWindow) == FALSE)
+    {
+        return NULL;
+    }
+
+    windowSize.cx = rcWindow.right - rcWindow.left;
+    windowSize.cy = rcWindow.bottom - rcWindow.top;
+
+    if (ResizeCaptureBitmap(pSession, windowSize) == FALSE)
+    {
+        return NULL;
+    }
+
+    /* only needed by the BitBlt fallback, but cheap to get from the cache */
+    hWindowDC = GetWindowDC(pSession->hWnd);
+
+    if (NULL == hWindowDC)
+    {
+        return NULL;
+    }
+
+    bCaptured = RenderWindow(
+        pSession->hWnd,
+        hWindowDC,
+        pSession->hMemoryDC,
+        windowSize,
+        pSession->bFullContent);
+
+    ReleaseDC(pSession->hWnd, hWindowDC);
+
+    if (FALSE == bCaptured)
+    {
+        return NULL;
+    }
+
+    /* GDI may still be drawing into the DIB section */
+    GdiFlush();
+
+    if (FALSE == pSession->bFullContent)
+    {
+        SetOpaqueAlpha(&pSession->image);
+    }
+
+    return &pSession->image;
+}
+
+WUAPI VOID
+WuDestroyCaptureSession(
+    IN PWUCAPTURESESSION    pSession
+    )
+{
+    if (NULL == pSession)
+    {
+        return;
+    }
+
+    ReleaseCaptureBitmap(pSession);
+
+    DeleteDC(pSession->hMemoryDC);
+
+    HeapFree(GetProcessHeap(), 0, pSession);
+}
@@ -13,63 +13,227 @@
 
 #include <strsafe.h>
 
-#include "undoc.h"
+#include "internal.h"
 
-#define CLIPBOARD_RETRY_COUNT       5
-#define CLIPBOARD_RETRY_DELAY_MS    10
+/*
+    A refused OpenClipboard is retried after 1, 2, 4 ... ms; when the
+    sequence number moved meanwhile, the holder is busy writing and will
+    likely close soon, so the delay starts over from the shortest one.
+*/
+#define CLIPBOARD_RETRY_COUNT       8
+#define CLIPBOARD_MIN_DELAY_MS      1
+#define CLIPBOARD_MAX_DELAY_MS      64
+
+/* Bucket i counts the accesses that took less than 2^i microseconds */
+#define CLIPBOARD_LATENCY_BUCKETS   33
+
+#define CLIPBOARD_PNG_FORMAT_NAME   L"PNG"
+#define CLIPBOARD_OWNER_CLASS_NAME  L"WuClipboardOwner"
+
+/* One block per image format: CF_DIB and PNG */
+#define CLIPBOARD_MAX_ITEMS         2
 
 typedef BOOL (*CLIPBOARDWORKPROC)(LPVOID);
 
+/*
+    The clipboard is prepared in place: the CF_DIB block is allocated and
+    locked when the image is created and only handed over on commit.
+*/
+struct tagWUCLIPBOARDIMAGE {
+    HGLOBAL hDib;
+    BYTE*   pbDib;              /* locked while the image is open */
+};
+
+static SRWLOCK          g_statsLock = SRWLOCK_INIT;
+static WUCLIPBOARDSTATS g_stats;
+static ULONGLONG        g_acLatency[CLIPBOARD_LATENCY_BUCKETS];
+
+/* Defined with the delayed rendering, which owns the same window */
+static HWND
+GetClipboardOwnerWindow(
+    VOID
+    );
+
+static ULONG
+ElapsedMicroseconds(
+    IN CONST LARGE_INTEGER* pliFrom,
+    IN CONST LARGE_INTEGER* pliTo
+    )
+{
+    LARGE_INTEGER liFrequency;
+
+    QueryPerformanceFrequency(&liFrequency);
+
+    return (ULONG) min(MAXULONG, (pliTo->QuadPart - pliFrom->QuadPart)
+        * MICROSECONDS_PER_SECOND / liFrequency.QuadPart);
+}
+
+static VOID
+RecordClipboardAccess(
+    IN BOOL     bOpened,
+    IN UINT     cRetries,
+    IN ULONG    uWaitMicroseconds,
+    IN ULONG    uHoldMicroseconds
+    )
+{
+    ULONG  uLatency = uWaitMicroseconds + uHoldMicroseconds;
+    UINT   iBucket  = 0;
+
+    if (uLatency < uWaitMicroseconds)
+    {
+        uLatency = MAXULONG;
+    }
+
+    while (uLatency != 0)
+    {
+        uLatency >>= 1;
+        ++iBucket;
+    }
+
+    AcquireSRWLockExclusive(&g_statsLock);
+
+    if (TRUE == bOpened)
+    {
+        g_stats.cOpens++;
+        g_stats.ullTotalHoldMicroseconds += uHoldMicroseconds;
+        g_stats.ullMaxHoldMicroseconds    = max(
+            g_stats.ullMaxHoldMicroseconds,
+            uHoldMicroseconds);
+        g_stats.ullLastHoldMicroseconds   = uHoldMicroseconds;
+    }
+    else
+    {
+        g_stats.cFailedOpens++;
+    }
+
+    g_stats.cRetries                 += cRetries;
+    g_stats.ullTotalWaitMicroseconds += uWaitMicroseconds;
+    g_stats.ullMaxWaitMicroseconds    = max(
+        g_stats.ullMaxWaitMicroseconds,
+        uWaitMicroseconds);
+
+    g_acLatency[iBucket]++;
+
+    ReleaseSRWLockExclusive(&g_statsLock);
+}
+
+/* Upper bound of the bucket holding the uPercent-th percentile */
+static ULONGLONG
+GetLatencyPercentile(
+    IN ULONGLONG    cAccesses,
+    IN UINT         uPercent
+    )
+{
+    ULONGLONG cRank = (cAccesses * uPercent + 99) / 100;
+    ULONGLONG cSeen = 0;
+    UINT      i     = 0;
+
+    if (0 == cAccesses)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < CLIPBOARD_LATENCY_BUCKETS; ++i)
+    {
+        cSeen += g_acLatency[i];
+
+        if (cSeen >= cRank)
+        {
+            break;
+        }
+    }
+
+    return (1ULL << min(i, CLIPBOARD_LATENCY_BUCKETS - 1)) - 1;
+}
+
+/*
+    The clipboard is always opened for the message-only owner window, so
+    EmptyClipboard has a live owner without looking one up on every call.
+    puHoldMicroseconds (optional) receives how long the clipboard stayed
+    open, from OpenClipboard to CloseClipboard.
+*/
 static BOOL
 WithOpenedClipboard(
-    IN CLIPBOARDWORKPROC    fnClipboardWorker,
-    IN LPVOID               lpUserData
+    IN  CLIPBOARDWORKPROC   fnClipboardWorker,
+    IN  LPVOID              lpUserData,
+    OUT PULONG              puHoldMicroseconds
     )
 {
-    HWND hWnd            = NULL;
-    BOOL bIsWorkerWindow = FALSE;
-    BOOL bOpened         = FALSE;
-    INT  i               = 0;
-    BOOL bResult         = FALSE;
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liOpened;
+    LARGE_INTEGER liClosed;
+    HWND          hWnd        = NULL;
+    DWORD         dwSequence  = 0;
+    DWORD         dwCurrent   = 0;
+    DWORD         dwDelay     = CLIPBOARD_MIN_DELAY_MS;
+    BOOL          bOpened     = FALSE;
+    UINT          i           = 0;
+    BOOL          bResult     = FALSE;
+    ULONG         uHold       = 0;
 
     if (NULL == fnClipboardWorker)
     {
         return FALSE;
     }
 
-    hWnd = WuCurrentProcessGetWindow();
-
-    if (NULL == hWnd)
-    {
-        hWnd = SHCreateWorkerWindowW(NULL, NULL, 0, 0, NULL, 0);
-        bIsWorkerWindow = TRUE;
-    }
+    hWnd = GetClipboardOwnerWindow();
 
     if (NULL == hWnd)
     {
         return FALSE;
     }
 
-    for (i = 0; i < CLIPBOARD_RETRY_COUNT; ++i)
+    QueryPerformanceCounter(&liStart);
+
+    dwSequence = GetClipboardSequenceNumber();
+
+    for (i = 0; i <= CLIPBOARD_RETRY_COUNT; ++i)
     {
+        if (i > 0)
+        {
+            Sleep(dwDelay);
+
+            dwCurrent = GetClipboardSequenceNumber();
+
+            if (dwCurrent != dwSequence)
+            {
+                dwSequence = dwCurrent;
+                dwDelay    = CLIPBOARD_MIN_DELAY_MS;
+            }
+            else
+            {
+                dwDelay = min(dwDelay * 2, CLIPBOARD_MAX_DELAY_MS);
+            }
+        }
+
         if (OpenClipboard(hWnd) == TRUE)
         {
             bOpened = TRUE;
             break;
         }
-
-        Sleep(CLIPBOARD_RETRY_DELAY_MS);
     }
 
+    QueryPerformanceCounter(&liOpened);
+
     if (TRUE == bOpened)
     {
         bResult = fnClipboardWorker(lpUserData);
         CloseClipboard();
+
+        QueryPerformanceCounter(&liClosed);
+
+        uHold = ElapsedMicroseconds(&liOpened, &liClosed);
     }
 
-    if (TRUE == bIsWorkerWindow)
+    RecordClipboardAccess(
+        bOpened,
+        min(i, CLIPBOARD_RETRY_COUNT),
+        ElapsedMicroseconds(&liStart, &liOpened),
+        uHold);
+
+    if (puHoldMicroseconds != NULL)
     {
-        DestroyWindow(hWnd);
+        *puHoldMicroseconds = uHold;
     }
 
     return bResult;
@@ -137,7 +301,8 @@ WuSetClipboardTextW(
 
     return WithOpenedClipboard(
         (CLIPBOARDWORKPROC) WuSetClipboardTextW_WorkerProc,
-        (LPVOID) szClipboardText);
+        (LPVOID) szClipboardText,
+        NULL);
 }
 
 WUAPI BOOL
@@ -162,27 +327,32 @@ WuSetClipboardTextA(
     return bResult;
 }
 
+/* Gets the CF_UNICODETEXT data, locked, and its length without the '\0' */
+typedef BOOL (*CLIPBOARDTEXTPROC)(LPCWSTR, ULONG, LPVOID);
+
+typedef struct tagCLIPBOARDTEXTWORK {
+    CLIPBOARDTEXTPROC   fnTextWorker;
+    LPVOID              lpUserData;
+} CLIPBOARDTEXTWORK, *PCLIPBOARDTEXTWORK;
+
 typedef struct tagCLIPBOARDTEXT {
     ULONG   cchClipboardText;
-    LPWSTR  szClipboardText;
+    LPVOID  szClipboardText;    /* LPWSTR or LPSTR, by the worker */
 } CLIPBOARDTEXT, *PCLIPBOARDTEXT;
 
 static BOOL
-WuGetClipboardTextW_WorkerProc(
-    IN PCLIPBOARDTEXT   pClipboardText
+WithClipboardText_WorkerProc(
+    IN PCLIPBOARDTEXTWORK   pWork
     )
 {
     HANDLE  hClipboardData  = NULL;
     LPCWSTR szClipboardData = NULL;
-    HRESULT hResult         = S_OK;
-
-    if (NULL == pClipboardText)
-    {
-        return FALSE;
-    }
+    SIZE_T  cchMax          = 0;
+    SIZE_T  cchText         = 0;
+    BOOL    bResult         = FALSE;
 
     hClipboardData = GetClipboardData(CF_UNICODETEXT);
-    
+
     if (NULL == hClipboardData)
     {
         return FALSE;
@@ -195,14 +365,94 @@ WuGetClipboardTextW_WorkerProc(
         return FALSE;
     }
 
-    hResult = StringCchCopyW(
-        pClipboardText->szClipboardText,
-        pClipboardText->cchClipboardText,
-        szClipboardData);
+    /* the block may be rounded up, or lack the '\0' altogether */
+    cchMax = min(GlobalSize(hClipboardData) / sizeof(WCHAR), MAXINT);
+
+    if (FAILED(StringCchLengthW(szClipboardData, cchMax, &cchText)))
+    {
+        cchText = cchMax;
+    }
+
+    bResult = pWork->fnTextWorker(
+        szClipboardData,
+        (ULONG) cchText,
+        pWork->lpUserData);
 
     GlobalUnlock(hClipboardData);
 
-    return SUCCEEDED(hResult);
+    return bResult;
+}
+
+static BOOL
+WithClipboardText(
+    IN CLIPBOARDTEXTPROC    fnTextWorker,
+    IN LPVOID               lpUserData
+    )
+{
+    CLIPBOARDTEXTWORK work;
+
+    if (IsClipboardFormatAvailable(CF_UNICODETEXT) == FALSE)
+    {
+        return FALSE;
+    }
+
+    work.fnTextWorker = fnTextWorker;
+    work.lpUserData   = lpUserData;
+
+    return WithOpenedClipboard(
+        (CLIPBOARDWORKPROC) WithClipboardText_WorkerProc,
+        &work,
+        NULL);
+}
+
+static BOOL
+WuGetClipboardTextLength_WorkerProc(
+    IN LPCWSTR  szText,
+    IN ULONG    cchText,
+    IN PULONG   pcchClipboardText
+    )
+{
+    UNREFERENCED_PARAMETER(szText);
+
+    *pcchClipboardText = cchText;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuGetClipboardTextLength(
+    OUT PULONG  pcchClipboardText
+    )
+{
+    if (NULL == pcchClipboardText)
+    {
+        return FALSE;
+    }
+
+    return WithClipboardText(
+        (CLIPBOARDTEXTPROC) WuGetClipboardTextLength_WorkerProc,
+        (LPVOID) pcchClipboardText);
+}
+
+static BOOL
+WuGetClipboardTextW_WorkerProc(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN PCLIPBOARDTEXT   pClipboardText
+    )
+{
+    LPWSTR szClipboardText = (LPWSTR) pClipboardText->szClipboardText;
+
+    if (cchText >= pClipboardText->cchClipboardText)
+    {
+        return FALSE;
+    }
+
+    CopyMemory(szClipboardText, szText, cchText * sizeof(WCHAR));
+
+    szClipboardText[cchText] = L'\0';
+
+    return TRUE;
 }
 
 WUAPI BOOL
@@ -218,186 +468,1265 @@ WuGetClipboardTextW(
         return FALSE;
     }
 
-    if (IsClipboardFormatAvailable(CF_UNICODETEXT) == FALSE)
-    {
-        return FALSE;
-    }
-
     clipboardText.szClipboardText  = szClipboardText;
     clipboardText.cchClipboardText = cchClipboardText;
 
-    return WithOpenedClipboard(
-        (CLIPBOARDWORKPROC) WuGetClipboardTextW_WorkerProc,
+    return WithClipboardText(
+        (CLIPBOARDTEXTPROC) WuGetClipboardTextW_WorkerProc,
         &clipboardText);
 }
 
+/* Converts straight from the clipboard memory, no wide copy in between */
+static BOOL
+WuGetClipboardTextA_WorkerProc(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN PCLIPBOARDTEXT   pClipboardText
+    )
+{
+    LPSTR szClipboardText = (LPSTR) pClipboardText->szClipboardText;
+    INT   cbWritten       = 0;
+
+    if (cchText > 0)
+    {
+        /* a zero size would make WideCharToMultiByte a size query */
+        if (pClipboardText->cchClipboardText <= 1)
+        {
+            return FALSE;
+        }
+
+        cbWritten = WideCharToMultiByte(
+            CP_ACP,
+            0,
+            szText,
+            (INT) cchText,
+            szClipboardText,
+            (INT) pClipboardText->cchClipboardText - 1,
+            NULL,
+            NULL);
+
+        if (0 == cbWritten)
+        {
+            return FALSE;
+        }
+    }
+
+    szClipboardText[cbWritten] = '\0';
+
+    return TRUE;
+}
+
 WUAPI BOOL
 WuGetClipboardTextA(
     OUT LPSTR   szClipboardText,
     IN  ULONG   cchClipboardText
     )
 {
-    LPWSTR szwClipboardText = NULL;
-    BOOL   bResult          = FALSE;
-
-    szwClipboardText = (LPWSTR) HeapAlloc(
-        GetProcessHeap(),
-        HEAP_ZERO_MEMORY,
-        cchClipboardText * sizeof(WCHAR));
+    CLIPBOARDTEXT clipboardText;
 
-    if (NULL == szwClipboardText)
+    if ((NULL == szClipboardText) || (0 == cchClipboardText))
     {
         return FALSE;
     }
 
-    bResult = WuGetClipboardTextW(
-        szwClipboardText,
-        cchClipboardText);
-
-    if (FALSE == bResult)
-    {
-        goto cleanup;
-    }
-
-    bResult = WuWideToAnsi(
-        szwClipboardText,
-        szClipboardText,
-        cchClipboardText);
+    clipboardText.szClipboardText  = szClipboardText;
+    clipboardText.cchClipboardText = (ULONG) min(cchClipboardText, MAXINT);
 
-cleanup:
-    if (szwClipboardText != NULL)
-    {
-        HeapFree(GetProcessHeap(), 0, szwClipboardText);
-    }
-    
-    return bResult;
+    return WithClipboardText(
+        (CLIPBOARDTEXTPROC) WuGetClipboardTextA_WorkerProc,
+        &clipboardText);
 }
 
 static BOOL
-WuSetClipboardImageData_WorkerProc(
-    IN PWUIMAGEDATA   pImageData
+WuGetClipboardTextHeapAllocW_WorkerProc(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN PCLIPBOARDTEXT   pClipboardText
     )
 {
-    BITMAPINFOHEADER bmiHeader;
-    SIZE_T           cbDibSize      = 0;
-    HGLOBAL          hClipboardData = NULL;
-    BYTE*            pClipboardData = NULL;
+    LPWSTR szClipboardText = NULL;
 
-    if (NULL == pImageData)
+    szClipboardText = (LPWSTR) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ((SIZE_T) cchText + 1) * sizeof(WCHAR));
+
+    if (NULL == szClipboardText)
     {
         return FALSE;
     }
 
-    ZeroMemory(&bmiHeader, sizeof(BITMAPINFOHEADER));
+    CopyMemory(szClipboardText, szText, (SIZE_T) cchText * sizeof(WCHAR));
 
-    bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
-    bmiHeader.biWidth       = pImageData->uWidth;
-    bmiHeader.biHeight      = -(LONG) pImageData->uHeight;
-    bmiHeader.biPlanes      = 1;
-    bmiHeader.biBitCount    = 32;
-    bmiHeader.biCompression = BI_RGB;
-    bmiHeader.biSizeImage   = pImageData->uWidth * pImageData->uHeight
-        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    szClipboardText[cchText] = L'\0';
 
-    cbDibSize = sizeof(BITMAPINFOHEADER) + bmiHeader.biSizeImage;
+    pClipboardText->szClipboardText  = szClipboardText;
+    pClipboardText->cchClipboardText = cchText;
 
-    hClipboardData = GlobalAlloc(GMEM_MOVEABLE, cbDibSize);
+    return TRUE;
+}
 
-    if (NULL == hClipboardData)
-    {
-        return FALSE;
-    }
+WUAPI LPWSTR
+WuGetClipboardTextHeapAllocW(
+    VOID
+    )
+{
+    CLIPBOARDTEXT clipboardText;
 
-    pClipboardData = (BYTE*) GlobalLock(hClipboardData);
-    
-    if (NULL == pClipboardData)
+    ZeroMemory(&clipboardText, sizeof(CLIPBOARDTEXT));
+
+    if (WithClipboardText(
+            (CLIPBOARDTEXTPROC) WuGetClipboardTextHeapAllocW_WorkerProc,
+            &clipboardText) == FALSE)
     {
-        GlobalFree(hClipboardData);
-        return FALSE;
+        return NULL;
     }
 
-    CopyMemory(pClipboardData, &bmiHeader, bmiHeader.biSize);
+    return (LPWSTR) clipboardText.szClipboardText;
+}
 
-    CopyMemory(
-        pClipboardData + bmiHeader.biSize,
-        pImageData->abData,
-        bmiHeader.biSizeImage);
+/*
+    UTF-8 needs at most three bytes per UTF-16 unit (four per surrogate
+    pair), so the buffer is sized from the length and filled in one pass.
+    Any other code page is measured first.
+*/
+static BOOL
+ConvertClipboardText(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN UINT             uCodePage,
+    IN PCLIPBOARDTEXT   pClipboardText
+    )
+{
+    LPSTR  szClipboardText = NULL;
+    SIZE_T cbMax           = 0;
+    INT    cbWritten       = 0;
 
-    GlobalUnlock(hClipboardData);
+    if (CP_UTF8 == uCodePage)
+    {
+        cbMax = (SIZE_T) cchText * 3;
+    }
+    else if (cchText > 0)
+    {
+        cbMax = (SIZE_T) WideCharToMultiByte(
+            uCodePage,
+            0,
+            szText,
+            (INT) cchText,
+            NULL,
+            0,
+            NULL,
+            NULL);
+
+        if (0 == cbMax)
+        {
+            return FALSE;
+        }
+    }
 
-    if (EmptyClipboard() == FALSE)
+    if (cbMax >= MAXINT)
     {
-        GlobalFree(hClipboardData);
         return FALSE;
     }
 
-    if (SetClipboardData(CF_DIB, hClipboardData) == FALSE)
+    szClipboardText = (LPSTR) HeapAlloc(GetProcessHeap(), 0, cbMax + 1);
+
+    if (NULL == szClipboardText)
     {
-        GlobalFree(hClipboardData);
         return FALSE;
     }
 
+    if (cchText > 0)
+    {
+        cbWritten = WideCharToMultiByte(
+            uCodePage,
+            0,
+            szText,
+            (INT) cchText,
+            szClipboardText,
+            (INT) cbMax,
+            NULL,
+            NULL);
+
+        if (0 == cbWritten)
+        {
+            HeapFree(GetProcessHeap(), 0, szClipboardText);
+            return FALSE;
+        }
+    }
+
+    szClipboardText[cbWritten] = '\0';
+
+    pClipboardText->szClipboardText  = szClipboardText;
+    pClipboardText->cchClipboardText = (ULONG) cbWritten;
+
     return TRUE;
 }
 
-WUAPI BOOL
-WuSetClipboardImageData(
-    IN PWUIMAGEDATA pImageData
+static BOOL
+WuGetClipboardTextHeapAllocA_WorkerProc(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN PCLIPBOARDTEXT   pClipboardText
     )
 {
-    if (NULL == pImageData)
+    return ConvertClipboardText(szText, cchText, CP_ACP, pClipboardText);
+}
+
+WUAPI LPSTR
+WuGetClipboardTextHeapAllocA(
+    VOID
+    )
+{
+    CLIPBOARDTEXT clipboardText;
+
+    ZeroMemory(&clipboardText, sizeof(CLIPBOARDTEXT));
+
+    if (WithClipboardText(
+            (CLIPBOARDTEXTPROC) WuGetClipboardTextHeapAllocA_WorkerProc,
+            &clipboardText) == FALSE)
     {
-        return FALSE;
+        return NULL;
     }
 
-    return WithOpenedClipboard(
-        (CLIPBOARDWORKPROC) WuSetClipboardImageData_WorkerProc,
-        (LPVOID) pImageData);
+    return (LPSTR) clipboardText.szClipboardText;
 }
 
 static BOOL
-WuGetClipboardImageData_WorkerProc(
-    IN PWUIMAGEDATA*    ppImageData
+WuGetClipboardTextUtf8HeapAlloc_WorkerProc(
+    IN LPCWSTR          szText,
+    IN ULONG            cchText,
+    IN PCLIPBOARDTEXT   pClipboardText
     )
 {
-    HBITMAP      hClipboardData = NULL;
-    PWUIMAGEDATA pImageData     = NULL;
+    return ConvertClipboardText(szText, cchText, CP_UTF8, pClipboardText);
+}
 
-    hClipboardData = (HBITMAP) GetClipboardData(CF_BITMAP);
-    
-    if (NULL == hClipboardData)
+WUAPI LPSTR
+WuGetClipboardTextUtf8HeapAlloc(
+    OUT PULONG  pcbClipboardText
+    )
+{
+    CLIPBOARDTEXT clipboardText;
+
+    ZeroMemory(&clipboardText, sizeof(CLIPBOARDTEXT));
+
+    if (WithClipboardText(
+            (CLIPBOARDTEXTPROC) WuGetClipboardTextUtf8HeapAlloc_WorkerProc,
+            &clipboardText) == FALSE)
     {
-        return FALSE;
+        return NULL;
     }
 
-    pImageData = WuExtractImageDataFromHBITMAP(hClipboardData);
-
-    if (NULL == pImageData)
+    if (pcbClipboardText != NULL)
     {
-        return FALSE;
+        *pcbClipboardText = clipboardText.cchClipboardText;
     }
 
-    *ppImageData = pImageData;
+    return (LPSTR) clipboardText.szClipboardText;
+}
 
-    return TRUE;
+/*
+    Delayed rendering needs an owner window that keeps answering
+    WM_RENDERFORMAT, so it lives on a thread of its own that only pumps
+    messages. It is created on first use and lives as long as the process.
+*/
+static INIT_ONCE g_ownerInitOnce = INIT_ONCE_STATIC_INIT;
+static HWND      g_hOwnerWnd     = NULL;
+
+/* Image behind the formats published without data, and which are left */
+static SRWLOCK  g_delayedLock      = SRWLOCK_INIT;
+static HWUIMAGE g_hDelayedImage    = NULL;
+static DWORD    g_dwDelayedFormats = 0;
+
+typedef struct tagOWNERTHREADSTART {
+    HANDLE  hReady;
+    HWND    hWnd;               /* NULL if the window could not be made */
+} OWNERTHREADSTART, *POWNERTHREADSTART;
+
+static UINT
+GetPngClipboardFormat(
+    VOID
+    )
+{
+    /* registering an existing name just returns its atom */
+    return RegisterClipboardFormatW(CLIPBOARD_PNG_FORMAT_NAME);
 }
 
-WUAPI BOOL
-WuGetClipboardImageData(
-    IN PWUIMAGEDATA*    ppImageData
+static DWORD
+ClipboardFormatToImageFlag(
+    IN UINT uFormat
     )
 {
-    if (NULL == ppImageData)
+    if (CF_DIB == uFormat)
     {
-        return FALSE;
+        return WU_CLIPBOARD_IMAGE_DIB;
     }
 
-    if (IsClipboardFormatAvailable(CF_BITMAP) == FALSE)
+    if (GetPngClipboardFormat() == uFormat)
     {
-        return FALSE;
+        return WU_CLIPBOARD_IMAGE_PNG;
     }
 
-    return WithOpenedClipboard(
-        (CLIPBOARDWORKPROC) WuGetClipboardImageData_WorkerProc,
-        (LPVOID) ppImageData);
+    return 0;
+}
+
+/* Hands the block over: pImage is freed, the caller owns the HGLOBAL */
+static HGLOBAL
+DetachClipboardImage(
+    IN PWUCLIPBOARDIMAGE    pImage
+    )
+{
+    HGLOBAL hDib = pImage->hDib;
+
+    GlobalUnlock(hDib);
+    HeapFree(GetProcessHeap(), 0, pImage);
+
+    return hDib;
+}
+
+static HGLOBAL
+CreateDibFromImageData(
+    IN CONST PWUIMAGEDATA   pImageData
+    )
+{
+    WUIMAGEVIEW       view;
+    PWUCLIPBOARDIMAGE pImage = NULL;
+
+    pImage = WuCreateClipboardImage(
+        pImageData->uWidth,
+        pImageData->uHeight,
+        &view);
+
+    if (NULL == pImage)
+    {
+        return NULL;
+    }
+
+    CopyMemory(
+        view.abData,
+        pImageData->abData,
+        (SIZE_T) view.cbStride * view.uHeight);
+
+    return DetachClipboardImage(pImage);
+}
+
+static HGLOBAL
+RenderImageFormat(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN DWORD                dwFormat
+    )
+{
+    if (WU_CLIPBOARD_IMAGE_DIB == dwFormat)
+    {
+        return CreateDibFromImageData(pImageData);
+    }
+
+    return WuSaveImageDataToHGlobal(pImageData, WU_IMAGE_FORMAT_PNG);
+}
+
+/*
+    Called with the clipboard open, either by the application asking for
+    the data (WM_RENDERFORMAT) or by us (WM_RENDERALLFORMATS, flush).
+    The format stays pending until SetClipboardData took the data, so a
+    failed render can be asked for again.
+*/
+static BOOL
+RenderDelayedFormat(
+    IN UINT uFormat
+    )
+{
+    HWUIMAGE     hImage     = NULL;
+    HWUIMAGE     hRelease   = NULL;
+    PWUIMAGEDATA pImageData = NULL;
+    HGLOBAL      hData      = NULL;
+    DWORD        dwFormat   = ClipboardFormatToImageFlag(uFormat);
+    BOOL         bResult    = FALSE;
+
+    AcquireSRWLockShared(&g_delayedLock);
+
+    if ((dwFormat != 0) && (g_dwDelayedFormats & dwFormat))
+    {
+        hImage = WuRetainImageHandle(g_hDelayedImage);
+    }
+
+    ReleaseSRWLockShared(&g_delayedLock);
+
+    if (NULL == hImage)
+    {
+        return FALSE;
+    }
+
+    /* encoding can take a while, it runs outside the lock */
+    pImageData = WuLockImageHandleData(hImage);
+
+    if (pImageData != NULL)
+    {
+        hData = RenderImageFormat(pImageData, dwFormat);
+        WuUnlockImageHandleData(hImage, pImageData);
+    }
+
+    if (NULL == hData)
+    {
+        goto cleanup;
+    }
+
+    if (NULL == SetClipboardData(uFormat, hData))
+    {
+        GlobalFree(hData);
+        goto cleanup;
+    }
+
+    AcquireSRWLockExclusive(&g_delayedLock);
+
+    /* unless a newer image replaced ours in the meantime */
+    if (g_hDelayedImage == hImage)
+    {
+        g_dwDelayedFormats &= ~dwFormat;
+
+        /* the last format rendered, the pixels are no longer needed */
+        if (0 == g_dwDelayedFormats)
+        {
+            hRelease        = g_hDelayedImage;
+            g_hDelayedImage = NULL;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_delayedLock);
+
+    bResult = TRUE;
+
+cleanup:
+    WuReleaseImageHandle(hImage);
+
+    if (hRelease != NULL)
+    {
+        WuReleaseImageHandle(hRelease);
+    }
+
+    return bResult;
+}
+
+/*
+    The owner window if it was already created, NULL otherwise. Unlike
+    GetClipboardOwnerWindow, never creates it.
+*/
+static HWND
+FindClipboardOwnerWindow(
+    VOID
+    )
+{
+    BOOL bPending = FALSE;
+
+    /* a completed INIT_ONCE orders the read of g_hOwnerWnd after it */
+    if (InitOnceBeginInitialize(&g_ownerInitOnce, INIT_ONCE_CHECK_ONLY,
+            &bPending, NULL) == FALSE)
+    {
+        return NULL;
+    }
+
+    return (FALSE == bPending) ? g_hOwnerWnd : NULL;
+}
+
+static BOOL
+RenderAllDelayedFormats_WorkerProc(
+    IN LPVOID   lpUnused
+    )
+{
+    HWND  hOwnerWnd = FindClipboardOwnerWindow();
+    DWORD dwFormats = 0;
+    BOOL  bResult   = TRUE;
+
+    UNREFERENCED_PARAMETER(lpUnused);
+
+    /* someone else took the clipboard since, nothing left to render */
+    if ((NULL == hOwnerWnd) || (GetClipboardOwner() != hOwnerWnd))
+    {
+        return TRUE;
+    }
+
+    AcquireSRWLockShared(&g_delayedLock);
+
+    dwFormats = g_dwDelayedFormats;
+
+    ReleaseSRWLockShared(&g_delayedLock);
+
+    if (dwFormats & WU_CLIPBOARD_IMAGE_DIB)
+    {
+        bResult &= RenderDelayedFormat(CF_DIB);
+    }
+
+    if (dwFormats & WU_CLIPBOARD_IMAGE_PNG)
+    {
+        bResult &= RenderDelayedFormat(GetPngClipboardFormat());
+    }
+
+    return bResult;
+}
+
+static VOID
+ReleaseDelayedImage(
+    VOID
+    )
+{
+    HWUIMAGE hImage = NULL;
+
+    AcquireSRWLockExclusive(&g_delayedLock);
+
+    hImage             = g_hDelayedImage;
+    g_hDelayedImage    = NULL;
+    g_dwDelayedFormats = 0;
+
+    ReleaseSRWLockExclusive(&g_delayedLock);
+
+    if (hImage != NULL)
+    {
+        WuReleaseImageHandle(hImage);
+    }
+}
+
+static LRESULT CALLBACK
+ClipboardOwnerWndProc(
+    IN HWND     hWnd,
+    IN UINT     uMsg,
+    IN WPARAM   wParam,
+    IN LPARAM   lParam
+    )
+{
+    switch (uMsg)
+    {
+        case WM_RENDERFORMAT:
+            RenderDelayedFormat((UINT) wParam);
+            return 0;
+        case WM_RENDERALLFORMATS:
+            /* only sent if the window goes away before the process */
+            if (OpenClipboard(hWnd) == TRUE)
+            {
+                RenderAllDelayedFormats_WorkerProc(NULL);
+                CloseClipboard();
+            }
+            return 0;
+        case WM_DESTROYCLIPBOARD:
+            ReleaseDelayedImage();
+            return 0;
+    }
+
+    return DefWindowProcW(hWnd, uMsg, wParam, lParam);
+}
+
+static DWORD WINAPI
+ClipboardOwnerThreadProc(
+    IN LPVOID   lpParameter
+    )
+{
+    POWNERTHREADSTART pStart    = (POWNERTHREADSTART) lpParameter;
+    WNDCLASSEXW       wndClass;
+    MSG               msg;
+    HINSTANCE         hInstance = NULL;
+    HWND              hWnd      = NULL;
+
+    /*
+        The window procedure must outlive any FreeLibrary of a DLL build,
+        so the module is pinned while the handle is looked up.
+    */
+    GetModuleHandleExW(
+        GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+            | GET_MODULE_HANDLE_EX_FLAG_PIN,
+        (LPCWSTR) ClipboardOwnerWndProc,
+        &hInstance);
+
+    ZeroMemory(&wndClass, sizeof(WNDCLASSEXW));
+
+    wndClass.cbSize        = sizeof(WNDCLASSEXW);
+    wndClass.lpfnWndProc   = ClipboardOwnerWndProc;
+    wndClass.hInstance     = hInstance;
+    wndClass.lpszClassName = CLIPBOARD_OWNER_CLASS_NAME;
+
+    RegisterClassExW(&wndClass);
+
+    hWnd = CreateWindowExW(
+        0,
+        CLIPBOARD_OWNER_CLASS_NAME,
+        NULL,
+        0,
+        0, 0, 0, 0,
+        HWND_MESSAGE,
+        NULL,
+        hInstance,
+        NULL);
+
+    /* pStart belongs to the creator again once the event is set */
+    pStart->hWnd = hWnd;
+    SetEvent(pStart->hReady);
+
+    if (NULL == hWnd)
+    {
+        return 1;
+    }
+
+    while (GetMessageW(&msg, NULL, 0, 0) > 0)
+    {
+        DispatchMessageW(&msg);
+    }
+
+    return 0;
+}
+
+static BOOL CALLBACK
+CreateClipboardOwner_InitOnceProc(
+    IN OUT PINIT_ONCE   pInitOnce,
+    IN OUT PVOID        pParameter,
+    OUT    PVOID*       ppContext
+    )
+{
+    OWNERTHREADSTART start;
+    HANDLE           hThread = NULL;
+
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pParameter);
+    UNREFERENCED_PARAMETER(ppContext);
+
+    start.hWnd   = NULL;
+    start.hReady = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    if (NULL == start.hReady)
+    {
+        return FALSE;
+    }
+
+    hThread = CreateThread(
+        NULL,
+        0,
+        ClipboardOwnerThreadProc,
+        &start,
+        0,
+        NULL);
+
+    if (hThread != NULL)
+    {
+        WaitForSingleObject(start.hReady, INFINITE);
+        CloseHandle(hThread);
+    }
+
+    CloseHandle(start.hReady);
+
+    g_hOwnerWnd = start.hWnd;
+
+    /* on failure the next call tries again */
+    return (g_hOwnerWnd != NULL);
+}
+
+static HWND
+GetClipboardOwnerWindow(
+    VOID
+    )
+{
+    if (InitOnceExecuteOnce(&g_ownerInitOnce,
+            CreateClipboardOwner_InitOnceProc, NULL, NULL) == FALSE)
+    {
+        return NULL;
+    }
+
+    return g_hOwnerWnd;
+}
+
+WUAPI PWUCLIPBOARDIMAGE
+WuCreateClipboardImage(
+    IN  UINT            uWidth,
+    IN  UINT            uHeight,
+    OUT PWUIMAGEVIEW    pView
+    )
+{
+    BITMAPINFOHEADER  bmiHeader;
+    PWUCLIPBOARDIMAGE pImage    = NULL;
+    SIZE_T            cbImage   = 0;
+
+    if ((NULL == pView) || (0 == uWidth) || (0 == uHeight))
+    {
+        return NULL;
+    }
+
+    if (_WuGetImageDataSize(uWidth, uHeight, &cbImage) == FALSE)
+    {
+        return NULL;
+    }
+
+    /* biSizeImage is a DWORD, larger images cannot be a CF_DIB */
+    if (cbImage > MAXDWORD - sizeof(BITMAPINFOHEADER))
+    {
+        return NULL;
+    }
+
+    pImage = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUCLIPBOARDIMAGE));
+
+    if (NULL == pImage)
+    {
+        return NULL;
+    }
+
+    ZeroMemory(&bmiHeader, sizeof(BITMAPINFOHEADER));
+
+    bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmiHeader.biWidth       = uWidth;
+    bmiHeader.biHeight      = -(LONG) uHeight;
+    bmiHeader.biPlanes      = 1;
+    bmiHeader.biBitCount    = 32;
+    bmiHeader.biCompression = BI_RGB;
+    bmiHeader.biSizeImage   = (DWORD) cbImage;
+
+    pImage->hDib = GlobalAlloc(
+        GMEM_MOVEABLE,
+        sizeof(BITMAPINFOHEADER) + cbImage);
+
+    if (NULL == pImage->hDib)
+    {
+        HeapFree(GetProcessHeap(), 0, pImage);
+        return NULL;
+    }
+
+    pImage->pbDib = (BYTE*) GlobalLock(pImage->hDib);
+
+    if (NULL == pImage->pbDib)
+    {
+        GlobalFree(pImage->hDib);
+        HeapFree(GetProcessHeap(), 0, pImage);
+        return NULL;
+    }
+
+    CopyMemory(pImage->pbDib, &bmiHeader, sizeof(BITMAPINFOHEADER));
+
+    pView->abData   = pImage->pbDib + sizeof(BITMAPINFOHEADER);
+    pView->uWidth   = uWidth;
+    pView->uHeight  = uHeight;
+    pView->cbStride = uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    return pImage;
+}
+
+typedef struct tagCLIPBOARDITEM {
+    UINT    uFormat;
+    HANDLE  hData;              /* NULL once owned by the clipboard */
+} CLIPBOARDITEM, *PCLIPBOARDITEM;
+
+typedef struct tagCLIPBOARDITEMS {
+    UINT            cItems;
+    CLIPBOARDITEM   aItems[CLIPBOARD_MAX_ITEMS];
+} CLIPBOARDITEMS, *PCLIPBOARDITEMS;
+
+static BOOL
+SetClipboardItems_WorkerProc(
+    IN PCLIPBOARDITEMS  pItems
+    )
+{
+    UINT i = 0;
+
+    if (EmptyClipboard() == FALSE)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < pItems->cItems; ++i)
+    {
+        if (NULL == SetClipboardData(
+                pItems->aItems[i].uFormat,
+                pItems->aItems[i].hData))
+        {
+            return FALSE;
+        }
+
+        pItems->aItems[i].hData = NULL;
+    }
+
+    return TRUE;
+}
+
+/* The blocks are prepared beforehand, the clipboard is only held to swap */
+static BOOL
+SetClipboardItems(
+    IN  PCLIPBOARDITEMS pItems,
+    OUT PULONG          puHoldMicroseconds
+    )
+{
+    BOOL bResult = FALSE;
+    UINT i       = 0;
+
+    for (i = 0; i < pItems->cItems; ++i)
+    {
+        if (NULL == pItems->aItems[i].hData)
+        {
+            break;
+        }
+    }
+
+    /* a block that could not be made fails the whole set */
+    if (i == pItems->cItems)
+    {
+        bResult = WithOpenedClipboard(
+            (CLIPBOARDWORKPROC) SetClipboardItems_WorkerProc,
+            (LPVOID) pItems,
+            puHoldMicroseconds);
+    }
+
+    for (i = 0; i < pItems->cItems; ++i)
+    {
+        if (pItems->aItems[i].hData != NULL)
+        {
+            GlobalFree(pItems->aItems[i].hData);
+        }
+    }
+
+    return bResult;
+}
+
+WUAPI BOOL
+WuCommitClipboardImage(
+    IN  PWUCLIPBOARDIMAGE   pImage,
+    OUT PULONG              puHoldMicroseconds
+    )
+{
+    CLIPBOARDITEMS items;
+
+    if (NULL == pImage)
+    {
+        return FALSE;
+    }
+
+    items.cItems            = 1;
+    items.aItems[0].uFormat = CF_DIB;
+    items.aItems[0].hData   = DetachClipboardImage(pImage);
+
+    return SetClipboardItems(&items, puHoldMicroseconds);
+}
+
+WUAPI VOID
+WuDiscardClipboardImage(
+    IN PWUCLIPBOARDIMAGE    pImage
+    )
+{
+    if (NULL == pImage)
+    {
+        return;
+    }
+
+    GlobalFree(DetachClipboardImage(pImage));
+}
+
+WUAPI BOOL
+WuSetClipboardImageData(
+    IN PWUIMAGEDATA pImageData
+    )
+{
+    return WuSetClipboardImageDataEx(pImageData, WU_CLIPBOARD_IMAGE_DIB);
+}
+
+typedef struct tagDELAYEDIMAGE {
+    HWUIMAGE    hImage;         /* NULL once kept for WM_RENDERFORMAT */
+    DWORD       dwFormats;
+} DELAYEDIMAGE, *PDELAYEDIMAGE;
+
+static BOOL
+SetDelayedImage_WorkerProc(
+    IN PDELAYEDIMAGE    pDelayed
+    )
+{
+    HWUIMAGE hPrevious = NULL;
+
+    /* sends WM_DESTROYCLIPBOARD, which drops an earlier delayed image */
+    if (EmptyClipboard() == FALSE)
+    {
+        return FALSE;
+    }
+
+    AcquireSRWLockExclusive(&g_delayedLock);
+
+    hPrevious          = g_hDelayedImage;
+    g_hDelayedImage    = pDelayed->hImage;
+    g_dwDelayedFormats = pDelayed->dwFormats;
+
+    ReleaseSRWLockExclusive(&g_delayedLock);
+
+    pDelayed->hImage = NULL;
+
+    if (hPrevious != NULL)
+    {
+        WuReleaseImageHandle(hPrevious);
+    }
+
+    if (pDelayed->dwFormats & WU_CLIPBOARD_IMAGE_DIB)
+    {
+        SetClipboardData(CF_DIB, NULL);
+    }
+
+    if (pDelayed->dwFormats & WU_CLIPBOARD_IMAGE_PNG)
+    {
+        SetClipboardData(GetPngClipboardFormat(), NULL);
+    }
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuSetClipboardImageHandle(
+    IN HWUIMAGE hImage,
+    IN DWORD    dwFlags
+    )
+{
+    DELAYEDIMAGE delayed;
+    PWUIMAGEDATA pImageData = NULL;
+    BOOL         bResult    = FALSE;
+
+    if ((NULL == hImage) || (0 == (dwFlags & WU_CLIPBOARD_IMAGE_FORMATS)))
+    {
+        return FALSE;
+    }
+
+    if (0 == (dwFlags & WU_CLIPBOARD_IMAGE_DELAYED))
+    {
+        /* the caller's handle, other threads may write through it */
+        pImageData = WuLockImageHandleData(hImage);
+
+        if (NULL == pImageData)
+        {
+            return FALSE;
+        }
+
+        bResult = WuSetClipboardImageDataEx(pImageData, dwFlags);
+
+        WuUnlockImageHandleData(hImage, pImageData);
+
+        return bResult;
+    }
+
+    /* a handle of our own, so later writes by the caller copy the pixels */
+    delayed.hImage    = WuShareImageHandle(hImage);
+    delayed.dwFormats = dwFlags & WU_CLIPBOARD_IMAGE_FORMATS;
+
+    if (NULL == delayed.hImage)
+    {
+        return FALSE;
+    }
+
+    bResult = WithOpenedClipboard(
+        (CLIPBOARDWORKPROC) SetDelayedImage_WorkerProc,
+        (LPVOID) &delayed,
+        NULL);
+
+    if (delayed.hImage != NULL)
+    {
+        WuReleaseImageHandle(delayed.hImage);
+    }
+
+    return bResult;
+}
+
+WUAPI BOOL
+WuSetClipboardImageDataEx(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN DWORD                dwFlags
+    )
+{
+    CLIPBOARDITEMS items;
+    PWUIMAGEDATA   pCopy   = NULL;
+    HWUIMAGE       hImage  = NULL;
+    BOOL           bResult = FALSE;
+    SIZE_T         cbImage = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    if (0 == (dwFlags & WU_CLIPBOARD_IMAGE_FORMATS))
+    {
+        return FALSE;
+    }
+
+    if (dwFlags & WU_CLIPBOARD_IMAGE_DELAYED)
+    {
+        /* the caller's image may change or go away before anyone pastes */
+        if (_WuGetImageDataSize(pImageData->uWidth, pImageData->uHeight,
+                &cbImage) == FALSE)
+        {
+            return FALSE;
+        }
+
+        pCopy = _WuCreateUninitializedImageData(
+            pImageData->uWidth,
+            pImageData->uHeight);
+
+        if (NULL == pCopy)
+        {
+            return FALSE;
+        }
+
+        CopyMemory(pCopy->abData, pImageData->abData, cbImage);
+
+        hImage = WuCreateImageHandle(pCopy);
+
+        if (NULL == hImage)
+        {
+            WuDestroyImageData(pCopy);
+            return FALSE;
+        }
+
+        bResult = WuSetClipboardImageHandle(hImage, dwFlags);
+
+        WuReleaseImageHandle(hImage);
+
+        return bResult;
+    }
+
+    /* everything is encoded before the clipboard is opened */
+    items.cItems = 0;
+
+    if (dwFlags & WU_CLIPBOARD_IMAGE_DIB)
+    {
+        items.aItems[items.cItems].uFormat = CF_DIB;
+        items.aItems[items.cItems].hData   =
+            CreateDibFromImageData(pImageData);
+        items.cItems++;
+    }
+
+    if (dwFlags & WU_CLIPBOARD_IMAGE_PNG)
+    {
+        items.aItems[items.cItems].uFormat = GetPngClipboardFormat();
+        items.aItems[items.cItems].hData   = WuSaveImageDataToHGlobal(
+            pImageData,
+            WU_IMAGE_FORMAT_PNG);
+        items.cItems++;
+    }
+
+    return SetClipboardItems(&items, NULL);
+}
+
+WUAPI BOOL
+WuFlushClipboard(
+    VOID
+    )
+{
+    if (NULL == FindClipboardOwnerWindow())
+    {
+        return TRUE;            /* nothing was ever delayed */
+    }
+
+    return WithOpenedClipboard(
+        (CLIPBOARDWORKPROC) RenderAllDelayedFormats_WorkerProc,
+        NULL,
+        NULL);
+}
+
+/* Parses the packed DIB in place, while the clipboard is still open */
+static PWUIMAGEDATA
+ReadClipboardDib(
+    IN UINT uFormat
+    )
+{
+    HANDLE       hClipboardData = NULL;
+    CONST BYTE*  pbDib          = NULL;
+    PWUIMAGEDATA pImageData     = NULL;
+
+    hClipboardData = GetClipboardData(uFormat);
+
+    if (NULL == hClipboardData)
+    {
+        return NULL;
+    }
+
+    pbDib = (CONST BYTE*) GlobalLock(hClipboardData);
+
+    if (NULL == pbDib)
+    {
+        return NULL;
+    }
+
+    pImageData = WuImageDataFromPackedDib(
+        pbDib,
+        GlobalSize(hClipboardData));
+
+    GlobalUnlock(hClipboardData);
+
+    return pImageData;
+}
+
+typedef struct tagCLIPBOARDIMAGEREAD {
+    PWUIMAGEDATA    pImageData;
+    BYTE*           pbPng;      /* copied out, decoded once closed */
+    SIZE_T          cbPng;
+    BOOL            bSkipPng;   /* it did not decode, use the bitmaps */
+} CLIPBOARDIMAGEREAD, *PCLIPBOARDIMAGEREAD;
+
+/*
+    Decoding a PNG takes far longer than copying it, so only the copy is
+    made while the clipboard is held.
+*/
+static BOOL
+CopyClipboardPng(
+    IN PCLIPBOARDIMAGEREAD  pRead
+    )
+{
+    HANDLE      hClipboardData = NULL;
+    CONST BYTE* pbPng          = NULL;
+    SIZE_T      cbPng          = 0;
+
+    hClipboardData = GetClipboardData(GetPngClipboardFormat());
+
+    if (NULL == hClipboardData)
+    {
+        return FALSE;
+    }
+
+    pbPng = (CONST BYTE*) GlobalLock(hClipboardData);
+
+    if (NULL == pbPng)
+    {
+        return FALSE;
+    }
+
+    cbPng        = GlobalSize(hClipboardData);
+    pRead->pbPng = HeapAlloc(GetProcessHeap(), 0, max(cbPng, 1));
+
+    if (pRead->pbPng != NULL)
+    {
+        CopyMemory(pRead->pbPng, pbPng, cbPng);
+        pRead->cbPng = cbPng;
+    }
+
+    GlobalUnlock(hClipboardData);
+
+    return (pRead->pbPng != NULL);
+}
+
+static BOOL
+WuGetClipboardImageData_WorkerProc(
+    IN PCLIPBOARDIMAGEREAD  pRead
+    )
+{
+    HBITMAP hClipboardData = NULL;
+
+    /* PNG is the only format that is sure to keep alpha */
+    if ((FALSE == pRead->bSkipPng)
+        && (IsClipboardFormatAvailable(GetPngClipboardFormat()) == TRUE)
+        && (CopyClipboardPng(pRead) == TRUE))
+    {
+        return TRUE;
+    }
+
+    /*
+        The DIB formats need no GDI round trip; CF_BITMAP is left for the
+        bitmaps the parser rejects (RLE, JPEG, PNG payloads).
+    */
+    if (IsClipboardFormatAvailable(CF_DIBV5) == TRUE)
+    {
+        pRead->pImageData = ReadClipboardDib(CF_DIBV5);
+    }
+
+    if ((NULL == pRead->pImageData)
+        && (IsClipboardFormatAvailable(CF_DIB) == TRUE))
+    {
+        pRead->pImageData = ReadClipboardDib(CF_DIB);
+    }
+
+    if (NULL == pRead->pImageData)
+    {
+        hClipboardData = (HBITMAP) GetClipboardData(CF_BITMAP);
+
+        if (NULL == hClipboardData)
+        {
+            return FALSE;
+        }
+
+        pRead->pImageData = WuExtractImageDataFromHBITMAP(hClipboardData);
+    }
+
+    return (pRead->pImageData != NULL);
+}
+
+WUAPI BOOL
+WuGetClipboardImageData(
+    IN PWUIMAGEDATA*    ppImageData
+    )
+{
+    CLIPBOARDIMAGEREAD read;
+
+    if (NULL == ppImageData)
+    {
+        return FALSE;
+    }
+
+    /* the DIB formats and CF_BITMAP are synthesized from each other */
+    if ((IsClipboardFormatAvailable(GetPngClipboardFormat()) == FALSE)
+        && (IsClipboardFormatAvailable(CF_DIB) == FALSE)
+        && (IsClipboardFormatAvailable(CF_BITMAP) == FALSE))
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(&read, sizeof(CLIPBOARDIMAGEREAD));
+
+    if (WithOpenedClipboard(
+            (CLIPBOARDWORKPROC) WuGetClipboardImageData_WorkerProc,
+            (LPVOID) &read,
+            NULL) == FALSE)
+    {
+        return FALSE;
+    }
+
+    if (read.pbPng != NULL)
+    {
+        read.pImageData = WuLoadImageDataFromMemory(
+            read.pbPng,
+            read.cbPng,
+            0);
+
+        HeapFree(GetProcessHeap(), 0, read.pbPng);
+        read.pbPng = NULL;
+
+        /* a PNG we cannot decode, the DIB formats may still be fine */
+        if (NULL == read.pImageData)
+        {
+            read.bSkipPng = TRUE;
+
+            WithOpenedClipboard(
+                (CLIPBOARDWORKPROC) WuGetClipboardImageData_WorkerProc,
+                (LPVOID) &read,
+                NULL);
+        }
+    }
+
+    if (NULL == read.pImageData)
+    {
+        return FALSE;
+    }
+
+    *ppImageData = read.pImageData;
+
+    return TRUE;
+}
+
+WUAPI VOID
+WuGetClipboardStats(
+    OUT PWUCLIPBOARDSTATS   pStats
+    )
+{
+    ULONGLONG cAccesses = 0;
+
+    if (NULL == pStats)
+    {
+        return;
+    }
+
+    AcquireSRWLockShared(&g_statsLock);
+
+    *pStats = g_stats;
+
+    cAccesses = g_stats.cOpens + g_stats.cFailedOpens;
+
+    pStats->ullP50Microseconds = GetLatencyPercentile(cAccesses, 50);
+    pStats->ullP90Microseconds = GetLatencyPercentile(cAccesses, 90);
+    pStats->ullP99Microseconds = GetLatencyPercentile(cAccesses, 99);
+
+    ReleaseSRWLockShared(&g_statsLock);
 }
@@ -0,0 +1,554 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       color.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <math.h>
+
+#include "internal.h"
+
+#define LUMA_STANDARD_MAX       2
+
+#define TABLES_STATE_EMPTY      0
+#define TABLES_STATE_BUILDING   1
+#define TABLES_STATE_READY      2
+
+/* Q14 luma weights, each triple sums to exactly 1 << 14 */
+#define LUMA_SHIFT  14
+
+/* fraction bits of the linear luma, an index into abLinearToSrgb8 */
+#define LUMA_INDEX_SHIFT    16
+
+typedef struct tagLUMACOEFFICIENTS {
+    DOUBLE  dbKr;
+    DOUBLE  dbKg;
+    DOUBLE  dbKb;
+    INT     iWeightR;
+    INT     iWeightG;
+    INT     iWeightB;
+} LUMACOEFFICIENTS;
+
+/*
+    Linear value of each sRGB byte times its weight, scaled so that the sum
+    of the three is a 16.16 index into abLinearToSrgb8 (at most 2^30)
+*/
+typedef struct tagLUMATABLES {
+    DWORD   adwWeightedB[256];
+    DWORD   adwWeightedG[256];
+    DWORD   adwWeightedR[256];
+} LUMATABLES;
+
+static CONST LUMACOEFFICIENTS g_aLumaCoefficients[LUMA_STANDARD_MAX] = {
+    { 0.299,  0.587,  0.114,  4899, 9617,  1868 },     /* WU_LUMA_BT601 */
+    { 0.2126, 0.7152, 0.0722, 3483, 11718, 1183 }      /* WU_LUMA_BT709 */
+};
+
+static WUCOLORTABLES g_colorTables;
+static LUMATABLES    g_aLumaTables[LUMA_STANDARD_MAX];
+static LONG volatile g_lTablesState = TABLES_STATE_EMPTY;
+
+static DOUBLE
+SrgbToLinearExact(
+    IN DOUBLE   dbSrgb
+    )
+{
+    if (dbSrgb <= 0.04045)
+    {
+        return dbSrgb / 12.92;
+    }
+
+    return pow((dbSrgb + 0.055) / 1.055, 2.4);
+}
+
+static DOUBLE
+LinearToSrgbExact(
+    IN DOUBLE   dbLinear
+    )
+{
+    if (dbLinear <= 0.0031308)
+    {
+        return dbLinear * 12.92;
+    }
+
+    return 1.055 * pow(dbLinear, 1.0 / 2.4) - 0.055;
+}
+
+static VOID
+BuildColorTables(
+    OUT WUCOLORTABLES*  pTables
+    )
+{
+    DOUBLE dbLinear = 0.0;
+    UINT   i        = 0;
+
+    for (i = 0; i < 256; ++i)
+    {
+        dbLinear = SrgbToLinearExact(i / 255.0);
+
+        pTables->afSrgbToLinear[i]   = (FLOAT) dbLinear;
+        pTables->awSrgbToLinear16[i] = (WORD) (dbLinear * 65535.0 + 0.5);
+    }
+
+    /* sRGB values in 8.8 fixed point, interpolated by _WuLinear16ToSrgb */
+    for (i = 0; i <= WU_LINEAR_TO_SRGB_TABLE_SIZE; ++i)
+    {
+        dbLinear = (DOUBLE) i / WU_LINEAR_TO_SRGB_TABLE_SIZE;
+
+        pTables->awLinearToSrgb[i] =
+            (WORD) (LinearToSrgbExact(dbLinear) * 255.0 * 256.0 + 0.5);
+    }
+
+    for (i = 0; i <= WU_LINEAR_TO_SRGB8_TABLE_SIZE; ++i)
+    {
+        dbLinear = (DOUBLE) i / WU_LINEAR_TO_SRGB8_TABLE_SIZE;
+
+        pTables->abLinearToSrgb8[i] =
+            (BYTE) (LinearToSrgbExact(dbLinear) * 255.0 + 0.5);
+    }
+}
+
+static VOID
+BuildLumaTables(
+    IN  CONST WUCOLORTABLES*    pTables,
+    OUT LUMATABLES*             aLumaTables
+    )
+{
+    CONST LUMACOEFFICIENTS* pCoefficients = NULL;
+    DOUBLE                  dbScale       = 0.0;
+    UINT                    uStandard     = 0;
+    UINT                    i             = 0;
+
+    for (uStandard = 0; uStandard < LUMA_STANDARD_MAX; ++uStandard)
+    {
+        pCoefficients = &g_aLumaCoefficients[uStandard];
+
+        for (i = 0; i < 256; ++i)
+        {
+            dbScale = (DOUBLE) pTables->afSrgbToLinear[i]
+                * WU_LINEAR_TO_SRGB8_TABLE_SIZE
+                * (1 << (LUMA_INDEX_SHIFT - LUMA_SHIFT));
+
+            aLumaTables[uStandard].adwWeightedB[i] =
+                (DWORD) (dbScale * pCoefficients->iWeightB + 0.5);
+            aLumaTables[uStandard].adwWeightedG[i] =
+                (DWORD) (dbScale * pCoefficients->iWeightG + 0.5);
+            aLumaTables[uStandard].adwWeightedR[i] =
+                (DWORD) (dbScale * pCoefficients->iWeightR + 0.5);
+        }
+    }
+}
+
+CONST WUCOLORTABLES*
+_WuGetColorTables(
+    VOID
+    )
+{
+    LONG lState = 0;
+
+    lState = InterlockedCompareExchange(
+        &g_lTablesState,
+        TABLES_STATE_BUILDING,
+        TABLES_STATE_EMPTY);
+
+    if (TABLES_STATE_EMPTY == lState)
+    {
+        BuildColorTables(&g_colorTables);
+        BuildLumaTables(&g_colorTables, g_aLumaTables);
+        InterlockedExchange(&g_lTablesState, TABLES_STATE_READY);
+    }
+    else
+    {
+        /* another thread is building the tables, this takes microseconds */
+        while (InterlockedCompareExchange(&g_lTablesState, 0, 0)
+                != TABLES_STATE_READY)
+        {
+            Sleep(0);
+        }
+    }
+
+    return &g_colorTables;
+}
+
+VOID
+_WuRowToLinear16(
+    IN  CONST BYTE* pbSrc,
+    OUT WORD*       pwDst,
+    IN  SIZE_T      cPixels
+    )
+{
+    CONST WUCOLORTABLES* pTables = _WuGetColorTables();
+    SIZE_T               i       = 0;
+
+    for (i = 0; i < cPixels; ++i, pbSrc += 4, pwDst += 4)
+    {
+        pwDst[0] = pTables->awSrgbToLinear16[pbSrc[0]];
+        pwDst[1] = pTables->awSrgbToLinear16[pbSrc[1]];
+        pwDst[2] = pTables->awSrgbToLinear16[pbSrc[2]];
+        pwDst[3] = (WORD) (pbSrc[3] * 257);     /* alpha stays linear */
+    }
+}
+
+VOID
+_WuLinear16ToRow(
+    IN  CONST WORD* pwSrc,
+    OUT BYTE*       pbDst,
+    IN  SIZE_T      cPixels
+    )
+{
+    CONST WUCOLORTABLES* pTables = _WuGetColorTables();
+    SIZE_T               i       = 0;
+
+    for (i = 0; i < cPixels; ++i, pwSrc += 4, pbDst += 4)
+    {
+        pbDst[0] = _WuLinear16ToSrgb(pTables, pwSrc[0]);
+        pbDst[1] = _WuLinear16ToSrgb(pTables, pwSrc[1]);
+        pbDst[2] = _WuLinear16ToSrgb(pTables, pwSrc[2]);
+        pbDst[3] = (BYTE) ((pwSrc[3] + 128) / 257);
+    }
+}
+
+WUAPI FLOAT
+WuSrgbToLinear(
+    IN BYTE bSrgb
+    )
+{
+    return _WuGetColorTables()->afSrgbToLinear[bSrgb];
+}
+
+WUAPI BYTE
+WuLinearToSrgb(
+    IN FLOAT    fLinear
+    )
+{
+    WORD wLinear = 0;
+
+    if (!(fLinear > 0.0f))      /* also catches NaN */
+    {
+        return 0;
+    }
+
+    if (fLinear >= 1.0f)
+    {
+        return 0xFF;
+    }
+
+    wLinear = (WORD) (fLinear * 65535.0f + 0.5f);
+
+    return _WuLinear16ToSrgb(_WuGetColorTables(), wLinear);
+}
+
+static VOID
+GrayscaleRowSrgb(
+    IN OUT BYTE*                    pbRow,
+    IN     UINT                     cPixels,
+    IN     CONST LUMACOEFFICIENTS*  pCoefficients
+    )
+{
+    UINT  x      = 0;
+    DWORD dwLuma = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i weights, zero, rounding, alphaMask;
+    __m128i pixels, lo, hi, luma, gray;
+
+    /* BGRA byte order, alpha weight is zero */
+    weights = _mm_set_epi16(
+        0, (SHORT) pCoefficients->iWeightR,
+        (SHORT) pCoefficients->iWeightG, (SHORT) pCoefficients->iWeightB,
+        0, (SHORT) pCoefficients->iWeightR,
+        (SHORT) pCoefficients->iWeightG, (SHORT) pCoefficients->iWeightB);
+
+    zero      = _mm_setzero_si128();
+    rounding  = _mm_set1_epi32(1 << (LUMA_SHIFT - 1));
+    alphaMask = _mm_set1_epi32((INT) 0xFF000000);
+
+    for (; x + 4 <= cPixels; x += 4)
+    {
+        pixels = _mm_loadu_si128((CONST __m128i*) (pbRow + x * 4));
+
+        /* (b*wb + g*wg, r*wr) per pixel, then fold the two halves */
+        lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+
+        lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+        hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+
+        luma = _mm_unpacklo_epi64(
+            _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+            _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+
+        luma = _mm_srli_epi32(_mm_add_epi32(luma, rounding), LUMA_SHIFT);
+
+        gray = _mm_or_si128(luma, _mm_slli_epi32(luma, 8));
+        gray = _mm_or_si128(gray, _mm_slli_epi32(luma, 16));
+        gray = _mm_or_si128(gray, _mm_and_si128(pixels, alphaMask));
+
+        _mm_storeu_si128((__m128i*) (pbRow + x * 4), gray);
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        dwLuma = (pbRow[x * 4 + 0] * pCoefficients->iWeightB
+                + pbRow[x * 4 + 1] * pCoefficients->iWeightG
+                + pbRow[x * 4 + 2] * pCoefficients->iWeightR
+                + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT;
+
+        pbRow[x * 4 + 0] = (BYTE) dwLuma;
+        pbRow[x * 4 + 1] = (BYTE) dwLuma;
+        pbRow[x * 4 + 2] = (BYTE) dwLuma;
+    }
+}
+
+/*
+    The per-channel tables fold the sRGB decode and the luma weight into
+    one lookup each, so a pixel costs three loads and two adds, plus one
+    lookup back to sRGB. Without a gather instruction an SSE2 version has
+    to move every index and table value between lanes and general purpose
+    registers, which made it slower than this loop.
+*/
+static VOID
+GrayscaleRowLinear(
+    IN OUT BYTE*                pbRow,
+    IN     UINT                 cPixels,
+    IN     CONST LUMATABLES*    pLuma,
+    IN     CONST WUCOLORTABLES* pTables
+    )
+{
+    CONST BYTE* abToSrgb = pTables->abLinearToSrgb8;
+    DWORD*      pdwRow   = (DWORD*) pbRow;
+    DWORD       dwPixel  = 0;
+    DWORD       dwLuma   = 0;
+    UINT        x        = 0;
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        dwPixel = pdwRow[x];
+        dwLuma  = (pLuma->adwWeightedB[dwPixel & 0xFF]
+                 + pLuma->adwWeightedG[(dwPixel >> 8) & 0xFF]
+                 + pLuma->adwWeightedR[(dwPixel >> 16) & 0xFF]
+                 + (1 << (LUMA_INDEX_SHIFT - 1))) >> LUMA_INDEX_SHIFT;
+
+        pdwRow[x] = (dwPixel & 0xFF000000) | (abToSrgb[dwLuma] * 0x010101);
+    }
+}
+
+VOID
+_WuGrayscaleRow(
+    IN OUT BYTE*            pbRow,
+    IN     UINT             cPixels,
+    IN     WU_LUMA_STANDARD standard,
+    IN     DWORD            dwFlags
+    )
+{
+    if (dwFlags & WU_COLOR_LINEAR_LIGHT)
+    {
+        CONST WUCOLORTABLES* pTables = _WuGetColorTables();
+
+        GrayscaleRowLinear(
+            pbRow,
+            cPixels,
+            &g_aLumaTables[standard],
+            pTables);
+    }
+    else
+    {
+        GrayscaleRowSrgb(pbRow, cPixels, &g_aLumaCoefficients[standard]);
+    }
+}
+
+WUAPI BOOL
+WuConvertImageDataToGrayscale(
+    IN PWUIMAGEDATA     pImageData,
+    IN WU_LUMA_STANDARD standard,
+    IN DWORD            dwFlags
+    )
+{
+    SIZE_T cbRow = 0;
+    UINT   y     = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    if (standard >= LUMA_STANDARD_MAX)
+    {
+        return FALSE;
+    }
+
+    cbRow = (SIZE_T) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (y = 0; y < pImageData->uHeight; ++y)
+    {
+        _WuGrayscaleRow(
+            pImageData->abData + y * cbRow,
+            pImageData->uWidth,
+            standard,
+            dwFlags);
+    }
+
+    return TRUE;
+}
+
+static BYTE
+ClampToByte(
+    IN INT  iValue
+    )
+{
+    if (iValue < 0)
+    {
+        return 0;
+    }
+
+    return (iValue > 0xFF) ? 0xFF : (BYTE) iValue;
+}
+
+/*
+    Full-range ("JPEG") YCbCr:
+
+        Y  = Kr * R + Kg * G + Kb * B
+        Cb = 128 + (B - Y) / (2 * (1 - Kb))
+        Cr = 128 + (R - Y) / (2 * (1 - Kr))
+
+    All coefficients are applied in Q16 fixed point.
+*/
+WUAPI BOOL
+WuImageDataToYCbCr(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  WU_LUMA_STANDARD    standard,
+    OUT BYTE*               abY,
+    OUT BYTE*               abCb,
+    OUT BYTE*               abCr
+    )
+{
+    CONST LUMACOEFFICIENTS* pCoefficients = NULL;
+    CONST BYTE*             pbPixel       = NULL;
+    INT                     iCbR, iCbG, iCbB;
+    INT                     iCrR, iCrG, iCrB;
+    INT                     iY            = 0;
+    SIZE_T                  cPixels       = 0;
+    SIZE_T                  i             = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    if ((NULL == abY) || (NULL == abCb) || (NULL == abCr))
+    {
+        return FALSE;
+    }
+
+    if (standard >= LUMA_STANDARD_MAX)
+    {
+        return FALSE;
+    }
+
+    pCoefficients = &g_aLumaCoefficients[standard];
+
+    iCbR = (INT) (-pCoefficients->dbKr / (2.0 * (1.0 - pCoefficients->dbKb))
+        * 65536.0 - 0.5);
+    iCbG = (INT) (-pCoefficients->dbKg / (2.0 * (1.0 - pCoefficients->dbKb))
+        * 65536.0 - 0.5);
+    iCbB = -(iCbR + iCbG);      /* chroma rows sum to zero */
+
+    iCrG = (INT) (-pCoefficients->dbKg / (2.0 * (1.0 - pCoefficients->dbKr))
+        * 65536.0 - 0.5);
+    iCrB = (INT) (-pCoefficients->dbKb / (2.0 * (1.0 - pCoefficients->dbKr))
+        * 65536.0 - 0.5);
+    iCrR = -(iCrG + iCrB);
+
+    cPixels = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+    pbPixel = pImageData->abData;
+
+    for (i = 0; i < cPixels; ++i, pbPixel += 4)
+    {
+        iY = (pbPixel[0] * pCoefficients->iWeightB
+            + pbPixel[1] * pCoefficients->iWeightG
+            + pbPixel[2] * pCoefficients->iWeightR
+            + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT;
+
+        abY[i]  = (BYTE) iY;
+
+        abCb[i] = ClampToByte(128 + ((pbPixel[2] * iCbR + pbPixel[1] * iCbG
+            + pbPixel[0] * iCbB + 32768) >> 16));
+
+        abCr[i] = ClampToByte(128 + ((pbPixel[2] * iCrR + pbPixel[1] * iCrG
+            + pbPixel[0] * iCrB + 32768) >> 16));
+    }
+
+    return TRUE;
+}
+
+WUAPI PWUIMAGEDATA
+WuImageDataFromYCbCr(
+    IN CONST BYTE*      abY,
+    IN CONST BYTE*      abCb,
+    IN CONST BYTE*      abCr,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN WU_LUMA_STANDARD standard
+    )
+{
+    CONST LUMACOEFFICIENTS* pCoefficients = NULL;
+    PWUIMAGEDATA            pImageData    = NULL;
+    BYTE*                   pbPixel       = NULL;
+    INT                     iRCr, iGCb, iGCr, iBCb;
+    INT                     iY, iCb, iCr;
+    SIZE_T                  cPixels       = 0;
+    SIZE_T                  i             = 0;
+
+    if ((NULL == abY) || (NULL == abCb) || (NULL == abCr))
+    {
+        return NULL;
+    }
+
+    if (standard >= LUMA_STANDARD_MAX)
+    {
+        return NULL;
+    }
+
+    pImageData = _WuCreateUninitializedImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    pCoefficients = &g_aLumaCoefficients[standard];
+
+    /* R = Y + 2(1-Kr) Cr,  B = Y + 2(1-Kb) Cb,  G = (Y - Kr R - Kb B) / Kg */
+    iRCr = (INT) (2.0 * (1.0 - pCoefficients->dbKr) * 65536.0 + 0.5);
+    iBCb = (INT) (2.0 * (1.0 - pCoefficients->dbKb) * 65536.0 + 0.5);
+    iGCb = (INT) (2.0 * pCoefficients->dbKb * (1.0 - pCoefficients->dbKb)
+        / pCoefficients->dbKg * 65536.0 + 0.5);
+    iGCr = (INT) (2.0 * pCoefficients->dbKr * (1.0 - pCoefficients->dbKr)
+        / pCoefficients->dbKg * 65536.0 + 0.5);
+
+    cPixels = (SIZE_T) uWidth * uHeight;
+    pbPixel = pImageData->abData;
+
+    for (i = 0; i < cPixels; ++i, pbPixel += 4)
+    {
+        iY  = abY[i];
+        iCb = abCb[i] - 128;
+        iCr = abCr[i] - 128;
+
+        pbPixel[0] = ClampToByte(iY + ((iBCb * iCb + 32768) >> 16));
+        pbPixel[1] = ClampToByte(
+            iY - ((iGCb * iCb + iGCr * iCr + 32768) >> 16));
+        pbPixel[2] = ClampToByte(iY + ((iRCr * iCr + 32768) >> 16));
+        pbPixel[3] = 0xFF;
+    }
+
+    return pImageData;
+}
@@ -0,0 +1,613 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       colorlut.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define MIN_ROWS_PER_BAND   16
+
+/* Lattice points keep B, G, R and a pad lane, scaled to 0..255 */
+#define ENTRY_FLOATS        4
+
+/*
+    Red is the fastest moving axis of the lattice, as in .cube files.
+    Every 8-bit channel value maps to the offset of the lower corner of
+    its cell along that axis (already multiplied by the axis stride) and
+    to the fraction inside the cell, so interpolating a pixel needs no
+    divisions and no clamping. Arrays are indexed in pixel byte order.
+*/
+struct tagWUCOLORLUT {
+    UINT                    cSize;
+    FLOAT*                  afEntries;
+    DWORD                   adwCell[3][256];
+    FLOAT                   afFrac[3][256];
+    DWORD*                  adwTable;       /* NULL if not precomputed */
+    UINT                    cTableBits;
+    WU_LUT_INTERPOLATION    tableInterpolation;
+};
+
+typedef struct tagCOLORLUTJOB {
+    PWUIMAGEDATA            pImageData;
+    PWUCOLORLUT             pLut;
+    WU_LUT_INTERPOLATION    interpolation;
+    UINT                    cRowsPerBand;
+} COLORLUTJOB, *PCOLORLUTJOB;
+
+static UINT
+GetBandCount(
+    IN UINT uHeight
+    )
+{
+    UINT cBands = (uHeight + MIN_ROWS_PER_BAND - 1) / MIN_ROWS_PER_BAND;
+
+    return max(1, min(cBands, _WuGetProcessorCount()));
+}
+
+/*
+    Picks the tetrahedron of the cell that contains the point: its inner
+    vertices (as entry offsets from the lower corner) and the weights
+    fW1 >= fW2 >= fW3 of the three edges walked from corner to corner.
+*/
+static WU_INLINE VOID
+SelectTetrahedron(
+    IN  UINT    cSize,
+    IN  FLOAT   fR,
+    IN  FLOAT   fG,
+    IN  FLOAT   fB,
+    OUT DWORD*  pdwFirst,
+    OUT DWORD*  pdwSecond,
+    OUT FLOAT   afWeights[3]
+    )
+{
+    DWORD dwR = 1;
+    DWORD dwG = cSize;
+    DWORD dwB = cSize * cSize;
+
+    if (fR > fG)
+    {
+        if (fG > fB)
+        {
+            *pdwFirst    = dwR;
+            *pdwSecond   = dwR + dwG;
+            afWeights[0] = fR;
+            afWeights[1] = fG;
+            afWeights[2] = fB;
+        }
+        else if (fR > fB)
+        {
+            *pdwFirst    = dwR;
+            *pdwSecond   = dwR + dwB;
+            afWeights[0] = fR;
+            afWeights[1] = fB;
+            afWeights[2] = fG;
+        }
+        else
+        {
+            *pdwFirst    = dwB;
+            *pdwSecond   = dwR + dwB;
+            afWeights[0] = fB;
+            afWeights[1] = fR;
+            afWeights[2] = fG;
+        }
+    }
+    else
+    {
+        if (fB > fG)
+        {
+            *pdwFirst    = dwB;
+            *pdwSecond   = dwG + dwB;
+            afWeights[0] = fB;
+            afWeights[1] = fG;
+            afWeights[2] = fR;
+        }
+        else if (fB > fR)
+        {
+            *pdwFirst    = dwG;
+            *pdwSecond   = dwG + dwB;
+            afWeights[0] = fG;
+            afWeights[1] = fB;
+            afWeights[2] = fR;
+        }
+        else
+        {
+            *pdwFirst    = dwG;
+            *pdwSecond   = dwR + dwG;
+            afWeights[0] = fG;
+            afWeights[1] = fR;
+            afWeights[2] = fB;
+        }
+    }
+}
+
+#ifdef _WU_HAVE_SSE2
+
+static WU_INLINE __m128
+LerpEntries(
+    IN __m128   a,
+    IN __m128   b,
+    IN __m128   t
+    )
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+#endif /* _WU_HAVE_SSE2 */
+
+static VOID
+InterpolateRow(
+    IN  CONST PWUCOLORLUT       pLut,
+    IN  WU_LUT_INTERPOLATION    interpolation,
+    IN  CONST DWORD*            pdwSrc,
+    OUT DWORD*                  pdwDst,
+    IN  UINT                    cPixels
+    )
+{
+    CONST FLOAT* pfCell   = NULL;
+    DWORD        dwPixel  = 0;
+    DWORD        dwFirst  = 0;
+    DWORD        dwSecond = 0;
+    DWORD        dwG      = pLut->cSize;
+    DWORD        dwB      = pLut->cSize * pLut->cSize;
+    DWORD        dwLast   = 1 + dwG + dwB;
+    FLOAT        afWeights[3];
+    FLOAT        fB       = 0.0f;
+    FLOAT        fG       = 0.0f;
+    FLOAT        fR       = 0.0f;
+    UINT         x        = 0;
+#ifdef _WU_HAVE_SSE2
+    __m128       c0, c1, c2, c3;
+    __m128       t;
+    __m128i      result;
+#else
+    FLOAT        afResult[3];
+    FLOAT        fValue   = 0.0f;
+    FLOAT        fBottom  = 0.0f;
+    FLOAT        fTop     = 0.0f;
+    UINT         c        = 0;
+#endif /* _WU_HAVE_SSE2 */
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        dwPixel = pdwSrc[x];
+
+        fB = pLut->afFrac[0][dwPixel & 0xFF];
+        fG = pLut->afFrac[1][(dwPixel >> 8) & 0xFF];
+        fR = pLut->afFrac[2][(dwPixel >> 16) & 0xFF];
+
+        pfCell = pLut->afEntries + ENTRY_FLOATS
+            * (pLut->adwCell[0][dwPixel & 0xFF]
+                + pLut->adwCell[1][(dwPixel >> 8) & 0xFF]
+                + pLut->adwCell[2][(dwPixel >> 16) & 0xFF]);
+
+        if (WU_LUT_INTERPOLATION_TETRAHEDRAL == interpolation)
+        {
+            SelectTetrahedron(pLut->cSize, fR, fG, fB,
+                &dwFirst, &dwSecond, afWeights);
+        }
+
+#ifdef _WU_HAVE_SSE2
+        if (WU_LUT_INTERPOLATION_TETRAHEDRAL == interpolation)
+        {
+            c0 = _mm_loadu_ps(pfCell);
+            c1 = _mm_loadu_ps(pfCell + ENTRY_FLOATS * dwFirst);
+            c2 = _mm_loadu_ps(pfCell + ENTRY_FLOATS * dwSecond);
+            c3 = _mm_loadu_ps(pfCell + ENTRY_FLOATS * dwLast);
+
+            c3 = _mm_mul_ps(_mm_sub_ps(c3, c2), _mm_set1_ps(afWeights[2]));
+            c2 = _mm_mul_ps(_mm_sub_ps(c2, c1), _mm_set1_ps(afWeights[1]));
+            c1 = _mm_mul_ps(_mm_sub_ps(c1, c0), _mm_set1_ps(afWeights[0]));
+            c0 = _mm_add_ps(_mm_add_ps(c0, c1), _mm_add_ps(c2, c3));
+        }
+        else
+        {
+            /* collapse red first, then green, then blue */
+            t  = _mm_set1_ps(fR);
+            c0 = LerpEntries(_mm_loadu_ps(pfCell),
+                _mm_loadu_ps(pfCell + ENTRY_FLOATS), t);
+            c1 = LerpEntries(_mm_loadu_ps(pfCell + ENTRY_FLOATS * dwG),
+                _mm_loadu_ps(pfCell + ENTRY_FLOATS * (dwG + 1)), t);
+            c2 = LerpEntries(_mm_loadu_ps(pfCell + ENTRY_FLOATS * dwB),
+                _mm_loadu_ps(pfCell + ENTRY_FLOATS * (dwB + 1)), t);
+            c3 = LerpEntries(
+                _mm_loadu_ps(pfCell + ENTRY_FLOATS * (dwB + dwG)),
+                _mm_loadu_ps(pfCell + ENTRY_FLOATS * dwLast), t);
+
+            t  = _mm_set1_ps(fG);
+            c0 = LerpEntries(c0, c1, t);
+            c2 = LerpEntries(c2, c3, t);
+            c0 = LerpEntries(c0, c2, _mm_set1_ps(fB));
+        }
+
+        /* saturating packs clamp out-of-range lattice values for free */
+        result = _mm_cvtps_epi32(c0);
+        result = _mm_packs_epi32(result, result);
+        result = _mm_packus_epi16(result, result);
+
+        pdwDst[x] = ((DWORD) _mm_cvtsi128_si32(result) & 0x00FFFFFF)
+            | (dwPixel & 0xFF000000);
+#else
+        for (c = 0; c < 3; ++c)
+        {
+            if (WU_LUT_INTERPOLATION_TETRAHEDRAL == interpolation)
+            {
+                fValue = pfCell[c]
+                    + afWeights[0] * (pfCell[ENTRY_FLOATS * dwFirst + c]
+                        - pfCell[c])
+                    + afWeights[1] * (pfCell[ENTRY_FLOATS * dwSecond + c]
+                        - pfCell[ENTRY_FLOATS * dwFirst + c])
+                    + afWeights[2] * (pfCell[ENTRY_FLOATS * dwLast + c]
+                        - pfCell[ENTRY_FLOATS * dwSecond + c]);
+            }
+            else
+            {
+                fBottom = pfCell[c] + fR * (pfCell[ENTRY_FLOATS + c]
+                    - pfCell[c]);
+                fTop = pfCell[ENTRY_FLOATS * dwG + c]
+                    + fR * (pfCell[ENTRY_FLOATS * (dwG + 1) + c]
+                        - pfCell[ENTRY_FLOATS * dwG + c]);
+                fBottom += fG * (fTop - fBottom);
+
+                fTop = pfCell[ENTRY_FLOATS * dwB + c]
+                    + fR * (pfCell[ENTRY_FLOATS * (dwB + 1) + c]
+                        - pfCell[ENTRY_FLOATS * dwB + c]);
+                fValue = pfCell[ENTRY_FLOATS * (dwB + dwG) + c]
+                    + fR * (pfCell[ENTRY_FLOATS * dwLast + c]
+                        - pfCell[ENTRY_FLOATS * (dwB + dwG) + c]);
+                fTop += fG * (fValue - fTop);
+
+                fValue = fBottom + fB * (fTop - fBottom);
+            }
+
+            afResult[c] = fValue;
+        }
+
+        dwPixel &= 0xFF000000;
+
+        for (c = 0; c < 3; ++c)
+        {
+            if (afResult[c] >= 255.0f)
+            {
+                dwPixel |= (DWORD) 0xFF << (c * 8);
+            }
+            else if (afResult[c] > 0.0f)
+            {
+                dwPixel |= (DWORD) (afResult[c] + 0.5f) << (c * 8);
+            }
+        }
+
+        pdwDst[x] = dwPixel;
+#endif /* _WU_HAVE_SSE2 */
+    }
+}
+
+static VOID
+LookupRow(
+    IN     CONST PWUCOLORLUT    pLut,
+    IN OUT DWORD*               pdwPixels,
+    IN     UINT                 cPixels
+    )
+{
+    CONST DWORD* adwTable = pLut->adwTable;
+    DWORD        dwPixel  = 0;
+    DWORD        dwMask   = (1 << pLut->cTableBits) - 1;
+    UINT         uShift   = 8 - pLut->cTableBits;
+    UINT         uBits    = pLut->cTableBits;
+    UINT         x        = 0;
+
+    if (8 == uBits)
+    {
+        for (x = 0; x < cPixels; ++x)
+        {
+            dwPixel      = pdwPixels[x];
+            pdwPixels[x] = adwTable[dwPixel & 0x00FFFFFF]
+                | (dwPixel & 0xFF000000);
+        }
+
+        return;
+    }
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        dwPixel      = pdwPixels[x];
+        pdwPixels[x] = adwTable[
+                (((dwPixel >> (16 + uShift)) & dwMask) << (2 * uBits))
+                | (((dwPixel >> (8 + uShift)) & dwMask) << uBits)
+                | ((dwPixel >> uShift) & dwMask)]
+            | (dwPixel & 0xFF000000);
+    }
+}
+
+static VOID
+ColorLutBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PCOLORLUTJOB pJob       = (PCOLORLUTJOB) pContext;
+    PWUIMAGEDATA pImageData = pJob->pImageData;
+    PWUCOLORLUT  pLut       = pJob->pLut;
+    DWORD*       pdwRow     = NULL;
+    UINT         uTop       = iBand * pJob->cRowsPerBand;
+    UINT         uBottom    = 0;
+    UINT         y          = 0;
+    BOOL         bLookup    = FALSE;
+
+    uBottom = min(uTop + pJob->cRowsPerBand, pImageData->uHeight);
+
+    bLookup = (pLut->adwTable != NULL)
+        && (pLut->tableInterpolation == pJob->interpolation);
+
+    for (y = uTop; y < uBottom; ++y)
+    {
+        pdwRow = (DWORD*) pImageData->abData
+            + (SIZE_T) y * pImageData->uWidth;
+
+        if (TRUE == bLookup)
+        {
+            LookupRow(pLut, pdwRow, pImageData->uWidth);
+        }
+        else
+        {
+            InterpolateRow(pLut, pJob->interpolation, pdwRow, pdwRow,
+                pImageData->uWidth);
+        }
+    }
+}
+
+/*
+    One item per red plane of the table. Each row of the plane is filled
+    by running the interpolation kernel over the centers of its cells.
+*/
+static VOID
+PrecomputePlaneProc(
+    IN UINT     iPlane,
+    IN LPVOID   pContext
+    )
+{
+    PCOLORLUTJOB pJob   = (PCOLORLUTJOB) pContext;
+    PWUCOLORLUT  pLut   = pJob->pLut;
+    DWORD        adwRow[256];
+    UINT         cCells = 1 << pLut->cTableBits;
+    UINT         uShift = 8 - pLut->cTableBits;
+    UINT         uHalf  = ((1 << uShift) - 1) / 2;
+    UINT         g      = 0;
+    UINT         b      = 0;
+
+    for (g = 0; g < cCells; ++g)
+    {
+        for (b = 0; b < cCells; ++b)
+        {
+            adwRow[b] = (((iPlane << uShift) + uHalf) << 16)
+                | (((g << uShift) + uHalf) << 8)
+                | ((b << uShift) + uHalf);
+        }
+
+        InterpolateRow(
+            pLut,
+            pJob->interpolation,
+            adwRow,
+            pLut->adwTable + ((SIZE_T) iPlane * cCells + g) * cCells,
+            cCells);
+    }
+}
+
+WUAPI PWUCOLORLUT
+WuCreateColorLut(
+    IN UINT         cSize,
+    IN CONST FLOAT* afTable,
+    IN CONST FLOAT* afDomainMin,
+    IN CONST FLOAT* afDomainMax
+    )
+{
+    PWUCOLORLUT pLut    = NULL;
+    SIZE_T      cPoints = 0;
+    SIZE_T      i       = 0;
+    FLOAT       fMin    = 0.0f;
+    FLOAT       fMax    = 1.0f;
+    FLOAT       fCoord  = 0.0f;
+    DWORD       dwCell  = 0;
+    DWORD       dwStep  = 1;
+    UINT        c       = 0;
+    UINT        v       = 0;
+
+    if ((NULL == afTable) || (cSize < WU_COLOR_LUT_MIN_SIZE)
+        || (cSize > WU_COLOR_LUT_MAX_SIZE))
+    {
+        return NULL;
+    }
+
+    for (c = 0; c < 3; ++c)
+    {
+        fMin = (afDomainMin != NULL) ? afDomainMin[c] : 0.0f;
+        fMax = (afDomainMax != NULL) ? afDomainMax[c] : 1.0f;
+
+        if (!(fMax > fMin))
+        {
+            return NULL;
+        }
+    }
+
+    pLut = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUCOLORLUT));
+
+    if (NULL == pLut)
+    {
+        return NULL;
+    }
+
+    cPoints = (SIZE_T) cSize * cSize * cSize;
+
+    pLut->cSize     = cSize;
+    pLut->afEntries = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        cPoints * ENTRY_FLOATS * sizeof(FLOAT));
+
+    if (NULL == pLut->afEntries)
+    {
+        HeapFree(GetProcessHeap(), 0, pLut);
+        return NULL;
+    }
+
+    for (i = 0; i < cPoints; ++i)
+    {
+        pLut->afEntries[i * ENTRY_FLOATS]     = afTable[i * 3 + 2] * 255.0f;
+        pLut->afEntries[i * ENTRY_FLOATS + 1] = afTable[i * 3 + 1] * 255.0f;
+        pLut->afEntries[i * ENTRY_FLOATS + 2] = afTable[i * 3] * 255.0f;
+        pLut->afEntries[i * ENTRY_FLOATS + 3] = 0.0f;
+    }
+
+    /* pixel byte c is blue, green, red; the domain arrays are R, G, B */
+    for (c = 0; c < 3; ++c)
+    {
+        fMin   = (afDomainMin != NULL) ? afDomainMin[2 - c] : 0.0f;
+        fMax   = (afDomainMax != NULL) ? afDomainMax[2 - c] : 1.0f;
+        dwStep = (2 == c) ? 1 : ((1 == c) ? cSize : cSize * cSize);
+
+        for (v = 0; v < 256; ++v)
+        {
+            fCoord = ((FLOAT) v / 255.0f - fMin) / (fMax - fMin)
+                * (FLOAT) (cSize - 1);
+
+            fCoord = max(0.0f, min(fCoord, (FLOAT) (cSize - 1)));
+            dwCell = min((DWORD) fCoord, cSize - 2);
+
+            pLut->adwCell[c][v] = dwCell * dwStep;
+            pLut->afFrac[c][v]  = fCoord - (FLOAT) dwCell;
+        }
+    }
+
+    return pLut;
+}
+
+WUAPI BOOL
+WuPrecomputeColorLut(
+    IN PWUCOLORLUT          pLut,
+    IN WU_LUT_INTERPOLATION interpolation,
+    IN UINT                 cBits
+    )
+{
+    COLORLUTJOB job;
+
+    if (NULL == pLut)
+    {
+        return FALSE;
+    }
+
+    if ((interpolation != WU_LUT_INTERPOLATION_TRILINEAR)
+        && (interpolation != WU_LUT_INTERPOLATION_TETRAHEDRAL))
+    {
+        return FALSE;
+    }
+
+    if ((cBits != 0) && ((cBits < WU_COLOR_LUT_MIN_TABLE_BITS)
+        || (cBits > WU_COLOR_LUT_MAX_TABLE_BITS)))
+    {
+        return FALSE;
+    }
+
+    if (pLut->adwTable != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pLut->adwTable);
+        pLut->adwTable   = NULL;
+        pLut->cTableBits = 0;
+    }
+
+    if (0 == cBits)
+    {
+        return TRUE;
+    }
+
+    pLut->adwTable = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ((SIZE_T) 1 << (3 * cBits)) * sizeof(DWORD));
+
+    if (NULL == pLut->adwTable)
+    {
+        return FALSE;
+    }
+
+    pLut->cTableBits         = cBits;
+    pLut->tableInterpolation = interpolation;
+
+    ZeroMemory(&job, sizeof(COLORLUTJOB));
+
+    job.pLut          = pLut;
+    job.interpolation = interpolation;
+
+    _WuParallelFor(1 << cBits, PrecomputePlaneProc, &job);
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuApplyColorLut(
+    IN PWUIMAGEDATA         pImageData,
+    IN CONST PWUCOLORLUT    pLut,
+    IN WU_LUT_INTERPOLATION interpolation
+    )
+{
+    COLORLUTJOB job;
+    UINT        cBands = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == pLut))
+    {
+        return FALSE;
+    }
+
+    if ((interpolation != WU_LUT_INTERPOLATION_TRILINEAR)
+        && (interpolation != WU_LUT_INTERPOLATION_TETRAHEDRAL))
+    {
+        return FALSE;
+    }
+
+    if ((0 == pImageData->uWidth) || (0 == pImageData->uHeight))
+    {
+        return TRUE;
+    }
+
+    cBands = GetBandCount(pImageData->uHeight);
+
+    ZeroMemory(&job, sizeof(COLORLUTJOB));
+
+    job.pImageData    = pImageData;
+    job.pLut          = pLut;
+    job.interpolation = interpolation;
+    job.cRowsPerBand  = (pImageData->uHeight + cBands - 1) / cBands;
+
+    _WuParallelFor(cBands, ColorLutBandProc, &job);
+
+    return TRUE;
+}
+
+WUAPI VOID
+WuDestroyColorLut(
+    IN PWUCOLORLUT  pLut
+    )
+{
+    if (NULL == pLut)
+    {
+        return;
+    }
+
+    if (pLut->adwTable != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pLut->adwTable);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pLut->afEntries);
+    HeapFree(GetProcessHeap(), 0, pLut);
+}
@@ -0,0 +1,831 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       components.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define MIN_ROWS_PER_BAND       16
+
+#define INITIAL_SPANS           256
+
+/* Per-band statistics are merged at the end, cap what they may take */
+#define MAX_STATS_BYTES         (64 * 1024 * 1024)
+
+/***************************************************************************
+ *  Flood fill
+ ***************************************************************************/
+
+/* A row to scan for unvisited matching runs in [uLeft, uRight] */
+typedef struct tagSPAN {
+    UINT    uLeft;
+    UINT    uRight;
+    UINT    y;
+} SPAN, *PSPAN;
+
+typedef struct tagFLOODFILL {
+    CONST WUIMAGEDATA*  pImageData;
+    BYTE*               abSelected;     /* uWidth bytes per row */
+    BYTE                abLow[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    BYTE                abHigh[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    PSPAN               aSpans;
+    SIZE_T              cSpans;
+    SIZE_T              cMaxSpans;
+} FLOODFILL, *PFLOODFILL;
+
+static BOOL
+MatchesSeed(
+    IN PFLOODFILL   pFill,
+    IN UINT         x,
+    IN UINT         y
+    )
+{
+    CONST BYTE* pbPixel = pFill->pImageData->abData
+        + ((SIZE_T) y * pFill->pImageData->uWidth + x)
+            * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    UINT        c       = 0;
+
+    for (c = 0; c < WU_IMAGEDATA_BYTES_PER_PIXEL; ++c)
+    {
+        if ((pbPixel[c] < pFill->abLow[c]) || (pbPixel[c] > pFill->abHigh[c]))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+PushSpan(
+    IN PFLOODFILL   pFill,
+    IN UINT         uLeft,
+    IN UINT         uRight,
+    IN UINT         y
+    )
+{
+    PSPAN pSpans = NULL;
+
+    if (pFill->cSpans == pFill->cMaxSpans)
+    {
+        pSpans = HeapReAlloc(
+            GetProcessHeap(),
+            0,
+            pFill->aSpans,
+            pFill->cMaxSpans * 2 * sizeof(SPAN));
+
+        if (NULL == pSpans)
+        {
+            return FALSE;
+        }
+
+        pFill->aSpans     = pSpans;
+        pFill->cMaxSpans *= 2;
+    }
+
+    pFill->aSpans[pFill->cSpans].uLeft  = uLeft;
+    pFill->aSpans[pFill->cSpans].uRight = uRight;
+    pFill->aSpans[pFill->cSpans].y      = y;
+
+    pFill->cSpans++;
+
+    return TRUE;
+}
+
+/*
+    Iterative scanline fill: every popped span is searched for runs that
+    match and are not selected yet, each run is grown left and right to
+    its full extent, and the rows above and below it are pushed as spans.
+    The explicit span stack grows on the heap, never on the call stack.
+*/
+static BOOL
+FloodSelect(
+    IN PFLOODFILL   pFill,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN BOOL         bDiagonal
+    )
+{
+    UINT  uWidth  = pFill->pImageData->uWidth;
+    UINT  uHeight = pFill->pImageData->uHeight;
+    BYTE* pbRow   = NULL;
+    SPAN  span;
+    UINT  uLeft   = 0;
+    UINT  uRight  = 0;
+    UINT  x       = 0;
+
+    pFill->cMaxSpans = INITIAL_SPANS;
+    pFill->cSpans    = 0;
+
+    pFill->aSpans = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        pFill->cMaxSpans * sizeof(SPAN));
+
+    if (NULL == pFill->aSpans)
+    {
+        return FALSE;
+    }
+
+    PushSpan(pFill, uX, uX, uY);
+
+    while (pFill->cSpans != 0)
+    {
+        span  = pFill->aSpans[--pFill->cSpans];
+        pbRow = pFill->abSelected + (SIZE_T) span.y * uWidth;
+
+        for (x = span.uLeft; x <= span.uRight; ++x)
+        {
+            if ((pbRow[x] != 0) || (MatchesSeed(pFill, x, span.y) == FALSE))
+            {
+                continue;
+            }
+
+            uLeft  = x;
+            uRight = x;
+
+            while ((uLeft > 0) && (0 == pbRow[uLeft - 1])
+                && (MatchesSeed(pFill, uLeft - 1, span.y) == TRUE))
+            {
+                uLeft--;
+            }
+
+            while ((uRight + 1 < uWidth) && (0 == pbRow[uRight + 1])
+                && (MatchesSeed(pFill, uRight + 1, span.y) == TRUE))
+            {
+                uRight++;
+            }
+
+            FillMemory(pbRow + uLeft, uRight - uLeft + 1, 0xFF);
+
+            /* diagonal neighbours widen the rows above and below by one */
+            if (TRUE == bDiagonal)
+            {
+                uLeft  = (uLeft > 0) ? uLeft - 1 : 0;
+                uRight = min(uWidth - 1, uRight + 1);
+            }
+
+            if (((span.y > 0)
+                    && (PushSpan(pFill, uLeft, uRight, span.y - 1) == FALSE))
+                || ((span.y + 1 < uHeight)
+                    && (PushSpan(pFill, uLeft, uRight, span.y + 1) == FALSE)))
+            {
+                HeapFree(GetProcessHeap(), 0, pFill->aSpans);
+                return FALSE;
+            }
+
+            x = uRight;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, pFill->aSpans);
+
+    return TRUE;
+}
+
+static BYTE*
+SelectRegion(
+    IN CONST WUIMAGEDATA*   pImageData,
+    IN UINT                 uX,
+    IN UINT                 uY,
+    IN BYTE                 bTolerance,
+    IN DWORD                dwFlags
+    )
+{
+    FLOODFILL   fill;
+    CONST BYTE* pbSeed = NULL;
+    UINT        c      = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (uX >= pImageData->uWidth) || (uY >= pImageData->uHeight))
+    {
+        return NULL;
+    }
+
+    ZeroMemory(&fill, sizeof(FLOODFILL));
+
+    fill.pImageData = pImageData;
+
+    pbSeed = pImageData->abData
+        + ((SIZE_T) uY * pImageData->uWidth + uX)
+            * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (c = 0; c < WU_IMAGEDATA_BYTES_PER_PIXEL; ++c)
+    {
+        fill.abLow[c]  = (BYTE) max(0, (INT) pbSeed[c] - bTolerance);
+        fill.abHigh[c] = (BYTE) min(0xFF, (INT) pbSeed[c] + bTolerance);
+    }
+
+    fill.abSelected = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        (SIZE_T) pImageData->uWidth * pImageData->uHeight);
+
+    if (NULL == fill.abSelected)
+    {
+        return NULL;
+    }
+
+    if (FloodSelect(&fill, uX, uY,
+            (dwFlags & WU_CONNECTIVITY_8) ? TRUE : FALSE) == FALSE)
+    {
+        HeapFree(GetProcessHeap(), 0, fill.abSelected);
+        return NULL;
+    }
+
+    return fill.abSelected;
+}
+
+WUAPI PWUIMAGEMASK
+WuFloodSelect(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN UINT                 uX,
+    IN UINT                 uY,
+    IN BYTE                 bTolerance,
+    IN DWORD                dwFlags
+    )
+{
+    PWUIMAGEMASK pMask      = NULL;
+    BYTE*        abSelected = NULL;
+    UINT         y          = 0;
+
+    abSelected = SelectRegion(pImageData, uX, uY, bTolerance, dwFlags);
+
+    if (NULL == abSelected)
+    {
+        return NULL;
+    }
+
+    pMask = WuCreateImageMask(
+        pImageData->uWidth,
+        pImageData->uHeight,
+        dwFlags);
+
+    if (pMask != NULL)
+    {
+        for (y = 0; y < pMask->uHeight; ++y)
+        {
+            _WuStoreMaskRow(pMask, y,
+                abSelected + (SIZE_T) y * pMask->uWidth);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, abSelected);
+
+    return pMask;
+}
+
+WUAPI BOOL
+WuFloodFill(
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN BYTE         bTolerance,
+    IN DWORD        dwFlags,
+    IN WUCOLOR      color
+    )
+{
+    BYTE*  abSelected = NULL;
+    DWORD* pdwPixels  = NULL;
+    DWORD  dwPixel    = 0;
+    SIZE_T cPixels    = 0;
+    SIZE_T i          = 0;
+
+    abSelected = SelectRegion(pImageData, uX, uY, bTolerance, dwFlags);
+
+    if (NULL == abSelected)
+    {
+        return FALSE;
+    }
+
+    dwPixel = (DWORD) WuGetColorB(color)
+        | ((DWORD) WuGetColorG(color) << 8)
+        | ((DWORD) WuGetColorR(color) << 16)
+        | ((DWORD) WuGetColorA(color) << 24);
+
+    pdwPixels = (DWORD*) pImageData->abData;
+    cPixels   = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+
+    for (i = 0; i < cPixels; ++i)
+    {
+        if (abSelected[i] != 0)
+        {
+            pdwPixels[i] = dwPixel;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, abSelected);
+
+    return TRUE;
+}
+
+/***************************************************************************
+ *  Connected components
+ ***************************************************************************/
+
+/*
+    Two-pass union-find labelling in row bands. A pixel that starts a new
+    provisional label gets its own index + 1, so bands label without any
+    coordination. Unions always link the larger root below the smaller,
+    which keeps every parent below its child: roots are the first pixel
+    of their component in raster order, and one ascending sweep over
+    adwParent turns provisional labels into final ones.
+*/
+typedef struct tagCOMPONENTSTATS {
+    ULONGLONG   ullSumX;
+    ULONGLONG   ullSumY;
+    DWORD       cPixels;
+    UINT        uLeft;
+    UINT        uTop;
+    UINT        uRight;                 /* inclusive */
+    UINT        uBottom;                /* inclusive */
+} COMPONENTSTATS, *PCOMPONENTSTATS;
+
+typedef struct tagLABELJOB {
+    CONST WUIMAGEMASK*  pMask;
+    BOOL                bDiagonal;
+    DWORD*              adwLabels;      /* uWidth per row */
+    DWORD*              adwParent;      /* uWidth * uHeight + 1 */
+    BYTE*               abRows;         /* one mask row per band */
+    UINT                cRowsPerBand;
+    PCOMPONENTSTATS     aStats;         /* cStats per band */
+    UINT                cStats;
+} LABELJOB, *PLABELJOB;
+
+static DWORD
+FindRoot(
+    IN DWORD*   adwParent,
+    IN DWORD    dwLabel
+    )
+{
+    /* path halving */
+    while (adwParent[dwLabel] != dwLabel)
+    {
+        adwParent[dwLabel] = adwParent[adwParent[dwLabel]];
+        dwLabel            = adwParent[dwLabel];
+    }
+
+    return dwLabel;
+}
+
+static DWORD
+Union(
+    IN DWORD*   adwParent,
+    IN DWORD    dwA,
+    IN DWORD    dwB
+    )
+{
+    dwA = FindRoot(adwParent, dwA);
+    dwB = FindRoot(adwParent, dwB);
+
+    if (dwA < dwB)
+    {
+        adwParent[dwB] = dwA;
+        return dwA;
+    }
+
+    adwParent[dwA] = dwB;
+
+    return dwB;
+}
+
+/* Label of a pixel touching dwLabel and dwOther (either may be 0) */
+static DWORD
+Join(
+    IN DWORD*   adwParent,
+    IN DWORD    dwLabel,
+    IN DWORD    dwOther
+    )
+{
+    if ((0 == dwOther) || (dwOther == dwLabel))
+    {
+        return dwLabel;
+    }
+
+    if (0 == dwLabel)
+    {
+        return dwOther;
+    }
+
+    return Union(adwParent, dwLabel, dwOther);
+}
+
+static VOID
+LabelBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PLABELJOB   pJob      = (PLABELJOB) pContext;
+    UINT        uWidth    = pJob->pMask->uWidth;
+    UINT        uHeight   = pJob->pMask->uHeight;
+    DWORD*      adwParent = pJob->adwParent;
+    BYTE*       pbValues  = pJob->abRows + (SIZE_T) iBand * uWidth;
+    DWORD*      pdwRow    = NULL;
+    DWORD*      pdwAbove  = NULL;
+    DWORD       dwLabel   = 0;
+    UINT        uFirst    = iBand * pJob->cRowsPerBand;
+    UINT        uLast     = min(uHeight, uFirst + pJob->cRowsPerBand);
+    UINT        x         = 0;
+    UINT        y         = 0;
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        _WuLoadMaskRow(pJob->pMask, y, pbValues);
+
+        pdwRow   = pJob->adwLabels + (SIZE_T) y * uWidth;
+        pdwAbove = (y > uFirst) ? pdwRow - uWidth : NULL;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            if (0 == pbValues[x])
+            {
+                pdwRow[x] = 0;
+                continue;
+            }
+
+            dwLabel = (x > 0) ? pdwRow[x - 1] : 0;
+
+            /* the first row of a band is joined upwards by MergeBands */
+            if ((pdwAbove != NULL) && (dwLabel != 0))
+            {
+                /* the left pixel has already joined the ones above it */
+                if (TRUE == pJob->bDiagonal)
+                {
+                    if ((x + 1 < uWidth) && (pdwAbove[x + 1] != pdwAbove[x]))
+                    {
+                        dwLabel = Join(adwParent, dwLabel, pdwAbove[x + 1]);
+                    }
+                }
+                else if (pdwAbove[x] != pdwAbove[x - 1])
+                {
+                    dwLabel = Join(adwParent, dwLabel, pdwAbove[x]);
+                }
+            }
+            else if (pdwAbove != NULL)
+            {
+                dwLabel = Join(adwParent, dwLabel, pdwAbove[x]);
+
+                if (TRUE == pJob->bDiagonal)
+                {
+                    if (x > 0)
+                    {
+                        dwLabel = Join(adwParent, dwLabel, pdwAbove[x - 1]);
+                    }
+
+                    if (x + 1 < uWidth)
+                    {
+                        dwLabel = Join(adwParent, dwLabel, pdwAbove[x + 1]);
+                    }
+                }
+            }
+
+            if (0 == dwLabel)
+            {
+                dwLabel = (DWORD) ((SIZE_T) y * uWidth + x + 1);
+
+                adwParent[dwLabel] = dwLabel;
+            }
+
+            pdwRow[x] = dwLabel;
+        }
+    }
+}
+
+/* Joins labels across the seam above the first row of every band */
+static VOID
+MergeBands(
+    IN PLABELJOB    pJob,
+    IN UINT         cBands
+    )
+{
+    UINT   uWidth   = pJob->pMask->uWidth;
+    DWORD* pdwRow   = NULL;
+    DWORD* pdwAbove = NULL;
+    UINT   b        = 0;
+    UINT   x        = 0;
+
+    for (b = 1; b < cBands; ++b)
+    {
+        pdwRow   = pJob->adwLabels + (SIZE_T) b * pJob->cRowsPerBand * uWidth;
+        pdwAbove = pdwRow - uWidth;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            if (0 == pdwRow[x])
+            {
+                continue;
+            }
+
+            if (pdwAbove[x] != 0)
+            {
+                Union(pJob->adwParent, pdwRow[x], pdwAbove[x]);
+            }
+
+            if (TRUE == pJob->bDiagonal)
+            {
+                if ((x > 0) && (pdwAbove[x - 1] != 0))
+                {
+                    Union(pJob->adwParent, pdwRow[x], pdwAbove[x - 1]);
+                }
+
+                if ((x + 1 < uWidth) && (pdwAbove[x + 1] != 0))
+                {
+                    Union(pJob->adwParent, pdwRow[x], pdwAbove[x + 1]);
+                }
+            }
+        }
+    }
+}
+
+static VOID
+RelabelBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PLABELJOB       pJob          = (PLABELJOB) pContext;
+    UINT            uWidth        = pJob->pMask->uWidth;
+    UINT            uHeight       = pJob->pMask->uHeight;
+    PCOMPONENTSTATS aStats        = NULL;
+    PCOMPONENTSTATS pStats        = NULL;
+    DWORD*          pdwRow        = NULL;
+    DWORD           dwLabel       = 0;
+    DWORD           dwProvisional = 0;
+    DWORD           dwFinal       = 0;
+    UINT            uFirst        = iBand * pJob->cRowsPerBand;
+    UINT            uLast         = min(uHeight, uFirst + pJob->cRowsPerBand);
+    UINT            uStart        = 0;
+    UINT            x             = 0;
+    UINT            y             = 0;
+
+    if (pJob->aStats != NULL)
+    {
+        aStats = pJob->aStats + (SIZE_T) iBand * pJob->cStats;
+    }
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        pdwRow = pJob->adwLabels + (SIZE_T) y * uWidth;
+
+        /* runs share their provisional label, look each one up once */
+        for (x = 0; x < uWidth; ++x)
+        {
+            if (pdwRow[x] != dwProvisional)
+            {
+                dwProvisional = pdwRow[x];
+                dwFinal       = pJob->adwParent[dwProvisional];
+            }
+
+            pdwRow[x] = dwFinal;
+        }
+
+        if (NULL == aStats)
+        {
+            continue;
+        }
+
+        /* statistics go by runs, a run adds its x range in one step */
+        for (x = 0; x < uWidth; x = uStart)
+        {
+            dwLabel = pdwRow[x];
+
+            for (uStart = x + 1; uStart < uWidth; ++uStart)
+            {
+                if (pdwRow[uStart] != dwLabel)
+                {
+                    break;
+                }
+            }
+
+            if ((0 == dwLabel) || (dwLabel > pJob->cStats))
+            {
+                continue;
+            }
+
+            pStats = &aStats[dwLabel - 1];
+
+            if (0 == pStats->cPixels)
+            {
+                pStats->uLeft = x;
+                pStats->uTop  = y;
+            }
+
+            pStats->uLeft    = min(pStats->uLeft, x);
+            pStats->uRight   = max(pStats->uRight, uStart - 1);
+            pStats->uBottom  = y;
+            pStats->cPixels += uStart - x;
+            pStats->ullSumX += ((ULONGLONG) x + uStart - 1) * (uStart - x) / 2;
+            pStats->ullSumY += (ULONGLONG) y * (uStart - x);
+        }
+    }
+}
+
+static VOID
+MergeStats(
+    IN  PLABELJOB       pJob,
+    IN  UINT            cBands,
+    IN  UINT            cComponents,
+    OUT PWUCOMPONENT    aComponents
+    )
+{
+    PCOMPONENTSTATS pStats = NULL;
+    COMPONENTSTATS  total;
+    UINT            b      = 0;
+    UINT            i      = 0;
+
+    for (i = 0; i < cComponents; ++i)
+    {
+        ZeroMemory(&total, sizeof(COMPONENTSTATS));
+
+        /* bands run top to bottom, so the first one holds uTop */
+        for (b = 0; b < cBands; ++b)
+        {
+            pStats = &pJob->aStats[(SIZE_T) b * pJob->cStats + i];
+
+            if (0 == pStats->cPixels)
+            {
+                continue;
+            }
+
+            if (0 == total.cPixels)
+            {
+                total.uLeft = pStats->uLeft;
+                total.uTop  = pStats->uTop;
+            }
+
+            total.uLeft    = min(total.uLeft, pStats->uLeft);
+            total.uRight   = max(total.uRight, pStats->uRight);
+            total.uBottom  = pStats->uBottom;
+            total.cPixels += pStats->cPixels;
+            total.ullSumX += pStats->ullSumX;
+            total.ullSumY += pStats->ullSumY;
+        }
+
+        aComponents[i].uX         = total.uLeft;
+        aComponents[i].uY         = total.uTop;
+        aComponents[i].uWidth     = total.uRight - total.uLeft + 1;
+        aComponents[i].uHeight    = total.uBottom - total.uTop + 1;
+        aComponents[i].cPixels    = total.cPixels;
+        aComponents[i].fCentroidX = (FLOAT) ((DOUBLE) total.ullSumX
+            / total.cPixels);
+        aComponents[i].fCentroidY = (FLOAT) ((DOUBLE) total.ullSumY
+            / total.cPixels);
+    }
+}
+
+WUAPI BOOL
+WuLabelComponents(
+    IN  CONST PWUIMAGEMASK  pMask,
+    IN  DWORD               dwFlags,
+    OUT DWORD*              adwLabels,
+    OUT PWUCOMPONENT        aComponents,
+    IN  UINT                cMaxComponents,
+    OUT UINT*               pcComponents
+    )
+{
+    LABELJOB  job;
+    SIZE_T    cPixels     = 0;
+    SIZE_T    i           = 0;
+    DWORD     cComponents = 0;
+    UINT      cBands      = 0;
+    UINT      cStatBands  = 0;
+    BOOL      bResult     = FALSE;
+
+    if ((NULL == pMask) || (NULL == pMask->abData) || (NULL == pcComponents)
+        || ((NULL == aComponents) && (cMaxComponents != 0)))
+    {
+        return FALSE;
+    }
+
+    /* labels are DWORD pixel indices + 1 */
+    if ((ULONGLONG) pMask->uWidth * pMask->uHeight >= MAXDWORD)
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(&job, sizeof(LABELJOB));
+
+    cPixels = (SIZE_T) pMask->uWidth * pMask->uHeight;
+    cBands  = (pMask->uHeight + MIN_ROWS_PER_BAND - 1) / MIN_ROWS_PER_BAND;
+    cBands  = max(1, min(cBands, _WuGetProcessorCount()));
+
+    job.pMask        = pMask;
+    job.bDiagonal    = (dwFlags & WU_CONNECTIVITY_8) ? TRUE : FALSE;
+    job.cRowsPerBand = (pMask->uHeight + cBands - 1) / cBands;
+    job.adwLabels    = adwLabels;
+
+    cBands = (pMask->uHeight + job.cRowsPerBand - 1) / job.cRowsPerBand;
+
+    if (NULL == job.adwLabels)
+    {
+        job.adwLabels = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            cPixels * sizeof(DWORD));
+    }
+
+    job.adwParent = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        (cPixels + 1) * sizeof(DWORD));
+
+    job.abRows = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) cBands * pMask->uWidth);
+
+    if ((NULL == job.adwLabels) || (NULL == job.adwParent)
+        || (NULL == job.abRows))
+    {
+        goto cleanup;
+    }
+
+    _WuParallelFor(cBands, LabelBandProc, &job);
+
+    MergeBands(&job, cBands);
+
+    /* parents are below their children, so one sweep resolves them all */
+    for (i = 1; i <= cPixels; ++i)
+    {
+        if (0 == job.adwParent[i])
+        {
+            continue;
+        }
+
+        job.adwParent[i] = (job.adwParent[i] == i)
+            ? ++cComponents
+            : job.adwParent[job.adwParent[i]];
+    }
+
+    job.cStats = min(cComponents, cMaxComponents);
+
+    if (job.cStats != 0)
+    {
+        cStatBands = (UINT) min(cBands, MAX_STATS_BYTES
+            / ((SIZE_T) job.cStats * sizeof(COMPONENTSTATS)));
+
+        /* too many components to keep per band: one band does it all */
+        if (cStatBands < cBands)
+        {
+            job.cRowsPerBand = pMask->uHeight;
+            cBands           = 1;
+        }
+
+        job.aStats = HeapAlloc(
+            GetProcessHeap(),
+            HEAP_ZERO_MEMORY,
+            (SIZE_T) cBands * job.cStats * sizeof(COMPONENTSTATS));
+
+        if (NULL == job.aStats)
+        {
+            goto cleanup;
+        }
+    }
+
+    /* internal labels without statistics need no second pass */
+    if ((adwLabels != NULL) || (job.cStats != 0))
+    {
+        _WuParallelFor(cBands, RelabelBandProc, &job);
+    }
+
+    if (job.cStats != 0)
+    {
+        MergeStats(&job, cBands, job.cStats, aComponents);
+    }
+
+    *pcComponents = cComponents;
+
+    bResult = TRUE;
+
+cleanup:
+    if ((job.adwLabels != NULL) && (job.adwLabels != adwLabels))
+    {
+        HeapFree(GetProcessHeap(), 0, job.adwLabels);
+    }
+
+    if (job.adwParent != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, job.adwParent);
+    }
+
+    if (job.abRows != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, job.abRows);
+    }
+
+    if (job.aStats != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, job.aStats);
+    }
+
+    return bResult;
+}
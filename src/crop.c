@@ -0,0 +1,355 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       crop.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <stdlib.h>
+
+#include "internal.h"
+
+/*
+    A pixel is background when every channel lies within the matching
+    byte of dwTolerance of dwBackground. Transparent mode compares
+    against zero alpha with a tolerance of 0xFF on the color channels.
+*/
+typedef struct tagBACKGROUND {
+    DWORD   dwBackground;
+    DWORD   dwTolerance;
+#ifdef _WU_HAVE_SSE2
+    __m128i background;
+    __m128i tolerance;
+#endif /* _WU_HAVE_SSE2 */
+} BACKGROUND, *PBACKGROUND;
+
+static WU_INLINE BOOL
+IsBackgroundPixel(
+    IN CONST BACKGROUND*    pBackground,
+    IN DWORD                dwPixel
+    )
+{
+    UINT c       = 0;
+    BYTE bPixel  = 0;
+    BYTE bTarget = 0;
+
+    for (c = 0; c < 32; c += 8)
+    {
+        bPixel  = (BYTE) (dwPixel >> c);
+        bTarget = (BYTE) (pBackground->dwBackground >> c);
+
+        if ((DWORD) abs((INT) bPixel - (INT) bTarget)
+            > ((pBackground->dwTolerance >> c) & 0xFF))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+#ifdef _WU_HAVE_SSE2
+
+/* Bit i of the result is set when pixel i of the four is background */
+static WU_INLINE INT
+GetBackgroundBits(
+    IN CONST BACKGROUND*    pBackground,
+    IN CONST DWORD*         pdwPixels
+    )
+{
+    __m128i pixels = _mm_loadu_si128((CONST __m128i*) pdwPixels);
+    __m128i delta;
+
+    delta = _mm_or_si128(
+        _mm_subs_epu8(pixels, pBackground->background),
+        _mm_subs_epu8(pBackground->background, pixels));
+
+    delta = _mm_subs_epu8(delta, pBackground->tolerance);
+
+    return _mm_movemask_ps(_mm_castsi128_ps(
+        _mm_cmpeq_epi32(delta, _mm_setzero_si128())));
+}
+
+#endif /* _WU_HAVE_SSE2 */
+
+/* Index of the first content pixel in [uBegin, uEnd), or uEnd */
+static UINT
+FindContentForward(
+    IN CONST BACKGROUND*    pBackground,
+    IN CONST DWORD*         pdwRow,
+    IN UINT                 uBegin,
+    IN UINT                 uEnd
+    )
+{
+    UINT x = uBegin;
+
+#ifdef _WU_HAVE_SSE2
+    INT  iBits = 0;
+
+    for (; x + 4 <= uEnd; x += 4)
+    {
+        iBits = GetBackgroundBits(pBackground, pdwRow + x);
+
+        if (iBits != 0xF)
+        {
+            while (iBits & 1)
+            {
+                iBits >>= 1;
+                x++;
+            }
+
+            return x;
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < uEnd; ++x)
+    {
+        if (IsBackgroundPixel(pBackground, pdwRow[x]) == FALSE)
+        {
+            return x;
+        }
+    }
+
+    return uEnd;
+}
+
+/* One past the last content pixel in [uBegin, uEnd), or uBegin */
+static UINT
+FindContentBackward(
+    IN CONST BACKGROUND*    pBackground,
+    IN CONST DWORD*         pdwRow,
+    IN UINT                 uBegin,
+    IN UINT                 uEnd
+    )
+{
+    UINT x = uEnd;
+
+#ifdef _WU_HAVE_SSE2
+    INT  iBits = 0;
+
+    for (; x >= uBegin + 4; x -= 4)
+    {
+        iBits = GetBackgroundBits(pBackground, pdwRow + x - 4);
+
+        if (iBits != 0xF)
+        {
+            while (iBits & 0x8)
+            {
+                iBits <<= 1;
+                x--;
+            }
+
+            return x;
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x > uBegin; --x)
+    {
+        if (IsBackgroundPixel(pBackground, pdwRow[x - 1]) == FALSE)
+        {
+            return x;
+        }
+    }
+
+    return uBegin;
+}
+
+static WU_INLINE CONST DWORD*
+GetRow(
+    IN CONST WUIMAGEDATA*   pImageData,
+    IN UINT                 y
+    )
+{
+    return (CONST DWORD*) pImageData->abData
+        + (SIZE_T) y * pImageData->uWidth;
+}
+
+WUAPI BOOL
+WuImageContentBounds(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  WUCOLOR             background,
+    IN  BYTE                bTolerance,
+    IN  DWORD               dwFlags,
+    OUT PUINT               puX,
+    OUT PUINT               puY,
+    OUT PUINT               puWidth,
+    OUT PUINT               puHeight
+    )
+{
+    BACKGROUND   bg;
+    CONST DWORD* pdwRow  = NULL;
+    UINT         uWidth  = 0;
+    UINT         uTop    = 0;
+    UINT         uBottom = 0;
+    UINT         uLeft   = 0;
+    UINT         uRight  = 0;
+    UINT         y       = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == puX) || (NULL == puY)
+        || (NULL == puWidth) || (NULL == puHeight))
+    {
+        return FALSE;
+    }
+
+    *puX      = 0;
+    *puY      = 0;
+    *puWidth  = 0;
+    *puHeight = 0;
+
+    uWidth = pImageData->uWidth;
+
+    if ((0 == uWidth) || (0 == pImageData->uHeight))
+    {
+        return TRUE;
+    }
+
+    ZeroMemory(&bg, sizeof(BACKGROUND));
+
+    if (dwFlags & WU_CONTENT_TRANSPARENT)
+    {
+        bg.dwBackground = 0;
+        bg.dwTolerance  = 0x00FFFFFF | ((DWORD) bTolerance << 24);
+    }
+    else
+    {
+        bg.dwBackground = (dwFlags & WU_CONTENT_CORNER_BACKGROUND)
+            ? GetRow(pImageData, 0)[0]
+            : ((DWORD) WuGetColorB(background)
+                | ((DWORD) WuGetColorG(background) << 8)
+                | ((DWORD) WuGetColorR(background) << 16)
+                | ((DWORD) WuGetColorA(background) << 24));
+
+        bg.dwTolerance = bTolerance * 0x01010101;
+    }
+
+#ifdef _WU_HAVE_SSE2
+    bg.background = _mm_set1_epi32((INT) bg.dwBackground);
+    bg.tolerance  = _mm_set1_epi32((INT) bg.dwTolerance);
+#endif /* _WU_HAVE_SSE2 */
+
+    /* whole rows from the top and from the bottom */
+    for (uTop = 0; uTop < pImageData->uHeight; ++uTop)
+    {
+        pdwRow = GetRow(pImageData, uTop);
+        uLeft  = FindContentForward(&bg, pdwRow, 0, uWidth);
+
+        if (uLeft < uWidth)
+        {
+            break;
+        }
+    }
+
+    if (uTop == pImageData->uHeight)
+    {
+        return TRUE;
+    }
+
+    uRight = FindContentBackward(&bg, pdwRow, uLeft, uWidth);
+
+    for (uBottom = pImageData->uHeight; uBottom - 1 > uTop; --uBottom)
+    {
+        pdwRow = GetRow(pImageData, uBottom - 1);
+
+        if (FindContentForward(&bg, pdwRow, 0, uWidth) < uWidth)
+        {
+            break;
+        }
+    }
+
+    /*
+        Every other row only needs the pixels outside the columns already
+        known to hold content, and the scans stop as soon as the box
+        spans the whole width.
+    */
+    for (y = uTop + 1; (y < uBottom) && ((uLeft > 0) || (uRight < uWidth));
+        ++y)
+    {
+        pdwRow = GetRow(pImageData, y);
+        uLeft  = FindContentForward(&bg, pdwRow, 0, uLeft);
+        uRight = FindContentBackward(&bg, pdwRow, uRight, uWidth);
+    }
+
+    *puX      = uLeft;
+    *puY      = uTop;
+    *puWidth  = uRight - uLeft;
+    *puHeight = uBottom - uTop;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuGetImageView(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  UINT                uX,
+    IN  UINT                uY,
+    IN  UINT                uWidth,
+    IN  UINT                uHeight,
+    OUT PWUIMAGEVIEW        pView
+    )
+{
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == pView))
+    {
+        return FALSE;
+    }
+
+    if ((uX > pImageData->uWidth) || (uWidth > pImageData->uWidth - uX)
+        || (uY > pImageData->uHeight)
+        || (uHeight > pImageData->uHeight - uY))
+    {
+        return FALSE;
+    }
+
+    pView->cbStride = pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    pView->abData   = pImageData->abData + (SIZE_T) uY * pView->cbStride
+        + (SIZE_T) uX * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    pView->uWidth   = uWidth;
+    pView->uHeight  = uHeight;
+
+    return TRUE;
+}
+
+WUAPI PWUIMAGEDATA
+WuCopyImageView(
+    IN CONST PWUIMAGEVIEW   pView
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbRow      = 0;
+    UINT         y          = 0;
+
+    if ((NULL == pView) || (NULL == pView->abData))
+    {
+        return NULL;
+    }
+
+    pImageData = _WuCreateUninitializedImageData(
+        pView->uWidth,
+        pView->uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    cbRow = (SIZE_T) pView->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (y = 0; y < pView->uHeight; ++y)
+    {
+        CopyMemory(
+            pImageData->abData + y * cbRow,
+            pView->abData + (SIZE_T) y * pView->cbStride,
+            cbRow);
+    }
+
+    return pImageData;
+}
@@ -0,0 +1,437 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       cube.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <string.h>
+
+#include "internal.h"
+
+/* A 256-point .cube file is about 400 MB, anything above is not a LUT */
+#define MAX_CUBE_FILE_BYTES     (512 * 1024 * 1024)
+
+typedef struct tagCUBEPARSER {
+    LPCSTR  pchCursor;
+    LPCSTR  pchEnd;
+} CUBEPARSER, *PCUBEPARSER;
+
+static WU_INLINE BOOL
+IsBlank(
+    IN CHAR ch
+    )
+{
+    return (' ' == ch) || ('\t' == ch) || ('\r' == ch);
+}
+
+static WU_INLINE BOOL
+IsDigit(
+    IN CHAR ch
+    )
+{
+    return (ch >= '0') && (ch <= '9');
+}
+
+static VOID
+SkipBlanks(
+    IN PCUBEPARSER  pParser
+    )
+{
+    while ((pParser->pchCursor < pParser->pchEnd)
+        && IsBlank(*pParser->pchCursor))
+    {
+        pParser->pchCursor++;
+    }
+}
+
+static VOID
+SkipLine(
+    IN PCUBEPARSER  pParser
+    )
+{
+    while ((pParser->pchCursor < pParser->pchEnd)
+        && (*pParser->pchCursor != '\n'))
+    {
+        pParser->pchCursor++;
+    }
+
+    if (pParser->pchCursor < pParser->pchEnd)
+    {
+        pParser->pchCursor++;
+    }
+}
+
+/* Only blanks (or a comment) may follow the values of a line */
+static BOOL
+IsEndOfLine(
+    IN PCUBEPARSER  pParser
+    )
+{
+    SkipBlanks(pParser);
+
+    return (pParser->pchCursor == pParser->pchEnd)
+        || ('\n' == *pParser->pchCursor)
+        || ('#' == *pParser->pchCursor);
+}
+
+static BOOL
+MatchKeyword(
+    IN PCUBEPARSER  pParser,
+    IN LPCSTR       szKeyword
+    )
+{
+    LPCSTR pch = pParser->pchCursor;
+
+    while (*szKeyword != '\0')
+    {
+        if ((pch == pParser->pchEnd) || (*pch != *szKeyword))
+        {
+            return FALSE;
+        }
+
+        pch++;
+        szKeyword++;
+    }
+
+    if ((pch != pParser->pchEnd) && !IsBlank(*pch) && (*pch != '\n'))
+    {
+        return FALSE;
+    }
+
+    pParser->pchCursor = pch;
+
+    return TRUE;
+}
+
+/*
+    Locale-independent decimal parser (strtod would honour a decimal
+    comma) that never reads past the end of the text, which does not have
+    to be null-terminated.
+*/
+static BOOL
+ParseFloat(
+    IN  PCUBEPARSER pParser,
+    OUT FLOAT*      pfValue
+    )
+{
+    LPCSTR pch       = NULL;
+    DOUBLE fValue    = 0.0;
+    DOUBLE fScale    = 1.0;
+    BOOL   bNegative = FALSE;
+    BOOL   bDigits   = FALSE;
+    INT    iExponent = 0;
+    BOOL   bNegExp   = FALSE;
+
+    SkipBlanks(pParser);
+
+    pch = pParser->pchCursor;
+
+    if ((pch < pParser->pchEnd) && (('-' == *pch) || ('+' == *pch)))
+    {
+        bNegative = ('-' == *pch);
+        pch++;
+    }
+
+    while ((pch < pParser->pchEnd) && IsDigit(*pch))
+    {
+        fValue  = fValue * 10.0 + (*pch - '0');
+        bDigits = TRUE;
+        pch++;
+    }
+
+    if ((pch < pParser->pchEnd) && ('.' == *pch))
+    {
+        pch++;
+
+        while ((pch < pParser->pchEnd) && IsDigit(*pch))
+        {
+            fScale  /= 10.0;
+            fValue  += (*pch - '0') * fScale;
+            bDigits  = TRUE;
+            pch++;
+        }
+    }
+
+    if (FALSE == bDigits)
+    {
+        return FALSE;
+    }
+
+    if ((pch < pParser->pchEnd) && (('e' == *pch) || ('E' == *pch)))
+    {
+        pch++;
+
+        if ((pch < pParser->pchEnd) && (('-' == *pch) || ('+' == *pch)))
+        {
+            bNegExp = ('-' == *pch);
+            pch++;
+        }
+
+        if ((pch == pParser->pchEnd) || !IsDigit(*pch))
+        {
+            return FALSE;
+        }
+
+        while ((pch < pParser->pchEnd) && IsDigit(*pch))
+        {
+            iExponent = min(iExponent * 10 + (*pch - '0'), 100);
+            pch++;
+        }
+
+        for (; iExponent > 0; --iExponent)
+        {
+            fValue = (TRUE == bNegExp) ? fValue / 10.0 : fValue * 10.0;
+        }
+    }
+
+    if ((pch < pParser->pchEnd) && !IsBlank(*pch) && (*pch != '\n')
+        && (*pch != '#'))
+    {
+        return FALSE;
+    }
+
+    pParser->pchCursor = pch;
+
+    *pfValue = (FLOAT) ((TRUE == bNegative) ? -fValue : fValue);
+
+    return TRUE;
+}
+
+static BOOL
+ParseFloats(
+    IN  PCUBEPARSER pParser,
+    OUT FLOAT*      afValues,
+    IN  UINT        cValues
+    )
+{
+    UINT i = 0;
+
+    for (i = 0; i < cValues; ++i)
+    {
+        if (ParseFloat(pParser, &afValues[i]) == FALSE)
+        {
+            return FALSE;
+        }
+    }
+
+    return IsEndOfLine(pParser);
+}
+
+WUAPI PWUCOLORLUT
+WuCreateColorLutFromCube(
+    IN LPCSTR   szCube,
+    IN SIZE_T   cchCube
+    )
+{
+    CUBEPARSER  parser;
+    FLOAT       afDomainMin[3] = { 0.0f, 0.0f, 0.0f };
+    FLOAT       afDomainMax[3] = { 1.0f, 1.0f, 1.0f };
+    FLOAT       afRange[2];
+    PWUCOLORLUT pLut           = NULL;
+    FLOAT*      afTable        = NULL;
+    FLOAT       fSize          = 0.0f;
+    SIZE_T      cPoints        = 0;
+    SIZE_T      iPoint         = 0;
+    UINT        cSize          = 0;
+    CHAR        ch             = 0;
+
+    if (NULL == szCube)
+    {
+        return NULL;
+    }
+
+    parser.pchCursor = szCube;
+    parser.pchEnd    = szCube + cchCube;
+
+    /* UTF-8 byte order mark */
+    if ((cchCube >= 3) && (0 == memcmp(szCube, "\xEF\xBB\xBF", 3)))
+    {
+        parser.pchCursor += 3;
+    }
+
+    while (parser.pchCursor < parser.pchEnd)
+    {
+        SkipBlanks(&parser);
+
+        if (IsEndOfLine(&parser) == TRUE)
+        {
+            SkipLine(&parser);
+            continue;
+        }
+
+        ch = *parser.pchCursor;
+
+        if (IsDigit(ch) || ('-' == ch) || ('+' == ch) || ('.' == ch))
+        {
+            if ((NULL == afTable) || (iPoint == cPoints))
+            {
+                goto cleanup;
+            }
+
+            if (ParseFloats(&parser, afTable + iPoint * 3, 3) == FALSE)
+            {
+                goto cleanup;
+            }
+
+            iPoint++;
+        }
+        else if (MatchKeyword(&parser, "LUT_3D_SIZE") == TRUE)
+        {
+            if ((afTable != NULL)
+                || (ParseFloats(&parser, &fSize, 1) == FALSE)
+                || (fSize < WU_COLOR_LUT_MIN_SIZE)
+                || (fSize > WU_COLOR_LUT_MAX_SIZE)
+                || (fSize != (FLOAT) (UINT) fSize))
+            {
+                goto cleanup;
+            }
+
+            cSize   = (UINT) fSize;
+            cPoints = (SIZE_T) cSize * cSize * cSize;
+            afTable = HeapAlloc(
+                GetProcessHeap(),
+                0,
+                cPoints * 3 * sizeof(FLOAT));
+
+            if (NULL == afTable)
+            {
+                goto cleanup;
+            }
+        }
+        else if (MatchKeyword(&parser, "DOMAIN_MIN") == TRUE)
+        {
+            if (ParseFloats(&parser, afDomainMin, 3) == FALSE)
+            {
+                goto cleanup;
+            }
+        }
+        else if (MatchKeyword(&parser, "DOMAIN_MAX") == TRUE)
+        {
+            if (ParseFloats(&parser, afDomainMax, 3) == FALSE)
+            {
+                goto cleanup;
+            }
+        }
+        else if (MatchKeyword(&parser, "LUT_3D_INPUT_RANGE") == TRUE)
+        {
+            if (ParseFloats(&parser, afRange, 2) == FALSE)
+            {
+                goto cleanup;
+            }
+
+            afDomainMin[0] = afDomainMin[1] = afDomainMin[2] = afRange[0];
+            afDomainMax[0] = afDomainMax[1] = afDomainMax[2] = afRange[1];
+        }
+        else if (MatchKeyword(&parser, "LUT_1D_SIZE") == TRUE)
+        {
+            /* 1D (and combined 1D + 3D) files are not supported */
+            goto cleanup;
+        }
+
+        /* TITLE and vendor keywords are ignored */
+        SkipLine(&parser);
+    }
+
+    if ((afTable != NULL) && (iPoint == cPoints))
+    {
+        pLut = WuCreateColorLut(cSize, afTable, afDomainMin, afDomainMax);
+    }
+
+cleanup:
+    if (afTable != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, afTable);
+    }
+
+    return pLut;
+}
+
+WUAPI PWUCOLORLUT
+WuLoadColorLutFromFileW(
+    IN LPCWSTR  szFilePath
+    )
+{
+    LARGE_INTEGER liSize;
+    PWUCOLORLUT   pLut   = NULL;
+    HANDLE        hFile  = INVALID_HANDLE_VALUE;
+    LPSTR         szCube = NULL;
+    DWORD         cbRead = 0;
+
+    if (NULL == szFilePath)
+    {
+        return NULL;
+    }
+
+    hFile = CreateFileW(
+        szFilePath,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        return NULL;
+    }
+
+    if ((GetFileSizeEx(hFile, &liSize) == FALSE)
+        || (liSize.QuadPart <= 0)
+        || (liSize.QuadPart > MAX_CUBE_FILE_BYTES))
+    {
+        goto cleanup;
+    }
+
+    szCube = HeapAlloc(GetProcessHeap(), 0, (SIZE_T) liSize.QuadPart);
+
+    if (NULL == szCube)
+    {
+        goto cleanup;
+    }
+
+    if ((ReadFile(hFile, szCube, liSize.LowPart, &cbRead, NULL) == FALSE)
+        || (cbRead != liSize.LowPart))
+    {
+        goto cleanup;
+    }
+
+    pLut = WuCreateColorLutFromCube(szCube, cbRead);
+
+cleanup:
+    if (szCube != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, szCube);
+    }
+
+    CloseHandle(hFile);
+
+    return pLut;
+}
+
+WUAPI PWUCOLORLUT
+WuLoadColorLutFromFileA(
+    IN LPCSTR   szFilePath
+    )
+{
+    WCHAR szwPath[MAX_PATH];
+
+    if (NULL == szFilePath)
+    {
+        return NULL;
+    }
+
+    if (WuAnsiToWide(szFilePath, szwPath, MAX_PATH) == FALSE)
+    {
+        return NULL;
+    }
+
+    return WuLoadColorLutFromFileW(szwPath);
+}
@@ -0,0 +1,588 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       delta.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define MAKE_ULONGLONG(hi, lo)  (((ULONGLONG) (hi) << 32) | (lo))
+
+/* Golden ratio and the two multipliers of the murmur3 64-bit finalizer */
+#define HASH_SEED       MAKE_ULONGLONG(0x9E3779B9, 0x7F4A7C15)
+#define HASH_MIX_1      MAKE_ULONGLONG(0xFF51AFD7, 0xED558CCD)
+#define HASH_MIX_2      MAKE_ULONGLONG(0xC4CEB9FE, 0x1A85EC53)
+
+/* Per-block key increments of the two lanes (xxHash primes) */
+#define HASH_STEP_HI_0  0x27D4EB2F
+#define HASH_STEP_LO_0  0x85EBCA77
+#define HASH_STEP_HI_1  0x165667B1
+#define HASH_STEP_LO_1  0x9E3779B9
+
+#define NO_RECT         MAXUINT
+
+#define MIN_TILE_SIZE   8
+#define MAX_TILE_SIZE   1024
+
+/*
+    Tile hashes of the previous frame plus the buffers of the last delta,
+    which are reused (and only grow) from one frame to the next.
+*/
+struct tagWUFRAMEDIFF {
+    UINT            uTileSize;
+    UINT            cTilesX;
+    UINT            cTilesY;
+    ULONGLONG*      aullHashes;     /* NULL before the first frame */
+    BYTE*           abDirty;        /* one per tile */
+    UINT*           aiOpenRects;    /* one per tile column */
+    SIZE_T          cbMaxRects;
+    SIZE_T          cbMaxPixels;
+    WUFRAMEDELTA    delta;
+};
+
+typedef struct tagFRAMEDIFFJOB {
+    CONST WUIMAGEDATA*  pFrame;
+    PWUFRAMEDIFF        pDiff;
+    BOOL                bFull;
+} FRAMEDIFFJOB, *PFRAMEDIFFJOB;
+
+static WU_INLINE ULONGLONG
+MixHash(
+    IN ULONGLONG    ullHash
+    )
+{
+    ullHash ^= ullHash >> 33;
+    ullHash *= HASH_MIX_1;
+    ullHash ^= ullHash >> 33;
+    ullHash *= HASH_MIX_2;
+    ullHash ^= ullHash >> 33;
+
+    return ullHash;
+}
+
+/*
+    XXH3-style accumulation over two 64-bit lanes: every 16-byte block is
+    xored with a key that moves on with the block position, the 32-bit
+    halves of each lane are multiplied together and the swapped block is
+    added on top, so a block of zeros or a block moved elsewhere still
+    changes the hash.
+*/
+static ULONGLONG
+HashTile(
+    IN CONST BYTE*  pbTile,
+    IN SIZE_T       cbStride,
+    IN UINT         uWidth,
+    IN UINT         uHeight
+    )
+{
+    SIZE_T      cbRow    = (SIZE_T) uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    SIZE_T      cbBlocks = cbRow & ~((SIZE_T) 15);
+    CONST BYTE* pbRow    = NULL;
+    CONST BYTE* pbBlock  = NULL;
+    BYTE        abTail[16];
+    ULONGLONG   aullAcc[2];
+    ULONGLONG   ullKey   = 0;
+    SIZE_T      i        = 0;
+    UINT        y        = 0;
+#ifdef _WU_HAVE_SSE2
+    __m128i     acc      = _mm_setzero_si128();
+    __m128i     step     = _mm_set_epi32(
+        (INT) HASH_STEP_HI_1, (INT) HASH_STEP_LO_1,
+        (INT) HASH_STEP_HI_0, (INT) HASH_STEP_LO_0);
+    __m128i     key, data, mixed;
+#else
+    ULONGLONG   aullKey[2];
+    ULONGLONG   aullData[2];
+    ULONGLONG   ullMixed = 0;
+    UINT        l        = 0;
+#endif /* _WU_HAVE_SSE2 */
+
+    ullKey = HASH_SEED ^ (((ULONGLONG) uWidth << 32) | uHeight);
+
+#ifdef _WU_HAVE_SSE2
+    key = _mm_set_epi32(
+        (INT) (~ullKey >> 32), (INT) ~ullKey,
+        (INT) (ullKey >> 32), (INT) ullKey);
+#else
+    aullAcc[0] = 0;
+    aullAcc[1] = 0;
+    aullKey[0] = ullKey;
+    aullKey[1] = ~ullKey;
+#endif /* _WU_HAVE_SSE2 */
+
+    ZeroMemory(abTail, sizeof(abTail));
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        pbRow = pbTile + y * cbStride;
+
+        for (i = 0; i < cbRow; i += 16)
+        {
+            pbBlock = pbRow + i;
+
+            if (i == cbBlocks)
+            {
+                /* partial block of a tile clipped by the image edge */
+                CopyMemory(abTail, pbBlock, cbRow - i);
+                pbBlock = abTail;
+            }
+
+#ifdef _WU_HAVE_SSE2
+            data  = _mm_loadu_si128((CONST __m128i*) pbBlock);
+            mixed = _mm_xor_si128(data, key);
+            acc   = _mm_add_epi64(acc, _mm_shuffle_epi32(data,
+                _MM_SHUFFLE(1, 0, 3, 2)));
+            acc   = _mm_add_epi64(acc, _mm_mul_epu32(mixed,
+                _mm_shuffle_epi32(mixed, _MM_SHUFFLE(2, 3, 0, 1))));
+            key   = _mm_add_epi64(key, step);
+#else
+            CopyMemory(aullData, pbBlock, sizeof(aullData));
+
+            for (l = 0; l < 2; ++l)
+            {
+                ullMixed        = aullData[l] ^ aullKey[l];
+                aullAcc[1 - l] += aullData[l];
+                aullAcc[l]     += (ullMixed & 0xFFFFFFFF) * (ullMixed >> 32);
+            }
+
+            aullKey[0] += MAKE_ULONGLONG(HASH_STEP_HI_0, HASH_STEP_LO_0);
+            aullKey[1] += MAKE_ULONGLONG(HASH_STEP_HI_1, HASH_STEP_LO_1);
+#endif /* _WU_HAVE_SSE2 */
+        }
+    }
+
+#ifdef _WU_HAVE_SSE2
+    _mm_storeu_si128((__m128i*) aullAcc, acc);
+#endif /* _WU_HAVE_SSE2 */
+
+    return MixHash(aullAcc[0] ^ MixHash(aullAcc[1] + ullKey));
+}
+
+/* One item per row of tiles: hashes it and flags the tiles that changed */
+static VOID
+HashTileRowProc(
+    IN UINT     iTileRow,
+    IN LPVOID   pContext
+    )
+{
+    PFRAMEDIFFJOB      pJob     = (PFRAMEDIFFJOB) pContext;
+    PWUFRAMEDIFF       pDiff    = pJob->pDiff;
+    CONST WUIMAGEDATA* pFrame   = pJob->pFrame;
+    SIZE_T             cbStride = 0;
+    SIZE_T             iTile    = 0;
+    ULONGLONG          ullHash  = 0;
+    UINT               uTop     = iTileRow * pDiff->uTileSize;
+    UINT               uLeft    = 0;
+    UINT               uHeight  = 0;
+    UINT               t        = 0;
+
+    cbStride = (SIZE_T) pFrame->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    uHeight  = min(pDiff->uTileSize, pFrame->uHeight - uTop);
+
+    for (t = 0; t < pDiff->cTilesX; ++t)
+    {
+        iTile = (SIZE_T) iTileRow * pDiff->cTilesX + t;
+        uLeft = t * pDiff->uTileSize;
+
+        ullHash = HashTile(
+            pFrame->abData + uTop * cbStride
+                + (SIZE_T) uLeft * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            cbStride,
+            min(pDiff->uTileSize, pFrame->uWidth - uLeft),
+            uHeight);
+
+        pDiff->abDirty[iTile] = (TRUE == pJob->bFull)
+            || (pDiff->aullHashes[iTile] != ullHash);
+
+        pDiff->aullHashes[iTile] = ullHash;
+    }
+}
+
+static VOID
+FreeTiles(
+    IN PWUFRAMEDIFF pDiff
+    )
+{
+    if (pDiff->aullHashes != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pDiff->aullHashes);
+    }
+
+    pDiff->aullHashes  = NULL;
+    pDiff->aiOpenRects = NULL;
+    pDiff->abDirty     = NULL;
+}
+
+/* The per-tile arrays share one allocation, hashes first for alignment */
+static BOOL
+ResetTiles(
+    IN PWUFRAMEDIFF pDiff,
+    IN UINT         uWidth,
+    IN UINT         uHeight
+    )
+{
+    SIZE_T cTiles = 0;
+
+    FreeTiles(pDiff);
+
+    pDiff->cTilesX = (uWidth + pDiff->uTileSize - 1) / pDiff->uTileSize;
+    pDiff->cTilesY = (uHeight + pDiff->uTileSize - 1) / pDiff->uTileSize;
+
+    cTiles = (SIZE_T) pDiff->cTilesX * pDiff->cTilesY;
+
+    pDiff->aullHashes = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        cTiles * (sizeof(ULONGLONG) + 1) + pDiff->cTilesX * sizeof(UINT));
+
+    if (NULL == pDiff->aullHashes)
+    {
+        return FALSE;
+    }
+
+    pDiff->aiOpenRects = (UINT*) (pDiff->aullHashes + cTiles);
+    pDiff->abDirty     = (BYTE*) (pDiff->aiOpenRects + pDiff->cTilesX);
+
+    pDiff->delta.uWidth  = uWidth;
+    pDiff->delta.uHeight = uHeight;
+
+    return TRUE;
+}
+
+/*
+    Runs of dirty tiles within a row of tiles become rectangles. A run
+    spanning exactly the same columns as a rectangle that reaches down to
+    this row extends that rectangle instead; aiOpenRects tracks, for the
+    tile column a rectangle starts on, the one that can still grow.
+*/
+static BOOL
+BuildRects(
+    IN PWUFRAMEDIFF pDiff
+    )
+{
+    PWUFRAMEDELTA pDelta    = &pDiff->delta;
+    PWUDIRTYRECT  pRect     = NULL;
+    UINT*         aiOpen    = pDiff->aiOpenRects;
+    CONST BYTE*   abDirty   = NULL;
+    UINT          uTileSize = pDiff->uTileSize;
+    UINT          uX        = 0;
+    UINT          uWidth    = 0;
+    UINT          uBottom   = 0;
+    UINT          tx        = 0;
+    UINT          ty        = 0;
+    UINT          tEnd      = 0;
+
+    pDelta->cRects      = 0;
+    pDelta->cDirtyTiles = 0;
+
+    for (tx = 0; tx < pDiff->cTilesX; ++tx)
+    {
+        aiOpen[tx] = NO_RECT;
+    }
+
+    for (ty = 0; ty < pDiff->cTilesY; ++ty)
+    {
+        abDirty = pDiff->abDirty + (SIZE_T) ty * pDiff->cTilesX;
+        uBottom = min((ty + 1) * uTileSize, pDelta->uHeight);
+
+        for (tx = 0; tx < pDiff->cTilesX; tx = tEnd)
+        {
+            if (0 == abDirty[tx])
+            {
+                aiOpen[tx] = NO_RECT;
+                tEnd       = tx + 1;
+                continue;
+            }
+
+            for (tEnd = tx + 1; tEnd < pDiff->cTilesX; ++tEnd)
+            {
+                if (0 == abDirty[tEnd])
+                {
+                    break;
+                }
+
+                aiOpen[tEnd] = NO_RECT;
+            }
+
+            pDelta->cDirtyTiles += tEnd - tx;
+
+            uX     = tx * uTileSize;
+            uWidth = min(tEnd * uTileSize, pDelta->uWidth) - uX;
+
+            if ((aiOpen[tx] != NO_RECT)
+                && (pDelta->aRects[aiOpen[tx]].uWidth == uWidth))
+            {
+                pRect          = &pDelta->aRects[aiOpen[tx]];
+                pRect->uHeight = uBottom - pRect->uY;
+                continue;
+            }
+
+            if (_WuGrowBuffer((LPVOID*) &pDelta->aRects, &pDiff->cbMaxRects,
+                    (SIZE_T) (pDelta->cRects + 1) * sizeof(WUDIRTYRECT))
+                == FALSE)
+            {
+                return FALSE;
+            }
+
+            aiOpen[tx]     = pDelta->cRects;
+            pRect          = &pDelta->aRects[pDelta->cRects++];
+            pRect->uX      = uX;
+            pRect->uY      = ty * uTileSize;
+            pRect->uWidth  = uWidth;
+            pRect->uHeight = uBottom - pRect->uY;
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+CopyRects(
+    IN PWUFRAMEDIFF         pDiff,
+    IN CONST WUIMAGEDATA*   pFrame
+    )
+{
+    PWUFRAMEDELTA      pDelta   = &pDiff->delta;
+    CONST WUDIRTYRECT* pRect    = NULL;
+    SIZE_T             cbStride = 0;
+    SIZE_T             cbRow    = 0;
+    SIZE_T             cbTotal  = 0;
+    BYTE*              pbDst    = NULL;
+    UINT               r        = 0;
+    UINT               y        = 0;
+
+    for (r = 0; r < pDelta->cRects; ++r)
+    {
+        cbTotal += (SIZE_T) pDelta->aRects[r].uWidth
+            * pDelta->aRects[r].uHeight * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    }
+
+    if (_WuGrowBuffer((LPVOID*) &pDelta->abPixels, &pDiff->cbMaxPixels,
+            cbTotal) == FALSE)
+    {
+        return FALSE;
+    }
+
+    cbStride = (SIZE_T) pFrame->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    pbDst    = pDelta->abPixels;
+
+    for (r = 0; r < pDelta->cRects; ++r)
+    {
+        pRect = &pDelta->aRects[r];
+        cbRow = (SIZE_T) pRect->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        for (y = pRect->uY; y < pRect->uY + pRect->uHeight; ++y)
+        {
+            CopyMemory(
+                pbDst,
+                pFrame->abData + y * cbStride
+                    + (SIZE_T) pRect->uX * WU_IMAGEDATA_BYTES_PER_PIXEL,
+                cbRow);
+
+            pbDst += cbRow;
+        }
+    }
+
+    pDelta->cbPixels = cbTotal;
+
+    return TRUE;
+}
+
+WUAPI PWUFRAMEDIFF
+WuCreateFrameDiff(
+    IN UINT uTileSize
+    )
+{
+    PWUFRAMEDIFF pDiff = NULL;
+
+    if (0 == uTileSize)
+    {
+        uTileSize = WU_FRAME_DIFF_DEFAULT_TILE_SIZE;
+    }
+
+    if ((uTileSize < MIN_TILE_SIZE) || (uTileSize > MAX_TILE_SIZE))
+    {
+        return NULL;
+    }
+
+    pDiff = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUFRAMEDIFF));
+
+    if (NULL == pDiff)
+    {
+        return NULL;
+    }
+
+    pDiff->uTileSize = uTileSize;
+
+    return pDiff;
+}
+
+WUAPI PWUFRAMEDELTA
+WuFrameDiffCompare(
+    IN PWUFRAMEDIFF         pDiff,
+    IN CONST PWUIMAGEDATA   pFrame,
+    IN DWORD                dwFlags
+    )
+{
+    FRAMEDIFFJOB job;
+    BOOL         bFull = (dwFlags & WU_FRAME_DIFF_FULL) != 0;
+
+    if ((NULL == pDiff) || (NULL == pFrame) || (NULL == pFrame->abData))
+    {
+        return NULL;
+    }
+
+    if ((0 == pFrame->uWidth) || (0 == pFrame->uHeight))
+    {
+        return NULL;
+    }
+
+    if ((NULL == pDiff->aullHashes)
+        || (pDiff->delta.uWidth != pFrame->uWidth)
+        || (pDiff->delta.uHeight != pFrame->uHeight))
+    {
+        if (ResetTiles(pDiff, pFrame->uWidth, pFrame->uHeight) == FALSE)
+        {
+            return NULL;
+        }
+
+        bFull = TRUE;
+    }
+
+    ZeroMemory(&job, sizeof(FRAMEDIFFJOB));
+
+    job.pFrame = pFrame;
+    job.pDiff  = pDiff;
+    job.bFull  = bFull;
+
+    _WuParallelFor(pDiff->cTilesY, HashTileRowProc, &job);
+
+    pDiff->delta.cTiles = pDiff->cTilesX * pDiff->cTilesY;
+
+    if ((BuildRects(pDiff) == FALSE) || (CopyRects(pDiff, pFrame) == FALSE))
+    {
+        /* the hashes already moved on, the next frame must be complete */
+        FreeTiles(pDiff);
+
+        return NULL;
+    }
+
+    return &pDiff->delta;
+}
+
+WUAPI VOID
+WuDestroyFrameDiff(
+    IN PWUFRAMEDIFF pDiff
+    )
+{
+    if (NULL == pDiff)
+    {
+        return;
+    }
+
+    FreeTiles(pDiff);
+
+    if (pDiff->delta.aRects != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pDiff->delta.aRects);
+    }
+
+    if (pDiff->delta.abPixels != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pDiff->delta.abPixels);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pDiff);
+}
+
+WUAPI BOOL
+WuApplyFrameDelta(
+    IN PWUIMAGEDATA         pImageData,
+    IN CONST PWUFRAMEDELTA  pDelta
+    )
+{
+    CONST WUDIRTYRECT* pRect    = NULL;
+    CONST BYTE*        pbSrc    = NULL;
+    SIZE_T             cbStride = 0;
+    SIZE_T             cbRow    = 0;
+    SIZE_T             cbUsed   = 0;
+    UINT               r        = 0;
+    UINT               y        = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == pDelta))
+    {
+        return FALSE;
+    }
+
+    if ((pImageData->uWidth != pDelta->uWidth)
+        || (pImageData->uHeight != pDelta->uHeight))
+    {
+        return FALSE;
+    }
+
+    if ((pDelta->cRects > 0)
+        && ((NULL == pDelta->aRects) || (NULL == pDelta->abPixels)))
+    {
+        return FALSE;
+    }
+
+    /*
+        The whole delta is validated first: a rectangle outside the frame
+        or pixels short of cbPixels (a truncated or forged delta) must
+        not leave the image half updated.
+    */
+    for (r = 0; r < pDelta->cRects; ++r)
+    {
+        pRect = &pDelta->aRects[r];
+        cbRow = (SIZE_T) pRect->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        if ((pRect->uX > pDelta->uWidth)
+            || (pRect->uWidth > pDelta->uWidth - pRect->uX)
+            || (pRect->uY > pDelta->uHeight)
+            || (pRect->uHeight > pDelta->uHeight - pRect->uY))
+        {
+            return FALSE;
+        }
+
+        /* cbRow * uHeight cannot overflow, the rectangle fits the frame */
+        if (cbRow * pRect->uHeight > pDelta->cbPixels - cbUsed)
+        {
+            return FALSE;
+        }
+
+        cbUsed += cbRow * pRect->uHeight;
+    }
+
+    cbStride = (SIZE_T) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    pbSrc    = pDelta->abPixels;
+
+    for (r = 0; r < pDelta->cRects; ++r)
+    {
+        pRect = &pDelta->aRects[r];
+        cbRow = (SIZE_T) pRect->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        for (y = pRect->uY; y < pRect->uY + pRect->uHeight; ++y)
+        {
+            CopyMemory(
+                pImageData->abData + y * cbStride
+                    + (SIZE_T) pRect->uX * WU_IMAGEDATA_BYTES_PER_PIXEL,
+                pbSrc,
+                cbRow);
+
+            pbSrc += cbRow;
+        }
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,476 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       dib.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#ifndef BI_ALPHABITFIELDS
+    #define BI_ALPHABITFIELDS   6       /* not present in every wingdi.h */
+#endif /* BI_ALPHABITFIELDS */
+
+/* Masks live right after the 40-byte header, inside it for V2 and later */
+#define DIB_MASKS_OFFSET        sizeof(BITMAPINFOHEADER)
+#define DIB_ALPHA_MASK_END      (DIB_MASKS_OFFSET + 4 * sizeof(DWORD))
+
+#define DIB_MAX_PALETTE         256
+
+#define OPAQUE_ALPHA            0xFF000000
+
+typedef enum {
+    DIB_ROW_BGRX      = 0x0,    /* 32 bpp, 8-bit BGR, alpha forced */
+    DIB_ROW_BGRA      = 0x1,    /* 32 bpp, 8-bit BGRA, copied as is */
+    DIB_ROW_BGR       = 0x2,    /* 24 bpp */
+    DIB_ROW_INDEXED   = 0x3,    /* 1, 2, 4 or 8 bpp through the palette */
+    DIB_ROW_BITFIELDS = 0x4     /* 16 or 32 bpp, any masks */
+} DIB_ROW_FORMAT;
+
+typedef struct tagDIBCHANNEL {
+    DWORD   dwMask;
+    UINT    uShift;             /* of the lowest mask bit */
+    DWORD   dwMax;              /* mask >> uShift, 0 if unused */
+} DIBCHANNEL, *PDIBCHANNEL;
+
+typedef struct tagDIBLAYOUT {
+    DIB_ROW_FORMAT  format;
+    UINT            uBitCount;
+    DIBCHANNEL      aChannels[4];       /* B, G, R, A */
+    DWORD           adwPalette[DIB_MAX_PALETTE];
+} DIBLAYOUT, *PDIBLAYOUT;
+
+static DWORD
+ReadDword(
+    IN CONST BYTE*  pb
+    )
+{
+    return (DWORD) pb[0]
+        | ((DWORD) pb[1] << 8)
+        | ((DWORD) pb[2] << 16)
+        | ((DWORD) pb[3] << 24);
+}
+
+static VOID
+SetChannel(
+    OUT PDIBCHANNEL pChannel,
+    IN  DWORD       dwMask
+    )
+{
+    pChannel->dwMask = dwMask;
+    pChannel->uShift = 0;
+    pChannel->dwMax  = 0;
+
+    if (0 == dwMask)
+    {
+        return;
+    }
+
+    while (0 == (dwMask & 1))
+    {
+        dwMask >>= 1;
+        pChannel->uShift++;
+    }
+
+    pChannel->dwMax = dwMask;
+}
+
+/* Scales one masked channel to 8 bits, rounding to nearest */
+static WU_INLINE DWORD
+ExtractChannel(
+    IN CONST DIBCHANNEL*    pChannel,
+    IN DWORD                dwPixel
+    )
+{
+    DWORD dwValue = (dwPixel & pChannel->dwMask) >> pChannel->uShift;
+
+    if (0xFF == pChannel->dwMax)
+    {
+        return dwValue;
+    }
+
+    return (DWORD) (((ULONGLONG) dwValue * 0xFF + pChannel->dwMax / 2)
+        / pChannel->dwMax);
+}
+
+static BOOL
+IsContiguousMask(
+    IN DWORD    dwMask
+    )
+{
+    while ((dwMask != 0) && (0 == (dwMask & 1)))
+    {
+        dwMask >>= 1;
+    }
+
+    return (0 == (dwMask & (dwMask + 1)));
+}
+
+static VOID
+ConvertRowBgrx(
+    IN  CONST BYTE* pbSrc,
+    OUT BYTE*       pbDst,
+    IN  UINT        cPixels
+    )
+{
+    UINT  x      = 0;
+    DWORD dwBgrx = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i alpha = _mm_set1_epi32((INT) OPAQUE_ALPHA);
+
+    for (; x + 4 <= cPixels; x += 4)
+    {
+        _mm_storeu_si128((__m128i*) (pbDst + x * 4), _mm_or_si128(
+            _mm_loadu_si128((CONST __m128i*) (pbSrc + x * 4)),
+            alpha));
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        CopyMemory(&dwBgrx, pbSrc + x * 4, sizeof(DWORD));
+
+        dwBgrx |= OPAQUE_ALPHA;
+
+        CopyMemory(pbDst + x * 4, &dwBgrx, sizeof(DWORD));
+    }
+}
+
+static VOID
+ConvertRowBgr(
+    IN  CONST BYTE* pbSrc,
+    OUT BYTE*       pbDst,
+    IN  UINT        cPixels
+    )
+{
+    DWORD adwSrc[3];
+    DWORD adwDst[4];
+    UINT  x         = 0;
+
+    /* four pixels are three whole DWORDs, spread them with shifts */
+    for (; x + 4 <= cPixels; x += 4, pbSrc += 12, pbDst += 16)
+    {
+        CopyMemory(adwSrc, pbSrc, sizeof(adwSrc));
+
+        adwDst[0] = adwSrc[0] | OPAQUE_ALPHA;
+        adwDst[1] = (adwSrc[0] >> 24) | (adwSrc[1] << 8) | OPAQUE_ALPHA;
+        adwDst[2] = (adwSrc[1] >> 16) | (adwSrc[2] << 16) | OPAQUE_ALPHA;
+        adwDst[3] = (adwSrc[2] >> 8) | OPAQUE_ALPHA;
+
+        CopyMemory(pbDst, adwDst, sizeof(adwDst));
+    }
+
+    for (; x < cPixels; ++x, pbSrc += 3, pbDst += 4)
+    {
+        pbDst[0] = pbSrc[0];
+        pbDst[1] = pbSrc[1];
+        pbDst[2] = pbSrc[2];
+        pbDst[3] = 0xFF;
+    }
+}
+
+static VOID
+ConvertRowIndexed(
+    IN  CONST DIBLAYOUT*    pLayout,
+    IN  CONST BYTE*         pbSrc,
+    OUT BYTE*               pbDst,
+    IN  UINT                cPixels
+    )
+{
+    UINT  uBitCount  = pLayout->uBitCount;
+    UINT  uIndexMask = (1u << uBitCount) - 1;
+    UINT  uBit       = 0;
+    UINT  x          = 0;
+    DWORD dwColor    = 0;
+
+    for (x = 0; x < cPixels; ++x, uBit += uBitCount)
+    {
+        /* the leftmost pixel is in the most significant bits */
+        dwColor = pLayout->adwPalette[
+            (pbSrc[uBit >> 3] >> (8 - uBitCount - (uBit & 7))) & uIndexMask];
+
+        CopyMemory(pbDst + x * 4, &dwColor, sizeof(DWORD));
+    }
+}
+
+static VOID
+ConvertRowBitfields(
+    IN  CONST DIBLAYOUT*    pLayout,
+    IN  CONST BYTE*         pbSrc,
+    OUT BYTE*               pbDst,
+    IN  UINT                cPixels
+    )
+{
+    UINT  uBytes  = pLayout->uBitCount / 8;
+    UINT  x       = 0;
+    DWORD dwPixel = 0;
+
+    for (x = 0; x < cPixels; ++x, pbSrc += uBytes, pbDst += 4)
+    {
+        dwPixel = (2 == uBytes)
+            ? (DWORD) pbSrc[0] | ((DWORD) pbSrc[1] << 8)
+            : ReadDword(pbSrc);
+
+        pbDst[0] = (BYTE) ExtractChannel(&pLayout->aChannels[0], dwPixel);
+        pbDst[1] = (BYTE) ExtractChannel(&pLayout->aChannels[1], dwPixel);
+        pbDst[2] = (BYTE) ExtractChannel(&pLayout->aChannels[2], dwPixel);
+        pbDst[3] = (0 == pLayout->aChannels[3].dwMask)
+            ? 0xFF
+            : (BYTE) ExtractChannel(&pLayout->aChannels[3], dwPixel);
+    }
+}
+
+/* Header order of the masks is R, G, B, A; channels are stored B, G, R, A */
+static CONST UINT g_auMaskToChannel[4] = { 2, 1, 0, 3 };
+
+/*
+    Picks the row converter from the header. Returns the size of what sits
+    between the header and the palette (the masks of a 40-byte header), or
+    MAXDWORD if the bitmap cannot be read.
+*/
+static DWORD
+ParseLayout(
+    IN  CONST BITMAPINFOHEADER* pHeader,
+    IN  CONST BYTE*             pbDib,
+    IN  SIZE_T                  cbDib,
+    OUT PDIBLAYOUT              pLayout
+    )
+{
+    DWORD cbMasks = 0;
+    DWORD cMasks  = 0;
+    DWORD dwMask  = 0;
+    DWORD i       = 0;
+
+    pLayout->uBitCount = pHeader->biBitCount;
+
+    if (BI_RGB == pHeader->biCompression)
+    {
+        switch (pHeader->biBitCount)
+        {
+            case 1:
+            case 2:
+            case 4:
+            case 8:
+                pLayout->format = DIB_ROW_INDEXED;
+                return 0;
+            case 16:
+                /* 5-5-5, the top bit is unused */
+                SetChannel(&pLayout->aChannels[0], 0x001F);
+                SetChannel(&pLayout->aChannels[1], 0x03E0);
+                SetChannel(&pLayout->aChannels[2], 0x7C00);
+                pLayout->format = DIB_ROW_BITFIELDS;
+                return 0;
+            case 24:
+                pLayout->format = DIB_ROW_BGR;
+                return 0;
+            case 32:
+                pLayout->format = DIB_ROW_BGRX;
+                return 0;
+            default:
+                return MAXDWORD;
+        }
+    }
+
+    /* RLE, JPEG and PNG payloads are not handled here */
+    if (BI_BITFIELDS == pHeader->biCompression)
+    {
+        cMasks = 3;
+    }
+    else if (BI_ALPHABITFIELDS == pHeader->biCompression)
+    {
+        cMasks = 4;
+    }
+    else
+    {
+        return MAXDWORD;
+    }
+
+    if ((pHeader->biBitCount != 16) && (pHeader->biBitCount != 32))
+    {
+        return MAXDWORD;
+    }
+
+    if (sizeof(BITMAPINFOHEADER) == pHeader->biSize)
+    {
+        cbMasks = cMasks * sizeof(DWORD);
+    }
+    else if (pHeader->biSize >= DIB_ALPHA_MASK_END)
+    {
+        cMasks = 4;         /* V3 and later always carry an alpha mask */
+    }
+    else if (pHeader->biSize < DIB_MASKS_OFFSET + cMasks * sizeof(DWORD))
+    {
+        return MAXDWORD;
+    }
+
+    if (cbDib < DIB_MASKS_OFFSET + cMasks * sizeof(DWORD))
+    {
+        return MAXDWORD;
+    }
+
+    for (i = 0; i < cMasks; ++i)
+    {
+        dwMask = ReadDword(pbDib + DIB_MASKS_OFFSET + i * sizeof(DWORD));
+
+        /* only alpha may be absent, ExtractChannel divides by the max */
+        if ((IsContiguousMask(dwMask) == FALSE)
+            || ((0 == dwMask) && (i < 3)))
+        {
+            return MAXDWORD;
+        }
+
+        SetChannel(&pLayout->aChannels[g_auMaskToChannel[i]], dwMask);
+    }
+
+    pLayout->format = DIB_ROW_BITFIELDS;
+
+    if ((32 == pHeader->biBitCount)
+        && (0x000000FF == pLayout->aChannels[0].dwMask)
+        && (0x0000FF00 == pLayout->aChannels[1].dwMask)
+        && (0x00FF0000 == pLayout->aChannels[2].dwMask))
+    {
+        if (0 == pLayout->aChannels[3].dwMask)
+        {
+            pLayout->format = DIB_ROW_BGRX;
+        }
+        else if (0xFF000000 == pLayout->aChannels[3].dwMask)
+        {
+            pLayout->format = DIB_ROW_BGRA;
+        }
+    }
+
+    return cbMasks;
+}
+
+WUAPI PWUIMAGEDATA
+WuImageDataFromPackedDib(
+    IN CONST BYTE*  pbDib,
+    IN SIZE_T       cbDib
+    )
+{
+    BITMAPINFOHEADER header;
+    DIBLAYOUT        layout;
+    PWUIMAGEDATA     pImageData = NULL;
+    CONST BYTE*      pbPalette  = NULL;
+    CONST BYTE*      pbBits     = NULL;
+    CONST BYTE*      pbSrcRow   = NULL;
+    BYTE*            pbDstRow   = NULL;
+    DWORD            cbMasks    = 0;
+    DWORD            cColors    = 0;
+    ULONGLONG        cbStride   = 0;
+    ULONGLONG        cbOffset   = 0;
+    UINT             uWidth     = 0;
+    UINT             uHeight    = 0;
+    BOOL             bTopDown   = FALSE;
+    UINT             i          = 0;
+    UINT             y          = 0;
+
+    if ((NULL == pbDib) || (cbDib < sizeof(BITMAPINFOHEADER)))
+    {
+        return NULL;
+    }
+
+    /* clipboard memory is aligned, but callers may hand in any buffer */
+    CopyMemory(&header, pbDib, sizeof(BITMAPINFOHEADER));
+
+    if ((header.biSize < sizeof(BITMAPINFOHEADER))
+        || (header.biSize > cbDib)
+        || (header.biPlanes != 1)
+        || (header.biWidth <= 0)
+        || (0 == header.biHeight)
+        || (header.biHeight < -MAXLONG))
+    {
+        return NULL;
+    }
+
+    ZeroMemory(&layout, sizeof(DIBLAYOUT));
+
+    cbMasks = ParseLayout(&header, pbDib, cbDib, &layout);
+
+    if (MAXDWORD == cbMasks)
+    {
+        return NULL;
+    }
+
+    bTopDown = (header.biHeight < 0);
+    uWidth   = (UINT) header.biWidth;
+    uHeight  = (UINT) (bTopDown ? -header.biHeight : header.biHeight);
+
+    /* biClrUsed may also list colors for bitmaps that need no palette */
+    cColors = header.biClrUsed;
+
+    if ((DIB_ROW_INDEXED == layout.format) && (0 == cColors))
+    {
+        cColors = 1u << layout.uBitCount;
+    }
+
+    cbOffset = (ULONGLONG) header.biSize + cbMasks
+        + (ULONGLONG) cColors * sizeof(RGBQUAD);
+    cbStride = (((ULONGLONG) uWidth * layout.uBitCount + 31) / 32) * 4;
+
+    if ((cbOffset > cbDib) || (cbStride * uHeight > cbDib - cbOffset))
+    {
+        return NULL;
+    }
+
+    pbPalette = pbDib + header.biSize + cbMasks;
+    pbBits    = pbDib + (SIZE_T) cbOffset;
+
+    if (DIB_ROW_INDEXED == layout.format)
+    {
+        /* indices past the palette read as black */
+        for (i = 0; i < min(cColors, DIB_MAX_PALETTE); ++i)
+        {
+            layout.adwPalette[i] = (ReadDword(pbPalette + i * 4)
+                & 0x00FFFFFF) | OPAQUE_ALPHA;
+        }
+
+        for (; i < DIB_MAX_PALETTE; ++i)
+        {
+            layout.adwPalette[i] = OPAQUE_ALPHA;
+        }
+    }
+
+    pImageData = _WuCreateUninitializedImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        pbSrcRow = pbBits
+            + (SIZE_T) cbStride * (bTopDown ? y : uHeight - 1 - y);
+        pbDstRow = pImageData->abData
+            + (SIZE_T) y * uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        switch (layout.format)
+        {
+            case DIB_ROW_BGRX:
+                ConvertRowBgrx(pbSrcRow, pbDstRow, uWidth);
+                break;
+            case DIB_ROW_BGRA:
+                CopyMemory(pbDstRow, pbSrcRow, (SIZE_T) uWidth * 4);
+                break;
+            case DIB_ROW_BGR:
+                ConvertRowBgr(pbSrcRow, pbDstRow, uWidth);
+                break;
+            case DIB_ROW_INDEXED:
+                ConvertRowIndexed(&layout, pbSrcRow, pbDstRow, uWidth);
+                break;
+            default:
+                ConvertRowBitfields(&layout, pbSrcRow, pbDstRow, uWidth);
+                break;
+        }
+    }
+
+    return pImageData;
+}
@@ -0,0 +1,968 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       draw.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <math.h>
+
+#include "internal.h"
+
+#define PI                      3.14159265358979323846
+
+#define STRIP_ROWS              32
+
+/* Edges are clipped this far outside the image, see AddEdge */
+#define EDGE_MARGIN             1.0
+#define EDGE_MAX_PIECES         3
+
+/* Ellipses are flattened to chords no further than this from the curve */
+#define ELLIPSE_TOLERANCE       0.125
+#define MIN_ELLIPSE_SEGMENTS    8
+#define MAX_ELLIPSE_SEGMENTS    1024
+
+typedef struct tagEDGE {
+    FLOAT   x0;
+    FLOAT   y0;
+    FLOAT   x1;
+    FLOAT   y1;
+} EDGE, *PEDGE;
+
+/*
+    Signed-area coverage accumulation: every edge adds the area it covers
+    to the left of each pixel into afAccum, a running sum along the row
+    then gives the winding-weighted coverage of every pixel. Overlapping
+    shapes with the same winding saturate at full coverage, so strokes
+    built from overlapping quads come out as their union.
+*/
+typedef struct tagRASTER {
+    PWUIMAGEDATA    pImageData;
+    PEDGE           aEdges;
+    UINT            cEdges;
+    UINT            cMaxEdges;
+    FLOAT           fMinX;
+    FLOAT           fMinY;
+    FLOAT           fMaxX;
+    FLOAT           fMaxY;
+} RASTER, *PRASTER;
+
+static DWORD
+ColorToPixel(
+    IN WUCOLOR  color
+    )
+{
+    /* blending treats the source as opaque, see BlendSpan */
+    return (DWORD) WuGetColorB(color)
+        | ((DWORD) WuGetColorG(color) << 8)
+        | ((DWORD) WuGetColorR(color) << 16)
+        | 0xFF000000;
+}
+
+/*
+    Source-over with a constant color and alpha. With the source alpha
+    channel set to 255, the same formula also gives the destination
+    alpha: a + da * (1 - a).
+*/
+static VOID
+BlendSpan(
+    IN OUT DWORD*   pdwPixels,
+    IN     UINT     cPixels,
+    IN     DWORD    dwColor,
+    IN     UINT     uAlpha
+    )
+{
+    UINT  x      = 0;
+    UINT  c      = 0;
+    UINT  uValue = 0;
+    DWORD dwDst  = 0;
+    DWORD dwOut  = 0;
+
+    if (0 == uAlpha)
+    {
+        return;
+    }
+
+    if (uAlpha >= 0xFF)
+    {
+        for (x = 0; x < cPixels; ++x)
+        {
+            pdwPixels[x] = dwColor;
+        }
+
+        return;
+    }
+
+#ifdef _WU_HAVE_SSE2
+    {
+        __m128i zero    = _mm_setzero_si128();
+        __m128i bias    = _mm_set1_epi16(0x80);
+        __m128i inverse = _mm_set1_epi16((SHORT) (0xFF - uAlpha));
+        __m128i source;
+        __m128i lo, hi;
+
+        source = _mm_unpacklo_epi8(_mm_set1_epi32((INT) dwColor), zero);
+        source = _mm_add_epi16(
+            _mm_mullo_epi16(source, _mm_set1_epi16((SHORT) uAlpha)),
+            bias);
+
+        for (; x + 4 <= cPixels; x += 4)
+        {
+            hi = _mm_loadu_si128((CONST __m128i*) (pdwPixels + x));
+            lo = _mm_unpacklo_epi8(hi, zero);
+            hi = _mm_unpackhi_epi8(hi, zero);
+
+            lo = _mm_add_epi16(_mm_mullo_epi16(lo, inverse), source);
+            hi = _mm_add_epi16(_mm_mullo_epi16(hi, inverse), source);
+
+            /* t / 255 as (t + (t >> 8)) >> 8, t already biased */
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+            _mm_storeu_si128((__m128i*) (pdwPixels + x),
+                _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        dwDst = pdwPixels[x];
+        dwOut = 0;
+
+        for (c = 0; c < 32; c += 8)
+        {
+            uValue = ((dwColor >> c) & 0xFF) * uAlpha
+                + ((dwDst >> c) & 0xFF) * (0xFF - uAlpha) + 0x80;
+
+            dwOut |= (DWORD) (((uValue + (uValue >> 8)) >> 8) & 0xFF) << c;
+        }
+
+        pdwPixels[x] = dwOut;
+    }
+}
+
+static BOOL
+BeginRaster(
+    IN PRASTER      pRaster,
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         cMaxEdges
+    )
+{
+    ZeroMemory(pRaster, sizeof(RASTER));
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (0 == cMaxEdges) || (cMaxEdges > MAXUINT / EDGE_MAX_PIECES))
+    {
+        return FALSE;
+    }
+
+    /* every edge may be split while clipping */
+    pRaster->aEdges = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) cMaxEdges * EDGE_MAX_PIECES * sizeof(EDGE));
+
+    if (NULL == pRaster->aEdges)
+    {
+        return FALSE;
+    }
+
+    pRaster->pImageData = pImageData;
+    pRaster->cMaxEdges  = cMaxEdges * EDGE_MAX_PIECES;
+    pRaster->fMinX      = (FLOAT) pImageData->uWidth;
+    pRaster->fMinY      = (FLOAT) pImageData->uHeight;
+    pRaster->fMaxX      = 0.0f;
+    pRaster->fMaxY      = 0.0f;
+
+    return TRUE;
+}
+
+static VOID
+StoreEdge(
+    IN PRASTER  pRaster,
+    IN DOUBLE   dbX0,
+    IN DOUBLE   dbY0,
+    IN DOUBLE   dbX1,
+    IN DOUBLE   dbY1
+    )
+{
+    PEDGE pEdge = NULL;
+    FLOAT x0    = (FLOAT) dbX0;
+    FLOAT y0    = (FLOAT) dbY0;
+    FLOAT x1    = (FLOAT) dbX1;
+    FLOAT y1    = (FLOAT) dbY1;
+
+    /* horizontal edges add no area */
+    if ((y0 == y1) || (pRaster->cEdges >= pRaster->cMaxEdges))
+    {
+        return;
+    }
+
+    pEdge = &pRaster->aEdges[pRaster->cEdges++];
+
+    pEdge->x0 = x0;
+    pEdge->y0 = y0;
+    pEdge->x1 = x1;
+    pEdge->y1 = y1;
+
+    pRaster->fMinX = min(pRaster->fMinX, min(x0, x1));
+    pRaster->fMaxX = max(pRaster->fMaxX, max(x0, x1));
+    pRaster->fMinY = min(pRaster->fMinY, min(y0, y1));
+    pRaster->fMaxY = max(pRaster->fMaxY, max(y0, y1));
+}
+
+/*
+    Edges are clipped to the image (plus EDGE_MARGIN) before they are
+    stored, in DOUBLE so that even spans of +/-FLT_MAX stay finite. Rows
+    outside the image are never drawn and are simply cut off. Coverage
+    left or right of the image collapses onto its border column anyway,
+    so those parts are replaced by vertical edges on the clip bounds
+    covering the same rows, which splits an edge into up to
+    EDGE_MAX_PIECES.
+*/
+static VOID
+AddEdge(
+    IN PRASTER  pRaster,
+    IN FLOAT    fX0,
+    IN FLOAT    fY0,
+    IN FLOAT    fX1,
+    IN FLOAT    fY1
+    )
+{
+    DOUBLE dbMinX = -EDGE_MARGIN;
+    DOUBLE dbMaxX = pRaster->pImageData->uWidth + EDGE_MARGIN;
+    DOUBLE dbMinY = -EDGE_MARGIN;
+    DOUBLE dbMaxY = pRaster->pImageData->uHeight + EDGE_MARGIN;
+    DOUBLE dbDx   = (DOUBLE) fX1 - fX0;
+    DOUBLE dbDy   = (DOUBLE) fY1 - fY0;
+    DOUBLE dbT0   = 0.0;
+    DOUBLE dbT1   = 0.0;
+    DOUBLE dbTa   = 0.0;
+    DOUBLE dbTb   = 0.0;
+    DOUBLE dbX    = 0.0;
+    DOUBLE adbT[EDGE_MAX_PIECES + 1];
+    UINT   cT     = 0;
+    UINT   i      = 0;
+
+    /* horizontal edges add no area; NaN and infinities are dropped */
+    if (!(fY0 != fY1) || !(dbDx - dbDx == 0.0) || !(dbDy - dbDy == 0.0))
+    {
+        return;
+    }
+
+    /* the part of the edge, as t in [0, 1], that crosses the rows */
+    dbT0 = (dbMinY - fY0) / dbDy;
+    dbT1 = (dbMaxY - fY0) / dbDy;
+
+    dbTa = max(0.0, min(dbT0, dbT1));
+    dbTb = min(1.0, max(dbT0, dbT1));
+
+    if (!(dbTa < dbTb))
+    {
+        return;
+    }
+
+    adbT[cT++] = dbTa;
+
+    /* crossings of the clip columns, in t order */
+    if (dbDx != 0.0)
+    {
+        dbT0 = (dbMinX - fX0) / dbDx;
+        dbT1 = (dbMaxX - fX0) / dbDx;
+
+        if (dbT0 > dbT1)
+        {
+            dbX  = dbT0;
+            dbT0 = dbT1;
+            dbT1 = dbX;
+        }
+
+        if ((dbT0 > dbTa) && (dbT0 < dbTb))
+        {
+            adbT[cT++] = dbT0;
+        }
+
+        if ((dbT1 > dbTa) && (dbT1 < dbTb))
+        {
+            adbT[cT++] = dbT1;
+        }
+    }
+
+    adbT[cT] = dbTb;
+
+    for (i = 0; i < cT; ++i)
+    {
+        dbTa = adbT[i];
+        dbTb = adbT[i + 1];
+
+        /* whole pieces are on one side of a clip column */
+        dbX = fX0 + dbDx * 0.5 * (dbTa + dbTb);
+
+        if ((dbX < dbMinX) || (dbX > dbMaxX))
+        {
+            dbX = (dbX < dbMinX) ? dbMinX : dbMaxX;
+
+            StoreEdge(pRaster, dbX, fY0 + dbDy * dbTa,
+                dbX, fY0 + dbDy * dbTb);
+        }
+        else
+        {
+            StoreEdge(pRaster, fX0 + dbDx * dbTa, fY0 + dbDy * dbTa,
+                fX0 + dbDx * dbTb, fY0 + dbDy * dbTb);
+        }
+    }
+}
+
+static VOID
+AddPolygon(
+    IN PRASTER          pRaster,
+    IN CONST WUPOINTF*  aPoints,
+    IN UINT             cPoints,
+    IN BOOL             bReverse
+    )
+{
+    UINT i    = 0;
+    UINT next = 0;
+
+    for (i = 0; i < cPoints; ++i)
+    {
+        next = (i + 1) % cPoints;
+
+        if (TRUE == bReverse)
+        {
+            AddEdge(pRaster, aPoints[next].x, aPoints[next].y,
+                aPoints[i].x, aPoints[i].y);
+        }
+        else
+        {
+            AddEdge(pRaster, aPoints[i].x, aPoints[i].y,
+                aPoints[next].x, aPoints[next].y);
+        }
+    }
+}
+
+static VOID
+AddRectangle(
+    IN PRASTER  pRaster,
+    IN FLOAT    fLeft,
+    IN FLOAT    fTop,
+    IN FLOAT    fRight,
+    IN FLOAT    fBottom,
+    IN BOOL     bReverse
+    )
+{
+    WUPOINTF aCorners[4];
+
+    aCorners[0].x = fLeft;
+    aCorners[0].y = fTop;
+    aCorners[1].x = fRight;
+    aCorners[1].y = fTop;
+    aCorners[2].x = fRight;
+    aCorners[2].y = fBottom;
+    aCorners[3].x = fLeft;
+    aCorners[3].y = fBottom;
+
+    AddPolygon(pRaster, aCorners, 4, bReverse);
+}
+
+static UINT
+GetEllipseSegments(
+    IN FLOAT    fRadiusX,
+    IN FLOAT    fRadiusY
+    )
+{
+    DOUBLE dbRadius = max(fabs(fRadiusX), fabs(fRadiusY));
+    DOUBLE dbSteps  = 0.0;
+
+    if (!(dbRadius > ELLIPSE_TOLERANCE))
+    {
+        return MIN_ELLIPSE_SEGMENTS;
+    }
+
+    dbSteps = PI / acos(1.0 - ELLIPSE_TOLERANCE / dbRadius);
+
+    if (!(dbSteps < MAX_ELLIPSE_SEGMENTS))
+    {
+        return MAX_ELLIPSE_SEGMENTS;
+    }
+
+    return max(MIN_ELLIPSE_SEGMENTS, (UINT) ceil(dbSteps));
+}
+
+static VOID
+AddEllipse(
+    IN PRASTER  pRaster,
+    IN FLOAT    fCenterX,
+    IN FLOAT    fCenterY,
+    IN FLOAT    fRadiusX,
+    IN FLOAT    fRadiusY,
+    IN UINT     cSegments,
+    IN BOOL     bReverse
+    )
+{
+    DOUBLE dbStep = 2.0 * PI / cSegments;
+    FLOAT  x0     = fCenterX + fRadiusX;
+    FLOAT  y0     = fCenterY;
+    FLOAT  x1     = 0.0f;
+    FLOAT  y1     = 0.0f;
+    UINT   i      = 0;
+
+    for (i = 1; i <= cSegments; ++i)
+    {
+        x1 = fCenterX + (FLOAT) (fRadiusX * cos(dbStep * i));
+        y1 = fCenterY + (FLOAT) (fRadiusY * sin(dbStep * i));
+
+        if (TRUE == bReverse)
+        {
+            AddEdge(pRaster, x1, y1, x0, y0);
+        }
+        else
+        {
+            AddEdge(pRaster, x0, y0, x1, y1);
+        }
+
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+/* Segment as a quad with square caps, always wound the same way */
+static VOID
+AddSegment(
+    IN PRASTER  pRaster,
+    IN FLOAT    x0,
+    IN FLOAT    y0,
+    IN FLOAT    x1,
+    IN FLOAT    y1,
+    IN FLOAT    fWidth
+    )
+{
+    WUPOINTF aCorners[4];
+    DOUBLE   dbLength = sqrt((DOUBLE) (x1 - x0) * (x1 - x0)
+        + (DOUBLE) (y1 - y0) * (y1 - y0));
+    FLOAT    dx       = 0.0f;
+    FLOAT    dy       = 0.0f;
+
+    if (!(dbLength > 0.0))
+    {
+        return;
+    }
+
+    dx = (FLOAT) ((x1 - x0) * 0.5 * fWidth / dbLength);
+    dy = (FLOAT) ((y1 - y0) * 0.5 * fWidth / dbLength);
+
+    aCorners[0].x = x0 - dx - dy;
+    aCorners[0].y = y0 - dy + dx;
+    aCorners[1].x = x1 + dx - dy;
+    aCorners[1].y = y1 + dy + dx;
+    aCorners[2].x = x1 + dx + dy;
+    aCorners[2].y = y1 + dy - dx;
+    aCorners[3].x = x0 - dx + dy;
+    aCorners[3].y = y0 - dy - dx;
+
+    AddPolygon(pRaster, aCorners, 4, FALSE);
+}
+
+/* NaN lands on the left border instead of reaching floor() */
+static FLOAT
+ClampToStrip(
+    IN FLOAT    fX,
+    IN UINT     uWidth
+    )
+{
+    if (!(fX > 0.0f))
+    {
+        return 0.0f;
+    }
+
+    return min(fX, (FLOAT) uWidth);
+}
+
+/*
+    Adds the area of pEdge within rows [iTop, iTop + cRows) to afAccum and
+    widens the touched column range [auFirst, auLast) of those rows.
+*/
+static VOID
+AccumulateEdge(
+    IN CONST EDGE*  pEdge,
+    IN FLOAT        fLeft,
+    IN INT          iTop,
+    IN UINT         cRows,
+    IN UINT         uWidth,
+    IN SIZE_T       cStride,
+    IN OUT FLOAT*   afAccum,
+    IN OUT UINT*    auFirst,
+    IN OUT UINT*    auLast
+    )
+{
+    FLOAT* pfRow   = NULL;
+    FLOAT  fDir    = 1.0f;
+    FLOAT  x0      = pEdge->x0;
+    FLOAT  y0      = pEdge->y0;
+    FLOAT  x1      = pEdge->x1;
+    FLOAT  y1      = pEdge->y1;
+    FLOAT  fTop    = 0.0f;
+    FLOAT  fBottom = 0.0f;
+    FLOAT  fDxDy   = 0.0f;
+    FLOAT  x       = 0.0f;
+    FLOAT  xNext   = 0.0f;
+    FLOAT  fLo     = 0.0f;
+    FLOAT  fHi     = 0.0f;
+    FLOAT  dy      = 0.0f;
+    FLOAT  d       = 0.0f;
+    FLOAT  fLoFrac = 0.0f;
+    FLOAT  fHiFrac = 0.0f;
+    FLOAT  s       = 0.0f;
+    FLOAT  a0      = 0.0f;
+    FLOAT  a1      = 0.0f;
+    FLOAT  a2      = 0.0f;
+    FLOAT  am      = 0.0f;
+    FLOAT  fMid    = 0.0f;
+    INT    iLo     = 0;
+    INT    iHi     = 0;
+    INT    i       = 0;
+    INT    y       = 0;
+
+    if (y0 > y1)
+    {
+        fDir = -1.0f;
+        x0   = pEdge->x1;
+        y0   = pEdge->y1;
+        x1   = pEdge->x0;
+        y1   = pEdge->y0;
+    }
+
+    fTop    = max(y0, (FLOAT) iTop);
+    fBottom = min(y1, (FLOAT) (iTop + (INT) cRows));
+
+    if (fTop >= fBottom)
+    {
+        return;
+    }
+
+    fDxDy = (x1 - x0) / (y1 - y0);
+    x     = x0 + (fTop - y0) * fDxDy - fLeft;
+
+    for (y = (INT) floor(fTop); y < (INT) ceil(fBottom); ++y)
+    {
+        pfRow = afAccum + (SIZE_T) (y - iTop) * cStride;
+
+        dy    = min((FLOAT) (y + 1), fBottom) - max((FLOAT) y, fTop);
+        xNext = x + fDxDy * dy;
+        d     = dy * fDir;
+
+        /* parts left or right of the strip collapse onto its borders */
+        fLo = ClampToStrip(min(x, xNext), uWidth);
+        fHi = ClampToStrip(max(x, xNext), uWidth);
+
+        iLo = (INT) floor(fLo);
+        iHi = (INT) ceil(fHi);
+
+        /* the last column written is iLo + 1 or iHi, whichever is more */
+        auFirst[y - iTop] = min(auFirst[y - iTop], (UINT) iLo);
+        auLast[y - iTop]  = max(auLast[y - iTop],
+            (UINT) max(iLo + 1, iHi) + 1);
+
+        if (iHi <= iLo + 1)
+        {
+            fMid = 0.5f * (fLo + fHi) - (FLOAT) iLo;
+
+            pfRow[iLo]     += d - d * fMid;
+            pfRow[iLo + 1] += d * fMid;
+        }
+        else
+        {
+            s       = 1.0f / (fHi - fLo);
+            fLoFrac = fLo - (FLOAT) iLo;
+            fHiFrac = fHi - (FLOAT) iHi + 1.0f;
+            a0      = 0.5f * s * (1.0f - fLoFrac) * (1.0f - fLoFrac);
+            am      = 0.5f * s * fHiFrac * fHiFrac;
+
+            pfRow[iLo] += d * a0;
+
+            if (iHi == iLo + 2)
+            {
+                pfRow[iLo + 1] += d * (1.0f - a0 - am);
+            }
+            else
+            {
+                a1 = s * (1.5f - fLoFrac);
+
+                pfRow[iLo + 1] += d * (a1 - a0);
+
+                for (i = iLo + 2; i < iHi - 1; ++i)
+                {
+                    pfRow[i] += d * s;
+                }
+
+                a2 = a1 + (FLOAT) (iHi - iLo - 3) * s;
+
+                pfRow[iHi - 1] += d * (1.0f - a2 - am);
+            }
+
+            pfRow[iHi] += d * am;
+        }
+
+        x = xNext;
+    }
+}
+
+/* Fills everything added to pRaster and releases its edges */
+static BOOL
+FillRaster(
+    IN PRASTER  pRaster,
+    IN WUCOLOR  color
+    )
+{
+    PWUIMAGEDATA pImageData = pRaster->pImageData;
+    FLOAT*       afAccum    = NULL;
+    FLOAT*       pfRow      = NULL;
+    DWORD*       pdwRow     = NULL;
+    DWORD        dwColor    = ColorToPixel(color);
+    UINT         uOpacity   = WuGetColorA(color);
+    SIZE_T       cStride    = 0;
+    FLOAT        fSum       = 0.0f;
+    UINT         uLeft      = 0;
+    UINT         uRight     = 0;
+    UINT         uTop       = 0;
+    UINT         uBottom    = 0;
+    UINT         uWidth     = 0;
+    UINT         uStrip     = 0;
+    UINT         cRows      = 0;
+    UINT         uAlpha     = 0;
+    UINT         uRunStart  = 0;
+    UINT         uRunAlpha  = 0;
+    UINT         uEnd       = 0;
+    UINT         x          = 0;
+    UINT         y          = 0;
+    UINT         i          = 0;
+
+    UINT         auFirst[STRIP_ROWS];
+    UINT         auLast[STRIP_ROWS];
+
+    /* nothing to draw, or the shape is off the image */
+    if ((0 == pRaster->cEdges) || (0 == uOpacity)
+        || !(pRaster->fMaxX > 0.0f) || !(pRaster->fMaxY > 0.0f)
+        || !(pRaster->fMinX < (FLOAT) pImageData->uWidth)
+        || !(pRaster->fMinY < (FLOAT) pImageData->uHeight))
+    {
+        HeapFree(GetProcessHeap(), 0, pRaster->aEdges);
+        return TRUE;
+    }
+
+    uLeft   = (UINT) max(0.0f, (FLOAT) floor(pRaster->fMinX));
+    uTop    = (UINT) max(0.0f, (FLOAT) floor(pRaster->fMinY));
+    uRight  = (UINT) min((FLOAT) pImageData->uWidth,
+        (FLOAT) ceil(pRaster->fMaxX));
+    uBottom = (UINT) min((FLOAT) pImageData->uHeight,
+        (FLOAT) ceil(pRaster->fMaxY));
+    uWidth  = uRight - uLeft;
+
+    /* two spare columns take the area of edges on the right border */
+    cStride = (SIZE_T) uWidth + 2;
+
+    afAccum = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        cStride * STRIP_ROWS * sizeof(FLOAT));
+
+    if (NULL == afAccum)
+    {
+        HeapFree(GetProcessHeap(), 0, pRaster->aEdges);
+        return FALSE;
+    }
+
+    for (uStrip = uTop; uStrip < uBottom; uStrip += STRIP_ROWS)
+    {
+        cRows = min(STRIP_ROWS, uBottom - uStrip);
+
+        for (y = 0; y < cRows; ++y)
+        {
+            auFirst[y] = (UINT) cStride;
+            auLast[y]  = 0;
+        }
+
+        for (i = 0; i < pRaster->cEdges; ++i)
+        {
+            AccumulateEdge(
+                &pRaster->aEdges[i],
+                (FLOAT) uLeft,
+                (INT) uStrip,
+                cRows,
+                uWidth,
+                cStride,
+                afAccum,
+                auFirst,
+                auLast);
+        }
+
+        for (y = 0; y < cRows; ++y)
+        {
+            if (auFirst[y] >= auLast[y])
+            {
+                continue;
+            }
+
+            pfRow  = afAccum + (SIZE_T) y * cStride;
+            pdwRow = (DWORD*) pImageData->abData
+                + (SIZE_T) (uStrip + y) * pImageData->uWidth + uLeft;
+
+            /* outlines are closed, so coverage is zero past the range */
+            uEnd      = min(uWidth, auLast[y]);
+            fSum      = 0.0f;
+            uRunStart = auFirst[y];
+            uRunAlpha = 0;
+
+            /* equal coverage runs (shape interiors) blend as one span */
+            for (x = auFirst[y]; x <= uEnd; ++x)
+            {
+                uAlpha = 0;
+
+                if (x < uEnd)
+                {
+                    fSum  += pfRow[x];
+                    uAlpha = (UINT) (min(1.0f, (FLOAT) fabs(fSum))
+                        * uOpacity + 0.5f);
+                }
+
+                if ((x == uEnd) || (uAlpha != uRunAlpha))
+                {
+                    BlendSpan(pdwRow + uRunStart, x - uRunStart, dwColor,
+                        uRunAlpha);
+
+                    uRunStart = x;
+                    uRunAlpha = uAlpha;
+                }
+            }
+
+            ZeroMemory(pfRow + auFirst[y],
+                (auLast[y] - auFirst[y]) * sizeof(FLOAT));
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, afAccum);
+    HeapFree(GetProcessHeap(), 0, pRaster->aEdges);
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuFillPolygon(
+    IN PWUIMAGEDATA     pImageData,
+    IN CONST WUPOINTF*  aPoints,
+    IN UINT             cPoints,
+    IN WUCOLOR          color
+    )
+{
+    RASTER raster;
+
+    if ((NULL == aPoints) || (cPoints < 3))
+    {
+        return FALSE;
+    }
+
+    if (BeginRaster(&raster, pImageData, cPoints) == FALSE)
+    {
+        return FALSE;
+    }
+
+    AddPolygon(&raster, aPoints, cPoints, FALSE);
+
+    return FillRaster(&raster, color);
+}
+
+WUAPI BOOL
+WuFillRectangle(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX,
+    IN FLOAT        fY,
+    IN FLOAT        fWidth,
+    IN FLOAT        fHeight,
+    IN WUCOLOR      color
+    )
+{
+    RASTER raster;
+
+    if (BeginRaster(&raster, pImageData, 4) == FALSE)
+    {
+        return FALSE;
+    }
+
+    AddRectangle(&raster, fX, fY, fX + fWidth, fY + fHeight, FALSE);
+
+    return FillRaster(&raster, color);
+}
+
+WUAPI BOOL
+WuDrawRectangle(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX,
+    IN FLOAT        fY,
+    IN FLOAT        fWidth,
+    IN FLOAT        fHeight,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    )
+{
+    RASTER raster;
+
+    if (!(fLineWidth > 0.0f))
+    {
+        return FALSE;
+    }
+
+    if (BeginRaster(&raster, pImageData, 8) == FALSE)
+    {
+        return FALSE;
+    }
+
+    AddRectangle(&raster, fX, fY, fX + fWidth, fY + fHeight, FALSE);
+
+    /* the frame is the rectangle minus its inset, if anything is left */
+    if ((2.0f * fLineWidth < fWidth) && (2.0f * fLineWidth < fHeight))
+    {
+        AddRectangle(
+            &raster,
+            fX + fLineWidth,
+            fY + fLineWidth,
+            fX + fWidth - fLineWidth,
+            fY + fHeight - fLineWidth,
+            TRUE);
+    }
+
+    return FillRaster(&raster, color);
+}
+
+WUAPI BOOL
+WuFillEllipse(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fCenterX,
+    IN FLOAT        fCenterY,
+    IN FLOAT        fRadiusX,
+    IN FLOAT        fRadiusY,
+    IN WUCOLOR      color
+    )
+{
+    RASTER raster;
+    UINT   cSegments = GetEllipseSegments(fRadiusX, fRadiusY);
+
+    if (BeginRaster(&raster, pImageData, cSegments) == FALSE)
+    {
+        return FALSE;
+    }
+
+    AddEllipse(&raster, fCenterX, fCenterY, fRadiusX, fRadiusY,
+        cSegments, FALSE);
+
+    return FillRaster(&raster, color);
+}
+
+WUAPI BOOL
+WuDrawEllipse(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fCenterX,
+    IN FLOAT        fCenterY,
+    IN FLOAT        fRadiusX,
+    IN FLOAT        fRadiusY,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    )
+{
+    RASTER raster;
+    FLOAT  fHalf     = fLineWidth * 0.5f;
+    UINT   cSegments = 0;
+
+    if (!(fLineWidth > 0.0f))
+    {
+        return FALSE;
+    }
+
+    cSegments = GetEllipseSegments(fRadiusX + fHalf, fRadiusY + fHalf);
+
+    if (BeginRaster(&raster, pImageData, cSegments * 2) == FALSE)
+    {
+        return FALSE;
+    }
+
+    AddEllipse(&raster, fCenterX, fCenterY, fRadiusX + fHalf,
+        fRadiusY + fHalf, cSegments, FALSE);
+
+    if ((fRadiusX > fHalf) && (fRadiusY > fHalf))
+    {
+        AddEllipse(&raster, fCenterX, fCenterY, fRadiusX - fHalf,
+            fRadiusY - fHalf, cSegments, TRUE);
+    }
+
+    return FillRaster(&raster, color);
+}
+
+WUAPI BOOL
+WuDrawLine(
+    IN PWUIMAGEDATA pImageData,
+    IN FLOAT        fX0,
+    IN FLOAT        fY0,
+    IN FLOAT        fX1,
+    IN FLOAT        fY1,
+    IN FLOAT        fLineWidth,
+    IN WUCOLOR      color
+    )
+{
+    WUPOINTF aPoints[2];
+
+    aPoints[0].x = fX0;
+    aPoints[0].y = fY0;
+    aPoints[1].x = fX1;
+    aPoints[1].y = fY1;
+
+    return WuDrawPolyline(pImageData, aPoints, 2, FALSE, fLineWidth, color);
+}
+
+WUAPI BOOL
+WuDrawPolyline(
+    IN PWUIMAGEDATA     pImageData,
+    IN CONST WUPOINTF*  aPoints,
+    IN UINT             cPoints,
+    IN BOOL             bClosed,
+    IN FLOAT            fLineWidth,
+    IN WUCOLOR          color
+    )
+{
+    RASTER raster;
+    UINT   cSegments = 0;
+    UINT   i         = 0;
+    UINT   next      = 0;
+
+    if ((NULL == aPoints) || (cPoints < 2) || !(fLineWidth > 0.0f))
+    {
+        return FALSE;
+    }
+
+    cSegments = (TRUE == bClosed) ? cPoints : cPoints - 1;
+
+    if (BeginRaster(&raster, pImageData, cSegments * 4) == FALSE)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < cSegments; ++i)
+    {
+        next = (i + 1) % cPoints;
+
+        AddSegment(
+            &raster,
+            aPoints[i].x,
+            aPoints[i].y,
+            aPoints[next].x,
+            aPoints[next].y,
+            fLineWidth);
+    }
+
+    return FillRaster(&raster, color);
+}
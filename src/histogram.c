@@ -0,0 +1,549 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       histogram.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+/*
+    Consecutive pixels of the same color would increment the same bin
+    back to back and stall on the store-to-load dependency, so every band
+    spreads its pixels over SUB_HISTOGRAMS copies merged at the end.
+*/
+#define SUB_HISTOGRAMS          4
+
+#define HISTOGRAM_CHANNELS      5       /* B, G, R, A, luma */
+#define LUMA_CHANNEL            4
+
+#define MIN_ROWS_PER_BAND       16
+
+/* Dominant color is picked among 5-bit-per-channel RGB cells */
+#define CELL_BITS               5
+#define CELL_COUNT              (1 << (3 * CELL_BITS))
+
+typedef struct tagHISTOGRAMBAND {
+    DWORD   adwCounts[SUB_HISTOGRAMS][HISTOGRAM_CHANNELS][WU_HISTOGRAM_BINS];
+    DWORD   cPixels;
+    BYTE*   pbLumaRow;                  /* NULL without WU_HISTOGRAM_LUMA */
+} HISTOGRAMBAND, *PHISTOGRAMBAND;
+
+typedef struct tagCELLBAND {
+    DWORD       adwCounts[CELL_COUNT];
+    ULONGLONG   aullSum[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    DWORD       cPixels;                /* pixels in the winning cell */
+} CELLBAND, *PCELLBAND;
+
+typedef struct tagHISTOGRAMJOB {
+    CONST WUIMAGEDATA*  pImageData;
+    CONST BYTE*         abMask;
+    WU_LUMA_STANDARD    standard;
+    DWORD               dwFlags;
+    UINT                cRowsPerBand;
+    PHISTOGRAMBAND      aBands;
+    PCELLBAND           aCellBands;
+    BOOL                bSumCell;       /* second dominant color pass */
+    DWORD               dwCell;
+} HISTOGRAMJOB, *PHISTOGRAMJOB;
+
+static UINT
+GetBandCount(
+    IN UINT uHeight
+    )
+{
+    UINT cBands = (uHeight + MIN_ROWS_PER_BAND - 1) / MIN_ROWS_PER_BAND;
+
+    return max(1, min(cBands, _WuGetProcessorCount()));
+}
+
+static VOID
+CountPixel(
+    IN DWORD    aadwCounts[HISTOGRAM_CHANNELS][WU_HISTOGRAM_BINS],
+    IN DWORD    dwPixel
+    )
+{
+    aadwCounts[0][dwPixel & 0xFF]++;
+    aadwCounts[1][(dwPixel >> 8) & 0xFF]++;
+    aadwCounts[2][(dwPixel >> 16) & 0xFF]++;
+    aadwCounts[3][dwPixel >> 24]++;
+}
+
+static VOID
+CountRow(
+    IN PHISTOGRAMBAND   pBand,
+    IN CONST DWORD*     pdwPixels,
+    IN CONST BYTE*      pbLuma,
+    IN CONST BYTE*      abMask,
+    IN UINT             cPixels
+    )
+{
+    UINT x = 0;
+    UINT s = 0;
+
+    if ((NULL == abMask) && (NULL == pbLuma))
+    {
+        for (; x + SUB_HISTOGRAMS <= cPixels; x += SUB_HISTOGRAMS)
+        {
+            CountPixel(pBand->adwCounts[0], pdwPixels[x]);
+            CountPixel(pBand->adwCounts[1], pdwPixels[x + 1]);
+            CountPixel(pBand->adwCounts[2], pdwPixels[x + 2]);
+            CountPixel(pBand->adwCounts[3], pdwPixels[x + 3]);
+        }
+
+        pBand->cPixels += x;
+    }
+
+    for (; x < cPixels; ++x)
+    {
+        if ((abMask != NULL) && (0 == abMask[x]))
+        {
+            continue;
+        }
+
+        s = x % SUB_HISTOGRAMS;
+
+        CountPixel(pBand->adwCounts[s], pdwPixels[x]);
+
+        if (pbLuma != NULL)
+        {
+            pBand->adwCounts[s][LUMA_CHANNEL][pbLuma[x * 4]]++;
+        }
+
+        pBand->cPixels++;
+    }
+}
+
+static VOID
+HistogramBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PHISTOGRAMJOB      pJob       = (PHISTOGRAMJOB) pContext;
+    PHISTOGRAMBAND     pBand      = &pJob->aBands[iBand];
+    CONST WUIMAGEDATA* pImageData = pJob->pImageData;
+    CONST DWORD*       pdwPixels  = NULL;
+    CONST BYTE*        abMask     = NULL;
+    SIZE_T             iRow       = 0;
+    UINT               uTop       = iBand * pJob->cRowsPerBand;
+    UINT               uBottom    = 0;
+    UINT               y          = 0;
+    UINT               c          = 0;
+    UINT               s          = 0;
+    UINT               i          = 0;
+
+    uBottom = min(uTop + pJob->cRowsPerBand, pImageData->uHeight);
+
+    for (y = uTop; y < uBottom; ++y)
+    {
+        iRow      = (SIZE_T) y * pImageData->uWidth;
+        pdwPixels = (CONST DWORD*) pImageData->abData + iRow;
+        abMask    = (pJob->abMask != NULL) ? pJob->abMask + iRow : NULL;
+
+        if (pBand->pbLumaRow != NULL)
+        {
+            CopyMemory(pBand->pbLumaRow, pdwPixels,
+                (SIZE_T) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+            _WuGrayscaleRow(
+                pBand->pbLumaRow,
+                pImageData->uWidth,
+                pJob->standard,
+                pJob->dwFlags & WU_COLOR_LINEAR_LIGHT);
+        }
+
+        CountRow(
+            pBand,
+            pdwPixels,
+            pBand->pbLumaRow,
+            abMask,
+            pImageData->uWidth);
+    }
+
+    for (s = 1; s < SUB_HISTOGRAMS; ++s)
+    {
+        for (c = 0; c < HISTOGRAM_CHANNELS; ++c)
+        {
+            for (i = 0; i < WU_HISTOGRAM_BINS; ++i)
+            {
+                pBand->adwCounts[0][c][i] += pBand->adwCounts[s][c][i];
+            }
+        }
+    }
+}
+
+WUAPI BOOL
+WuImageHistogram(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  CONST BYTE*         abMask,
+    IN  WU_LUMA_STANDARD    standard,
+    IN  DWORD               dwFlags,
+    OUT PWUHISTOGRAM        pHistogram
+    )
+{
+    HISTOGRAMJOB job;
+    UINT         cBands  = 0;
+    UINT         b       = 0;
+    UINT         i       = 0;
+    BOOL         bResult = FALSE;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == pHistogram))
+    {
+        return FALSE;
+    }
+
+    if ((standard != WU_LUMA_BT601) && (standard != WU_LUMA_BT709))
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(pHistogram, sizeof(WUHISTOGRAM));
+    ZeroMemory(&job, sizeof(HISTOGRAMJOB));
+
+    if ((0 == pImageData->uWidth) || (0 == pImageData->uHeight))
+    {
+        return TRUE;
+    }
+
+    cBands = GetBandCount(pImageData->uHeight);
+
+    job.pImageData   = pImageData;
+    job.abMask       = abMask;
+    job.standard     = standard;
+    job.dwFlags      = dwFlags;
+    job.cRowsPerBand = (pImageData->uHeight + cBands - 1) / cBands;
+
+    job.aBands = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        cBands * sizeof(HISTOGRAMBAND));
+
+    if (NULL == job.aBands)
+    {
+        return FALSE;
+    }
+
+    if (dwFlags & WU_HISTOGRAM_LUMA)
+    {
+        for (b = 0; b < cBands; ++b)
+        {
+            job.aBands[b].pbLumaRow = HeapAlloc(
+                GetProcessHeap(),
+                0,
+                (SIZE_T) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+            if (NULL == job.aBands[b].pbLumaRow)
+            {
+                goto cleanup;
+            }
+        }
+    }
+
+    _WuParallelFor(cBands, HistogramBandProc, &job);
+
+    for (b = 0; b < cBands; ++b)
+    {
+        for (i = 0; i < WU_HISTOGRAM_BINS; ++i)
+        {
+            pHistogram->adwB[i]    += job.aBands[b].adwCounts[0][0][i];
+            pHistogram->adwG[i]    += job.aBands[b].adwCounts[0][1][i];
+            pHistogram->adwR[i]    += job.aBands[b].adwCounts[0][2][i];
+            pHistogram->adwA[i]    += job.aBands[b].adwCounts[0][3][i];
+            pHistogram->adwLuma[i] +=
+                job.aBands[b].adwCounts[0][LUMA_CHANNEL][i];
+        }
+
+        pHistogram->cPixels += job.aBands[b].cPixels;
+    }
+
+    bResult = TRUE;
+
+cleanup:
+    for (b = 0; b < cBands; ++b)
+    {
+        if (job.aBands[b].pbLumaRow != NULL)
+        {
+            HeapFree(GetProcessHeap(), 0, job.aBands[b].pbLumaRow);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, job.aBands);
+
+    return bResult;
+}
+
+static VOID
+ChannelStats(
+    IN  CONST DWORD*    adwCounts,
+    IN  DWORD           cPixels,
+    OUT BYTE*           pbMin,
+    OUT BYTE*           pbMax,
+    OUT FLOAT*          pfMean
+    )
+{
+    ULONGLONG ullSum = 0;
+    UINT      uMin   = 0;
+    UINT      uMax   = WU_HISTOGRAM_BINS - 1;
+    UINT      i      = 0;
+
+    while (0 == adwCounts[uMin])
+    {
+        ++uMin;
+    }
+
+    while (0 == adwCounts[uMax])
+    {
+        --uMax;
+    }
+
+    for (i = uMin; i <= uMax; ++i)
+    {
+        ullSum += (ULONGLONG) adwCounts[i] * i;
+    }
+
+    *pbMin  = (BYTE) uMin;
+    *pbMax  = (BYTE) uMax;
+    *pfMean = (FLOAT) ((DOUBLE) ullSum / cPixels);
+}
+
+WUAPI BOOL
+WuHistogramGetStats(
+    IN  CONST PWUHISTOGRAM  pHistogram,
+    OUT WUCOLOR*            pMin,
+    OUT WUCOLOR*            pMax,
+    OUT PWUCOLORF           pMean
+    )
+{
+    BYTE     abMin[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    BYTE     abMax[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    WUCOLORF mean;
+
+    if ((NULL == pHistogram) || (0 == pHistogram->cPixels))
+    {
+        return FALSE;
+    }
+
+    ChannelStats(pHistogram->adwB, pHistogram->cPixels,
+        &abMin[0], &abMax[0], &mean.fB);
+    ChannelStats(pHistogram->adwG, pHistogram->cPixels,
+        &abMin[1], &abMax[1], &mean.fG);
+    ChannelStats(pHistogram->adwR, pHistogram->cPixels,
+        &abMin[2], &abMax[2], &mean.fR);
+    ChannelStats(pHistogram->adwA, pHistogram->cPixels,
+        &abMin[3], &abMax[3], &mean.fA);
+
+    if (pMin != NULL)
+    {
+        *pMin = WU_RGBA(abMin[2], abMin[1], abMin[0], abMin[3]);
+    }
+
+    if (pMax != NULL)
+    {
+        *pMax = WU_RGBA(abMax[2], abMax[1], abMax[0], abMax[3]);
+    }
+
+    if (pMean != NULL)
+    {
+        *pMean = mean;
+    }
+
+    return TRUE;
+}
+
+static DWORD
+GetCell(
+    IN DWORD    dwPixel
+    )
+{
+    return ((dwPixel >> (8 - CELL_BITS)) & ((1 << CELL_BITS) - 1))
+        | (((dwPixel >> (16 - CELL_BITS)) & ((1 << CELL_BITS) - 1))
+            << CELL_BITS)
+        | (((dwPixel >> (24 - CELL_BITS)) & ((1 << CELL_BITS) - 1))
+            << (2 * CELL_BITS));
+}
+
+static VOID
+AddRun(
+    IN PHISTOGRAMJOB    pJob,
+    IN PCELLBAND        pBand,
+    IN DWORD            dwPixel,
+    IN DWORD            cRun
+    )
+{
+    DWORD dwCell = GetCell(dwPixel);
+    UINT  c      = 0;
+
+    if (FALSE == pJob->bSumCell)
+    {
+        pBand->adwCounts[dwCell] += cRun;
+    }
+    else if (dwCell == pJob->dwCell)
+    {
+        for (c = 0; c < WU_IMAGEDATA_BYTES_PER_PIXEL; ++c)
+        {
+            pBand->aullSum[c] += (ULONGLONG) ((dwPixel >> (c * 8)) & 0xFF)
+                * cRun;
+        }
+
+        pBand->cPixels += cRun;
+    }
+}
+
+/*
+    Runs of identical pixels (flat UI areas) are counted once: a single
+    hot cell would otherwise serialize on its own counter.
+*/
+static VOID
+CellBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PHISTOGRAMJOB      pJob       = (PHISTOGRAMJOB) pContext;
+    PCELLBAND          pBand      = &pJob->aCellBands[iBand];
+    CONST WUIMAGEDATA* pImageData = pJob->pImageData;
+    CONST DWORD*       pdwPixels  = NULL;
+    SIZE_T             iPixel     = 0;
+    SIZE_T             iEnd       = 0;
+    DWORD              dwRunPixel = 0;
+    DWORD              cRun       = 0;
+
+    iPixel = (SIZE_T) iBand * pJob->cRowsPerBand * pImageData->uWidth;
+    iEnd   = (SIZE_T) min((iBand + 1) * pJob->cRowsPerBand,
+        pImageData->uHeight) * pImageData->uWidth;
+
+    pdwPixels = (CONST DWORD*) pImageData->abData;
+
+    for (; iPixel < iEnd; ++iPixel)
+    {
+        if ((pJob->abMask != NULL) && (0 == pJob->abMask[iPixel]))
+        {
+            continue;
+        }
+
+        if ((cRun > 0) && (pdwPixels[iPixel] == dwRunPixel))
+        {
+            ++cRun;
+            continue;
+        }
+
+        if (cRun > 0)
+        {
+            AddRun(pJob, pBand, dwRunPixel, cRun);
+        }
+
+        dwRunPixel = pdwPixels[iPixel];
+        cRun       = 1;
+    }
+
+    if (cRun > 0)
+    {
+        AddRun(pJob, pBand, dwRunPixel, cRun);
+    }
+}
+
+/*
+    The most common color cell wins; the result is the average of the
+    pixels that fell into it, so flat areas come back exactly.
+*/
+WUAPI BOOL
+WuImageDominantColor(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    IN  CONST BYTE*         abMask,
+    OUT WUCOLOR*            pColor
+    )
+{
+    HISTOGRAMJOB job;
+    ULONGLONG    aullSum[WU_IMAGEDATA_BYTES_PER_PIXEL];
+    ULONGLONG    cPixels = 0;
+    DWORD        dwCell  = 0;
+    UINT         cBands  = 0;
+    UINT         b       = 0;
+    UINT         c       = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (NULL == pColor))
+    {
+        return FALSE;
+    }
+
+    if ((0 == pImageData->uWidth) || (0 == pImageData->uHeight))
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(&job, sizeof(HISTOGRAMJOB));
+
+    cBands = GetBandCount(pImageData->uHeight);
+
+    job.pImageData   = pImageData;
+    job.abMask       = abMask;
+    job.cRowsPerBand = (pImageData->uHeight + cBands - 1) / cBands;
+
+    job.aCellBands = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        cBands * sizeof(CELLBAND));
+
+    if (NULL == job.aCellBands)
+    {
+        return FALSE;
+    }
+
+    _WuParallelFor(cBands, CellBandProc, &job);
+
+    for (dwCell = 0; dwCell < CELL_COUNT; ++dwCell)
+    {
+        for (b = 1; b < cBands; ++b)
+        {
+            job.aCellBands[0].adwCounts[dwCell] +=
+                job.aCellBands[b].adwCounts[dwCell];
+        }
+
+        if (job.aCellBands[0].adwCounts[dwCell]
+                > job.aCellBands[0].adwCounts[job.dwCell])
+        {
+            job.dwCell = dwCell;
+        }
+    }
+
+    /* second pass averages the pixels of the winning cell only */
+    job.bSumCell = TRUE;
+
+    _WuParallelFor(cBands, CellBandProc, &job);
+
+    ZeroMemory(aullSum, sizeof(aullSum));
+
+    for (b = 0; b < cBands; ++b)
+    {
+        for (c = 0; c < WU_IMAGEDATA_BYTES_PER_PIXEL; ++c)
+        {
+            aullSum[c] += job.aCellBands[b].aullSum[c];
+        }
+
+        cPixels += job.aCellBands[b].cPixels;
+    }
+
+    HeapFree(GetProcessHeap(), 0, job.aCellBands);
+
+    if (0 == cPixels)
+    {
+        return FALSE;   /* everything is masked out */
+    }
+
+    *pColor = WU_RGBA(
+        (aullSum[2] + cPixels / 2) / cPixels,
+        (aullSum[1] + cPixels / 2) / cPixels,
+        (aullSum[0] + cPixels / 2) / cPixels,
+        (aullSum[3] + cPixels / 2) / cPixels);
+
+    return TRUE;
+}
@@ -37,41 +37,29 @@ static CONST GUID* g_aImageFormatToWicGuid[WU_IMAGE_FORMAT_MAX] = {
     &GUID_ContainerFormatJpeg   /* WU_IMAGE_FORMAT_JPEG */
 };
 
-WUAPI PWUIMAGEDATA
-WuCreateEmptyImageData(
-    IN UINT uWidth,
-    IN UINT uHeight
+/*
+    WIC buffer sizes are 32-bit, so larger images are transferred in strips
+    of whole rows. Returns the number of rows per strip, 0 if a single row
+    does not fit.
+*/
+static UINT
+GetWicStripRows(
+    IN  CONST PWUIMAGEDATA  pImageData,
+    OUT UINT*               pcbStride
     )
 {
-    PWUIMAGEDATA pImageData = NULL;
+    ULONGLONG cbStride = 0;
 
-    if ((uWidth == 0) || (uHeight == 0))
-    {
-        return NULL;
-    }
- 
-    pImageData = HeapAlloc(GetProcessHeap(), 0, sizeof(WUIMAGEDATA));
+    cbStride = (ULONGLONG) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
 
-    if (NULL == pImageData)
+    if ((0 == cbStride) || (cbStride > MAXUINT))
     {
-        return NULL;
+        return 0;
     }
 
-    pImageData->uWidth  = uWidth;
-    pImageData->uHeight = uHeight;
+    *pcbStride = (UINT) cbStride;
 
-    pImageData->abData = HeapAlloc(
-        GetProcessHeap(),
-        HEAP_ZERO_MEMORY,
-        uWidth * uHeight * WU_IMAGEDATA_BYTES_PER_PIXEL);
-    
-    if (NULL == pImageData->abData)
-    {
-        HeapFree(GetProcessHeap(), 0, pImageData);
-        return NULL;
-    }
-
-    return pImageData;
+    return (UINT) min(pImageData->uHeight, MAXUINT / cbStride);
 }
 
 WUAPI PWUIMAGEDATA
@@ -158,6 +146,12 @@ WuCreateHBITMAPFromImageData(
         return NULL;
     }
 
+    if (_WuGetImageDataSize(pImageData->uWidth, pImageData->uHeight,
+            &cbImage) == FALSE)
+    {
+        return NULL;
+    }
+
     hDC = GetDC(NULL);
 
     if (NULL == hDC)
@@ -182,9 +176,6 @@ WuCreateHBITMAPFromImageData(
         return NULL;
     }
 
-    cbImage = pImageData->uWidth * pImageData->uHeight
-        * WU_IMAGEDATA_BYTES_PER_PIXEL;
-
     CopyMemory(pBits, pImageData->abData, cbImage);
 
     ReleaseDC(NULL, hDC);
@@ -192,80 +183,76 @@ WuCreateHBITMAPFromImageData(
     return hBitmap;
 }
 
-WUAPI BOOL
-WuSaveImageDataToFileW(
-    IN CONST PWUIMAGEDATA   pImageData,
-    IN LPCWSTR              szFilePath,
-    IN WU_IMAGE_FORMAT      format
+/*
+    COM is initialized for the calling thread when it was not already;
+    *pbNeedUninit tells whether CoUninitialize must be called afterwards.
+*/
+static HRESULT
+CreateWicFactory(
+    OUT IWICImagingFactory**    ppWicFactory,
+    OUT BOOL*                   pbNeedUninit
     )
 {
-    WCHAR                  szTempPath[MAX_PATH];
-    WICPixelFormatGUID     pixelFormat;
-    IWICImagingFactory*    pWicFactory = NULL;
-    IWICStream*            pWicStream  = NULL;
-    IWICBitmapEncoder*     pWicEncoder = NULL;
-    IWICBitmapFrameEncode* pWicFrame   = NULL;
-    IStream*               pStream     = NULL;
-    CONST GUID*            pGuidFormat = NULL;
-    BOOL                   bResult     = FALSE;
-    BOOL                   bNeedUninit = FALSE; 
-    HRESULT                hResult     = S_OK;
+    HRESULT hResult = S_OK;
 
-    if ((NULL == pImageData) || (NULL == szFilePath))
-    {
-        return FALSE;
-    }
-
-    if (format >= WU_IMAGE_FORMAT_MAX)
-    {
-        return FALSE;
-    }
+    *ppWicFactory = NULL;
+    *pbNeedUninit = FALSE;
 
     /* WIC minimum supported client: Windows XP with SP2 */
     if (IsWindowsXPSP2OrGreater() == FALSE)
     {
-        return FALSE;
+        return E_NOTIMPL;
     }
 
     hResult = CoInitialize(NULL);
 
-    bNeedUninit = SUCCEEDED(hResult) && (hResult == S_OK);
-
     if (FAILED(hResult))
     {
-        return FALSE;
+        return hResult;
     }
 
+    *pbNeedUninit = (hResult == S_OK);
+
     hResult = CoCreateInstance(
         &CLSID_WICImagingFactory,
         NULL,
         CLSCTX_INPROC_SERVER,
         &IID_IWICImagingFactory,
-        (LPVOID*) &pWicFactory);
+        (LPVOID*) ppWicFactory);
 
-    CLEANUP_IF_FAILED(hResult);
+    if (FAILED(hResult) && (TRUE == *pbNeedUninit))
+    {
+        CoUninitialize();
+        *pbNeedUninit = FALSE;
+    }
 
-    hResult = pWicFactory->lpVtbl->CreateStream(pWicFactory, &pWicStream);
+    return hResult;
+}
 
-    CLEANUP_IF_FAILED(hResult);
+static HRESULT
+EncodeImageData(
+    IN IWICImagingFactory*  pWicFactory,
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_FORMAT      format,
+    IN IStream*             pStream
+    )
+{
+    WICPixelFormatGUID     pixelFormat;
+    IWICBitmapEncoder*     pWicEncoder = NULL;
+    IWICBitmapFrameEncode* pWicFrame   = NULL;
+    HRESULT                hResult     = S_OK;
+    UINT                   cbStride    = 0;
+    UINT                   cStripRows  = 0;
+    UINT                   cRows       = 0;
+    UINT                   y           = 0;
 
-    bResult = _WuSafeExpandEnvironmentStrings(
-        szFilePath,
-        szTempPath,
-        MAX_PATH);
+    cStripRows = GetWicStripRows(pImageData, &cbStride);
 
-    if (FALSE == bResult)
+    if (0 == cStripRows)
     {
-        goto cleanup;
+        return E_INVALIDARG;
     }
 
-    hResult = pWicStream->lpVtbl->InitializeFromFilename(
-        pWicStream,
-        szTempPath,
-        GENERIC_WRITE);
-    
-    CLEANUP_IF_FAILED(hResult);
-
     hResult = pWicFactory->lpVtbl->CreateEncoder(
         pWicFactory,
         g_aImageFormatToWicGuid[format],
@@ -274,13 +261,6 @@ WuSaveImageDataToFileW(
 
     CLEANUP_IF_FAILED(hResult);
 
-    hResult = pWicStream->lpVtbl->QueryInterface(
-        pWicStream,
-        &IID_IStream,
-        (VOID**) &pStream);
-
-    CLEANUP_IF_FAILED(hResult);
-
     hResult = pWicEncoder->lpVtbl->Initialize(
         pWicEncoder,
         pStream,
@@ -314,15 +294,19 @@ WuSaveImageDataToFileW(
 
     CLEANUP_IF_FAILED(hResult);
 
-    hResult = pWicFrame->lpVtbl->WritePixels(
-        pWicFrame,
-        pImageData->uHeight,
-        pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL,
-        pImageData->uWidth * pImageData->uHeight
-            * WU_IMAGEDATA_BYTES_PER_PIXEL,
-        pImageData->abData);
+    for (y = 0; y < pImageData->uHeight; y += cRows)
+    {
+        cRows = min(cStripRows, pImageData->uHeight - y);
+
+        hResult = pWicFrame->lpVtbl->WritePixels(
+            pWicFrame,
+            cRows,
+            cbStride,
+            cRows * cbStride,
+            pImageData->abData + (SIZE_T) y * cbStride);
     
-    CLEANUP_IF_FAILED(hResult);
+        CLEANUP_IF_FAILED(hResult);
+    }
 
     hResult = pWicFrame->lpVtbl->Commit(pWicFrame);
 
@@ -333,6 +317,66 @@ WuSaveImageDataToFileW(
 cleanup:
     SAFE_RELEASE_COM_OBJECT(pWicFrame);
     SAFE_RELEASE_COM_OBJECT(pWicEncoder);
+
+    return hResult;
+}
+
+WUAPI BOOL
+WuSaveImageDataToFileW(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN LPCWSTR              szFilePath,
+    IN WU_IMAGE_FORMAT      format
+    )
+{
+    WCHAR               szTempPath[MAX_PATH];
+    IWICImagingFactory* pWicFactory = NULL;
+    IWICStream*         pWicStream  = NULL;
+    IStream*            pStream     = NULL;
+    BOOL                bNeedUninit = FALSE; 
+    HRESULT             hResult     = S_OK;
+
+    if ((NULL == pImageData) || (NULL == szFilePath))
+    {
+        return FALSE;
+    }
+
+    if (format >= WU_IMAGE_FORMAT_MAX)
+    {
+        return FALSE;
+    }
+
+    if (_WuSafeExpandEnvironmentStrings(szFilePath, szTempPath,
+            MAX_PATH) == FALSE)
+    {
+        return FALSE;
+    }
+
+    hResult = CreateWicFactory(&pWicFactory, &bNeedUninit);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicFactory->lpVtbl->CreateStream(pWicFactory, &pWicStream);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicStream->lpVtbl->InitializeFromFilename(
+        pWicStream,
+        szTempPath,
+        GENERIC_WRITE);
+    
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicStream->lpVtbl->QueryInterface(
+        pWicStream,
+        &IID_IStream,
+        (VOID**) &pStream);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = EncodeImageData(pWicFactory, pImageData, format, pStream);
+
+cleanup:
+    SAFE_RELEASE_COM_OBJECT(pStream);
     SAFE_RELEASE_COM_OBJECT(pWicStream);
     SAFE_RELEASE_COM_OBJECT(pWicFactory);
 
@@ -344,6 +388,80 @@ cleanup:
     return SUCCEEDED(hResult);
 }
 
+WUAPI HGLOBAL
+WuSaveImageDataToHGlobal(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_FORMAT      format
+    )
+{
+    STATSTG             statStg;
+    IWICImagingFactory* pWicFactory = NULL;
+    IStream*            pStream     = NULL;
+    HGLOBAL             hGlobal     = NULL;
+    HGLOBAL             hTrimmed    = NULL;
+    BOOL                bNeedUninit = FALSE;
+    HRESULT             hResult     = S_OK;
+
+    if ((NULL == pImageData) || (format >= WU_IMAGE_FORMAT_MAX))
+    {
+        return NULL;
+    }
+
+    hResult = CreateWicFactory(&pWicFactory, &bNeedUninit);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    /* the stream grows its own moveable block, which we keep */
+    hResult = CreateStreamOnHGlobal(NULL, FALSE, &pStream);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = EncodeImageData(pWicFactory, pImageData, format, pStream);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = GetHGlobalFromStream(pStream, &hGlobal);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pStream->lpVtbl->Stat(pStream, &statStg, STATFLAG_NONAME);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    /* the block is grown in steps, trim it to what was written */
+    hTrimmed = GlobalReAlloc(
+        hGlobal,
+        (SIZE_T) statStg.cbSize.QuadPart,
+        GMEM_MOVEABLE);
+
+    if (hTrimmed != NULL)
+    {
+        hGlobal = hTrimmed;
+    }
+
+cleanup:
+    /* the block outlives the stream, also when encoding failed */
+    if (FAILED(hResult) && (pStream != NULL))
+    {
+        if (SUCCEEDED(GetHGlobalFromStream(pStream, &hGlobal)))
+        {
+            GlobalFree(hGlobal);
+        }
+
+        hGlobal = NULL;
+    }
+
+    SAFE_RELEASE_COM_OBJECT(pStream);
+    SAFE_RELEASE_COM_OBJECT(pWicFactory);
+
+    if (TRUE == bNeedUninit)
+    {
+        CoUninitialize();
+    }
+
+    return hGlobal;
+}
+
 WUAPI BOOL
 WuSaveImageDataToFileA(
     IN CONST PWUIMAGEDATA   pImageData,
@@ -366,86 +484,139 @@ WuSaveImageDataToFileA(
     return WuSaveImageDataToFileW(pImageData, szwFilePath, format);
 }
 
-WUAPI PWUIMAGEDATA
-WuLoadImageDataFromFileW(
-    IN LPCWSTR  szFilePath
+/*
+    EXIF Orientation (tag 0x0112) -> WIC transform that makes the image
+    upright. Index 0 is unused, values 1-8 are defined by EXIF 2.3.
+*/
+static CONST WICBitmapTransformOptions g_aExifOrientationToWicTransform[9] = {
+    WICBitmapTransformRotate0,
+    WICBitmapTransformRotate0,                                      /* 1 */
+    WICBitmapTransformFlipHorizontal,                               /* 2 */
+    WICBitmapTransformRotate180,                                    /* 3 */
+    WICBitmapTransformFlipVertical,                                 /* 4 */
+    WICBitmapTransformRotate90 | WICBitmapTransformFlipHorizontal,  /* 5 */
+    WICBitmapTransformRotate90,                                     /* 6 */
+    WICBitmapTransformRotate270 | WICBitmapTransformFlipHorizontal, /* 7 */
+    WICBitmapTransformRotate270                                     /* 8 */
+};
+
+static WICBitmapTransformOptions
+GetFrameOrientationTransform(
+    IN IWICBitmapFrameDecode*   pWicFrame
     )
 {
-    WCHAR                  szTempPath[MAX_PATH];
-    IWICImagingFactory*    pWicFactory   = NULL;
-    IWICBitmapDecoder*     pWicDecoder   = NULL;
-    IWICBitmapFrameDecode* pWicFrame     = NULL;
-    IWICFormatConverter*   pWicConverter = NULL;
-    IWICBitmapSource*      pWicBitmapSrc = NULL;
-    PWUIMAGEDATA           pImageData    = NULL;
-    UINT                   uWidth        = 0;
-    UINT                   uHeight       = 0;
-    BOOL                   bResult       = FALSE;
-    BOOL                   bNeedUninit   = FALSE; 
-    HRESULT                hResult       = S_OK;
+    PROPVARIANT              propValue;
+    IWICMetadataQueryReader* pWicReader   = NULL;
+    USHORT                   uOrientation = 1;
+    HRESULT                  hResult      = S_OK;
 
-    if (NULL == szFilePath)
-    {
-        return FALSE;
-    }
+    hResult = pWicFrame->lpVtbl->GetMetadataQueryReader(
+        pWicFrame,
+        &pWicReader);
 
-    /* WIC minimum supported client: Windows XP with SP2 */
-    if (IsWindowsXPSP2OrGreater() == FALSE)
+    if (FAILED(hResult))
     {
-        return FALSE;
+        return WICBitmapTransformRotate0;   /* format without metadata */
     }
 
-    hResult = CoInitialize(NULL);
+    PropVariantInit(&propValue);
 
-    bNeedUninit = (SUCCEEDED(hResult) && (hResult == S_OK));
+    /* JPEG keeps EXIF in APP1, TIFF in the root IFD */
+    hResult = pWicReader->lpVtbl->GetMetadataByName(
+        pWicReader,
+        L"/app1/ifd/{ushort=274}",
+        &propValue);
 
     if (FAILED(hResult))
     {
-        return NULL;
+        hResult = pWicReader->lpVtbl->GetMetadataByName(
+            pWicReader,
+            L"/ifd/{ushort=274}",
+            &propValue);
     }
 
-    hResult = CoCreateInstance(
-        &CLSID_WICImagingFactory,
-        NULL,
-        CLSCTX_INPROC_SERVER,
-        &IID_IWICImagingFactory,
-        (LPVOID*) &pWicFactory);
+    if (SUCCEEDED(hResult) && (VT_UI2 == propValue.vt))
+    {
+        uOrientation = propValue.uiVal;
+    }
 
-    CLEANUP_IF_FAILED(hResult);
+    PropVariantClear(&propValue);
 
-    bResult = _WuSafeExpandEnvironmentStrings(
-        szFilePath,
-        szTempPath,
-        MAX_PATH);
+    SAFE_RELEASE_COM_OBJECT(pWicReader);
 
-    if (FALSE == bResult)
+    if ((uOrientation < 1) || (uOrientation > 8))
     {
-        goto cleanup;
+        return WICBitmapTransformRotate0;
     }
 
-    hResult = pWicFactory->lpVtbl->CreateDecoderFromFilename(
-        pWicFactory,
-        szTempPath,
-        NULL,
-        GENERIC_READ,
-        WICDecodeMetadataCacheOnLoad,
-        &pWicDecoder);
+    return g_aExifOrientationToWicTransform[uOrientation];
+}
 
-    CLEANUP_IF_FAILED(hResult);
+static HRESULT
+DecodeImageData(
+    IN  IWICImagingFactory* pWicFactory,
+    IN  IWICBitmapDecoder*  pWicDecoder,
+    IN  DWORD               dwFlags,
+    OUT PWUIMAGEDATA*       ppImageData
+    )
+{
+    WICRect                   rcStrip;
+    IWICBitmapFrameDecode*    pWicFrame       = NULL;
+    IWICBitmapFlipRotator*    pWicFlipRotator = NULL;
+    IWICFormatConverter*      pWicConverter   = NULL;
+    IWICBitmapSource*         pWicBitmapSrc   = NULL;
+    PWUIMAGEDATA              pImageData      = NULL;
+    WICBitmapTransformOptions transform       = WICBitmapTransformRotate0;
+    UINT                      uWidth          = 0;
+    UINT                      uHeight         = 0;
+    HRESULT                   hResult         = S_OK;
+    UINT                      cbStride        = 0;
+    UINT                      cStripRows      = 0;
+    UINT                      y               = 0;
 
     hResult = pWicDecoder->lpVtbl->GetFrame(pWicDecoder, 0, &pWicFrame);
 
     CLEANUP_IF_FAILED(hResult);
 
-    hResult = pWicFrame->lpVtbl->GetSize(pWicFrame, &uWidth, &uHeight);
-
+    hResult = pWicFrame->lpVtbl->QueryInterface(
+        pWicFrame,
+        &IID_IWICBitmapSource,
+        (VOID**) &pWicBitmapSrc);
+    
     CLEANUP_IF_FAILED(hResult);
 
-    pImageData = WuCreateEmptyImageData(uWidth, uHeight);
+    if (dwFlags & WU_IMAGE_LOAD_APPLY_ORIENTATION)
+    {
+        transform = GetFrameOrientationTransform(pWicFrame);
+    }
 
-    if (NULL == pImageData)
+    /*
+        The flip/rotator sits between the decoder and the format converter,
+        so CopyPixels below writes the pixels already upright.
+    */
+    if (transform != WICBitmapTransformRotate0)
     {
-        goto cleanup;
+        hResult = pWicFactory->lpVtbl->CreateBitmapFlipRotator(
+            pWicFactory,
+            &pWicFlipRotator);
+
+        CLEANUP_IF_FAILED(hResult);
+
+        hResult = pWicFlipRotator->lpVtbl->Initialize(
+            pWicFlipRotator,
+            pWicBitmapSrc,
+            transform);
+
+        CLEANUP_IF_FAILED(hResult);
+
+        SAFE_RELEASE_COM_OBJECT(pWicBitmapSrc);
+
+        hResult = pWicFlipRotator->lpVtbl->QueryInterface(
+            pWicFlipRotator,
+            &IID_IWICBitmapSource,
+            (VOID**) &pWicBitmapSrc);
+
+        CLEANUP_IF_FAILED(hResult);
     }
 
     hResult = pWicFactory->lpVtbl->CreateFormatConverter(
@@ -454,13 +625,6 @@ WuLoadImageDataFromFileW(
 
     CLEANUP_IF_FAILED(hResult);
 
-    hResult = pWicFrame->lpVtbl->QueryInterface(
-        pWicFrame,
-        &IID_IWICBitmapSource,
-        (VOID**) &pWicBitmapSrc);
-    
-    CLEANUP_IF_FAILED(hResult);
-
     hResult = pWicConverter->lpVtbl->Initialize(
         pWicConverter,
         pWicBitmapSrc,
@@ -472,22 +636,102 @@ WuLoadImageDataFromFileW(
 
     CLEANUP_IF_FAILED(hResult);
 
-    hResult = pWicConverter->lpVtbl->CopyPixels(
-        pWicConverter,
-        NULL,
-        pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL,
-        pImageData->uWidth * pImageData->uHeight
-            * WU_IMAGEDATA_BYTES_PER_PIXEL,
-        pImageData->abData);
+    hResult = pWicConverter->lpVtbl->GetSize(pWicConverter, &uWidth, &uHeight);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    /* CopyPixels overwrites every pixel, no need to zero the buffer */
+    pImageData = _WuCreateUninitializedImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        hResult = E_OUTOFMEMORY;
+        goto cleanup;
+    }
+
+    cStripRows = GetWicStripRows(pImageData, &cbStride);
+
+    if (0 == cStripRows)
+    {
+        hResult = E_INVALIDARG;
+        goto cleanup;
+    }
+
+    for (y = 0; y < pImageData->uHeight; y += rcStrip.Height)
+    {
+        rcStrip.X      = 0;
+        rcStrip.Y      = (INT) y;
+        rcStrip.Width  = (INT) pImageData->uWidth;
+        rcStrip.Height = (INT) min(cStripRows, pImageData->uHeight - y);
+
+        hResult = pWicConverter->lpVtbl->CopyPixels(
+            pWicConverter,
+            &rcStrip,
+            cbStride,
+            rcStrip.Height * cbStride,
+            pImageData->abData + (SIZE_T) y * cbStride);
+
+        CLEANUP_IF_FAILED(hResult);
+    }
 
 cleanup:
     if ((pImageData != NULL) && FAILED(hResult))
     {
         WuDestroyImageData(pImageData);
+        pImageData = NULL;
     }
 
     SAFE_RELEASE_COM_OBJECT(pWicConverter);
+    SAFE_RELEASE_COM_OBJECT(pWicBitmapSrc);
+    SAFE_RELEASE_COM_OBJECT(pWicFlipRotator);
     SAFE_RELEASE_COM_OBJECT(pWicFrame);
+
+    *ppImageData = pImageData;
+
+    return hResult;
+}
+
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileExW(
+    IN LPCWSTR  szFilePath,
+    IN DWORD    dwFlags
+    )
+{
+    WCHAR               szTempPath[MAX_PATH];
+    IWICImagingFactory* pWicFactory = NULL;
+    IWICBitmapDecoder*  pWicDecoder = NULL;
+    PWUIMAGEDATA        pImageData  = NULL;
+    BOOL                bNeedUninit = FALSE; 
+    HRESULT             hResult     = S_OK;
+
+    if (NULL == szFilePath)
+    {
+        return NULL;
+    }
+
+    if (_WuSafeExpandEnvironmentStrings(szFilePath, szTempPath,
+            MAX_PATH) == FALSE)
+    {
+        return NULL;
+    }
+
+    hResult = CreateWicFactory(&pWicFactory, &bNeedUninit);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicFactory->lpVtbl->CreateDecoderFromFilename(
+        pWicFactory,
+        szTempPath,
+        NULL,
+        GENERIC_READ,
+        WICDecodeMetadataCacheOnLoad,
+        &pWicDecoder);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    DecodeImageData(pWicFactory, pWicDecoder, dwFlags, &pImageData);
+
+cleanup:
     SAFE_RELEASE_COM_OBJECT(pWicDecoder);
     SAFE_RELEASE_COM_OBJECT(pWicFactory);
 
@@ -500,39 +744,98 @@ cleanup:
 }
 
 WUAPI PWUIMAGEDATA
-WuLoadImageDataFromFileA(
-    IN LPCSTR   szFilePath
+WuLoadImageDataFromMemory(
+    IN CONST BYTE*  pbData,
+    IN SIZE_T       cbData,
+    IN DWORD        dwFlags
     )
 {
-    WCHAR szwFilePath[MAX_PATH];
-
-    if (NULL == szFilePath)
+    IWICImagingFactory* pWicFactory = NULL;
+    IWICStream*         pWicStream  = NULL;
+    IWICBitmapDecoder*  pWicDecoder = NULL;
+    PWUIMAGEDATA        pImageData  = NULL;
+    BOOL                bNeedUninit = FALSE;
+    HRESULT             hResult     = S_OK;
+
+    /* IWICStream takes a DWORD size */
+    if ((NULL == pbData) || (0 == cbData) || (cbData > MAXDWORD))
     {
-        return FALSE;
+        return NULL;
     }
 
-    if (WuAnsiToWide(szFilePath, szwFilePath, MAX_PATH) == FALSE)
+    hResult = CreateWicFactory(&pWicFactory, &bNeedUninit);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicFactory->lpVtbl->CreateStream(pWicFactory, &pWicStream);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    /* the stream reads pbData in place, it is never written */
+    hResult = pWicStream->lpVtbl->InitializeFromMemory(
+        pWicStream,
+        (BYTE*) pbData,
+        (DWORD) cbData);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    hResult = pWicFactory->lpVtbl->CreateDecoderFromStream(
+        pWicFactory,
+        (IStream*) pWicStream,
+        NULL,
+        WICDecodeMetadataCacheOnLoad,
+        &pWicDecoder);
+
+    CLEANUP_IF_FAILED(hResult);
+
+    DecodeImageData(pWicFactory, pWicDecoder, dwFlags, &pImageData);
+
+cleanup:
+    SAFE_RELEASE_COM_OBJECT(pWicDecoder);
+    SAFE_RELEASE_COM_OBJECT(pWicStream);
+    SAFE_RELEASE_COM_OBJECT(pWicFactory);
+
+    if (TRUE == bNeedUninit)
     {
-        return FALSE;
+        CoUninitialize();
     }
 
-    return WuLoadImageDataFromFileW(szwFilePath);
+    return pImageData;
 }
 
-WUAPI VOID
-WuDestroyImageData(
-    IN PWUIMAGEDATA pImageData
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileExA(
+    IN LPCSTR   szFilePath,
+    IN DWORD    dwFlags
     )
 {
-    if (NULL == pImageData)
+    WCHAR szwFilePath[MAX_PATH];
+
+    if (NULL == szFilePath)
     {
-        return;
+        return NULL;
     }
 
-    if (pImageData->abData != NULL)
+    if (WuAnsiToWide(szFilePath, szwFilePath, MAX_PATH) == FALSE)
     {
-        HeapFree(GetProcessHeap(), 0, pImageData->abData);
+        return NULL;
     }
 
-    HeapFree(GetProcessHeap(), 0, pImageData);
+    return WuLoadImageDataFromFileExW(szwFilePath, dwFlags);
+}
+
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileW(
+    IN LPCWSTR  szFilePath
+    )
+{
+    return WuLoadImageDataFromFileExW(szFilePath, 0);
+}
+
+WUAPI PWUIMAGEDATA
+WuLoadImageDataFromFileA(
+    IN LPCSTR   szFilePath
+    )
+{
+    return WuLoadImageDataFromFileExA(szFilePath, 0);
 }
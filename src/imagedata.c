@@ -0,0 +1,158 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       imagedata.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+BOOL
+_WuGetImageDataSize(
+    IN  UINT    uWidth,
+    IN  UINT    uHeight,
+    OUT SIZE_T* pcbImage
+    )
+{
+    ULONGLONG cPixels = 0;
+
+    if (NULL == pcbImage)
+    {
+        return FALSE;
+    }
+
+    /* GDI and WIC take signed 32-bit dimensions */
+    if ((uWidth > MAXLONG) || (uHeight > MAXLONG))
+    {
+        return FALSE;
+    }
+
+    /* cannot overflow: both factors are below 2^31 */
+    cPixels = (ULONGLONG) uWidth * uHeight;
+
+    if (cPixels > ((ULONGLONG) MAXSIZE_T) / WU_IMAGEDATA_BYTES_PER_PIXEL)
+    {
+        return FALSE;
+    }
+
+    *pcbImage = (SIZE_T) cPixels * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    return TRUE;
+}
+
+static PWUIMAGEDATA
+CreateImageData(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwHeapFlags
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbImage    = 0;
+
+    if ((uWidth == 0) || (uHeight == 0))
+    {
+        return NULL;
+    }
+
+    if (_WuGetImageDataSize(uWidth, uHeight, &cbImage) == FALSE)
+    {
+        return NULL;
+    }
+ 
+    pImageData = HeapAlloc(GetProcessHeap(), 0, sizeof(WUIMAGEDATA));
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    pImageData->uWidth  = uWidth;
+    pImageData->uHeight = uHeight;
+
+    pImageData->abData = HeapAlloc(
+        GetProcessHeap(),
+        dwHeapFlags,
+        cbImage);
+    
+    if (NULL == pImageData->abData)
+    {
+        HeapFree(GetProcessHeap(), 0, pImageData);
+        return NULL;
+    }
+
+    return pImageData;
+}
+
+PWUIMAGEDATA
+_WuCreateUninitializedImageData(
+    IN UINT uWidth,
+    IN UINT uHeight
+    )
+{
+    return CreateImageData(uWidth, uHeight, 0);
+}
+
+BOOL
+_WuGrowBuffer(
+    IN OUT LPVOID*  ppBuffer,
+    IN OUT SIZE_T*  pcbBuffer,
+    IN     SIZE_T   cbNeeded
+    )
+{
+    LPVOID pBuffer = NULL;
+
+    if (cbNeeded <= *pcbBuffer)
+    {
+        return TRUE;
+    }
+
+    cbNeeded = max(cbNeeded, *pcbBuffer + *pcbBuffer / 2);
+
+    pBuffer = (NULL == *ppBuffer)
+        ? HeapAlloc(GetProcessHeap(), 0, cbNeeded)
+        : HeapReAlloc(GetProcessHeap(), 0, *ppBuffer, cbNeeded);
+
+    if (NULL == pBuffer)
+    {
+        return FALSE;
+    }
+
+    *ppBuffer  = pBuffer;
+    *pcbBuffer = cbNeeded;
+
+    return TRUE;
+}
+
+WUAPI PWUIMAGEDATA
+WuCreateEmptyImageData(
+    IN UINT uWidth,
+    IN UINT uHeight
+    )
+{
+    return CreateImageData(uWidth, uHeight, HEAP_ZERO_MEMORY);
+}
+
+WUAPI VOID
+WuDestroyImageData(
+    IN PWUIMAGEDATA pImageData
+    )
+{
+    if (NULL == pImageData)
+    {
+        return;
+    }
+
+    if (pImageData->abData != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pImageData->abData);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pImageData);
+}
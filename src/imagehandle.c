@@ -0,0 +1,398 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       imagehandle.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+/*
+    Two reference counts are involved:
+
+    - IMAGEBUFFER::cRefs counts the handles that point at the pixels. The
+      pixels are read-only while it is above one; the first writer gets
+      its own copy (copy-on-write).
+    - WUIMAGEHANDLE::cRefs counts the owners of one handle (retain and
+      release), so a handle can be passed between threads safely.
+
+    WUIMAGEHANDLE::pBuffer is swapped by the copy-on-write, so it is only
+    read or replaced under the handle's lock. IMAGEBUFFER::cRefs can only
+    go from one to two through the handle holding the sole reference,
+    which makes the sole-owner check stable while that lock is held.
+
+    WuLockImageHandleData adds a reference to the buffer on behalf of the
+    caller and records it in WUIMAGEHANDLE::pDataLocks, so the pixels
+    outlive a copy-on-write of the handle and the release of every other
+    handle sharing them. The data stays shared, hence read-only, until
+    WuUnlockImageHandleData finds the record again by its pImageData.
+*/
+
+typedef struct tagIMAGEBUFFER {
+    LONG volatile   cRefs;
+    PWUIMAGEDATA    pImageData;
+} IMAGEBUFFER, *PIMAGEBUFFER;
+
+typedef struct tagDATALOCK {
+    struct tagDATALOCK* pNext;
+    PIMAGEBUFFER        pBuffer;    /* holds one reference */
+    UINT                cLocks;
+} DATALOCK, *PDATALOCK;
+
+struct tagWUIMAGEHANDLE {
+    LONG volatile   cRefs;
+    SRWLOCK         lock;           /* guards pBuffer and pDataLocks */
+    PIMAGEBUFFER    pBuffer;
+    PDATALOCK       pDataLocks;
+};
+
+static PIMAGEBUFFER
+CreateImageBuffer(
+    IN PWUIMAGEDATA pImageData
+    )
+{
+    PIMAGEBUFFER pBuffer = NULL;
+
+    pBuffer = HeapAlloc(GetProcessHeap(), 0, sizeof(IMAGEBUFFER));
+
+    if (NULL == pBuffer)
+    {
+        return NULL;
+    }
+
+    pBuffer->cRefs      = 1;
+    pBuffer->pImageData = pImageData;
+
+    return pBuffer;
+}
+
+static VOID
+ReleaseImageBuffer(
+    IN PIMAGEBUFFER pBuffer
+    )
+{
+    if (InterlockedDecrement(&pBuffer->cRefs) != 0)
+    {
+        return;
+    }
+
+    WuDestroyImageData(pBuffer->pImageData);
+    HeapFree(GetProcessHeap(), 0, pBuffer);
+}
+
+static HWUIMAGE
+CreateHandleForBuffer(
+    IN PIMAGEBUFFER pBuffer
+    )
+{
+    HWUIMAGE hImage = NULL;
+
+    hImage = HeapAlloc(GetProcessHeap(), 0, sizeof(struct tagWUIMAGEHANDLE));
+
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    hImage->cRefs      = 1;
+    hImage->pBuffer    = pBuffer;
+    hImage->pDataLocks = NULL;
+
+    InitializeSRWLock(&hImage->lock);
+
+    return hImage;
+}
+
+WUAPI HWUIMAGE
+WuCreateImageHandle(
+    IN PWUIMAGEDATA pImageData
+    )
+{
+    PIMAGEBUFFER pBuffer = NULL;
+    HWUIMAGE     hImage  = NULL;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return NULL;
+    }
+
+    pBuffer = CreateImageBuffer(pImageData);
+
+    if (NULL == pBuffer)
+    {
+        return NULL;
+    }
+
+    hImage = CreateHandleForBuffer(pBuffer);
+
+    if (NULL == hImage)
+    {
+        /* the caller keeps ownership of pImageData on failure */
+        HeapFree(GetProcessHeap(), 0, pBuffer);
+        return NULL;
+    }
+
+    return hImage;
+}
+
+WUAPI HWUIMAGE
+WuRetainImageHandle(
+    IN HWUIMAGE hImage
+    )
+{
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    InterlockedIncrement(&hImage->cRefs);
+
+    return hImage;
+}
+
+WUAPI VOID
+WuReleaseImageHandle(
+    IN HWUIMAGE hImage
+    )
+{
+    PDATALOCK pDataLock = NULL;
+
+    if (NULL == hImage)
+    {
+        return;
+    }
+
+    if (InterlockedDecrement(&hImage->cRefs) != 0)
+    {
+        return;
+    }
+
+    /* locks the caller never released, their pixels can go now */
+    while (hImage->pDataLocks != NULL)
+    {
+        pDataLock          = hImage->pDataLocks;
+        hImage->pDataLocks = pDataLock->pNext;
+
+        ReleaseImageBuffer(pDataLock->pBuffer);
+        HeapFree(GetProcessHeap(), 0, pDataLock);
+    }
+
+    ReleaseImageBuffer(hImage->pBuffer);
+    HeapFree(GetProcessHeap(), 0, hImage);
+}
+
+WUAPI HWUIMAGE
+WuShareImageHandle(
+    IN HWUIMAGE hImage
+    )
+{
+    HWUIMAGE     hShared = NULL;
+    PIMAGEBUFFER pBuffer = NULL;
+
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    AcquireSRWLockExclusive(&hImage->lock);
+
+    pBuffer = hImage->pBuffer;
+    InterlockedIncrement(&pBuffer->cRefs);
+
+    ReleaseSRWLockExclusive(&hImage->lock);
+
+    hShared = CreateHandleForBuffer(pBuffer);
+
+    if (NULL == hShared)
+    {
+        ReleaseImageBuffer(pBuffer);
+        return NULL;
+    }
+
+    return hShared;
+}
+
+WUAPI PWUIMAGEDATA
+WuImageHandleGetData(
+    IN HWUIMAGE hImage
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    AcquireSRWLockShared(&hImage->lock);
+
+    pImageData = hImage->pBuffer->pImageData;
+
+    ReleaseSRWLockShared(&hImage->lock);
+
+    return pImageData;
+}
+
+WUAPI PWUIMAGEDATA
+WuLockImageHandleData(
+    IN HWUIMAGE hImage
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    PIMAGEBUFFER pBuffer    = NULL;
+    PDATALOCK    pDataLock  = NULL;
+
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    AcquireSRWLockExclusive(&hImage->lock);
+
+    pBuffer   = hImage->pBuffer;
+    pDataLock = hImage->pDataLocks;
+
+    while ((pDataLock != NULL) && (pDataLock->pBuffer != pBuffer))
+    {
+        pDataLock = pDataLock->pNext;
+    }
+
+    if (NULL == pDataLock)
+    {
+        pDataLock = HeapAlloc(GetProcessHeap(), 0, sizeof(DATALOCK));
+
+        if (pDataLock != NULL)
+        {
+            InterlockedIncrement(&pBuffer->cRefs);
+
+            pDataLock->pBuffer = pBuffer;
+            pDataLock->cLocks  = 0;
+            pDataLock->pNext   = hImage->pDataLocks;
+
+            hImage->pDataLocks = pDataLock;
+        }
+    }
+
+    if (pDataLock != NULL)
+    {
+        pDataLock->cLocks++;
+        pImageData = pBuffer->pImageData;
+    }
+
+    ReleaseSRWLockExclusive(&hImage->lock);
+
+    return pImageData;
+}
+
+WUAPI VOID
+WuUnlockImageHandleData(
+    IN HWUIMAGE             hImage,
+    IN CONST PWUIMAGEDATA   pImageData
+    )
+{
+    PDATALOCK*   ppDataLock = NULL;
+    PDATALOCK    pDataLock  = NULL;
+    PIMAGEBUFFER pRelease   = NULL;
+
+    if ((NULL == hImage) || (NULL == pImageData))
+    {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&hImage->lock);
+
+    ppDataLock = &hImage->pDataLocks;
+
+    while ((*ppDataLock != NULL)
+        && ((*ppDataLock)->pBuffer->pImageData != pImageData))
+    {
+        ppDataLock = &(*ppDataLock)->pNext;
+    }
+
+    pDataLock = *ppDataLock;
+
+    if ((pDataLock != NULL) && (0 == --pDataLock->cLocks))
+    {
+        *ppDataLock = pDataLock->pNext;
+        pRelease    = pDataLock->pBuffer;
+
+        HeapFree(GetProcessHeap(), 0, pDataLock);
+    }
+
+    ReleaseSRWLockExclusive(&hImage->lock);
+
+    /* may be the last reference, which frees the pixels */
+    if (pRelease != NULL)
+    {
+        ReleaseImageBuffer(pRelease);
+    }
+}
+
+WUAPI PWUIMAGEDATA
+WuImageHandleGetWritableData(
+    IN HWUIMAGE hImage
+    )
+{
+    PWUIMAGEDATA pSource = NULL;
+    PWUIMAGEDATA pCopy   = NULL;
+    PIMAGEBUFFER pBuffer = NULL;
+    PIMAGEBUFFER pShared = NULL;
+
+    if (NULL == hImage)
+    {
+        return NULL;
+    }
+
+    AcquireSRWLockExclusive(&hImage->lock);
+
+    pShared = hImage->pBuffer;
+    pSource = pShared->pImageData;
+
+    /* sole owner of the pixels, no one else can observe the write */
+    if (InterlockedCompareExchange(&pShared->cRefs, 1, 1) == 1)
+    {
+        ReleaseSRWLockExclusive(&hImage->lock);
+        return pSource;
+    }
+
+    /* our reference keeps pSource alive while it is copied */
+    pCopy = _WuCreateUninitializedImageData(
+        pSource->uWidth,
+        pSource->uHeight);
+
+    if (pCopy != NULL)
+    {
+        CopyMemory(
+            pCopy->abData,
+            pSource->abData,
+            (SIZE_T) pSource->uWidth * pSource->uHeight
+                * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+        pBuffer = CreateImageBuffer(pCopy);
+
+        if (NULL == pBuffer)
+        {
+            WuDestroyImageData(pCopy);
+            pCopy = NULL;
+        }
+        else
+        {
+            hImage->pBuffer = pBuffer;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&hImage->lock);
+
+    if (pBuffer != NULL)
+    {
+        ReleaseImageBuffer(pShared);
+    }
+
+    return pCopy;
+}
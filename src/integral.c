@@ -0,0 +1,460 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       integral.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define CHANNELS    WU_IMAGEDATA_BYTES_PER_PIXEL
+
+/* Largest pixel count whose channel sums still fit in a DWORD */
+#define MAX_NARROW_PIXELS   (MAXDWORD / 255)
+
+/*
+    Tables have a zero row and a zero column in front, so entry (x, y)
+    holds the sums over [0, x) x [0, y) and any region is four lookups.
+    Channel sums are 32-bit when the whole image cannot overflow them and
+    64-bit otherwise; squared sums are always 64-bit.
+*/
+struct tagWUINTEGRALIMAGE {
+    UINT        uWidth;
+    UINT        uHeight;
+    SIZE_T      cEntriesPerRow;
+    DWORD*      adwSum;             /* NULL if aullSum is used */
+    ULONGLONG*  aullSum;
+    ULONGLONG*  aullSqSum;          /* NULL without WU_INTEGRAL_SQUARED */
+};
+
+static VOID
+SumRowNarrow(
+    IN  CONST DWORD*    pdwPixels,
+    IN  UINT            cPixels,
+    IN  CONST DWORD*    pdwAbove,
+    OUT DWORD*          pdwRow
+    )
+{
+    UINT x = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum  = _mm_setzero_si128();
+    __m128i pixel;
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        pixel = _mm_cvtsi32_si128((INT) pdwPixels[x]);
+        pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel, zero), zero);
+        sum   = _mm_add_epi32(sum, pixel);
+
+        _mm_storeu_si128((__m128i*) (pdwRow + x * CHANNELS),
+            _mm_add_epi32(sum,
+                _mm_loadu_si128((CONST __m128i*) (pdwAbove + x * CHANNELS))));
+    }
+#else /* _WU_HAVE_SSE2 */
+    DWORD adwSum[CHANNELS] = { 0 };
+    UINT  c                = 0;
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        for (c = 0; c < CHANNELS; ++c)
+        {
+            adwSum[c] += (pdwPixels[x] >> (c * 8)) & 0xFF;
+
+            pdwRow[x * CHANNELS + c] = adwSum[c] + pdwAbove[x * CHANNELS + c];
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+}
+
+/* bSquared sums the squares of the channels instead */
+static VOID
+SumRowWide(
+    IN  CONST DWORD*        pdwPixels,
+    IN  UINT                cPixels,
+    IN  CONST ULONGLONG*    pullAbove,
+    IN  BOOL                bSquared,
+    OUT ULONGLONG*          pullRow
+    )
+{
+    UINT x = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero  = _mm_setzero_si128();
+    __m128i sumBG = _mm_setzero_si128();
+    __m128i sumRA = _mm_setzero_si128();
+    __m128i pixel;
+    SIZE_T  i     = 0;
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        i = (SIZE_T) x * CHANNELS;
+
+        pixel = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128((INT) pdwPixels[x]),
+            zero);
+
+        /* 255 * 255 still fits an unsigned 16-bit lane */
+        if (TRUE == bSquared)
+        {
+            pixel = _mm_mullo_epi16(pixel, pixel);
+        }
+
+        pixel = _mm_unpacklo_epi16(pixel, zero);
+        sumBG = _mm_add_epi64(sumBG, _mm_unpacklo_epi32(pixel, zero));
+        sumRA = _mm_add_epi64(sumRA, _mm_unpackhi_epi32(pixel, zero));
+
+        _mm_storeu_si128((__m128i*) (pullRow + i),
+            _mm_add_epi64(sumBG,
+                _mm_loadu_si128((CONST __m128i*) (pullAbove + i))));
+        _mm_storeu_si128((__m128i*) (pullRow + i + 2),
+            _mm_add_epi64(sumRA,
+                _mm_loadu_si128((CONST __m128i*) (pullAbove + i + 2))));
+    }
+#else /* _WU_HAVE_SSE2 */
+    ULONGLONG aullSum[CHANNELS] = { 0 };
+    UINT      uValue            = 0;
+    UINT      c                 = 0;
+
+    for (x = 0; x < cPixels; ++x)
+    {
+        for (c = 0; c < CHANNELS; ++c)
+        {
+            uValue = (pdwPixels[x] >> (c * 8)) & 0xFF;
+
+            aullSum[c] += (TRUE == bSquared) ? uValue * uValue : uValue;
+
+            pullRow[x * CHANNELS + c] = aullSum[c]
+                + pullAbove[x * CHANNELS + c];
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+}
+
+WUAPI PWUINTEGRALIMAGE
+WuBuildIntegralImage(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN DWORD                dwFlags
+    )
+{
+    PWUINTEGRALIMAGE pIntegral = NULL;
+    CONST DWORD*     pdwPixels = NULL;
+    SIZE_T           cEntries  = 0;
+    SIZE_T           iRow      = 0;
+    ULONGLONG        cPixels   = 0;
+    UINT             y         = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return NULL;
+    }
+
+    cPixels = (ULONGLONG) pImageData->uWidth * pImageData->uHeight;
+
+    /* every table entry is addressed with a SIZE_T */
+    if (((ULONGLONG) pImageData->uWidth + 1)
+            * ((ULONGLONG) pImageData->uHeight + 1)
+            > MAXSIZE_T / (CHANNELS * sizeof(ULONGLONG)))
+    {
+        return NULL;
+    }
+
+    pIntegral = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUINTEGRALIMAGE));
+
+    if (NULL == pIntegral)
+    {
+        return NULL;
+    }
+
+    pIntegral->uWidth         = pImageData->uWidth;
+    pIntegral->uHeight        = pImageData->uHeight;
+    pIntegral->cEntriesPerRow = ((SIZE_T) pImageData->uWidth + 1) * CHANNELS;
+
+    cEntries = pIntegral->cEntriesPerRow * ((SIZE_T) pImageData->uHeight + 1);
+
+    if (cPixels <= MAX_NARROW_PIXELS)
+    {
+        pIntegral->adwSum = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            cEntries * sizeof(DWORD));
+
+        if (NULL == pIntegral->adwSum)
+        {
+            goto error;
+        }
+
+        ZeroMemory(pIntegral->adwSum, pIntegral->cEntriesPerRow
+            * sizeof(DWORD));
+    }
+    else
+    {
+        pIntegral->aullSum = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            cEntries * sizeof(ULONGLONG));
+
+        if (NULL == pIntegral->aullSum)
+        {
+            goto error;
+        }
+
+        ZeroMemory(pIntegral->aullSum, pIntegral->cEntriesPerRow
+            * sizeof(ULONGLONG));
+    }
+
+    if (dwFlags & WU_INTEGRAL_SQUARED)
+    {
+        pIntegral->aullSqSum = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            cEntries * sizeof(ULONGLONG));
+
+        if (NULL == pIntegral->aullSqSum)
+        {
+            goto error;
+        }
+
+        ZeroMemory(pIntegral->aullSqSum, pIntegral->cEntriesPerRow
+            * sizeof(ULONGLONG));
+    }
+
+    for (y = 0; y < pImageData->uHeight; ++y)
+    {
+        pdwPixels = (CONST DWORD*) pImageData->abData
+            + (SIZE_T) y * pImageData->uWidth;
+
+        iRow = pIntegral->cEntriesPerRow * ((SIZE_T) y + 1);
+
+        /* the leading zero column of each row */
+        if (pIntegral->adwSum != NULL)
+        {
+            ZeroMemory(pIntegral->adwSum + iRow, CHANNELS * sizeof(DWORD));
+
+            SumRowNarrow(
+                pdwPixels,
+                pImageData->uWidth,
+                pIntegral->adwSum + iRow - pIntegral->cEntriesPerRow
+                    + CHANNELS,
+                pIntegral->adwSum + iRow + CHANNELS);
+        }
+        else
+        {
+            ZeroMemory(pIntegral->aullSum + iRow,
+                CHANNELS * sizeof(ULONGLONG));
+
+            SumRowWide(
+                pdwPixels,
+                pImageData->uWidth,
+                pIntegral->aullSum + iRow - pIntegral->cEntriesPerRow
+                    + CHANNELS,
+                FALSE,
+                pIntegral->aullSum + iRow + CHANNELS);
+        }
+
+        if (pIntegral->aullSqSum != NULL)
+        {
+            ZeroMemory(pIntegral->aullSqSum + iRow,
+                CHANNELS * sizeof(ULONGLONG));
+
+            SumRowWide(
+                pdwPixels,
+                pImageData->uWidth,
+                pIntegral->aullSqSum + iRow - pIntegral->cEntriesPerRow
+                    + CHANNELS,
+                TRUE,
+                pIntegral->aullSqSum + iRow + CHANNELS);
+        }
+    }
+
+    return pIntegral;
+
+error:
+    WuDestroyIntegralImage(pIntegral);
+    return NULL;
+}
+
+static BOOL
+IsRegionValid(
+    IN CONST PWUINTEGRALIMAGE   pIntegral,
+    IN UINT                     uX,
+    IN UINT                     uY,
+    IN UINT                     uWidth,
+    IN UINT                     uHeight
+    )
+{
+    if ((NULL == pIntegral) || (0 == uWidth) || (0 == uHeight))
+    {
+        return FALSE;
+    }
+
+    return (uX <= pIntegral->uWidth) && (uWidth <= pIntegral->uWidth - uX)
+        && (uY <= pIntegral->uHeight) && (uHeight <= pIntegral->uHeight - uY);
+}
+
+static VOID
+RegionSum(
+    IN  CONST PWUINTEGRALIMAGE  pIntegral,
+    IN  UINT                    uX,
+    IN  UINT                    uY,
+    IN  UINT                    uWidth,
+    IN  UINT                    uHeight,
+    IN  BOOL                    bSquared,
+    OUT ULONGLONG               aullSum[CHANNELS]
+    )
+{
+    SIZE_T iTopLeft     = 0;
+    SIZE_T iTopRight    = 0;
+    SIZE_T iBottomLeft  = 0;
+    SIZE_T iBottomRight = 0;
+    UINT   c            = 0;
+
+    iTopLeft     = (SIZE_T) uY * pIntegral->cEntriesPerRow
+        + (SIZE_T) uX * CHANNELS;
+    iTopRight    = iTopLeft + (SIZE_T) uWidth * CHANNELS;
+    iBottomLeft  = iTopLeft + (SIZE_T) uHeight * pIntegral->cEntriesPerRow;
+    iBottomRight = iBottomLeft + (SIZE_T) uWidth * CHANNELS;
+
+    for (c = 0; c < CHANNELS; ++c)
+    {
+        if (TRUE == bSquared)
+        {
+            aullSum[c] = pIntegral->aullSqSum[iBottomRight + c]
+                - pIntegral->aullSqSum[iTopRight + c]
+                - pIntegral->aullSqSum[iBottomLeft + c]
+                + pIntegral->aullSqSum[iTopLeft + c];
+        }
+        else if (pIntegral->adwSum != NULL)
+        {
+            aullSum[c] = pIntegral->adwSum[iBottomRight + c]
+                - pIntegral->adwSum[iTopRight + c]
+                - pIntegral->adwSum[iBottomLeft + c]
+                + pIntegral->adwSum[iTopLeft + c];
+        }
+        else
+        {
+            aullSum[c] = pIntegral->aullSum[iBottomRight + c]
+                - pIntegral->aullSum[iTopRight + c]
+                - pIntegral->aullSum[iBottomLeft + c]
+                + pIntegral->aullSum[iTopLeft + c];
+        }
+    }
+}
+
+WUAPI BOOL
+WuRegionMean(
+    IN  CONST PWUINTEGRALIMAGE  pIntegral,
+    IN  UINT                    uX,
+    IN  UINT                    uY,
+    IN  UINT                    uWidth,
+    IN  UINT                    uHeight,
+    OUT PWUCOLORF               pMean
+    )
+{
+    ULONGLONG aullSum[CHANNELS];
+    DOUBLE    dbCount = 0.0;
+
+    if ((NULL == pMean)
+        || (IsRegionValid(pIntegral, uX, uY, uWidth, uHeight) == FALSE))
+    {
+        return FALSE;
+    }
+
+    RegionSum(pIntegral, uX, uY, uWidth, uHeight, FALSE, aullSum);
+
+    dbCount = (DOUBLE) uWidth * uHeight;
+
+    pMean->fB = (FLOAT) ((DOUBLE) aullSum[0] / dbCount);
+    pMean->fG = (FLOAT) ((DOUBLE) aullSum[1] / dbCount);
+    pMean->fR = (FLOAT) ((DOUBLE) aullSum[2] / dbCount);
+    pMean->fA = (FLOAT) ((DOUBLE) aullSum[3] / dbCount);
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuRegionVariance(
+    IN  CONST PWUINTEGRALIMAGE  pIntegral,
+    IN  UINT                    uX,
+    IN  UINT                    uY,
+    IN  UINT                    uWidth,
+    IN  UINT                    uHeight,
+    OUT PWUCOLORF               pVariance
+    )
+{
+    ULONGLONG aullSum[CHANNELS];
+    ULONGLONG aullSqSum[CHANNELS];
+    DOUBLE    adbVariance[CHANNELS];
+    DOUBLE    dbCount = 0.0;
+    DOUBLE    dbMean  = 0.0;
+    UINT      c       = 0;
+
+    if ((NULL == pVariance)
+        || (IsRegionValid(pIntegral, uX, uY, uWidth, uHeight) == FALSE)
+        || (NULL == pIntegral->aullSqSum))
+    {
+        return FALSE;
+    }
+
+    RegionSum(pIntegral, uX, uY, uWidth, uHeight, FALSE, aullSum);
+    RegionSum(pIntegral, uX, uY, uWidth, uHeight, TRUE, aullSqSum);
+
+    dbCount = (DOUBLE) uWidth * uHeight;
+
+    for (c = 0; c < CHANNELS; ++c)
+    {
+        dbMean         = (DOUBLE) aullSum[c] / dbCount;
+        adbVariance[c] = (DOUBLE) aullSqSum[c] / dbCount - dbMean * dbMean;
+
+        /* rounding can push a flat region slightly below zero */
+        if (adbVariance[c] < 0.0)
+        {
+            adbVariance[c] = 0.0;
+        }
+    }
+
+    pVariance->fB = (FLOAT) adbVariance[0];
+    pVariance->fG = (FLOAT) adbVariance[1];
+    pVariance->fR = (FLOAT) adbVariance[2];
+    pVariance->fA = (FLOAT) adbVariance[3];
+
+    return TRUE;
+}
+
+WUAPI VOID
+WuDestroyIntegralImage(
+    IN PWUINTEGRALIMAGE pIntegral
+    )
+{
+    if (NULL == pIntegral)
+    {
+        return;
+    }
+
+    if (pIntegral->adwSum != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pIntegral->adwSum);
+    }
+
+    if (pIntegral->aullSum != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pIntegral->aullSum);
+    }
+
+    if (pIntegral->aullSqSum != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pIntegral->aullSqSum);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pIntegral);
+}
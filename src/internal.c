@@ -313,3 +313,30 @@ get_property:
 
     return !((0 == cchWritten) && (GetLastError() != ERROR_SUCCESS));
 }
+
+LONGLONG
+_WuGetTicks(
+    VOID
+    )
+{
+    LARGE_INTEGER liCounter;
+
+    QueryPerformanceCounter(&liCounter);
+
+    return liCounter.QuadPart;
+}
+
+/* Split so that hours of ticks times the unit rate cannot overflow */
+ULONGLONG
+_WuTicksToUnits(
+    IN LONGLONG     llTicks,
+    IN LONGLONG     llFrequency,
+    IN ULONGLONG    ullUnitsPerSecond
+    )
+{
+    ULONGLONG ullTicks     = (ULONGLONG) max(llTicks, 0);
+    ULONGLONG ullFrequency = (ULONGLONG) llFrequency;
+
+    return (ullTicks / ullFrequency) * ullUnitsPerSecond
+        + (ullTicks % ullFrequency) * ullUnitsPerSecond / ullFrequency;
+}
@@ -14,6 +14,17 @@
 
 #include <windows.h>
 
+#include "winutilz.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)               \
+    || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define _WU_HAVE_SSE2
+#endif
+
+#ifdef _WU_HAVE_SSE2
+    #include <emmintrin.h>
+#endif /* _WU_HAVE_SSE2 */
+
 typedef BOOL (*SETFROMFILEPROC)(LPCWSTR, DWORD);
 
 BOOL
@@ -58,4 +69,166 @@ _WuCurrentThemeGetStringProperty(
     IN  ULONG   cchValueSize
     );
 
+/*
+    Byte size of a uWidth x uHeight WUIMAGEDATA buffer, computed in 64 bits.
+    Fails if the size does not fit SIZE_T or a dimension exceeds MAXLONG.
+*/
+BOOL
+_WuGetImageDataSize(
+    IN  UINT    uWidth,
+    IN  UINT    uHeight,
+    OUT SIZE_T* pcbImage
+    );
+
+/*
+    Same as WuCreateEmptyImageData, but the pixel buffer is left
+    uninitialized. Meant for kernels that overwrite every pixel.
+*/
+PWUIMAGEDATA
+_WuCreateUninitializedImageData(
+    IN UINT uWidth,
+    IN UINT uHeight
+    );
+
+/*
+    Makes *ppBuffer hold at least cbNeeded bytes, growing by half of the
+    current size or more so that repeated calls stay amortized. The old
+    contents are kept and *ppBuffer is left untouched on failure.
+*/
+BOOL
+_WuGrowBuffer(
+    IN OUT LPVOID*  ppBuffer,
+    IN OUT SIZE_T*  pcbBuffer,
+    IN     SIZE_T   cbNeeded
+    );
+
+/***************************************************************************
+ *  Timing (recorder.c, scheduler.c)
+ ***************************************************************************/
+
+#define MAX_FRAME_RATE              1000
+
+#define MICROSECONDS_PER_SECOND     1000000
+#define MILLISECONDS_PER_SECOND     1000
+#define TIMESTAMP_UNITS_PER_SECOND  10000000    /* 100 ns */
+
+/* Current performance counter value */
+LONGLONG
+_WuGetTicks(
+    VOID
+    );
+
+/*
+    Converts a performance counter interval to ullUnitsPerSecond units.
+    Negative intervals count as zero.
+*/
+ULONGLONG
+_WuTicksToUnits(
+    IN LONGLONG     llTicks,
+    IN LONGLONG     llFrequency,
+    IN ULONGLONG    ullUnitsPerSecond
+    );
+
+/***************************************************************************
+ *  color.c
+ ***************************************************************************/
+
+#define WU_LINEAR_TO_SRGB_TABLE_SIZE    4096
+#define WU_LINEAR_TO_SRGB8_TABLE_SIZE   16384
+
+typedef struct tagWUCOLORTABLES {
+    FLOAT   afSrgbToLinear[256];
+    WORD    awSrgbToLinear16[256];
+    WORD    awLinearToSrgb[WU_LINEAR_TO_SRGB_TABLE_SIZE + 1];   /* 8.8 */
+    BYTE    abLinearToSrgb8[WU_LINEAR_TO_SRGB8_TABLE_SIZE + 1];
+} WUCOLORTABLES;
+
+/* Builds the tables on first use, safe to call from any thread */
+CONST WUCOLORTABLES*
+_WuGetColorTables(
+    VOID
+    );
+
+static WU_INLINE BYTE
+_WuLinear16ToSrgb(
+    IN CONST WUCOLORTABLES* pTables,
+    IN WORD                 wLinear
+    )
+{
+    CONST WORD* pwEntry = pTables->awLinearToSrgb + (wLinear >> 4);
+    UINT        uFrac   = wLinear & 0xF;
+    UINT        uValue  = 0;
+
+    uValue = pwEntry[0] * (16 - uFrac) + pwEntry[1] * uFrac;
+
+    return (BYTE) ((uValue + (128 << 4)) >> 12);
+}
+
+/* BGRA8 sRGB -> BGRA16 linear (alpha is only rescaled) */
+VOID
+_WuRowToLinear16(
+    IN  CONST BYTE* pbSrc,
+    OUT WORD*       pwDst,
+    IN  SIZE_T      cPixels
+    );
+
+VOID
+_WuLinear16ToRow(
+    IN  CONST WORD* pwSrc,
+    OUT BYTE*       pbDst,
+    IN  SIZE_T      cPixels
+    );
+
+/* Grayscale kernel of WuConvertImageDataToGrayscale for a single row */
+VOID
+_WuGrayscaleRow(
+    IN OUT BYTE*            pbRow,
+    IN     UINT             cPixels,
+    IN     WU_LUMA_STANDARD standard,
+    IN     DWORD            dwFlags
+    );
+
+/***************************************************************************
+ *  mask.c
+ ***************************************************************************/
+
+/* Writes one WUIMAGEMASK row from one byte per pixel, 0 or 0xFF */
+VOID
+_WuStoreMaskRow(
+    IN PWUIMAGEMASK pMask,
+    IN UINT         y,
+    IN CONST BYTE*  pbValues
+    );
+
+/* Reads one WUIMAGEMASK row as one byte per pixel */
+VOID
+_WuLoadMaskRow(
+    IN  CONST WUIMAGEMASK*  pMask,
+    IN  UINT                y,
+    OUT BYTE*               pbValues
+    );
+
+/***************************************************************************
+ *  parallel.c
+ ***************************************************************************/
+
+typedef VOID (*WUPARALLELPROC)(UINT iItem, LPVOID pContext);
+
+UINT
+_WuGetProcessorCount(
+    VOID
+    );
+
+/*
+    Calls pfnProc for every item in [0, cItems) on the system thread pool
+    and the calling thread, and returns once all of them are done. Items
+    should be coarse (row bands, not pixels).
+*/
+VOID
+_WuParallelFor(
+    IN UINT             cItems,
+    IN WUPARALLELPROC   pfnProc,
+    IN LPVOID           pContext
+    );
+
 #endif /* INTERNAL_H_INCLUDED */
@@ -0,0 +1,1186 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       mask.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <stdlib.h>
+
+#include "internal.h"
+
+#define MIN_LINES_PER_BAND  16
+
+#define MASK_SET            0xFF
+
+typedef struct tagMASKJOB {
+    CONST WUIMAGEDATA*      pImageData;
+    BYTE*                   abLuma;         /* uWidth bytes per row */
+    BYTE*                   abPlane;        /* morphology, same layout */
+    BYTE*                   abMagnitude;    /* WuImageGradient output */
+    PWUIMAGEMASK            pMask;
+    UINT                    uWidth;
+    UINT                    uHeight;
+    UINT                    cLines;         /* rows, or columns */
+    UINT                    cLinesPerBand;
+    BYTE*                   abScratch;
+    SIZE_T                  cbScratch;      /* per band */
+    WU_GRADIENT_OPERATOR    op;
+    BYTE                    bLevel;
+    BOOL                    bInvert;
+    UINT                    uRadius;
+    INT                     iOffset;
+    BOOL                    bDilate;
+} MASKJOB, *PMASKJOB;
+
+static UINT
+GetLinesPerBand(
+    IN UINT cLines
+    )
+{
+    UINT cBands = (cLines + MIN_LINES_PER_BAND - 1) / MIN_LINES_PER_BAND;
+
+    cBands = max(1, min(cBands, _WuGetProcessorCount()));
+
+    return (cLines + cBands - 1) / cBands;
+}
+
+/* Every band gets cbScratch bytes of scratch, 16-byte aligned */
+static BOOL
+RunBands(
+    IN PMASKJOB         pJob,
+    IN UINT             cLines,
+    IN SIZE_T           cbScratch,
+    IN WUPARALLELPROC   pfnProc
+    )
+{
+    UINT cBands = 0;
+
+    pJob->cLines        = cLines;
+    pJob->cLinesPerBand = GetLinesPerBand(cLines);
+    pJob->cbScratch     = (cbScratch + 15) & ~((SIZE_T) 15);
+    pJob->abScratch     = NULL;
+
+    cBands = (cLines + pJob->cLinesPerBand - 1) / pJob->cLinesPerBand;
+
+    if (cbScratch != 0)
+    {
+        pJob->abScratch = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            pJob->cbScratch * cBands);
+
+        if (NULL == pJob->abScratch)
+        {
+            return FALSE;
+        }
+    }
+
+    _WuParallelFor(cBands, pfnProc, pJob);
+
+    if (pJob->abScratch != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pJob->abScratch);
+        pJob->abScratch = NULL;
+    }
+
+    return TRUE;
+}
+
+static VOID
+GetBandLines(
+    IN  PMASKJOB    pJob,
+    IN  UINT        iBand,
+    OUT UINT*       puFirst,
+    OUT UINT*       puLast
+    )
+{
+    *puFirst = iBand * pJob->cLinesPerBand;
+    *puLast  = min(pJob->cLines, *puFirst + pJob->cLinesPerBand);
+}
+
+VOID
+_WuStoreMaskRow(
+    IN PWUIMAGEMASK pMask,
+    IN UINT         y,
+    IN CONST BYTE*  pbValues
+    )
+{
+    BYTE* pbRow = pMask->abData + (SIZE_T) y * pMask->cbStride;
+    UINT  x     = 0;
+
+    if (!(pMask->dwFlags & WU_MASK_PACKED))
+    {
+        CopyMemory(pbRow, pbValues, pMask->uWidth);
+        return;
+    }
+
+    ZeroMemory(pbRow, pMask->cbStride);
+
+#ifdef _WU_HAVE_SSE2
+    for (; x + 16 <= pMask->uWidth; x += 16)
+    {
+        INT iBits = _mm_movemask_epi8(
+            _mm_loadu_si128((CONST __m128i*) (pbValues + x)));
+
+        pbRow[x / 8]     = (BYTE) iBits;
+        pbRow[x / 8 + 1] = (BYTE) (iBits >> 8);
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < pMask->uWidth; ++x)
+    {
+        if (pbValues[x] != 0)
+        {
+            pbRow[x / 8] |= (BYTE) (1 << (x % 8));
+        }
+    }
+}
+
+VOID
+_WuLoadMaskRow(
+    IN  CONST WUIMAGEMASK*  pMask,
+    IN  UINT                y,
+    OUT BYTE*               pbValues
+    )
+{
+    CONST BYTE* pbRow = pMask->abData + (SIZE_T) y * pMask->cbStride;
+    UINT        x     = 0;
+
+    if (!(pMask->dwFlags & WU_MASK_PACKED))
+    {
+        CopyMemory(pbValues, pbRow, pMask->uWidth);
+        return;
+    }
+
+    for (x = 0; x < pMask->uWidth; ++x)
+    {
+        pbValues[x] = ((pbRow[x / 8] >> (x % 8)) & 1) ? MASK_SET : 0;
+    }
+}
+
+/* pbDst[x] = MASK_SET where pbSrc[x] > bLevel, the opposite with bInvert */
+static VOID
+ThresholdRow(
+    IN  CONST BYTE* pbSrc,
+    OUT BYTE*       pbDst,
+    IN  UINT        cPixels,
+    IN  BYTE        bLevel,
+    IN  BOOL        bInvert
+    )
+{
+    UINT x = 0;
+
+#ifdef _WU_HAVE_SSE2
+    {
+        __m128i level  = _mm_set1_epi8((CHAR) bLevel);
+        __m128i invert = _mm_set1_epi8((CHAR) (bInvert ? 0 : MASK_SET));
+        __m128i below;
+
+        for (; x + 16 <= cPixels; x += 16)
+        {
+            /* pbSrc[x] <= bLevel exactly when the saturated difference is 0 */
+            below = _mm_cmpeq_epi8(
+                _mm_subs_epu8(
+                    _mm_loadu_si128((CONST __m128i*) (pbSrc + x)),
+                    level),
+                _mm_setzero_si128());
+
+            _mm_storeu_si128((__m128i*) (pbDst + x),
+                _mm_xor_si128(below, invert));
+        }
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        pbDst[x] = ((pbSrc[x] > bLevel) != (bInvert != FALSE))
+            ? MASK_SET : 0;
+    }
+}
+
+static VOID
+LumaProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB pJob    = (PMASKJOB) pContext;
+    BYTE*    pbRow   = pJob->abScratch + iBand * pJob->cbScratch;
+    BYTE*    pbLuma  = NULL;
+    UINT     uWidth  = pJob->uWidth;
+    UINT     uFirst  = 0;
+    UINT     uLast   = 0;
+    UINT     x       = 0;
+    UINT     y       = 0;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        CopyMemory(
+            pbRow,
+            pJob->pImageData->abData
+                + (SIZE_T) y * uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            (SIZE_T) uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+        _WuGrayscaleRow(pbRow, uWidth, WU_LUMA_BT601, 0);
+
+        pbLuma = pJob->abLuma + (SIZE_T) y * uWidth;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            pbLuma[x] = pbRow[x * WU_IMAGEDATA_BYTES_PER_PIXEL];
+        }
+    }
+}
+
+/* BT.601 luma, one byte per pixel */
+static BYTE*
+BuildLumaPlane(
+    IN PMASKJOB pJob
+    )
+{
+    pJob->abLuma = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) pJob->uWidth * pJob->uHeight);
+
+    if (NULL == pJob->abLuma)
+    {
+        return NULL;
+    }
+
+    if (RunBands(pJob, pJob->uHeight,
+            (SIZE_T) pJob->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            LumaProc) == FALSE)
+    {
+        HeapFree(GetProcessHeap(), 0, pJob->abLuma);
+        pJob->abLuma = NULL;
+    }
+
+    return pJob->abLuma;
+}
+
+static BOOL
+BeginJob(
+    IN PMASKJOB             pJob,
+    IN CONST WUIMAGEDATA*   pImageData
+    )
+{
+    ZeroMemory(pJob, sizeof(MASKJOB));
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData)
+        || (0 == pImageData->uWidth) || (0 == pImageData->uHeight))
+    {
+        return FALSE;
+    }
+
+    pJob->pImageData = pImageData;
+    pJob->uWidth     = pImageData->uWidth;
+    pJob->uHeight    = pImageData->uHeight;
+
+    return (BuildLumaPlane(pJob) != NULL);
+}
+
+WUAPI PWUIMAGEMASK
+WuCreateImageMask(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwFlags
+    )
+{
+    PWUIMAGEMASK pMask    = NULL;
+    UINT         cbStride = 0;
+
+    if ((0 == uWidth) || (0 == uHeight)
+        || (uWidth > MAXLONG) || (uHeight > MAXLONG))
+    {
+        return NULL;
+    }
+
+    cbStride = (dwFlags & WU_MASK_PACKED) ? (uWidth + 7) / 8 : uWidth;
+
+    if ((ULONGLONG) cbStride * uHeight > (ULONGLONG) MAXSIZE_T)
+    {
+        return NULL;
+    }
+
+    pMask = HeapAlloc(GetProcessHeap(), 0, sizeof(WUIMAGEMASK));
+
+    if (NULL == pMask)
+    {
+        return NULL;
+    }
+
+    pMask->uWidth   = uWidth;
+    pMask->uHeight  = uHeight;
+    pMask->cbStride = cbStride;
+    pMask->dwFlags  = dwFlags & WU_MASK_PACKED;
+
+    pMask->abData = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        (SIZE_T) cbStride * uHeight);
+
+    if (NULL == pMask->abData)
+    {
+        HeapFree(GetProcessHeap(), 0, pMask);
+        return NULL;
+    }
+
+    return pMask;
+}
+
+WUAPI VOID
+WuDestroyImageMask(
+    IN PWUIMAGEMASK pMask
+    )
+{
+    if (NULL == pMask)
+    {
+        return;
+    }
+
+    if (pMask->abData != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pMask->abData);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pMask);
+}
+
+/***************************************************************************
+ *  Gradients
+ ***************************************************************************/
+
+/*
+    Both operators are separable: a vertical smoothing s and difference d
+    per column, then gx = s[x + 1] - s[x - 1] and gy = d smoothed along
+    the row. Sobel smooths with (1 2 1), Scharr with (3 10 3).
+*/
+static VOID
+GradientRow(
+    IN  CONST BYTE*             pbAbove,
+    IN  CONST BYTE*             pbRow,
+    IN  CONST BYTE*             pbBelow,
+    IN  UINT                    uWidth,
+    IN  WU_GRADIENT_OPERATOR    op,
+    IN  SHORT*                  asSmooth,   /* uWidth + 2 */
+    IN  SHORT*                  asDelta,    /* uWidth + 2 */
+    OUT BYTE*                   pbMagnitude
+    )
+{
+    SHORT sOuter = (WU_GRADIENT_SCHARR == op) ? 3 : 1;
+    SHORT sInner = (WU_GRADIENT_SCHARR == op) ? 10 : 2;
+    INT   iShift = (WU_GRADIENT_SCHARR == op) ? 4 : 2;
+    INT   gx     = 0;
+    INT   gy     = 0;
+    UINT  x      = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero  = _mm_setzero_si128();
+    __m128i outer = _mm_set1_epi16(sOuter);
+    __m128i inner = _mm_set1_epi16(sInner);
+    __m128i above, row, below, vx, vy;
+
+    for (; x + 8 <= uWidth; x += 8)
+    {
+        above = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((CONST __m128i*) (pbAbove + x)), zero);
+        row   = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((CONST __m128i*) (pbRow + x)), zero);
+        below = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((CONST __m128i*) (pbBelow + x)), zero);
+
+        _mm_storeu_si128((__m128i*) (asSmooth + x + 1), _mm_add_epi16(
+            _mm_mullo_epi16(_mm_add_epi16(above, below), outer),
+            _mm_mullo_epi16(row, inner)));
+
+        _mm_storeu_si128((__m128i*) (asDelta + x + 1),
+            _mm_sub_epi16(below, above));
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < uWidth; ++x)
+    {
+        asSmooth[x + 1] = (SHORT) (sOuter * (pbAbove[x] + pbBelow[x])
+            + sInner * pbRow[x]);
+        asDelta[x + 1]  = (SHORT) (pbBelow[x] - pbAbove[x]);
+    }
+
+    /* replicate the border columns */
+    asSmooth[0]          = asSmooth[1];
+    asDelta[0]           = asDelta[1];
+    asSmooth[uWidth + 1] = asSmooth[uWidth];
+    asDelta[uWidth + 1]  = asDelta[uWidth];
+
+    x = 0;
+
+#ifdef _WU_HAVE_SSE2
+    for (; x + 8 <= uWidth; x += 8)
+    {
+        vx = _mm_sub_epi16(
+            _mm_loadu_si128((CONST __m128i*) (asSmooth + x + 2)),
+            _mm_loadu_si128((CONST __m128i*) (asSmooth + x)));
+
+        vy = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_add_epi16(
+                _mm_loadu_si128((CONST __m128i*) (asDelta + x)),
+                _mm_loadu_si128((CONST __m128i*) (asDelta + x + 2))),
+                outer),
+            _mm_mullo_epi16(
+                _mm_loadu_si128((CONST __m128i*) (asDelta + x + 1)),
+                inner));
+
+        /* |v| as max(v, -v), the sum stays below 2^13 */
+        vx = _mm_max_epi16(vx, _mm_sub_epi16(zero, vx));
+        vy = _mm_max_epi16(vy, _mm_sub_epi16(zero, vy));
+        vx = _mm_srl_epi16(_mm_add_epi16(vx, vy), _mm_cvtsi32_si128(iShift));
+
+        _mm_storel_epi64((__m128i*) (pbMagnitude + x),
+            _mm_packus_epi16(vx, vx));
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < uWidth; ++x)
+    {
+        gx = asSmooth[x + 2] - asSmooth[x];
+        gy = sOuter * (asDelta[x] + asDelta[x + 2])
+            + sInner * asDelta[x + 1];
+
+        gx = (abs(gx) + abs(gy)) >> iShift;
+
+        pbMagnitude[x] = (BYTE) min(gx, 0xFF);
+    }
+}
+
+static VOID
+GradientProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB pJob      = (PMASKJOB) pContext;
+    UINT     uWidth    = pJob->uWidth;
+    BYTE*    pbScratch = pJob->abScratch + iBand * pJob->cbScratch;
+    SHORT*   asSmooth  = (SHORT*) pbScratch;
+    SHORT*   asDelta   = asSmooth + uWidth + 2;
+    BYTE*    pbOut     = (BYTE*) (asDelta + uWidth + 2);
+    BYTE*    pbValues  = pbOut + uWidth;
+    BYTE*    pbRow     = NULL;
+    UINT     uFirst    = 0;
+    UINT     uLast     = 0;
+    UINT     y         = 0;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        pbRow = pJob->abLuma + (SIZE_T) y * uWidth;
+
+        if (pJob->abMagnitude != NULL)
+        {
+            pbOut = pJob->abMagnitude + (SIZE_T) y * uWidth;
+        }
+
+        GradientRow(
+            (0 == y) ? pbRow : pbRow - uWidth,
+            pbRow,
+            (y + 1 == pJob->uHeight) ? pbRow : pbRow + uWidth,
+            uWidth,
+            pJob->op,
+            asSmooth,
+            asDelta,
+            pbOut);
+
+        if (pJob->pMask != NULL)
+        {
+            ThresholdRow(pbOut, pbValues, uWidth, pJob->bLevel, FALSE);
+            _WuStoreMaskRow(pJob->pMask, y, pbValues);
+        }
+    }
+}
+
+static BOOL
+RunGradient(
+    IN PMASKJOB pJob
+    )
+{
+    /* two SHORT rows of uWidth + 2, the magnitude and the mask values */
+    SIZE_T cbScratch = ((SIZE_T) pJob->uWidth + 2) * 2 * sizeof(SHORT)
+        + (SIZE_T) pJob->uWidth * 2;
+
+    return RunBands(pJob, pJob->uHeight, cbScratch, GradientProc);
+}
+
+WUAPI BOOL
+WuImageGradient(
+    IN  CONST PWUIMAGEDATA      pImageData,
+    IN  WU_GRADIENT_OPERATOR    op,
+    OUT BYTE*                   abMagnitude
+    )
+{
+    MASKJOB job;
+    BOOL    bResult = FALSE;
+
+    if (NULL == abMagnitude)
+    {
+        return FALSE;
+    }
+
+    if (BeginJob(&job, pImageData) == FALSE)
+    {
+        return FALSE;
+    }
+
+    job.op          = op;
+    job.abMagnitude = abMagnitude;
+
+    bResult = RunGradient(&job);
+
+    HeapFree(GetProcessHeap(), 0, job.abLuma);
+
+    return bResult;
+}
+
+WUAPI PWUIMAGEMASK
+WuDetectEdges(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_GRADIENT_OPERATOR op,
+    IN BYTE                 bThreshold,
+    IN DWORD                dwFlags
+    )
+{
+    MASKJOB job;
+
+    if (BeginJob(&job, pImageData) == FALSE)
+    {
+        return NULL;
+    }
+
+    job.op     = op;
+    job.bLevel = bThreshold;
+    job.pMask  = WuCreateImageMask(job.uWidth, job.uHeight, dwFlags);
+
+    if ((job.pMask != NULL) && (RunGradient(&job) == FALSE))
+    {
+        WuDestroyImageMask(job.pMask);
+        job.pMask = NULL;
+    }
+
+    HeapFree(GetProcessHeap(), 0, job.abLuma);
+
+    return job.pMask;
+}
+
+/***************************************************************************
+ *  Thresholds
+ ***************************************************************************/
+
+WUAPI BYTE
+WuOtsuThreshold(
+    IN CONST DWORD  adwBins[WU_HISTOGRAM_BINS]
+    )
+{
+    DOUBLE dbTotal    = 0.0;
+    DOUBLE dbSum      = 0.0;
+    DOUBLE dbBelow    = 0.0;
+    DOUBLE dbSumBelow = 0.0;
+    DOUBLE dbAbove    = 0.0;
+    DOUBLE dbMeanDiff = 0.0;
+    DOUBLE dbVariance = 0.0;
+    DOUBLE dbBest     = -1.0;
+    UINT   uBest      = 0;
+    UINT   i          = 0;
+
+    if (NULL == adwBins)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < WU_HISTOGRAM_BINS; ++i)
+    {
+        dbTotal += adwBins[i];
+        dbSum   += (DOUBLE) i * adwBins[i];
+    }
+
+    /* maximise the between-class variance of [0, i] and (i, 255] */
+    for (i = 0; i < WU_HISTOGRAM_BINS - 1; ++i)
+    {
+        dbBelow    += adwBins[i];
+        dbSumBelow += (DOUBLE) i * adwBins[i];
+        dbAbove     = dbTotal - dbBelow;
+
+        if ((0.0 == dbBelow) || (0.0 == dbAbove))
+        {
+            continue;
+        }
+
+        dbMeanDiff = dbSumBelow / dbBelow
+            - (dbSum - dbSumBelow) / dbAbove;
+        dbVariance = dbBelow * dbAbove * dbMeanDiff * dbMeanDiff;
+
+        if (dbVariance > dbBest)
+        {
+            dbBest = dbVariance;
+            uBest  = i;
+        }
+    }
+
+    return (BYTE) uBest;
+}
+
+static VOID
+ThresholdProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB pJob     = (PMASKJOB) pContext;
+    BYTE*    pbValues = pJob->abScratch + iBand * pJob->cbScratch;
+    UINT     uFirst   = 0;
+    UINT     uLast    = 0;
+    UINT     y        = 0;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        ThresholdRow(
+            pJob->abLuma + (SIZE_T) y * pJob->uWidth,
+            pbValues,
+            pJob->uWidth,
+            pJob->bLevel,
+            pJob->bInvert);
+
+        _WuStoreMaskRow(pJob->pMask, y, pbValues);
+    }
+}
+
+WUAPI PWUIMAGEMASK
+WuThresholdImage(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN BYTE                 bLevel,
+    IN DWORD                dwFlags
+    )
+{
+    MASKJOB     job;
+    WUHISTOGRAM histogram;
+    SIZE_T      cPixels = 0;
+    SIZE_T      i       = 0;
+
+    if (BeginJob(&job, pImageData) == FALSE)
+    {
+        return NULL;
+    }
+
+    /* the luma plane is already there, so count it directly */
+    if (dwFlags & WU_THRESHOLD_OTSU)
+    {
+        ZeroMemory(&histogram, sizeof(WUHISTOGRAM));
+
+        cPixels = (SIZE_T) job.uWidth * job.uHeight;
+
+        for (i = 0; i < cPixels; ++i)
+        {
+            histogram.adwLuma[job.abLuma[i]]++;
+        }
+
+        bLevel = WuOtsuThreshold(histogram.adwLuma);
+    }
+
+    job.bLevel  = bLevel;
+    job.bInvert = (dwFlags & WU_THRESHOLD_INVERT) ? TRUE : FALSE;
+    job.pMask   = WuCreateImageMask(job.uWidth, job.uHeight, dwFlags);
+
+    if ((job.pMask != NULL)
+        && (RunBands(&job, job.uHeight, job.uWidth, ThresholdProc) == FALSE))
+    {
+        WuDestroyImageMask(job.pMask);
+        job.pMask = NULL;
+    }
+
+    HeapFree(GetProcessHeap(), 0, job.abLuma);
+
+    return job.pMask;
+}
+
+/*
+    Box mean over the clamped (2r + 1)^2 window: every band keeps running
+    column sums over its window rows, and a prefix sum of those gives the
+    window sum of any pixel in the row, whatever the radius.
+*/
+static VOID
+AdaptiveProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB    pJob      = (PMASKJOB) pContext;
+    UINT        uWidth    = pJob->uWidth;
+    UINT        uHeight   = pJob->uHeight;
+    UINT        uRadius   = pJob->uRadius;
+    BYTE*       pbScratch = pJob->abScratch + iBand * pJob->cbScratch;
+    ULONGLONG*  aullPrefix = (ULONGLONG*) pbScratch;
+    DWORD*      adwColumns = (DWORD*) (aullPrefix + uWidth + 1);
+    BYTE*       pbValues  = (BYTE*) (adwColumns + uWidth);
+    CONST BYTE* pbLuma    = NULL;
+    LONGLONG    llSum     = 0;
+    LONGLONG    llCount   = 0;
+    UINT        uFirst    = 0;
+    UINT        uLast     = 0;
+    UINT        uTop      = 0;
+    UINT        uBottom   = 0;
+    UINT        uLeft     = 0;
+    UINT        uRight    = 0;
+    UINT        x         = 0;
+    UINT        y         = 0;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    if (uFirst >= uLast)
+    {
+        return;
+    }
+
+    ZeroMemory(adwColumns, uWidth * sizeof(DWORD));
+
+    /* window rows of the first row: [uTop, uBottom) */
+    uTop    = (uFirst > uRadius) ? uFirst - uRadius : 0;
+    uBottom = min(uHeight, uFirst + uRadius + 1);
+
+    for (y = uTop; y < uBottom; ++y)
+    {
+        pbLuma = pJob->abLuma + (SIZE_T) y * uWidth;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            adwColumns[x] += pbLuma[x];
+        }
+    }
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        if (y > uFirst)
+        {
+            if (y > uRadius)
+            {
+                pbLuma = pJob->abLuma + (SIZE_T) (y - uRadius - 1) * uWidth;
+
+                for (x = 0; x < uWidth; ++x)
+                {
+                    adwColumns[x] -= pbLuma[x];
+                }
+
+                uTop = y - uRadius;
+            }
+
+            if (y + uRadius < uHeight)
+            {
+                pbLuma = pJob->abLuma + (SIZE_T) (y + uRadius) * uWidth;
+
+                for (x = 0; x < uWidth; ++x)
+                {
+                    adwColumns[x] += pbLuma[x];
+                }
+
+                uBottom = y + uRadius + 1;
+            }
+        }
+
+        aullPrefix[0] = 0;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            aullPrefix[x + 1] = aullPrefix[x] + adwColumns[x];
+        }
+
+        pbLuma = pJob->abLuma + (SIZE_T) y * uWidth;
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            uLeft  = (x > uRadius) ? x - uRadius : 0;
+            uRight = min(uWidth, x + uRadius + 1);
+
+            llSum   = (LONGLONG) (aullPrefix[uRight] - aullPrefix[uLeft]);
+            llCount = (LONGLONG) (uRight - uLeft) * (uBottom - uTop);
+
+            /* luma > sum / count - offset, without the division */
+            pbValues[x] = (((pbLuma[x] + (LONGLONG) pJob->iOffset) * llCount
+                > llSum) != (pJob->bInvert != FALSE)) ? MASK_SET : 0;
+        }
+
+        _WuStoreMaskRow(pJob->pMask, y, pbValues);
+    }
+}
+
+WUAPI PWUIMAGEMASK
+WuAdaptiveThreshold(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN UINT                 uRadius,
+    IN INT                  iOffset,
+    IN DWORD                dwFlags
+    )
+{
+    MASKJOB job;
+    SIZE_T  cbScratch = 0;
+
+    if (BeginJob(&job, pImageData) == FALSE)
+    {
+        return NULL;
+    }
+
+    job.uRadius = min(uRadius, max(job.uWidth, job.uHeight));
+    job.iOffset = iOffset;
+    job.bInvert = (dwFlags & WU_THRESHOLD_INVERT) ? TRUE : FALSE;
+    job.pMask   = WuCreateImageMask(job.uWidth, job.uHeight, dwFlags);
+
+    cbScratch = ((SIZE_T) job.uWidth + 1) * sizeof(ULONGLONG)
+        + (SIZE_T) job.uWidth * (sizeof(DWORD) + 1);
+
+    if ((job.pMask != NULL)
+        && (RunBands(&job, job.uHeight, cbScratch, AdaptiveProc) == FALSE))
+    {
+        WuDestroyImageMask(job.pMask);
+        job.pMask = NULL;
+    }
+
+    HeapFree(GetProcessHeap(), 0, job.abLuma);
+
+    return job.pMask;
+}
+
+/***************************************************************************
+ *  Morphology
+ ***************************************************************************/
+
+/*
+    van Herk/Gil-Werman: the line, padded by the radius on both sides, is
+    cut into blocks of the window size k. Within each block g holds the
+    running min (erode) or max (dilate) from the block start and h the
+    one from the block end. Any window [i, i + k) covers the end of one
+    block and the start of the next, so its result is op(h[i], g[i + k - 1])
+    in three operations per pixel, whatever k is.
+*/
+static VOID
+CombineRow(
+    OUT BYTE*       pbDst,
+    IN  CONST BYTE* pbA,
+    IN  CONST BYTE* pbB,
+    IN  SIZE_T      cb,
+    IN  BOOL        bDilate
+    )
+{
+    SIZE_T i = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i a, b;
+
+    for (; i + 16 <= cb; i += 16)
+    {
+        a = _mm_loadu_si128((CONST __m128i*) (pbA + i));
+        b = _mm_loadu_si128((CONST __m128i*) (pbB + i));
+
+        _mm_storeu_si128((__m128i*) (pbDst + i),
+            bDilate ? _mm_max_epu8(a, b) : _mm_min_epu8(a, b));
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; i < cb; ++i)
+    {
+        pbDst[i] = bDilate ? max(pbA[i], pbB[i]) : min(pbA[i], pbB[i]);
+    }
+}
+
+static UINT
+GetPaddedLength(
+    IN UINT cLength,
+    IN UINT uRadius
+    )
+{
+    UINT cWindow = 2 * uRadius + 1;
+
+    return ((cLength + 2 * uRadius + cWindow - 1) / cWindow) * cWindow;
+}
+
+static VOID
+MorphRowsProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB pJob     = (PMASKJOB) pContext;
+    UINT     uWidth   = pJob->uWidth;
+    UINT     uRadius  = pJob->uRadius;
+    UINT     cWindow  = 2 * uRadius + 1;
+    UINT     cPadded  = GetPaddedLength(uWidth, uRadius);
+    BYTE*    pbLine   = pJob->abScratch + iBand * pJob->cbScratch;
+    BYTE*    pbG      = pbLine + cPadded;
+    BYTE*    pbH      = pbG + cPadded;
+    BYTE*    pbRow    = NULL;
+    BOOL     bDilate  = pJob->bDilate;
+    BYTE     bEmpty   = bDilate ? 0 : MASK_SET;
+    UINT     uFirst   = 0;
+    UINT     uLast    = 0;
+    UINT     uBlock   = 0;
+    UINT     uEnd     = 0;
+    UINT     i        = 0;
+    UINT     y        = 0;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    for (y = uFirst; y < uLast; ++y)
+    {
+        pbRow = pJob->abPlane + (SIZE_T) y * uWidth;
+
+        /* outside the image is neutral: set for erode, clear for dilate */
+        FillMemory(pbLine, cPadded, bEmpty);
+        CopyMemory(pbLine + uRadius, pbRow, uWidth);
+
+        for (uBlock = 0; uBlock < cPadded; uBlock += cWindow)
+        {
+            uEnd = uBlock + cWindow - 1;
+
+            pbG[uBlock] = pbLine[uBlock];
+            pbH[uEnd]   = pbLine[uEnd];
+
+            for (i = uBlock + 1; i <= uEnd; ++i)
+            {
+                pbG[i] = bDilate ? max(pbG[i - 1], pbLine[i])
+                    : min(pbG[i - 1], pbLine[i]);
+            }
+
+            for (i = uEnd; i-- > uBlock;)
+            {
+                pbH[i] = bDilate ? max(pbH[i + 1], pbLine[i])
+                    : min(pbH[i + 1], pbLine[i]);
+            }
+        }
+
+        CombineRow(pbRow, pbH, pbG + cWindow - 1, uWidth, bDilate);
+    }
+}
+
+/* The same along columns, with whole row segments as the elements */
+static VOID
+MorphColumnsProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PMASKJOB pJob     = (PMASKJOB) pContext;
+    UINT     uWidth   = pJob->uWidth;
+    UINT     uRadius  = pJob->uRadius;
+    UINT     cWindow  = 2 * uRadius + 1;
+    UINT     cPadded  = GetPaddedLength(pJob->uHeight, uRadius);
+    UINT     uFirst   = 0;
+    UINT     uLast    = 0;
+    UINT     cb       = 0;
+    BYTE*    pbEmpty  = pJob->abScratch + iBand * pJob->cbScratch;
+    BYTE*    pbG      = pbEmpty + pJob->cLinesPerBand;
+    BYTE*    pbH      = pbG + (SIZE_T) cPadded * pJob->cLinesPerBand;
+    BOOL     bDilate  = pJob->bDilate;
+    UINT     i        = 0;
+
+    CONST BYTE* pbLine = NULL;
+
+    GetBandLines(pJob, iBand, &uFirst, &uLast);
+
+    if (uFirst >= uLast)
+    {
+        return;
+    }
+
+    cb = uLast - uFirst;
+
+    FillMemory(pbEmpty, cb, bDilate ? 0 : MASK_SET);
+
+    for (i = 0; i < cPadded; ++i)
+    {
+        pbLine = ((i < uRadius) || (i >= uRadius + pJob->uHeight))
+            ? pbEmpty
+            : pJob->abPlane + (SIZE_T) (i - uRadius) * uWidth + uFirst;
+
+        if ((i % cWindow) == 0)
+        {
+            CopyMemory(pbG + (SIZE_T) i * cb, pbLine, cb);
+        }
+        else
+        {
+            CombineRow(pbG + (SIZE_T) i * cb, pbG + (SIZE_T) (i - 1) * cb,
+                pbLine, cb, bDilate);
+        }
+    }
+
+    for (i = cPadded; i-- > 0;)
+    {
+        pbLine = ((i < uRadius) || (i >= uRadius + pJob->uHeight))
+            ? pbEmpty
+            : pJob->abPlane + (SIZE_T) (i - uRadius) * uWidth + uFirst;
+
+        if ((i % cWindow) == cWindow - 1)
+        {
+            CopyMemory(pbH + (SIZE_T) i * cb, pbLine, cb);
+        }
+        else
+        {
+            CombineRow(pbH + (SIZE_T) i * cb, pbH + (SIZE_T) (i + 1) * cb,
+                pbLine, cb, bDilate);
+        }
+    }
+
+    for (i = 0; i < pJob->uHeight; ++i)
+    {
+        CombineRow(
+            pJob->abPlane + (SIZE_T) i * uWidth + uFirst,
+            pbH + (SIZE_T) i * cb,
+            pbG + (SIZE_T) (i + cWindow - 1) * cb,
+            cb,
+            bDilate);
+    }
+}
+
+static BOOL
+MorphPlane(
+    IN PMASKJOB pJob,
+    IN BOOL     bDilate,
+    IN UINT     uRadiusX,
+    IN UINT     uRadiusY
+    )
+{
+    UINT   cPadded   = 0;
+    UINT   cColumns  = 0;
+    SIZE_T cbScratch = 0;
+
+    pJob->bDilate = bDilate;
+
+    if (uRadiusX != 0)
+    {
+        pJob->uRadius = uRadiusX;
+        cPadded       = GetPaddedLength(pJob->uWidth, uRadiusX);
+
+        if (RunBands(pJob, pJob->uHeight, (SIZE_T) cPadded * 3,
+                MorphRowsProc) == FALSE)
+        {
+            return FALSE;
+        }
+    }
+
+    if (uRadiusY != 0)
+    {
+        pJob->uRadius = uRadiusY;
+        cPadded       = GetPaddedLength(pJob->uHeight, uRadiusY);
+
+        /* a neutral row and the g and h columns of the band */
+        cColumns  = GetLinesPerBand(pJob->uWidth);
+        cbScratch = (SIZE_T) cColumns * (1 + 2 * (SIZE_T) cPadded);
+
+        if (RunBands(pJob, pJob->uWidth, cbScratch,
+                MorphColumnsProc) == FALSE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuMorphImageMask(
+    IN OUT PWUIMAGEMASK         pMask,
+    IN     WU_MORPH_OPERATION   operation,
+    IN     UINT                 uRadiusX,
+    IN     UINT                 uRadiusY
+    )
+{
+    MASKJOB job;
+    BOOL    bPacked = FALSE;
+    BOOL    bResult = FALSE;
+    UINT    y       = 0;
+
+    if ((NULL == pMask) || (NULL == pMask->abData))
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(&job, sizeof(MASKJOB));
+
+    job.uWidth  = pMask->uWidth;
+    job.uHeight = pMask->uHeight;
+
+    /* beyond the image size every window is already the whole line */
+    uRadiusX = min(uRadiusX, job.uWidth);
+    uRadiusY = min(uRadiusY, job.uHeight);
+
+    bPacked = (pMask->dwFlags & WU_MASK_PACKED) ? TRUE : FALSE;
+
+    if (TRUE == bPacked)
+    {
+        job.abPlane = HeapAlloc(
+            GetProcessHeap(),
+            0,
+            (SIZE_T) job.uWidth * job.uHeight);
+
+        if (NULL == job.abPlane)
+        {
+            return FALSE;
+        }
+
+        for (y = 0; y < job.uHeight; ++y)
+        {
+            _WuLoadMaskRow(pMask, y, job.abPlane + (SIZE_T) y * job.uWidth);
+        }
+    }
+    else
+    {
+        job.abPlane = pMask->abData;
+    }
+
+    switch (operation)
+    {
+        case WU_MORPH_ERODE:
+            bResult = MorphPlane(&job, FALSE, uRadiusX, uRadiusY);
+            break;
+
+        case WU_MORPH_DILATE:
+            bResult = MorphPlane(&job, TRUE, uRadiusX, uRadiusY);
+            break;
+
+        case WU_MORPH_OPEN:
+            bResult = MorphPlane(&job, FALSE, uRadiusX, uRadiusY)
+                && MorphPlane(&job, TRUE, uRadiusX, uRadiusY);
+            break;
+
+        case WU_MORPH_CLOSE:
+            bResult = MorphPlane(&job, TRUE, uRadiusX, uRadiusY)
+                && MorphPlane(&job, FALSE, uRadiusX, uRadiusY);
+            break;
+
+        default:
+            bResult = FALSE;
+            break;
+    }
+
+    if (TRUE == bPacked)
+    {
+        if (TRUE == bResult)
+        {
+            for (y = 0; y < job.uHeight; ++y)
+            {
+                _WuStoreMaskRow(pMask, y,
+                    job.abPlane + (SIZE_T) y * job.uWidth);
+            }
+        }
+
+        HeapFree(GetProcessHeap(), 0, job.abPlane);
+    }
+
+    return bResult;
+}
@@ -0,0 +1,150 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       parallel.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+/*
+    Items are claimed one at a time from a shared counter, by the calling
+    thread and by up to (processors - 1) system thread pool workers. The
+    caller always takes part, so the loop completes even if the pool is
+    slow to start the workers; it only waits for the workers that did
+    start before the job (which lives on its stack) goes away.
+*/
+typedef struct tagPARALLELJOB {
+    WUPARALLELPROC  pfnProc;
+    LPVOID          pContext;
+    LONG            cItems;
+    LONG volatile   iNextItem;
+    LONG volatile   cActive;        /* caller + queued workers */
+    HANDLE          hDoneEvent;
+} PARALLELJOB, *PPARALLELJOB;
+
+static LONG volatile g_cProcessors = 0;
+
+static VOID
+RunItems(
+    IN PPARALLELJOB pJob
+    )
+{
+    LONG iItem = 0;
+
+    for (;;)
+    {
+        iItem = InterlockedIncrement(&pJob->iNextItem) - 1;
+
+        if (iItem >= pJob->cItems)
+        {
+            break;
+        }
+
+        pJob->pfnProc((UINT) iItem, pJob->pContext);
+    }
+}
+
+static DWORD WINAPI
+WorkerProc(
+    IN LPVOID   lpParameter
+    )
+{
+    PPARALLELJOB pJob       = (PPARALLELJOB) lpParameter;
+    HANDLE       hDoneEvent = pJob->hDoneEvent;
+
+    RunItems(pJob);
+
+    /* pJob may be gone as soon as the count reaches zero */
+    if (InterlockedDecrement(&pJob->cActive) == 0)
+    {
+        SetEvent(hDoneEvent);
+    }
+
+    return 0;
+}
+
+UINT
+_WuGetProcessorCount(
+    VOID
+    )
+{
+    SYSTEM_INFO systemInfo;
+
+    if (0 == g_cProcessors)
+    {
+        ZeroMemory(&systemInfo, sizeof(SYSTEM_INFO));
+        GetSystemInfo(&systemInfo);
+
+        InterlockedExchange(
+            &g_cProcessors,
+            (LONG) max(1, systemInfo.dwNumberOfProcessors));
+    }
+
+    return (UINT) g_cProcessors;
+}
+
+VOID
+_WuParallelFor(
+    IN UINT             cItems,
+    IN WUPARALLELPROC   pfnProc,
+    IN LPVOID           pContext
+    )
+{
+    PARALLELJOB job;
+    UINT        cWorkers = 0;
+    UINT        i        = 0;
+
+    if ((0 == cItems) || (NULL == pfnProc))
+    {
+        return;
+    }
+
+    ZeroMemory(&job, sizeof(PARALLELJOB));
+
+    job.pfnProc  = pfnProc;
+    job.pContext = pContext;
+    job.cItems   = (LONG) min(cItems, MAXLONG);
+    job.cActive  = 1;
+
+    cWorkers = min(cItems, _WuGetProcessorCount()) - 1;
+
+    if (cWorkers > 0)
+    {
+        job.hDoneEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    }
+
+    /* without an event nothing can be waited for: run everything inline */
+    if (job.hDoneEvent != NULL)
+    {
+        for (i = 0; i < cWorkers; ++i)
+        {
+            InterlockedIncrement(&job.cActive);
+
+            if (QueueUserWorkItem(WorkerProc, &job,
+                    WT_EXECUTEDEFAULT) == FALSE)
+            {
+                InterlockedDecrement(&job.cActive);
+                break;
+            }
+        }
+    }
+
+    RunItems(&job);
+
+    if (job.hDoneEvent != NULL)
+    {
+        if (InterlockedDecrement(&job.cActive) != 0)
+        {
+            WaitForSingleObject(job.hDoneEvent, INFINITE);
+        }
+
+        CloseHandle(job.hDoneEvent);
+    }
+}
@@ -0,0 +1,878 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       pipeline.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define TILE_SIZE           128
+
+#define BAYER_SIZE          4
+
+#define MAX_BLUR_RADIUS     1024
+
+typedef enum {
+    STAGE_SOURCE,
+    STAGE_POINT,
+    STAGE_BOX_BLUR,
+    STAGE_RESIZE
+} STAGE_KIND;
+
+typedef enum {
+    POINT_OP_GRAYSCALE,
+    POINT_OP_INVERT,
+    POINT_OP_DITHER,
+    POINT_OP_CUSTOM
+} POINT_OP;
+
+typedef struct tagPIPELINESTAGE {
+    STAGE_KIND          kind;
+    UINT                uWidth;         /* size of the stage output */
+    UINT                uHeight;
+    POINT_OP            pointOp;
+    WU_LUMA_STANDARD    standard;
+    DWORD               dwFlags;
+    UINT                uRadius;
+    WUPIXELROWPROC      pfnPixelRowProc;
+    LPVOID              pUserData;
+    BYTE*               abScratch;      /* halo / resampling input */
+    SIZE_T              cbScratch;
+} PIPELINESTAGE, *PPIPELINESTAGE;
+
+/*
+    Stage 0 is the source. Nothing is computed until WuExecuteImagePipeline,
+    which walks the output tile by tile and pulls every tile through the
+    stages: runs of point operations are applied row by row on the same
+    buffer, neighbourhood stages fetch their input tile plus a halo into a
+    per-stage scratch buffer. The output image is the only full-size
+    allocation.
+*/
+struct tagWUIMAGEPIPELINE {
+    PWUIMAGEDATA    pSource;
+    UINT            cStages;
+    PIPELINESTAGE   aStages[WU_IMAGE_PIPELINE_MAX_STAGES];
+};
+
+typedef struct tagSAMPLE {
+    UINT    uIndex;     /* relative to the fetched input region */
+    UINT    uFrac;      /* weight of uIndex + 1, 0..256 */
+} SAMPLE;
+
+static CONST BYTE g_aBayerMatrix[BAYER_SIZE][BAYER_SIZE] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+static BOOL
+EvaluateStage(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             iStage,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    );
+
+static BYTE*
+ReserveScratch(
+    IN PPIPELINESTAGE   pStage,
+    IN SIZE_T           cbScratch
+    )
+{
+    if (pStage->cbScratch >= cbScratch)
+    {
+        return pStage->abScratch;
+    }
+
+    if (pStage->abScratch != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pStage->abScratch);
+    }
+
+    pStage->abScratch = HeapAlloc(GetProcessHeap(), 0, cbScratch);
+    pStage->cbScratch = (NULL == pStage->abScratch) ? 0 : cbScratch;
+
+    return pStage->abScratch;
+}
+
+static VOID
+FreeScratch(
+    IN PWUIMAGEPIPELINE pPipeline
+    )
+{
+    UINT i = 0;
+
+    for (i = 0; i < pPipeline->cStages; ++i)
+    {
+        if (pPipeline->aStages[i].abScratch != NULL)
+        {
+            HeapFree(GetProcessHeap(), 0, pPipeline->aStages[i].abScratch);
+        }
+
+        pPipeline->aStages[i].abScratch = NULL;
+        pPipeline->aStages[i].cbScratch = 0;
+    }
+}
+
+static VOID
+InvertRow(
+    IN OUT BYTE*    pbRow,
+    IN     UINT     cPixels
+    )
+{
+    UINT x = 0;
+
+    for (x = 0; x < cPixels; ++x, pbRow += 4)
+    {
+        pbRow[0] = (BYTE) (255 - pbRow[0]);
+        pbRow[1] = (BYTE) (255 - pbRow[1]);
+        pbRow[2] = (BYTE) (255 - pbRow[2]);
+    }
+}
+
+/* Ordered dither of every color channel down to 0 / 255 */
+static VOID
+DitherRow(
+    IN OUT BYTE*    pbRow,
+    IN     UINT     cPixels,
+    IN     UINT     uX,
+    IN     UINT     uY
+    )
+{
+    CONST BYTE* abThresholds = g_aBayerMatrix[uY % BAYER_SIZE];
+    UINT        uThreshold   = 0;
+    UINT        x            = 0;
+
+    for (x = 0; x < cPixels; ++x, pbRow += 4)
+    {
+        uThreshold = abThresholds[(uX + x) % BAYER_SIZE] * 16 + 8;
+
+        pbRow[0] = (pbRow[0] >= uThreshold) ? 255 : 0;
+        pbRow[1] = (pbRow[1] >= uThreshold) ? 255 : 0;
+        pbRow[2] = (pbRow[2] >= uThreshold) ? 255 : 0;
+    }
+}
+
+static VOID
+ApplyPointStage(
+    IN     PPIPELINESTAGE   pStage,
+    IN OUT BYTE*            pbRow,
+    IN     UINT             cPixels,
+    IN     UINT             uX,
+    IN     UINT             uY
+    )
+{
+    switch (pStage->pointOp)
+    {
+        case POINT_OP_GRAYSCALE:
+            _WuGrayscaleRow(pbRow, cPixels, pStage->standard, pStage->dwFlags);
+            break;
+
+        case POINT_OP_INVERT:
+            InvertRow(pbRow, cPixels);
+            break;
+
+        case POINT_OP_DITHER:
+            DitherRow(pbRow, cPixels, uX, uY);
+            break;
+
+        case POINT_OP_CUSTOM:
+            pStage->pfnPixelRowProc(pbRow, cPixels, uX, uY, pStage->pUserData);
+            break;
+    }
+}
+
+static BOOL
+EvaluateSource(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    )
+{
+    PWUIMAGEDATA pSource = pPipeline->pSource;
+    SIZE_T       cbRow   = 0;
+    UINT         y       = 0;
+
+    cbRow = (SIZE_T) uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        CopyMemory(
+            pbDst + y * cbDstStride,
+            pSource->abData + ((SIZE_T) (uY + y) * pSource->uWidth + uX)
+                * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            cbRow);
+    }
+
+    return TRUE;
+}
+
+/* All consecutive point stages ending at iStage run in one pass */
+static BOOL
+EvaluatePointRun(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             iStage,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    )
+{
+    UINT iFirst = iStage;
+    UINT i      = 0;
+    UINT y      = 0;
+
+    while (STAGE_POINT == pPipeline->aStages[iFirst - 1].kind)
+    {
+        --iFirst;
+    }
+
+    if (EvaluateStage(pPipeline, iFirst - 1, uX, uY, uWidth, uHeight,
+            pbDst, cbDstStride) == FALSE)
+    {
+        return FALSE;
+    }
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        for (i = iFirst; i <= iStage; ++i)
+        {
+            ApplyPointStage(
+                &pPipeline->aStages[i],
+                pbDst + y * cbDstStride,
+                uWidth,
+                uX,
+                uY + y);
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+    Separable box blur, edges are clamped. The input region is the output
+    rect grown by the radius and clipped to the input image, so clamping
+    inside the region is the same as clamping to the image.
+*/
+static BOOL
+EvaluateBoxBlur(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             iStage,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    )
+{
+    PPIPELINESTAGE pStage    = &pPipeline->aStages[iStage];
+    UINT           uRadius   = pStage->uRadius;
+    UINT           uInLeft   = 0;
+    UINT           uInTop    = 0;
+    UINT           uInRight  = 0;
+    UINT           uInBottom = 0;
+    UINT           cInWidth  = 0;
+    UINT           cInHeight = 0;
+    UINT           uArea     = (2 * uRadius + 1) * (2 * uRadius + 1);
+    SIZE_T         cbInput   = 0;
+    BYTE*          abInput   = NULL;
+    DWORD*         adwRows   = NULL;
+    DWORD*         pdwRow    = NULL;
+    DWORD          adwSum[4];
+    CONST BYTE*    pbIn      = NULL;
+    BYTE*          pbOut     = NULL;
+    INT            iFirst    = 0;
+    INT            iLast     = 0;
+    INT            iLimit    = 0;
+    UINT           x         = 0;
+    UINT           y         = 0;
+    UINT           c         = 0;
+    INT            k         = 0;
+
+    uInLeft   = (uX > uRadius) ? uX - uRadius : 0;
+    uInTop    = (uY > uRadius) ? uY - uRadius : 0;
+    uInRight  = min(uX + uWidth + uRadius,
+        pPipeline->aStages[iStage - 1].uWidth);
+    uInBottom = min(uY + uHeight + uRadius,
+        pPipeline->aStages[iStage - 1].uHeight);
+
+    cInWidth  = uInRight - uInLeft;
+    cInHeight = uInBottom - uInTop;
+
+    cbInput = (SIZE_T) cInWidth * cInHeight * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    abInput = ReserveScratch(
+        pStage,
+        cbInput + (SIZE_T) uWidth * cInHeight * 4 * sizeof(DWORD));
+
+    if (NULL == abInput)
+    {
+        return FALSE;
+    }
+
+    adwRows = (DWORD*) (abInput + cbInput);
+
+    if (EvaluateStage(pPipeline, iStage - 1, uInLeft, uInTop, cInWidth,
+            cInHeight, abInput,
+            (SIZE_T) cInWidth * WU_IMAGEDATA_BYTES_PER_PIXEL) == FALSE)
+    {
+        return FALSE;
+    }
+
+    /* horizontal pass: running sums over clamped columns */
+    iLimit = (INT) cInWidth - 1;
+
+    for (y = 0; y < cInHeight; ++y)
+    {
+        pbIn   = abInput + (SIZE_T) y * cInWidth * 4;
+        pdwRow = adwRows + (SIZE_T) y * uWidth * 4;
+
+        for (c = 0; c < 4; ++c)
+        {
+            adwSum[c] = 0;
+
+            for (k = -(INT) uRadius; k <= (INT) uRadius; ++k)
+            {
+                iFirst = (INT) (uX - uInLeft) + k;
+                iFirst = max(0, min(iFirst, iLimit));
+
+                adwSum[c] += pbIn[iFirst * 4 + c];
+            }
+        }
+
+        for (x = 0; x < uWidth; ++x)
+        {
+            for (c = 0; c < 4; ++c)
+            {
+                pdwRow[x * 4 + c] = adwSum[c];
+            }
+
+            iFirst = (INT) (uX - uInLeft + x) - (INT) uRadius;
+            iLast  = (INT) (uX - uInLeft + x) + (INT) uRadius + 1;
+            iFirst = max(0, min(iFirst, iLimit));
+            iLast  = max(0, min(iLast, iLimit));
+
+            for (c = 0; c < 4; ++c)
+            {
+                adwSum[c] += pbIn[iLast * 4 + c];
+                adwSum[c] -= pbIn[iFirst * 4 + c];
+            }
+        }
+    }
+
+    /* vertical pass, one column at a time over the horizontal sums */
+    iLimit = (INT) cInHeight - 1;
+
+    for (x = 0; x < uWidth; ++x)
+    {
+        for (c = 0; c < 4; ++c)
+        {
+            adwSum[c] = 0;
+
+            for (k = -(INT) uRadius; k <= (INT) uRadius; ++k)
+            {
+                iFirst = (INT) (uY - uInTop) + k;
+                iFirst = max(0, min(iFirst, iLimit));
+
+                adwSum[c] += adwRows[((SIZE_T) iFirst * uWidth + x) * 4 + c];
+            }
+        }
+
+        for (y = 0; y < uHeight; ++y)
+        {
+            pbOut = pbDst + y * cbDstStride + x * 4;
+
+            for (c = 0; c < 4; ++c)
+            {
+                pbOut[c] = (BYTE) ((adwSum[c] + uArea / 2) / uArea);
+            }
+
+            iFirst = (INT) (uY - uInTop + y) - (INT) uRadius;
+            iLast  = (INT) (uY - uInTop + y) + (INT) uRadius + 1;
+            iFirst = max(0, min(iFirst, iLimit));
+            iLast  = max(0, min(iLast, iLimit));
+
+            for (c = 0; c < 4; ++c)
+            {
+                adwSum[c] += adwRows[((SIZE_T) iLast * uWidth + x) * 4 + c];
+                adwSum[c] -= adwRows[((SIZE_T) iFirst * uWidth + x) * 4 + c];
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/* Pixel-center aligned bilinear source position, clamped to the edges */
+static VOID
+MapSample(
+    IN  UINT    uOut,
+    IN  UINT    cOut,
+    IN  UINT    cIn,
+    OUT SAMPLE* pSample
+    )
+{
+    LONGLONG llPos = 0;     /* 24.8 */
+
+    llPos = (LONGLONG) ((((ULONGLONG) uOut * 2 + 1) * cIn << 8)
+        / ((ULONGLONG) cOut * 2)) - 128;
+
+    if (llPos <= 0)
+    {
+        pSample->uIndex = 0;
+        pSample->uFrac  = 0;
+    }
+    else if ((llPos >> 8) >= (LONGLONG) cIn - 1)
+    {
+        pSample->uIndex = cIn - 1;
+        pSample->uFrac  = 0;
+    }
+    else
+    {
+        pSample->uIndex = (UINT) (llPos >> 8);
+        pSample->uFrac  = (UINT) (llPos & 0xFF);
+    }
+}
+
+static BOOL
+EvaluateResize(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             iStage,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    )
+{
+    PPIPELINESTAGE pStage     = &pPipeline->aStages[iStage];
+    UINT           cSrcWidth  = pPipeline->aStages[iStage - 1].uWidth;
+    UINT           cSrcHeight = pPipeline->aStages[iStage - 1].uHeight;
+    SAMPLE         first;
+    SAMPLE         last;
+    SAMPLE         sampleY;
+    SAMPLE*        aSamplesX  = NULL;
+    UINT           uInLeft    = 0;
+    UINT           uInTop     = 0;
+    UINT           cInWidth   = 0;
+    UINT           cInHeight  = 0;
+    SIZE_T         cbInput    = 0;
+    BYTE*          abInput    = NULL;
+    CONST BYTE*    pbRow0     = NULL;
+    CONST BYTE*    pbRow1     = NULL;
+    CONST BYTE*    pb00       = NULL;
+    CONST BYTE*    pb01       = NULL;
+    CONST BYTE*    pb10       = NULL;
+    CONST BYTE*    pb11       = NULL;
+    BYTE*          pbOut      = NULL;
+    UINT           uFracX     = 0;
+    UINT           uTop       = 0;
+    UINT           uBottom    = 0;
+    UINT           uNext      = 0;
+    UINT           x          = 0;
+    UINT           y          = 0;
+    UINT           c          = 0;
+
+    /* the mapping is monotonic, so the end samples bound the input */
+    MapSample(uX, pStage->uWidth, cSrcWidth, &first);
+    MapSample(uX + uWidth - 1, pStage->uWidth, cSrcWidth, &last);
+
+    uInLeft  = first.uIndex;
+    cInWidth = min(last.uIndex + 2, cSrcWidth) - uInLeft;
+
+    MapSample(uY, pStage->uHeight, cSrcHeight, &first);
+    MapSample(uY + uHeight - 1, pStage->uHeight, cSrcHeight, &last);
+
+    uInTop    = first.uIndex;
+    cInHeight = min(last.uIndex + 2, cSrcHeight) - uInTop;
+
+    cbInput = (SIZE_T) cInWidth * cInHeight * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    abInput = ReserveScratch(pStage, cbInput + uWidth * sizeof(SAMPLE));
+
+    if (NULL == abInput)
+    {
+        return FALSE;
+    }
+
+    aSamplesX = (SAMPLE*) (abInput + cbInput);
+
+    for (x = 0; x < uWidth; ++x)
+    {
+        MapSample(uX + x, pStage->uWidth, cSrcWidth, &aSamplesX[x]);
+        aSamplesX[x].uIndex -= uInLeft;
+    }
+
+    if (EvaluateStage(pPipeline, iStage - 1, uInLeft, uInTop, cInWidth,
+            cInHeight, abInput,
+            (SIZE_T) cInWidth * WU_IMAGEDATA_BYTES_PER_PIXEL) == FALSE)
+    {
+        return FALSE;
+    }
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        MapSample(uY + y, pStage->uHeight, cSrcHeight, &sampleY);
+
+        uTop    = sampleY.uIndex - uInTop;
+        uBottom = min(uTop + 1, cInHeight - 1);
+
+        pbRow0 = abInput + (SIZE_T) uTop * cInWidth * 4;
+        pbRow1 = abInput + (SIZE_T) uBottom * cInWidth * 4;
+        pbOut  = pbDst + y * cbDstStride;
+
+        for (x = 0; x < uWidth; ++x, pbOut += 4)
+        {
+            uFracX = aSamplesX[x].uFrac;
+            uNext  = min(aSamplesX[x].uIndex + 1, cInWidth - 1);
+
+            pb00 = pbRow0 + aSamplesX[x].uIndex * 4;
+            pb01 = pbRow0 + uNext * 4;
+            pb10 = pbRow1 + aSamplesX[x].uIndex * 4;
+            pb11 = pbRow1 + uNext * 4;
+
+            for (c = 0; c < 4; ++c)
+            {
+                pbOut[c] = (BYTE) ((
+                    ((pb00[c] * (256 - uFracX) + pb01[c] * uFracX)
+                        * (256 - sampleY.uFrac))
+                    + ((pb10[c] * (256 - uFracX) + pb11[c] * uFracX)
+                        * sampleY.uFrac)
+                    + (1 << 15)) >> 16);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+EvaluateStage(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             iStage,
+    IN UINT             uX,
+    IN UINT             uY,
+    IN UINT             uWidth,
+    IN UINT             uHeight,
+    IN BYTE*            pbDst,
+    IN SIZE_T           cbDstStride
+    )
+{
+    switch (pPipeline->aStages[iStage].kind)
+    {
+        case STAGE_SOURCE:
+            return EvaluateSource(pPipeline, uX, uY, uWidth, uHeight,
+                pbDst, cbDstStride);
+
+        case STAGE_POINT:
+            return EvaluatePointRun(pPipeline, iStage, uX, uY, uWidth,
+                uHeight, pbDst, cbDstStride);
+
+        case STAGE_BOX_BLUR:
+            return EvaluateBoxBlur(pPipeline, iStage, uX, uY, uWidth,
+                uHeight, pbDst, cbDstStride);
+
+        case STAGE_RESIZE:
+            return EvaluateResize(pPipeline, iStage, uX, uY, uWidth,
+                uHeight, pbDst, cbDstStride);
+    }
+
+    return FALSE;
+}
+
+static PPIPELINESTAGE
+AppendStage(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN STAGE_KIND       kind
+    )
+{
+    PPIPELINESTAGE pStage = NULL;
+
+    if (NULL == pPipeline)
+    {
+        return NULL;
+    }
+
+    if (pPipeline->cStages >= WU_IMAGE_PIPELINE_MAX_STAGES)
+    {
+        return NULL;
+    }
+
+    pStage = &pPipeline->aStages[pPipeline->cStages++];
+
+    ZeroMemory(pStage, sizeof(PIPELINESTAGE));
+
+    pStage->kind    = kind;
+    pStage->uWidth  = pPipeline->aStages[pPipeline->cStages - 2].uWidth;
+    pStage->uHeight = pPipeline->aStages[pPipeline->cStages - 2].uHeight;
+
+    return pStage;
+}
+
+WUAPI PWUIMAGEPIPELINE
+WuCreateImagePipeline(
+    IN CONST PWUIMAGEDATA   pSource
+    )
+{
+    PWUIMAGEPIPELINE pPipeline = NULL;
+
+    if ((NULL == pSource) || (NULL == pSource->abData))
+    {
+        return NULL;
+    }
+
+    if ((0 == pSource->uWidth) || (0 == pSource->uHeight))
+    {
+        return NULL;
+    }
+
+    pPipeline = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUIMAGEPIPELINE));
+
+    if (NULL == pPipeline)
+    {
+        return NULL;
+    }
+
+    pPipeline->pSource = pSource;
+    pPipeline->cStages = 1;
+
+    pPipeline->aStages[0].kind    = STAGE_SOURCE;
+    pPipeline->aStages[0].uWidth  = pSource->uWidth;
+    pPipeline->aStages[0].uHeight = pSource->uHeight;
+
+    return pPipeline;
+}
+
+WUAPI BOOL
+WuPipelineResize(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             uWidth,
+    IN UINT             uHeight
+    )
+{
+    PPIPELINESTAGE pStage = NULL;
+
+    if ((0 == uWidth) || (0 == uHeight))
+    {
+        return FALSE;
+    }
+
+    pStage = AppendStage(pPipeline, STAGE_RESIZE);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->uWidth  = uWidth;
+    pStage->uHeight = uHeight;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuPipelineBoxBlur(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN UINT             uRadius
+    )
+{
+    PPIPELINESTAGE pStage = NULL;
+
+    if ((0 == uRadius) || (uRadius > MAX_BLUR_RADIUS))
+    {
+        return FALSE;
+    }
+
+    pStage = AppendStage(pPipeline, STAGE_BOX_BLUR);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->uRadius = uRadius;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuPipelineGrayscale(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN WU_LUMA_STANDARD standard,
+    IN DWORD            dwFlags
+    )
+{
+    PPIPELINESTAGE pStage = NULL;
+
+    if ((standard != WU_LUMA_BT601) && (standard != WU_LUMA_BT709))
+    {
+        return FALSE;
+    }
+
+    pStage = AppendStage(pPipeline, STAGE_POINT);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->pointOp  = POINT_OP_GRAYSCALE;
+    pStage->standard = standard;
+    pStage->dwFlags  = dwFlags;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuPipelineInvert(
+    IN PWUIMAGEPIPELINE pPipeline
+    )
+{
+    PPIPELINESTAGE pStage = AppendStage(pPipeline, STAGE_POINT);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->pointOp = POINT_OP_INVERT;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuPipelineDither(
+    IN PWUIMAGEPIPELINE pPipeline
+    )
+{
+    PPIPELINESTAGE pStage = AppendStage(pPipeline, STAGE_POINT);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->pointOp = POINT_OP_DITHER;
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuPipelinePixelRowProc(
+    IN PWUIMAGEPIPELINE pPipeline,
+    IN WUPIXELROWPROC   fnPixelRowProc,
+    IN LPVOID           pUserData
+    )
+{
+    PPIPELINESTAGE pStage = NULL;
+
+    if (NULL == fnPixelRowProc)
+    {
+        return FALSE;
+    }
+
+    pStage = AppendStage(pPipeline, STAGE_POINT);
+
+    if (NULL == pStage)
+    {
+        return FALSE;
+    }
+
+    pStage->pointOp         = POINT_OP_CUSTOM;
+    pStage->pfnPixelRowProc = fnPixelRowProc;
+    pStage->pUserData       = pUserData;
+
+    return TRUE;
+}
+
+WUAPI PWUIMAGEDATA
+WuExecuteImagePipeline(
+    IN PWUIMAGEPIPELINE pPipeline
+    )
+{
+    PWUIMAGEDATA   pOutput = NULL;
+    PPIPELINESTAGE pLast   = NULL;
+    SIZE_T         cbRow   = 0;
+    UINT           uX      = 0;
+    UINT           uY      = 0;
+
+    if (NULL == pPipeline)
+    {
+        return NULL;
+    }
+
+    pLast = &pPipeline->aStages[pPipeline->cStages - 1];
+
+    pOutput = _WuCreateUninitializedImageData(pLast->uWidth, pLast->uHeight);
+
+    if (NULL == pOutput)
+    {
+        return NULL;
+    }
+
+    cbRow = (SIZE_T) pOutput->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    for (uY = 0; uY < pOutput->uHeight; uY += TILE_SIZE)
+    {
+        for (uX = 0; uX < pOutput->uWidth; uX += TILE_SIZE)
+        {
+            if (EvaluateStage(
+                    pPipeline,
+                    pPipeline->cStages - 1,
+                    uX, uY,
+                    min(TILE_SIZE, pOutput->uWidth - uX),
+                    min(TILE_SIZE, pOutput->uHeight - uY),
+                    pOutput->abData + uY * cbRow
+                        + (SIZE_T) uX * WU_IMAGEDATA_BYTES_PER_PIXEL,
+                    cbRow) == FALSE)
+            {
+                WuDestroyImageData(pOutput);
+                pOutput = NULL;
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    FreeScratch(pPipeline);
+
+    return pOutput;
+}
+
+WUAPI VOID
+WuDestroyImagePipeline(
+    IN PWUIMAGEPIPELINE pPipeline
+    )
+{
+    if (NULL == pPipeline)
+    {
+        return;
+    }
+
+    FreeScratch(pPipeline);
+
+    HeapFree(GetProcessHeap(), 0, pPipeline);
+}
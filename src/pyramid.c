@@ -0,0 +1,538 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       pyramid.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <math.h>
+
+#include "internal.h"
+
+#define PYRAMID_FILTER_MAX  2
+
+/*
+    Kaiser-windowed sinc for 2:1 decimation. Output pixel x covers source
+    pixels 2x and 2x + 1, the taps reach KAISER_TAPS / 2 pixels further on
+    each side: 2x - 2 ... 2x + 3.
+*/
+#define KAISER_TAPS     6
+#define KAISER_BETA     4.0
+
+typedef struct tagPYRAMIDBUILDER {
+    PWUIMAGEPYRAMID     pPyramid;
+    WU_PYRAMID_FILTER   filter;
+    BOOL                bLinear;
+    FLOAT               afKaiser[KAISER_TAPS];
+    UINT                auNextRow[WU_IMAGE_PYRAMID_MAX_LEVELS];
+    BYTE*               pbScratch;
+} PYRAMIDBUILDER, *PPYRAMIDBUILDER;
+
+static UINT
+HalveDimension(
+    IN UINT uDimension
+    )
+{
+    return (uDimension + 1) / 2;
+}
+
+static UINT
+ClampIndex(
+    IN INT  iIndex,
+    IN UINT uCount
+    )
+{
+    if (iIndex < 0)
+    {
+        return 0;
+    }
+
+    return ((UINT) iIndex >= uCount) ? uCount - 1 : (UINT) iIndex;
+}
+
+/* Modified Bessel function of the first kind, order 0 (power series) */
+static DOUBLE
+BesselI0(
+    IN DOUBLE   dbX
+    )
+{
+    DOUBLE dbSum  = 1.0;
+    DOUBLE dbTerm = 1.0;
+    INT    k      = 0;
+
+    for (k = 1; k < 32; ++k)
+    {
+        dbTerm *= (dbX / (2.0 * k)) * (dbX / (2.0 * k));
+        dbSum  += dbTerm;
+    }
+
+    return dbSum;
+}
+
+static VOID
+ComputeKaiserWeights(
+    OUT FLOAT   afWeights[KAISER_TAPS]
+    )
+{
+    CONST DOUBLE dbPi       = 3.14159265358979323846;
+    DOUBLE       adbWeights[KAISER_TAPS];
+    DOUBLE       dbSum      = 0.0;
+    DOUBLE       dbOffset   = 0.0;
+    DOUBLE       dbArgument = 0.0;
+    DOUBLE       dbWindow   = 0.0;
+    INT          i          = 0;
+
+    for (i = 0; i < KAISER_TAPS; ++i)
+    {
+        /* distance from the output sample center, in source pixels */
+        dbOffset   = (i - KAISER_TAPS / 2) + 0.5;
+        dbArgument = dbPi * dbOffset / 2.0;
+
+        dbWindow = dbOffset / (KAISER_TAPS / 2);
+        dbWindow = BesselI0(KAISER_BETA * sqrt(1.0 - dbWindow * dbWindow))
+            / BesselI0(KAISER_BETA);
+
+        adbWeights[i] = (sin(dbArgument) / dbArgument) * dbWindow;
+        dbSum        += adbWeights[i];
+    }
+
+    for (i = 0; i < KAISER_TAPS; ++i)
+    {
+        afWeights[i] = (FLOAT) (adbWeights[i] / dbSum);
+    }
+}
+
+static UINT
+LastSourceRow(
+    IN WU_PYRAMID_FILTER    filter,
+    IN UINT                 uRow,
+    IN UINT                 uSourceHeight
+    )
+{
+    UINT uReach = (WU_PYRAMID_FILTER_KAISER == filter)
+        ? KAISER_TAPS / 2
+        : 1;
+
+    return min(2 * uRow + uReach, uSourceHeight - 1);
+}
+
+static VOID
+BoxRowSrgb(
+    IN  CONST BYTE* pbRow0,
+    IN  CONST BYTE* pbRow1,
+    IN  UINT        uSourceWidth,
+    OUT BYTE*       pbDst
+    )
+{
+    UINT uWidth = HalveDimension(uSourceWidth);
+    UINT x      = 0;
+    UINT x1     = 0;
+    UINT c      = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero, two;
+    __m128i a, b, lo, hi;
+
+    zero = _mm_setzero_si128();
+    two  = _mm_set1_epi16(2);
+
+    /* 4 source pixels -> 2 output pixels */
+    for (; 2 * x + 4 <= uSourceWidth; x += 2)
+    {
+        a = _mm_loadu_si128((CONST __m128i*) (pbRow0 + 8 * x));
+        b = _mm_loadu_si128((CONST __m128i*) (pbRow1 + 8 * x));
+
+        lo = _mm_add_epi16(
+            _mm_unpacklo_epi8(a, zero),
+            _mm_unpacklo_epi8(b, zero));
+
+        hi = _mm_add_epi16(
+            _mm_unpackhi_epi8(a, zero),
+            _mm_unpackhi_epi8(b, zero));
+
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+
+        _mm_storel_epi64(
+            (__m128i*) (pbDst + 4 * x),
+            _mm_packus_epi16(lo, lo));
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < uWidth; ++x)
+    {
+        x1 = min(2 * x + 1, uSourceWidth - 1);
+
+        for (c = 0; c < 4; ++c)
+        {
+            pbDst[4 * x + c] = (BYTE) ((pbRow0[8 * x + c] + pbRow0[4 * x1 + c]
+                + pbRow1[8 * x + c] + pbRow1[4 * x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+static VOID
+BoxRowLinear(
+    IN  CONST BYTE* pbRow0,
+    IN  CONST BYTE* pbRow1,
+    IN  UINT        uSourceWidth,
+    OUT BYTE*       pbDst,
+    IN  BYTE*       pbScratch
+    )
+{
+    WORD* pwRow0 = (WORD*) pbScratch;
+    WORD* pwRow1 = pwRow0 + (SIZE_T) uSourceWidth * 4;
+    WORD* pwOut  = pwRow1 + (SIZE_T) uSourceWidth * 4;
+    UINT  uWidth = HalveDimension(uSourceWidth);
+    UINT  x      = 0;
+    UINT  x1     = 0;
+    UINT  c      = 0;
+
+    _WuRowToLinear16(pbRow0, pwRow0, uSourceWidth);
+    _WuRowToLinear16(pbRow1, pwRow1, uSourceWidth);
+
+    for (x = 0; x < uWidth; ++x)
+    {
+        x1 = min(2 * x + 1, uSourceWidth - 1);
+
+        for (c = 0; c < 4; ++c)
+        {
+            pwOut[4 * x + c] = (WORD) ((pwRow0[8 * x + c] + pwRow0[4 * x1 + c]
+                + pwRow1[8 * x + c] + pwRow1[4 * x1 + c] + 2) >> 2);
+        }
+    }
+
+    _WuLinear16ToRow(pwOut, pbDst, uWidth);
+}
+
+static VOID
+KaiserRow(
+    IN  PPYRAMIDBUILDER     pBuilder,
+    IN  CONST PWUIMAGEDATA  pSource,
+    IN  UINT                uRow,
+    OUT BYTE*               pbDst
+    )
+{
+    CONST FLOAT*         afWeights = pBuilder->afKaiser;
+    CONST WUCOLORTABLES* pTables   = NULL;
+    FLOAT*               afColumn  = (FLOAT*) pBuilder->pbScratch;
+    CONST BYTE*          pbSrc     = NULL;
+    SIZE_T               cbRow     = 0;
+    UINT                 uWidth    = HalveDimension(pSource->uWidth);
+    UINT                 x         = 0;
+    UINT                 c         = 0;
+    INT                  i         = 0;
+    UINT                 uSrcX     = 0;
+    FLOAT                fSum      = 0.0f;
+    FLOAT                fWeight   = 0.0f;
+
+    cbRow = (SIZE_T) pSource->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    if (TRUE == pBuilder->bLinear)
+    {
+        pTables = _WuGetColorTables();
+    }
+
+    ZeroMemory(afColumn, cbRow * sizeof(FLOAT));
+
+    /* vertical pass: KAISER_TAPS source rows -> one float row */
+    for (i = 0; i < KAISER_TAPS; ++i)
+    {
+        fWeight = afWeights[i];
+        pbSrc   = pSource->abData + cbRow * ClampIndex(
+            (INT) (2 * uRow) + i - (KAISER_TAPS / 2 - 1),
+            pSource->uHeight);
+
+        for (x = 0; x < cbRow; ++x)
+        {
+            if ((NULL == pTables) || (3 == (x & 3)))
+            {
+                afColumn[x] += fWeight * pbSrc[x];
+            }
+            else
+            {
+                afColumn[x] += fWeight * 255.0f
+                    * pTables->afSrgbToLinear[pbSrc[x]];
+            }
+        }
+    }
+
+    /* horizontal pass with decimation */
+    for (x = 0; x < uWidth; ++x)
+    {
+        for (c = 0; c < 4; ++c)
+        {
+            fSum = 0.0f;
+
+            for (i = 0; i < KAISER_TAPS; ++i)
+            {
+                uSrcX = ClampIndex(
+                    (INT) (2 * x) + i - (KAISER_TAPS / 2 - 1),
+                    pSource->uWidth);
+
+                fSum += afWeights[i] * afColumn[4 * uSrcX + c];
+            }
+
+            fSum = (fSum < 0.0f) ? 0.0f : (fSum > 255.0f ? 255.0f : fSum);
+
+            if ((NULL == pTables) || (3 == c))
+            {
+                pbDst[4 * x + c] = (BYTE) (fSum + 0.5f);
+            }
+            else
+            {
+                pbDst[4 * x + c] = _WuLinear16ToSrgb(
+                    pTables,
+                    (WORD) (fSum * 257.0f + 0.5f));
+            }
+        }
+    }
+}
+
+static VOID
+ProduceRow(
+    IN PPYRAMIDBUILDER  pBuilder,
+    IN UINT             uLevel,
+    IN UINT             uRow
+    )
+{
+    CONST PWUIMAGEDATA pSource = &pBuilder->pPyramid->aLevels[uLevel - 1];
+    PWUIMAGEDATA       pTarget = &pBuilder->pPyramid->aLevels[uLevel];
+    SIZE_T             cbRow   = 0;
+    BYTE*              pbDst   = NULL;
+    CONST BYTE*        pbRow0  = NULL;
+    CONST BYTE*        pbRow1  = NULL;
+
+    cbRow = (SIZE_T) pSource->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    pbDst = pTarget->abData
+        + (SIZE_T) uRow * pTarget->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    if (WU_PYRAMID_FILTER_KAISER == pBuilder->filter)
+    {
+        KaiserRow(pBuilder, pSource, uRow, pbDst);
+        return;
+    }
+
+    pbRow0 = pSource->abData + cbRow * (2 * uRow);
+    pbRow1 = pSource->abData
+        + cbRow * min(2 * uRow + 1, pSource->uHeight - 1);
+
+    if (TRUE == pBuilder->bLinear)
+    {
+        BoxRowLinear(pbRow0, pbRow1, pSource->uWidth, pbDst,
+            pBuilder->pbScratch);
+    }
+    else
+    {
+        BoxRowSrgb(pbRow0, pbRow1, pSource->uWidth, pbDst);
+    }
+}
+
+/*
+    Produces every row of levels 2..n whose source rows are already
+    available. Called after each level 1 row, so a level k row is computed
+    while the level k - 1 rows it reads are still in cache.
+*/
+static VOID
+ProduceAvailableRows(
+    IN PPYRAMIDBUILDER  pBuilder
+    )
+{
+    PWUIMAGEPYRAMID pPyramid = pBuilder->pPyramid;
+    UINT            uLevel   = 0;
+    UINT            uRow     = 0;
+
+    for (uLevel = 2; uLevel < pPyramid->cLevels; ++uLevel)
+    {
+        uRow = pBuilder->auNextRow[uLevel];
+
+        while (uRow < pPyramid->aLevels[uLevel].uHeight)
+        {
+            if (LastSourceRow(pBuilder->filter, uRow,
+                    pPyramid->aLevels[uLevel - 1].uHeight)
+                >= pBuilder->auNextRow[uLevel - 1])
+            {
+                break;
+            }
+
+            ProduceRow(pBuilder, uLevel, uRow++);
+        }
+
+        pBuilder->auNextRow[uLevel] = uRow;
+    }
+}
+
+WUAPI PWUIMAGEPYRAMID
+WuBuildImagePyramid(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_PYRAMID_FILTER    filter,
+    IN UINT                 uMaxLevels,
+    IN DWORD                dwFlags
+    )
+{
+    PYRAMIDBUILDER  builder;
+    PWUIMAGEPYRAMID pPyramid = NULL;
+    SIZE_T          cbLevels = 0;
+    BYTE*           pbLevel  = NULL;
+    UINT            uWidth   = 0;
+    UINT            uHeight  = 0;
+    UINT            i        = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return NULL;
+    }
+
+    if (filter >= PYRAMID_FILTER_MAX)
+    {
+        return NULL;
+    }
+
+    if ((0 == uMaxLevels) || (uMaxLevels > WU_IMAGE_PYRAMID_MAX_LEVELS))
+    {
+        uMaxLevels = WU_IMAGE_PYRAMID_MAX_LEVELS;
+    }
+
+    pPyramid = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(WUIMAGEPYRAMID));
+
+    if (NULL == pPyramid)
+    {
+        return NULL;
+    }
+
+    /* level 0 is a view of the caller's image */
+    pPyramid->aLevels[0] = *pImageData;
+    pPyramid->cLevels    = 1;
+
+    uWidth  = pImageData->uWidth;
+    uHeight = pImageData->uHeight;
+
+    while ((pPyramid->cLevels < uMaxLevels) && ((uWidth > 1) || (uHeight > 1)))
+    {
+        uWidth  = HalveDimension(uWidth);
+        uHeight = HalveDimension(uHeight);
+
+        pPyramid->aLevels[pPyramid->cLevels].uWidth  = uWidth;
+        pPyramid->aLevels[pPyramid->cLevels].uHeight = uHeight;
+        pPyramid->cLevels++;
+
+        cbLevels += (SIZE_T) uWidth * uHeight * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    }
+
+    if (1 == pPyramid->cLevels)
+    {
+        return pPyramid;
+    }
+
+    pPyramid->abData = HeapAlloc(GetProcessHeap(), 0, cbLevels);
+
+    if (NULL == pPyramid->abData)
+    {
+        HeapFree(GetProcessHeap(), 0, pPyramid);
+        return NULL;
+    }
+
+    pbLevel = pPyramid->abData;
+
+    for (i = 1; i < pPyramid->cLevels; ++i)
+    {
+        pPyramid->aLevels[i].abData = pbLevel;
+
+        pbLevel += (SIZE_T) pPyramid->aLevels[i].uWidth
+            * pPyramid->aLevels[i].uHeight * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    }
+
+    ZeroMemory(&builder, sizeof(PYRAMIDBUILDER));
+
+    builder.pPyramid = pPyramid;
+    builder.filter   = filter;
+    builder.bLinear  = (dwFlags & WU_COLOR_LINEAR_LIGHT) ? TRUE : FALSE;
+
+    /* enough for one float row or three 16-bit linear rows of level 0 */
+    builder.pbScratch = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) pImageData->uWidth * 4 * sizeof(FLOAT) * 2);
+
+    if (NULL == builder.pbScratch)
+    {
+        WuDestroyImagePyramid(pPyramid);
+        return NULL;
+    }
+
+    if (WU_PYRAMID_FILTER_KAISER == filter)
+    {
+        ComputeKaiserWeights(builder.afKaiser);
+    }
+
+    builder.auNextRow[0] = pImageData->uHeight;
+
+    for (i = 0; i < pPyramid->aLevels[1].uHeight; ++i)
+    {
+        ProduceRow(&builder, 1, i);
+
+        builder.auNextRow[1] = i + 1;
+
+        ProduceAvailableRows(&builder);
+    }
+
+    HeapFree(GetProcessHeap(), 0, builder.pbScratch);
+
+    return pPyramid;
+}
+
+WUAPI PWUIMAGEDATA
+WuImagePyramidGetLevel(
+    IN PWUIMAGEPYRAMID  pPyramid,
+    IN UINT             uMinWidth,
+    IN UINT             uMinHeight
+    )
+{
+    UINT i = 0;
+
+    if ((NULL == pPyramid) || (0 == pPyramid->cLevels))
+    {
+        return NULL;
+    }
+
+    /* levels shrink monotonically, pick the last one that is big enough */
+    for (i = pPyramid->cLevels - 1; i > 0; --i)
+    {
+        if ((pPyramid->aLevels[i].uWidth >= uMinWidth)
+            && (pPyramid->aLevels[i].uHeight >= uMinHeight))
+        {
+            break;
+        }
+    }
+
+    return &pPyramid->aLevels[i];
+}
+
+WUAPI VOID
+WuDestroyImagePyramid(
+    IN PWUIMAGEPYRAMID  pPyramid
+    )
+{
+    if (NULL == pPyramid)
+    {
+        return;
+    }
+
+    if (pPyramid->abData != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pPyramid->abData);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pPyramid);
+}
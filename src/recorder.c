@@ -0,0 +1,934 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       recorder.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "undoc.h"
+#include "internal.h"
+
+#define MIN_BUFFER_COUNT            2
+#define MAX_BUFFER_COUNT            256
+#define MAX_ENCODER_COUNT           64
+
+#define COMPRESSION_CHUNK_SIZE      4096
+
+/* keeps alpha and the 6 high bits of every color channel */
+#define DEGRADED_PIXEL_MASK         0xFFFCFCFC
+
+typedef struct tagRECORDERSLOT {
+    WURECORDERFRAMEHEADER   header;
+    BYTE*                   pbRaw;          /* rects, then pixels */
+    SIZE_T                  cbRawMax;
+    BYTE*                   pbPayload;      /* compressed pbRaw */
+    SIZE_T                  cbPayloadMax;
+    LONGLONG                llQueued;       /* performance counter */
+    volatile LONG           bEncoded;
+} RECORDERSLOT, *PRECORDERSLOT;
+
+typedef struct tagRECORDERENCODER {
+    PWUSCREENRECORDER   pRecorder;
+    HANDLE              hThread;
+    LPVOID              pWorkSpace;
+} RECORDERENCODER, *PRECORDERENCODER;
+
+/*
+    Frame n lives in aSlots[n % cSlots] from the moment the capture thread
+    fills it until it has been written. The capture thread is the only
+    producer; encoders claim frames with an atomic increment of iClaim, in
+    order but finishing in any order, and whichever encoder finds the
+    frame at iWrite encoded writes it and every encoded frame after it.
+    Slots are therefore released in order, which is what lets a plain
+    modulo index the ring. The two semaphores only count free and queued
+    slots so that idle threads sleep instead of spinning.
+*/
+struct tagWUSCREENRECORDER {
+    WURECORDERCONFIG    config;
+    HANDLE              hFile;
+    PWUCAPTURESESSION   pSession;
+    PWUFRAMEDIFF        pDiff;
+    USHORT              uCompressionFormat;     /* 0 stores raw frames */
+    LONGLONG            llFrequency;
+    LONGLONG            llStart;
+    LONGLONG            llStop;
+
+    PRECORDERSLOT       aSlots;
+    UINT                cSlots;
+    HANDLE              hFreeSlots;
+    HANDLE              hQueuedSlots;
+    volatile LONG       iClaim;
+    volatile LONG       iEnd;           /* one past the last frame */
+    volatile LONG       cQueued;
+    LONG                iProduce;       /* capture thread only */
+    BOOL                bForceKeyFrame; /* capture thread only */
+    LONG                iWrite;         /* under csWrite */
+    BOOL                bWriteFailed;   /* under csWrite */
+    CRITICAL_SECTION    csWrite;
+
+    HANDLE              hStopEvent;
+    HANDLE              hCaptureThread;
+    PRECORDERENCODER    aEncoders;
+    UINT                cEncoders;
+
+    CRITICAL_SECTION    csStats;
+    WURECORDERSTATS     stats;
+};
+
+/* Caller holds csStats */
+static VOID
+AddStageSample(
+    IN PWUSCREENRECORDER        pRecorder,
+    IN PWURECORDERSTAGESTATS    pStage,
+    IN LONGLONG                 llTicks
+    )
+{
+    ULONGLONG ullMicroseconds = _WuTicksToUnits(
+        llTicks,
+        pRecorder->llFrequency,
+        MICROSECONDS_PER_SECOND);
+
+    pStage->cFrames++;
+    pStage->ullTotalMicroseconds += ullMicroseconds;
+    pStage->ullMaxMicroseconds    = max(pStage->ullMaxMicroseconds,
+                                        ullMicroseconds);
+}
+
+static BOOL
+WriteAll(
+    IN HANDLE       hFile,
+    IN LPCVOID      pData,
+    IN DWORD        cbData
+    )
+{
+    DWORD cbWritten = 0;
+
+    if (0 == cbData)
+    {
+        return TRUE;
+    }
+
+    return (WriteFile(hFile, pData, cbData, &cbWritten, NULL) != FALSE)
+        && (cbWritten == cbData);
+}
+
+/* XPRESS (Windows 8 and later) is several times faster than LZNT1 */
+static ULONG
+SelectCompression(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    static CONST USHORT auFormats[] = {
+        COMPRESSION_FORMAT_XPRESS,
+        COMPRESSION_FORMAT_LZNT1
+    };
+
+    ULONG cbWorkSpace = 0;
+    ULONG cbFragment  = 0;
+    UINT  i           = 0;
+
+    for (i = 0; i < ARRAYSIZE(auFormats); ++i)
+    {
+        if (NT_SUCCESS(RtlGetCompressionWorkSpaceSize(
+                auFormats[i] | COMPRESSION_ENGINE_STANDARD,
+                &cbWorkSpace,
+                &cbFragment)))
+        {
+            pRecorder->uCompressionFormat = auFormats[i];
+            return cbWorkSpace;
+        }
+    }
+
+    pRecorder->uCompressionFormat = COMPRESSION_FORMAT_NONE;
+
+    return 0;
+}
+
+static BOOL
+FillSlot(
+    IN PRECORDERSLOT        pSlot,
+    IN CONST WUFRAMEDELTA*  pDelta
+    )
+{
+    SIZE_T cbRects = (SIZE_T) pDelta->cRects * sizeof(WUDIRTYRECT);
+    SIZE_T cbRaw   = cbRects + pDelta->cbPixels;
+
+    if ((cbRaw < cbRects) || (cbRaw > MAXDWORD))
+    {
+        return FALSE;
+    }
+
+    if (_WuGrowBuffer((LPVOID*) &pSlot->pbRaw, &pSlot->cbRawMax,
+            cbRaw) == FALSE)
+    {
+        return FALSE;
+    }
+
+    if (cbRaw > 0)
+    {
+        CopyMemory(pSlot->pbRaw, pDelta->aRects, cbRects);
+        CopyMemory(pSlot->pbRaw + cbRects, pDelta->abPixels,
+                   pDelta->cbPixels);
+    }
+
+    pSlot->header.dwFlags = (pDelta->cDirtyTiles == pDelta->cTiles)
+        ? WU_RECORDER_FRAME_KEY : 0;
+    pSlot->header.uWidth    = pDelta->uWidth;
+    pSlot->header.uHeight   = pDelta->uHeight;
+    pSlot->header.cRects    = pDelta->cRects;
+    pSlot->header.cbRaw     = (DWORD) cbRaw;
+    pSlot->header.cbPayload = (DWORD) cbRaw;
+
+    return TRUE;
+}
+
+/* Ends the stream: every encoder claims one index past the last frame */
+static VOID
+EndStream(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    InterlockedExchange(&pRecorder->iEnd, pRecorder->iProduce);
+
+    if (pRecorder->cEncoders > 0)
+    {
+        ReleaseSemaphore(
+            pRecorder->hQueuedSlots,
+            (LONG) pRecorder->cEncoders,
+            NULL);
+    }
+}
+
+static VOID
+CaptureFrame(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    HANDLE        ahWait[2];
+    PWUIMAGEDATA  pFrame   = NULL;
+    PWUFRAMEDELTA pDelta   = NULL;
+    PRECORDERSLOT pSlot    = NULL;
+    LONGLONG      llBegin  = 0;
+    LONG          cQueued  = 0;
+    DWORD         dwFlags  = 0;
+    BOOL          bDegrade = FALSE;
+
+    if (WU_RECORDER_BACKPRESSURE_BLOCK == pRecorder->config.backpressure)
+    {
+        ahWait[0] = pRecorder->hStopEvent;
+        ahWait[1] = pRecorder->hFreeSlots;
+
+        if (WaitForMultipleObjects(2, ahWait, FALSE, INFINITE)
+            != WAIT_OBJECT_0 + 1)
+        {
+            return;
+        }
+    }
+    else if (WaitForSingleObject(pRecorder->hFreeSlots, 0)
+             != WAIT_OBJECT_0)
+    {
+        EnterCriticalSection(&pRecorder->csStats);
+        pRecorder->stats.cFramesDropped++;
+        LeaveCriticalSection(&pRecorder->csStats);
+
+        return;
+    }
+
+    llBegin = _WuGetTicks();
+    pSlot   = &pRecorder->aSlots[(ULONG) pRecorder->iProduce
+                                 % pRecorder->cSlots];
+
+    if ((TRUE == pRecorder->bForceKeyFrame)
+        || (0 == pRecorder->iProduce % pRecorder->config.uKeyFrameInterval))
+    {
+        dwFlags = WU_FRAME_DIFF_FULL;
+    }
+
+    pFrame = WuCaptureSessionCaptureFrame(pRecorder->pSession);
+
+    if (pFrame != NULL)
+    {
+        pDelta = WuFrameDiffCompare(pRecorder->pDiff, pFrame, dwFlags);
+    }
+
+    /* a frame the diff has seen but the file has not breaks the chain */
+    if ((NULL == pDelta) || (FillSlot(pSlot, pDelta) == FALSE))
+    {
+        pRecorder->bForceKeyFrame = (pDelta != NULL)
+            || (TRUE == pRecorder->bForceKeyFrame);
+
+        ReleaseSemaphore(pRecorder->hFreeSlots, 1, NULL);
+        return;
+    }
+
+    pRecorder->bForceKeyFrame = FALSE;
+
+    cQueued = InterlockedIncrement(&pRecorder->cQueued);
+
+    if ((WU_RECORDER_BACKPRESSURE_DEGRADE == pRecorder->config.backpressure)
+        && ((UINT) cQueued * 2 > pRecorder->cSlots))
+    {
+        pSlot->header.dwFlags |= WU_RECORDER_FRAME_DEGRADED;
+        bDegrade = TRUE;
+    }
+
+    pSlot->header.ullTimestamp = _WuTicksToUnits(
+        llBegin - pRecorder->llStart,
+        pRecorder->llFrequency,
+        TIMESTAMP_UNITS_PER_SECOND);
+
+    pSlot->llQueued = _WuGetTicks();
+
+    EnterCriticalSection(&pRecorder->csStats);
+
+    pRecorder->stats.cFramesCaptured++;
+    pRecorder->stats.cFramesDegraded += (TRUE == bDegrade) ? 1 : 0;
+    pRecorder->stats.cMaxQueued = max(pRecorder->stats.cMaxQueued,
+                                      (UINT) cQueued);
+
+    AddStageSample(pRecorder, &pRecorder->stats.capture,
+                   pSlot->llQueued - llBegin);
+
+    LeaveCriticalSection(&pRecorder->csStats);
+
+    pRecorder->iProduce++;
+
+    ReleaseSemaphore(pRecorder->hQueuedSlots, 1, NULL);
+}
+
+static DWORD WINAPI
+CaptureThreadProc(
+    IN LPVOID   pParameter
+    )
+{
+    PWUSCREENRECORDER pRecorder   = (PWUSCREENRECORDER) pParameter;
+    LONGLONG          llInterval  = 0;
+    LONGLONG          llNextFrame = 0;
+    LONGLONG          llNow       = 0;
+    DWORD             dwTimeout   = 0;
+
+    llInterval  = max(1, pRecorder->llFrequency
+                         / pRecorder->config.uFrameRate);
+    llNextFrame = pRecorder->llStart;
+
+    for (;;)
+    {
+        llNow = _WuGetTicks();
+
+        /* rounded up, so the wait never ends before the frame is due */
+        dwTimeout = (llNow < llNextFrame)
+            ? (DWORD) _WuTicksToUnits(llNextFrame - llNow,
+                                      pRecorder->llFrequency,
+                                      MILLISECONDS_PER_SECOND) + 1
+            : 0;
+
+        if (WaitForSingleObject(pRecorder->hStopEvent, dwTimeout)
+            != WAIT_TIMEOUT)
+        {
+            break;
+        }
+
+        CaptureFrame(pRecorder);
+
+        /* after a slow frame, start over instead of catching up */
+        llNextFrame = max(llNextFrame + llInterval, _WuGetTicks());
+    }
+
+    EndStream(pRecorder);
+
+    return 0;
+}
+
+static VOID
+EncodeSlot(
+    IN PRECORDERENCODER pEncoder,
+    IN PRECORDERSLOT    pSlot
+    )
+{
+    PWUSCREENRECORDER pRecorder  = pEncoder->pRecorder;
+    DWORD             cbRaw      = pSlot->header.cbRaw;
+    SIZE_T            cbRects    = 0;
+    DWORD*            pdwPixels  = NULL;
+    SIZE_T            cPixels    = 0;
+    SIZE_T            i          = 0;
+    ULONG             cbFinal    = 0;
+    NTSTATUS          status     = 0;
+
+    if (pSlot->header.dwFlags & WU_RECORDER_FRAME_DEGRADED)
+    {
+        cbRects   = (SIZE_T) pSlot->header.cRects * sizeof(WUDIRTYRECT);
+        pdwPixels = (DWORD*) (pSlot->pbRaw + cbRects);
+        cPixels   = (cbRaw - cbRects) / WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+        for (i = 0; i < cPixels; ++i)
+        {
+            pdwPixels[i] &= DEGRADED_PIXEL_MASK;
+        }
+    }
+
+    if ((COMPRESSION_FORMAT_NONE == pRecorder->uCompressionFormat)
+        || (0 == cbRaw))
+    {
+        return;
+    }
+
+    if (_WuGrowBuffer((LPVOID*) &pSlot->pbPayload, &pSlot->cbPayloadMax,
+            cbRaw) == FALSE)
+    {
+        return;
+    }
+
+    status = RtlCompressBuffer(
+        pRecorder->uCompressionFormat | COMPRESSION_ENGINE_STANDARD,
+        pSlot->pbRaw,
+        cbRaw,
+        pSlot->pbPayload,
+        cbRaw,
+        COMPRESSION_CHUNK_SIZE,
+        &cbFinal,
+        pEncoder->pWorkSpace);
+
+    /* incompressible frames (STATUS_BUFFER_TOO_SMALL) are stored raw */
+    if ((STATUS_SUCCESS == status) && (cbFinal < cbRaw))
+    {
+        pSlot->header.dwFlags   |= WU_RECORDER_FRAME_COMPRESSED;
+        pSlot->header.cbPayload  = cbFinal;
+    }
+}
+
+static BOOL
+WriteSlot(
+    IN PWUSCREENRECORDER    pRecorder,
+    IN PRECORDERSLOT        pSlot
+    )
+{
+    CONST BYTE* pbPayload = (pSlot->header.dwFlags
+                             & WU_RECORDER_FRAME_COMPRESSED)
+        ? pSlot->pbPayload : pSlot->pbRaw;
+
+    return (WriteAll(pRecorder->hFile, &pSlot->header,
+                     sizeof(WURECORDERFRAMEHEADER)) == TRUE)
+        && (WriteAll(pRecorder->hFile, pbPayload,
+                     pSlot->header.cbPayload) == TRUE);
+}
+
+/* Writes the encoded frames at the head of the ring, in order */
+static VOID
+WriteEncodedSlots(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    PRECORDERSLOT pSlot   = NULL;
+    LONGLONG      llBegin = 0;
+    BOOL          bResult = FALSE;
+
+    EnterCriticalSection(&pRecorder->csWrite);
+
+    for (;;)
+    {
+        pSlot = &pRecorder->aSlots[(ULONG) pRecorder->iWrite
+                                   % pRecorder->cSlots];
+
+        if (InterlockedCompareExchange(&pSlot->bEncoded, FALSE, TRUE)
+            == FALSE)
+        {
+            break;
+        }
+
+        llBegin = _WuGetTicks();
+        bResult = FALSE;
+
+        /* after a failure the frames are only drained */
+        if (FALSE == pRecorder->bWriteFailed)
+        {
+            bResult = WriteSlot(pRecorder, pSlot);
+
+            pRecorder->bWriteFailed = !bResult;
+        }
+
+        EnterCriticalSection(&pRecorder->csStats);
+
+        if (TRUE == bResult)
+        {
+            pRecorder->stats.cFramesWritten++;
+            pRecorder->stats.cbRaw     += pSlot->header.cbRaw;
+            pRecorder->stats.cbWritten += sizeof(WURECORDERFRAMEHEADER)
+                + pSlot->header.cbPayload;
+        }
+
+        AddStageSample(pRecorder, &pRecorder->stats.write,
+                       _WuGetTicks() - llBegin);
+
+        LeaveCriticalSection(&pRecorder->csStats);
+
+        pRecorder->iWrite++;
+
+        InterlockedDecrement(&pRecorder->cQueued);
+        ReleaseSemaphore(pRecorder->hFreeSlots, 1, NULL);
+    }
+
+    LeaveCriticalSection(&pRecorder->csWrite);
+}
+
+static DWORD WINAPI
+EncoderThreadProc(
+    IN LPVOID   pParameter
+    )
+{
+    PRECORDERENCODER  pEncoder  = (PRECORDERENCODER) pParameter;
+    PWUSCREENRECORDER pRecorder = pEncoder->pRecorder;
+    PRECORDERSLOT     pSlot     = NULL;
+    LONGLONG          llBegin   = 0;
+    LONGLONG          llEnd     = 0;
+    LONG              iFrame    = 0;
+
+    while (WaitForSingleObject(pRecorder->hQueuedSlots, INFINITE)
+           == WAIT_OBJECT_0)
+    {
+        iFrame = InterlockedIncrement(&pRecorder->iClaim) - 1;
+
+        if (iFrame >= pRecorder->iEnd)
+        {
+            break;
+        }
+
+        pSlot   = &pRecorder->aSlots[(ULONG) iFrame % pRecorder->cSlots];
+        llBegin = _WuGetTicks();
+
+        EncodeSlot(pEncoder, pSlot);
+
+        llEnd = _WuGetTicks();
+
+        EnterCriticalSection(&pRecorder->csStats);
+
+        AddStageSample(pRecorder, &pRecorder->stats.queue,
+                       llBegin - pSlot->llQueued);
+        AddStageSample(pRecorder, &pRecorder->stats.encode,
+                       llEnd - llBegin);
+
+        LeaveCriticalSection(&pRecorder->csStats);
+
+        InterlockedExchange(&pSlot->bEncoded, TRUE);
+
+        WriteEncodedSlots(pRecorder);
+    }
+
+    return 0;
+}
+
+static VOID
+ApplyConfigDefaults(
+    IN OUT PWURECORDERCONFIG    pConfig
+    )
+{
+    if (0 == pConfig->uFrameRate)
+    {
+        pConfig->uFrameRate = WU_RECORDER_DEFAULT_FRAME_RATE;
+    }
+
+    if (0 == pConfig->cEncoders)
+    {
+        pConfig->cEncoders = _WuGetProcessorCount();
+    }
+
+    if (0 == pConfig->cBuffers)
+    {
+        pConfig->cBuffers = WU_RECORDER_DEFAULT_BUFFER_COUNT;
+    }
+
+    if (0 == pConfig->uKeyFrameInterval)
+    {
+        pConfig->uKeyFrameInterval = WU_RECORDER_DEFAULT_KEY_FRAME_INTERVAL;
+    }
+
+    pConfig->uFrameRate = min(pConfig->uFrameRate, MAX_FRAME_RATE);
+    pConfig->cEncoders  = min(pConfig->cEncoders, MAX_ENCODER_COUNT);
+    pConfig->cBuffers   = max(MIN_BUFFER_COUNT,
+                              min(pConfig->cBuffers, MAX_BUFFER_COUNT));
+}
+
+/* Threads must have stopped */
+static VOID
+FreeRecorder(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    UINT i = 0;
+
+    if (pRecorder->aEncoders != NULL)
+    {
+        for (i = 0; i < pRecorder->config.cEncoders; ++i)
+        {
+            if (pRecorder->aEncoders[i].pWorkSpace != NULL)
+            {
+                HeapFree(GetProcessHeap(), 0,
+                         pRecorder->aEncoders[i].pWorkSpace);
+            }
+        }
+
+        HeapFree(GetProcessHeap(), 0, pRecorder->aEncoders);
+    }
+
+    if (pRecorder->aSlots != NULL)
+    {
+        for (i = 0; i < pRecorder->cSlots; ++i)
+        {
+            if (pRecorder->aSlots[i].pbRaw != NULL)
+            {
+                HeapFree(GetProcessHeap(), 0, pRecorder->aSlots[i].pbRaw);
+            }
+
+            if (pRecorder->aSlots[i].pbPayload != NULL)
+            {
+                HeapFree(GetProcessHeap(), 0,
+                         pRecorder->aSlots[i].pbPayload);
+            }
+        }
+
+        HeapFree(GetProcessHeap(), 0, pRecorder->aSlots);
+    }
+
+    if (pRecorder->hStopEvent != NULL)
+    {
+        CloseHandle(pRecorder->hStopEvent);
+    }
+
+    if (pRecorder->hQueuedSlots != NULL)
+    {
+        CloseHandle(pRecorder->hQueuedSlots);
+    }
+
+    if (pRecorder->hFreeSlots != NULL)
+    {
+        CloseHandle(pRecorder->hFreeSlots);
+    }
+
+    if (pRecorder->hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(pRecorder->hFile);
+    }
+
+    WuDestroyFrameDiff(pRecorder->pDiff);
+    WuDestroyCaptureSession(pRecorder->pSession);
+
+    DeleteCriticalSection(&pRecorder->csStats);
+    DeleteCriticalSection(&pRecorder->csWrite);
+
+    HeapFree(GetProcessHeap(), 0, pRecorder);
+}
+
+static VOID
+JoinThreads(
+    IN PWUSCREENRECORDER    pRecorder
+    )
+{
+    UINT i = 0;
+
+    SetEvent(pRecorder->hStopEvent);
+
+    /* the capture thread ends the stream itself once it leaves */
+    if (pRecorder->hCaptureThread != NULL)
+    {
+        WaitForSingleObject(pRecorder->hCaptureThread, INFINITE);
+        CloseHandle(pRecorder->hCaptureThread);
+    }
+    else
+    {
+        EndStream(pRecorder);
+    }
+
+    for (i = 0; i < pRecorder->cEncoders; ++i)
+    {
+        WaitForSingleObject(pRecorder->aEncoders[i].hThread, INFINITE);
+        CloseHandle(pRecorder->aEncoders[i].hThread);
+    }
+
+    pRecorder->llStop = _WuGetTicks();
+}
+
+static BOOL
+StartThreads(
+    IN PWUSCREENRECORDER    pRecorder,
+    IN ULONG                cbWorkSpace
+    )
+{
+    PRECORDERENCODER pEncoder = NULL;
+    UINT             i        = 0;
+
+    for (i = 0; i < pRecorder->config.cEncoders; ++i)
+    {
+        pEncoder            = &pRecorder->aEncoders[i];
+        pEncoder->pRecorder = pRecorder;
+
+        if (cbWorkSpace > 0)
+        {
+            pEncoder->pWorkSpace = HeapAlloc(
+                GetProcessHeap(),
+                0,
+                cbWorkSpace);
+
+            if (NULL == pEncoder->pWorkSpace)
+            {
+                return FALSE;
+            }
+        }
+
+        pEncoder->hThread = CreateThread(
+            NULL,
+            0,
+            EncoderThreadProc,
+            pEncoder,
+            0,
+            NULL);
+
+        if (NULL == pEncoder->hThread)
+        {
+            return FALSE;
+        }
+
+        pRecorder->cEncoders++;
+    }
+
+    pRecorder->llStart        = _WuGetTicks();
+    pRecorder->hCaptureThread = CreateThread(
+        NULL,
+        0,
+        CaptureThreadProc,
+        pRecorder,
+        0,
+        NULL);
+
+    return (pRecorder->hCaptureThread != NULL);
+}
+
+WUAPI PWUSCREENRECORDER
+WuStartScreenRecorderW(
+    IN LPCWSTR                  szFilePath,
+    IN CONST PWURECORDERCONFIG  pConfig
+    )
+{
+    WURECORDERFILEHEADER fileHeader;
+    LARGE_INTEGER        liFrequency;
+    PWUSCREENRECORDER    pRecorder   = NULL;
+    ULONG                cbWorkSpace = 0;
+    BOOL                 bSuccess    = FALSE;
+
+    if (NULL == szFilePath)
+    {
+        return NULL;
+    }
+
+    if ((pConfig != NULL)
+        && (pConfig->backpressure > WU_RECORDER_BACKPRESSURE_DEGRADE))
+    {
+        return NULL;
+    }
+
+    pRecorder = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUSCREENRECORDER));
+
+    if (NULL == pRecorder)
+    {
+        return NULL;
+    }
+
+    InitializeCriticalSection(&pRecorder->csWrite);
+    InitializeCriticalSection(&pRecorder->csStats);
+
+    pRecorder->hFile = INVALID_HANDLE_VALUE;
+    pRecorder->iEnd  = MAXLONG;
+
+    if (pConfig != NULL)
+    {
+        pRecorder->config = *pConfig;
+    }
+
+    ApplyConfigDefaults(&pRecorder->config);
+
+    QueryPerformanceFrequency(&liFrequency);
+
+    pRecorder->llFrequency = liFrequency.QuadPart;
+    pRecorder->cSlots      = pRecorder->config.cBuffers;
+
+    pRecorder->pSession = WuCreateCaptureSession(pRecorder->config.hWnd);
+    pRecorder->pDiff    = WuCreateFrameDiff(pRecorder->config.uTileSize);
+
+    if ((NULL == pRecorder->pSession) || (NULL == pRecorder->pDiff))
+    {
+        goto cleanup;
+    }
+
+    pRecorder->aSlots = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        pRecorder->cSlots * sizeof(RECORDERSLOT));
+
+    pRecorder->aEncoders = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        pRecorder->config.cEncoders * sizeof(RECORDERENCODER));
+
+    if ((NULL == pRecorder->aSlots) || (NULL == pRecorder->aEncoders))
+    {
+        goto cleanup;
+    }
+
+    /* one extra count per encoder for the end of the stream */
+    pRecorder->hFreeSlots = CreateSemaphoreW(
+        NULL,
+        (LONG) pRecorder->cSlots,
+        (LONG) pRecorder->cSlots,
+        NULL);
+
+    pRecorder->hQueuedSlots = CreateSemaphoreW(
+        NULL,
+        0,
+        (LONG) (pRecorder->cSlots + pRecorder->config.cEncoders),
+        NULL);
+
+    pRecorder->hStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    if ((NULL == pRecorder->hFreeSlots) || (NULL == pRecorder->hQueuedSlots)
+        || (NULL == pRecorder->hStopEvent))
+    {
+        goto cleanup;
+    }
+
+    cbWorkSpace = SelectCompression(pRecorder);
+
+    pRecorder->hFile = CreateFileW(
+        szFilePath,
+        GENERIC_WRITE,
+        FILE_SHARE_READ,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (INVALID_HANDLE_VALUE == pRecorder->hFile)
+    {
+        goto cleanup;
+    }
+
+    ZeroMemory(&fileHeader, sizeof(WURECORDERFILEHEADER));
+
+    fileHeader.dwMagic            = WU_RECORDER_FILE_MAGIC;
+    fileHeader.dwVersion          = WU_RECORDER_FILE_VERSION;
+    fileHeader.uFrameRate         = pRecorder->config.uFrameRate;
+    fileHeader.wCompressionFormat = pRecorder->uCompressionFormat;
+
+    if (WriteAll(pRecorder->hFile, &fileHeader,
+            sizeof(WURECORDERFILEHEADER)) == FALSE)
+    {
+        goto cleanup;
+    }
+
+    bSuccess = StartThreads(pRecorder, cbWorkSpace);
+
+cleanup:
+    if (FALSE == bSuccess)
+    {
+        if (pRecorder->hStopEvent != NULL)
+        {
+            JoinThreads(pRecorder);
+        }
+
+        if (pRecorder->hFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(pRecorder->hFile);
+            pRecorder->hFile = INVALID_HANDLE_VALUE;
+
+            DeleteFileW(szFilePath);
+        }
+
+        FreeRecorder(pRecorder);
+        pRecorder = NULL;
+    }
+
+    return pRecorder;
+}
+
+WUAPI PWUSCREENRECORDER
+WuStartScreenRecorderA(
+    IN LPCSTR                   szFilePath,
+    IN CONST PWURECORDERCONFIG  pConfig
+    )
+{
+    WCHAR szwPath[MAX_PATH];
+
+    if (NULL == szFilePath)
+    {
+        return NULL;
+    }
+
+    if (WuAnsiToWide(szFilePath, szwPath, MAX_PATH) == FALSE)
+    {
+        return NULL;
+    }
+
+    return WuStartScreenRecorderW(szwPath, pConfig);
+}
+
+WUAPI BOOL
+WuGetScreenRecorderStats(
+    IN  PWUSCREENRECORDER   pRecorder,
+    OUT PWURECORDERSTATS    pStats
+    )
+{
+    LONGLONG llNow = 0;
+
+    if ((NULL == pRecorder) || (NULL == pStats))
+    {
+        return FALSE;
+    }
+
+    llNow = (pRecorder->llStop != 0) ? pRecorder->llStop : _WuGetTicks();
+
+    EnterCriticalSection(&pRecorder->csStats);
+
+    *pStats = pRecorder->stats;
+
+    LeaveCriticalSection(&pRecorder->csStats);
+
+    pStats->ullElapsedMicroseconds = _WuTicksToUnits(
+        llNow - pRecorder->llStart,
+        pRecorder->llFrequency,
+        MICROSECONDS_PER_SECOND);
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuStopScreenRecorder(
+    IN  PWUSCREENRECORDER   pRecorder,
+    OUT PWURECORDERSTATS    pStats
+    )
+{
+    BOOL bResult = FALSE;
+
+    if (NULL == pRecorder)
+    {
+        return FALSE;
+    }
+
+    JoinThreads(pRecorder);
+
+    if (pStats != NULL)
+    {
+        WuGetScreenRecorderStats(pRecorder, pStats);
+    }
+
+    bResult = !pRecorder->bWriteFailed;
+
+    FreeRecorder(pRecorder);
+
+    return bResult;
+}
@@ -0,0 +1,439 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       scheduler.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION   0x00000002
+#endif /* CREATE_WAITABLE_TIMER_HIGH_RESOLUTION */
+
+struct tagWUCAPTURESCHEDULER {
+    WUCAPTURESCHEDULERCONFIG    config;
+    PWUCAPTURESESSION           pSession;
+    HANDLE                      hTimer;
+    HANDLE                      hStopEvent;
+    HANDLE                      hThread;
+    LONGLONG                    llFrequency;
+    LONGLONG                    llStart;
+
+    CRITICAL_SECTION            csStats;
+    WUCAPTURESCHEDULERSTATS     stats;
+    WUFRAMETIMING               aHistory[WU_CAPTURE_SCHEDULER_HISTORY];
+    ULONGLONG                   cHistory;   /* frames ever recorded */
+};
+
+static WU_INLINE UINT
+TicksToMicroseconds(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN LONGLONG             llTicks
+    )
+{
+    return (UINT) min(MAXUINT, _WuTicksToUnits(
+        llTicks,
+        pScheduler->llFrequency,
+        MICROSECONDS_PER_SECOND));
+}
+
+/* Ticks since the start in 100 ns units */
+static WU_INLINE ULONGLONG
+TicksToTimestamp(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN LONGLONG             llTicks
+    )
+{
+    return _WuTicksToUnits(
+        llTicks - pScheduler->llStart,
+        pScheduler->llFrequency,
+        TIMESTAMP_UNITS_PER_SECOND);
+}
+
+/* Exact for every frame, rounding errors do not add up */
+static LONGLONG
+GetDueTicks(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN ULONGLONG            iFrame
+    )
+{
+    return pScheduler->llStart + (LONGLONG) (iFrame
+        * (ULONGLONG) pScheduler->llFrequency
+        / pScheduler->config.uFrameRate);
+}
+
+/* Index of the first deadline at or after llTicks */
+static ULONGLONG
+GetNextFrame(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN LONGLONG             llTicks
+    )
+{
+    ULONGLONG ullTicks = (ULONGLONG) max(llTicks - pScheduler->llStart, 0);
+
+    return (ullTicks * pScheduler->config.uFrameRate
+            + (ULONGLONG) pScheduler->llFrequency - 1)
+        / (ULONGLONG) pScheduler->llFrequency;
+}
+
+/* Sleeps until llDue, FALSE once the scheduler is being stopped */
+static BOOL
+WaitUntil(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN LONGLONG             llDue
+    )
+{
+    LARGE_INTEGER liDueTime;
+    HANDLE        ahWait[2];
+    LONGLONG      llNow = 0;
+
+    ahWait[0] = pScheduler->hStopEvent;
+    ahWait[1] = pScheduler->hTimer;
+
+    for (llNow = _WuGetTicks(); llNow < llDue; llNow = _WuGetTicks())
+    {
+        /* relative, in 100 ns units; an early wake-up only loops */
+        liDueTime.QuadPart = -(LONGLONG) _WuTicksToUnits(
+            llDue - llNow,
+            pScheduler->llFrequency,
+            TIMESTAMP_UNITS_PER_SECOND);
+
+        if (SetWaitableTimer(pScheduler->hTimer, &liDueTime, 0, NULL,
+                NULL, FALSE) == FALSE)
+        {
+            return FALSE;
+        }
+
+        if (WaitForMultipleObjects(2, ahWait, FALSE, INFINITE)
+            != WAIT_OBJECT_0 + 1)
+        {
+            return FALSE;
+        }
+    }
+
+    return (WaitForSingleObject(pScheduler->hStopEvent, 0) == WAIT_TIMEOUT);
+}
+
+static VOID
+RecordFrame(
+    IN PWUCAPTURESCHEDULER  pScheduler,
+    IN CONST WUFRAMETIMING* pTiming
+    )
+{
+    PWUCAPTURESCHEDULERSTATS pStats = &pScheduler->stats;
+
+    EnterCriticalSection(&pScheduler->csStats);
+
+    pStats->cFrames++;
+
+    pStats->ullTotalCaptureMicroseconds += pTiming->uCaptureMicroseconds;
+    pStats->ullTotalProcessMicroseconds += pTiming->uProcessMicroseconds;
+    pStats->ullTotalJitterMicroseconds  += pTiming->uJitterMicroseconds;
+
+    pStats->ullMaxCaptureMicroseconds = max(
+        pStats->ullMaxCaptureMicroseconds,
+        pTiming->uCaptureMicroseconds);
+
+    pStats->ullMaxProcessMicroseconds = max(
+        pStats->ullMaxProcessMicroseconds,
+        pTiming->uProcessMicroseconds);
+
+    pStats->ullMaxJitterMicroseconds = max(
+        pStats->ullMaxJitterMicroseconds,
+        pTiming->uJitterMicroseconds);
+
+    pScheduler->aHistory[pScheduler->cHistory
+                         % WU_CAPTURE_SCHEDULER_HISTORY] = *pTiming;
+    pScheduler->cHistory++;
+
+    LeaveCriticalSection(&pScheduler->csStats);
+}
+
+static DWORD WINAPI
+SchedulerThreadProc(
+    IN LPVOID   pParameter
+    )
+{
+    PWUCAPTURESCHEDULER       pScheduler      = NULL;
+    PWUCAPTURESCHEDULERCONFIG pConfig         = NULL;
+    WUCAPTURESCHEDULERSTATS   stats;
+    WUFRAMETIMING             timing;
+    PWUIMAGEDATA              pFrame          = NULL;
+    ULONGLONG                 iFrame          = 0;
+    ULONGLONG                 iNextFrame      = 0;
+    LONGLONG                  llDue           = 0;
+    LONGLONG                  llBegin         = 0;
+    LONGLONG                  llCaptured      = 0;
+    LONGLONG                  llEnd           = 0;
+    LONGLONG                  llNextStats     = 0;
+    LONGLONG                  llStatsInterval = 0;
+    UINT                      cSkipped        = 0;
+    BOOL                      bContinue       = TRUE;
+
+    pScheduler = (PWUCAPTURESCHEDULER) pParameter;
+    pConfig    = &pScheduler->config;
+
+    llStatsInterval = pScheduler->llFrequency * pConfig->uStatsInterval
+        / MILLISECONDS_PER_SECOND;
+    llNextStats     = pScheduler->llStart + llStatsInterval;
+
+    while (TRUE == bContinue)
+    {
+        llDue = GetDueTicks(pScheduler, iFrame);
+
+        if (WaitUntil(pScheduler, llDue) == FALSE)
+        {
+            break;
+        }
+
+        llBegin    = _WuGetTicks();
+        pFrame     = WuCaptureSessionCaptureFrame(pScheduler->pSession);
+        llCaptured = _WuGetTicks();
+
+        ZeroMemory(&timing, sizeof(WUFRAMETIMING));
+
+        timing.iFrame         = iFrame;
+        timing.ullDueTime     = TicksToTimestamp(pScheduler, llDue);
+        timing.ullStartTime   = TicksToTimestamp(pScheduler, llBegin);
+        timing.cSkippedBefore = cSkipped;
+
+        timing.uJitterMicroseconds = TicksToMicroseconds(
+            pScheduler,
+            llBegin - llDue);
+
+        timing.uCaptureMicroseconds = TicksToMicroseconds(
+            pScheduler,
+            llCaptured - llBegin);
+
+        if ((pFrame != NULL) && (pConfig->pfnFrame != NULL))
+        {
+            bContinue = pConfig->pfnFrame(pFrame, &timing,
+                                          pConfig->pUserData);
+        }
+
+        llEnd = _WuGetTicks();
+
+        if (pFrame != NULL)
+        {
+            timing.uProcessMicroseconds = TicksToMicroseconds(
+                pScheduler,
+                llEnd - llCaptured);
+
+            RecordFrame(pScheduler, &timing);
+        }
+
+        /* deadlines that passed while this frame was handled are skipped */
+        iNextFrame = max(iFrame + 1, GetNextFrame(pScheduler, llEnd));
+        cSkipped   = (UINT) min(MAXUINT, iNextFrame - iFrame - 1);
+        iFrame     = iNextFrame;
+
+        EnterCriticalSection(&pScheduler->csStats);
+
+        pScheduler->stats.cFailed  += (NULL == pFrame) ? 1 : 0;
+        pScheduler->stats.cSkipped += cSkipped;
+
+        LeaveCriticalSection(&pScheduler->csStats);
+
+        if ((pConfig->pfnStats != NULL) && (llEnd >= llNextStats))
+        {
+            WuGetCaptureSchedulerStats(pScheduler, &stats);
+            pConfig->pfnStats(&stats, pConfig->pUserData);
+
+            llNextStats = llEnd + llStatsInterval;
+        }
+    }
+
+    return 0;
+}
+
+static VOID
+FreeScheduler(
+    IN PWUCAPTURESCHEDULER  pScheduler
+    )
+{
+    if (pScheduler->hTimer != NULL)
+    {
+        CloseHandle(pScheduler->hTimer);
+    }
+
+    if (pScheduler->hStopEvent != NULL)
+    {
+        CloseHandle(pScheduler->hStopEvent);
+    }
+
+    WuDestroyCaptureSession(pScheduler->pSession);
+
+    DeleteCriticalSection(&pScheduler->csStats);
+
+    HeapFree(GetProcessHeap(), 0, pScheduler);
+}
+
+WUAPI PWUCAPTURESCHEDULER
+WuStartCaptureScheduler(
+    IN CONST PWUCAPTURESCHEDULERCONFIG  pConfig
+    )
+{
+    PWUCAPTURESCHEDULER pScheduler = NULL;
+    LARGE_INTEGER       liFrequency;
+
+    pScheduler = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUCAPTURESCHEDULER));
+
+    if (NULL == pScheduler)
+    {
+        return NULL;
+    }
+
+    InitializeCriticalSection(&pScheduler->csStats);
+
+    if (pConfig != NULL)
+    {
+        pScheduler->config = *pConfig;
+    }
+
+    if (0 == pScheduler->config.uFrameRate)
+    {
+        pScheduler->config.uFrameRate =
+            WU_CAPTURE_SCHEDULER_DEFAULT_FRAME_RATE;
+    }
+
+    if (0 == pScheduler->config.uStatsInterval)
+    {
+        pScheduler->config.uStatsInterval =
+            WU_CAPTURE_SCHEDULER_DEFAULT_STATS_INTERVAL;
+    }
+
+    pScheduler->config.uFrameRate = min(pScheduler->config.uFrameRate,
+                                        MAX_FRAME_RATE);
+
+    QueryPerformanceFrequency(&liFrequency);
+
+    pScheduler->llFrequency = liFrequency.QuadPart;
+
+    pScheduler->pSession = WuCreateCaptureSession(pScheduler->config.hWnd);
+
+    pScheduler->hTimer = CreateWaitableTimerExW(
+        NULL,
+        NULL,
+        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+        TIMER_ALL_ACCESS);
+
+    /* the flag is rejected before Windows 10 1803 */
+    if (NULL == pScheduler->hTimer)
+    {
+        pScheduler->hTimer = CreateWaitableTimerW(NULL, FALSE, NULL);
+    }
+
+    pScheduler->hStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    if ((NULL == pScheduler->pSession) || (NULL == pScheduler->hTimer)
+        || (NULL == pScheduler->hStopEvent))
+    {
+        FreeScheduler(pScheduler);
+        return NULL;
+    }
+
+    pScheduler->llStart = _WuGetTicks();
+    pScheduler->hThread = CreateThread(
+        NULL,
+        0,
+        SchedulerThreadProc,
+        pScheduler,
+        0,
+        NULL);
+
+    if (NULL == pScheduler->hThread)
+    {
+        FreeScheduler(pScheduler);
+        return NULL;
+    }
+
+    return pScheduler;
+}
+
+WUAPI BOOL
+WuGetCaptureSchedulerStats(
+    IN  PWUCAPTURESCHEDULER         pScheduler,
+    OUT PWUCAPTURESCHEDULERSTATS    pStats
+    )
+{
+    LONGLONG llNow = _WuGetTicks();
+
+    if ((NULL == pScheduler) || (NULL == pStats))
+    {
+        return FALSE;
+    }
+
+    EnterCriticalSection(&pScheduler->csStats);
+
+    *pStats = pScheduler->stats;
+
+    LeaveCriticalSection(&pScheduler->csStats);
+
+    pStats->ullElapsedMicroseconds = _WuTicksToUnits(
+        llNow - pScheduler->llStart,
+        pScheduler->llFrequency,
+        MICROSECONDS_PER_SECOND);
+
+    return TRUE;
+}
+
+WUAPI UINT
+WuGetCaptureSchedulerTimings(
+    IN  PWUCAPTURESCHEDULER pScheduler,
+    OUT PWUFRAMETIMING      aTimings,
+    IN  UINT                cMaxTimings
+    )
+{
+    ULONGLONG iFirst   = 0;
+    UINT      cTimings = 0;
+    UINT      i        = 0;
+
+    if ((NULL == pScheduler) || (NULL == aTimings))
+    {
+        return 0;
+    }
+
+    EnterCriticalSection(&pScheduler->csStats);
+
+    cTimings = (UINT) min(pScheduler->cHistory,
+                          min(cMaxTimings, WU_CAPTURE_SCHEDULER_HISTORY));
+    iFirst   = pScheduler->cHistory - cTimings;
+
+    for (i = 0; i < cTimings; ++i)
+    {
+        aTimings[i] = pScheduler->aHistory[(iFirst + i)
+                                           % WU_CAPTURE_SCHEDULER_HISTORY];
+    }
+
+    LeaveCriticalSection(&pScheduler->csStats);
+
+    return cTimings;
+}
+
+WUAPI VOID
+WuStopCaptureScheduler(
+    IN PWUCAPTURESCHEDULER  pScheduler
+    )
+{
+    if (NULL == pScheduler)
+    {
+        return;
+    }
+
+    SetEvent(pScheduler->hStopEvent);
+
+    WaitForSingleObject(pScheduler->hThread, INFINITE);
+    CloseHandle(pScheduler->hThread);
+
+    FreeScheduler(pScheduler);
+}
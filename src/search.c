@@ -0,0 +1,916 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       search.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "internal.h"
+
+#define MAX_SEARCH_LEVELS       5
+#define MIN_LEVEL_NEEDLE_SIZE   8
+#define MIN_COMPARED_PIXELS     16
+#define MAX_NEEDLE_WIDTH        16384   /* keeps SIMD row sums in 32 bits */
+
+#define REFINE_RADIUS           2
+#define MIN_CANDIDATES          16
+#define MAX_CANDIDATES          256
+#define CANDIDATES_PER_MATCH    4
+
+#define ROWS_PER_BAND           8
+
+#define COLOR_MASK              0x00FFFFFF
+#define ALPHA_THRESHOLD         128
+
+#define CHANNELS_COMPARED       3
+
+typedef struct tagSEARCHLEVEL {
+    PWUIMAGEDATA    pHaystack;      /* pyramid level, not owned */
+    UINT            uNeedleWidth;
+    UINT            uNeedleHeight;
+    DWORD*          adwNeedle;      /* needle pixels AND adwMask */
+    DWORD*          adwMask;        /* COLOR_MASK, or 0 if ignored */
+    UINT            cCompared;      /* pixels with a non-zero mask */
+    DOUBLE          dbNeedleSum;    /* over compared channels (NCC) */
+    DOUBLE          dbNeedleSqSum;
+} SEARCHLEVEL, *PSEARCHLEVEL;
+
+typedef struct tagCANDIDATE {
+    UINT    x;
+    UINT    y;
+    FLOAT   fScore;
+} CANDIDATE, *PCANDIDATE;
+
+/*
+    Scores are distances internally (lower is better) for every metric,
+    NCC is stored as 1 - correlation and converted back on output.
+*/
+typedef struct tagSEARCH {
+    WU_MATCH_METRIC metric;
+    UINT            cLevels;
+    SEARCHLEVEL     aLevels[MAX_SEARCH_LEVELS];
+    FLOAT*          afScores;       /* score map of the coarsest level */
+    UINT            cPositionsX;
+    UINT            cPositionsY;
+    CANDIDATE       aCandidates[MAX_CANDIDATES];
+    UINT            cCandidates;
+    CANDIDATE       aRanked[MAX_CANDIDATES];
+    UINT            cRanked;
+} SEARCH, *PSEARCH;
+
+static UINT
+AbsDiff(
+    IN DWORD    dwLeft,
+    IN DWORD    dwRight
+    )
+{
+    return (dwLeft > dwRight) ? dwLeft - dwRight : dwRight - dwLeft;
+}
+
+static ULONGLONG
+SadRow(
+    IN CONST DWORD* pdwHaystack,
+    IN CONST DWORD* pdwNeedle,
+    IN CONST DWORD* pdwMask,
+    IN UINT         cPixels
+    )
+{
+    ULONGLONG ullSum = 0;
+    DWORD     dwHay  = 0;
+    DWORD     dwNdl  = 0;
+    UINT      x      = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i sum = _mm_setzero_si128();
+    __m128i hay;
+
+    for (; x + 4 <= cPixels; x += 4)
+    {
+        hay = _mm_and_si128(
+            _mm_loadu_si128((CONST __m128i*) (pdwHaystack + x)),
+            _mm_loadu_si128((CONST __m128i*) (pdwMask + x)));
+
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(hay,
+            _mm_loadu_si128((CONST __m128i*) (pdwNeedle + x))));
+    }
+
+    ullSum = (DWORD) _mm_cvtsi128_si32(sum)
+        + (DWORD) _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        dwHay = pdwHaystack[x] & pdwMask[x];
+        dwNdl = pdwNeedle[x];
+
+        ullSum += AbsDiff(dwHay & 0xFF, dwNdl & 0xFF)
+            + AbsDiff((dwHay >> 8) & 0xFF, (dwNdl >> 8) & 0xFF)
+            + AbsDiff((dwHay >> 16) & 0xFF, (dwNdl >> 16) & 0xFF);
+    }
+
+    return ullSum;
+}
+
+static ULONGLONG
+SsdRow(
+    IN CONST DWORD* pdwHaystack,
+    IN CONST DWORD* pdwNeedle,
+    IN CONST DWORD* pdwMask,
+    IN UINT         cPixels
+    )
+{
+    ULONGLONG ullSum = 0;
+    DWORD     dwHay  = 0;
+    DWORD     dwNdl  = 0;
+    UINT      uDiff  = 0;
+    UINT      x      = 0;
+    UINT      c      = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum  = _mm_setzero_si128();
+    __m128i hay, ndl, diff;
+    DWORD   adwLanes[4];
+
+    for (; x + 4 <= cPixels; x += 4)
+    {
+        hay = _mm_and_si128(
+            _mm_loadu_si128((CONST __m128i*) (pdwHaystack + x)),
+            _mm_loadu_si128((CONST __m128i*) (pdwMask + x)));
+        ndl = _mm_loadu_si128((CONST __m128i*) (pdwNeedle + x));
+
+        diff = _mm_sub_epi16(
+            _mm_unpacklo_epi8(hay, zero),
+            _mm_unpacklo_epi8(ndl, zero));
+        sum  = _mm_add_epi32(sum, _mm_madd_epi16(diff, diff));
+
+        diff = _mm_sub_epi16(
+            _mm_unpackhi_epi8(hay, zero),
+            _mm_unpackhi_epi8(ndl, zero));
+        sum  = _mm_add_epi32(sum, _mm_madd_epi16(diff, diff));
+    }
+
+    _mm_storeu_si128((__m128i*) adwLanes, sum);
+
+    ullSum = (ULONGLONG) adwLanes[0] + adwLanes[1] + adwLanes[2]
+        + adwLanes[3];
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        dwHay = pdwHaystack[x] & pdwMask[x];
+        dwNdl = pdwNeedle[x];
+
+        for (c = 0; c < CHANNELS_COMPARED; ++c)
+        {
+            uDiff   = AbsDiff((dwHay >> (c * 8)) & 0xFF,
+                (dwNdl >> (c * 8)) & 0xFF);
+            ullSum += uDiff * uDiff;
+        }
+    }
+
+    return ullSum;
+}
+
+/* Sums of h, h*h and h*n over the compared channels of one row */
+static VOID
+CorrelationRow(
+    IN     CONST DWORD* pdwHaystack,
+    IN     CONST DWORD* pdwNeedle,
+    IN     CONST DWORD* pdwMask,
+    IN     UINT         cPixels,
+    IN OUT ULONGLONG*   pullSum,
+    IN OUT ULONGLONG*   pullSqSum,
+    IN OUT ULONGLONG*   pullCrossSum
+    )
+{
+    DWORD dwHay = 0;
+    DWORD dwNdl = 0;
+    UINT  uHay  = 0;
+    UINT  x     = 0;
+    UINT  c     = 0;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i zero  = _mm_setzero_si128();
+    __m128i sum   = _mm_setzero_si128();
+    __m128i sqSum = _mm_setzero_si128();
+    __m128i cross = _mm_setzero_si128();
+    __m128i hay, ndl, hay16, ndl16;
+    DWORD   adwSq[4];
+    DWORD   adwCross[4];
+
+    for (; x + 4 <= cPixels; x += 4)
+    {
+        hay = _mm_and_si128(
+            _mm_loadu_si128((CONST __m128i*) (pdwHaystack + x)),
+            _mm_loadu_si128((CONST __m128i*) (pdwMask + x)));
+        ndl = _mm_loadu_si128((CONST __m128i*) (pdwNeedle + x));
+
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(hay, zero));
+
+        hay16 = _mm_unpacklo_epi8(hay, zero);
+        ndl16 = _mm_unpacklo_epi8(ndl, zero);
+        sqSum = _mm_add_epi32(sqSum, _mm_madd_epi16(hay16, hay16));
+        cross = _mm_add_epi32(cross, _mm_madd_epi16(hay16, ndl16));
+
+        hay16 = _mm_unpackhi_epi8(hay, zero);
+        ndl16 = _mm_unpackhi_epi8(ndl, zero);
+        sqSum = _mm_add_epi32(sqSum, _mm_madd_epi16(hay16, hay16));
+        cross = _mm_add_epi32(cross, _mm_madd_epi16(hay16, ndl16));
+    }
+
+    _mm_storeu_si128((__m128i*) adwSq, sqSum);
+    _mm_storeu_si128((__m128i*) adwCross, cross);
+
+    *pullSum += (DWORD) _mm_cvtsi128_si32(sum)
+        + (DWORD) _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    *pullSqSum += (ULONGLONG) adwSq[0] + adwSq[1] + adwSq[2] + adwSq[3];
+    *pullCrossSum += (ULONGLONG) adwCross[0] + adwCross[1] + adwCross[2]
+        + adwCross[3];
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; x < cPixels; ++x)
+    {
+        dwHay = pdwHaystack[x] & pdwMask[x];
+        dwNdl = pdwNeedle[x];
+
+        for (c = 0; c < CHANNELS_COMPARED; ++c)
+        {
+            uHay = (dwHay >> (c * 8)) & 0xFF;
+
+            *pullSum      += uHay;
+            *pullSqSum    += uHay * uHay;
+            *pullCrossSum += uHay * ((dwNdl >> (c * 8)) & 0xFF);
+        }
+    }
+}
+
+static CONST DWORD*
+GetHaystackRow(
+    IN PSEARCHLEVEL pLevel,
+    IN UINT         uX,
+    IN UINT         uY
+    )
+{
+    return (CONST DWORD*) pLevel->pHaystack->abData
+        + (SIZE_T) uY * pLevel->pHaystack->uWidth + uX;
+}
+
+/* Stops as soon as the partial distance exceeds fBound */
+static FLOAT
+DifferenceScore(
+    IN PSEARCHLEVEL pLevel,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN BOOL         bSquared,
+    IN FLOAT        fBound
+    )
+{
+    DOUBLE    dbCount  = (DOUBLE) pLevel->cCompared * CHANNELS_COMPARED;
+    DOUBLE    dbBound  = (DOUBLE) fBound * dbCount;
+    ULONGLONG ullSum   = 0;
+    SIZE_T    iNeedle  = 0;
+    UINT      y        = 0;
+
+    for (y = 0; y < pLevel->uNeedleHeight; ++y)
+    {
+        iNeedle = (SIZE_T) y * pLevel->uNeedleWidth;
+
+        if (TRUE == bSquared)
+        {
+            ullSum += SsdRow(
+                GetHaystackRow(pLevel, uX, uY + y),
+                pLevel->adwNeedle + iNeedle,
+                pLevel->adwMask + iNeedle,
+                pLevel->uNeedleWidth);
+        }
+        else
+        {
+            ullSum += SadRow(
+                GetHaystackRow(pLevel, uX, uY + y),
+                pLevel->adwNeedle + iNeedle,
+                pLevel->adwMask + iNeedle,
+                pLevel->uNeedleWidth);
+        }
+
+        if ((DOUBLE) ullSum > dbBound)
+        {
+            break;
+        }
+    }
+
+    return (FLOAT) ((DOUBLE) ullSum / dbCount);
+}
+
+static FLOAT
+CorrelationScore(
+    IN PSEARCHLEVEL pLevel,
+    IN UINT         uX,
+    IN UINT         uY
+    )
+{
+    DOUBLE    dbCount      = (DOUBLE) pLevel->cCompared * CHANNELS_COMPARED;
+    ULONGLONG ullSum       = 0;
+    ULONGLONG ullSqSum     = 0;
+    ULONGLONG ullCrossSum  = 0;
+    DOUBLE    dbVarHay     = 0.0;
+    DOUBLE    dbVarNeedle  = 0.0;
+    DOUBLE    dbCovariance = 0.0;
+    SIZE_T    iNeedle      = 0;
+    UINT      y            = 0;
+
+    for (y = 0; y < pLevel->uNeedleHeight; ++y)
+    {
+        iNeedle = (SIZE_T) y * pLevel->uNeedleWidth;
+
+        CorrelationRow(
+            GetHaystackRow(pLevel, uX, uY + y),
+            pLevel->adwNeedle + iNeedle,
+            pLevel->adwMask + iNeedle,
+            pLevel->uNeedleWidth,
+            &ullSum,
+            &ullSqSum,
+            &ullCrossSum);
+    }
+
+    dbVarHay = dbCount * (DOUBLE) ullSqSum
+        - (DOUBLE) ullSum * (DOUBLE) ullSum;
+    dbVarNeedle = dbCount * pLevel->dbNeedleSqSum
+        - pLevel->dbNeedleSum * pLevel->dbNeedleSum;
+    dbCovariance = dbCount * (DOUBLE) ullCrossSum
+        - (DOUBLE) ullSum * pLevel->dbNeedleSum;
+
+    if ((dbVarHay <= 0.5) || (dbVarNeedle <= 0.5))
+    {
+        /* flat areas have no correlation, compare their means instead */
+        if ((dbVarHay <= 0.5) && (dbVarNeedle <= 0.5))
+        {
+            return (FLOAT) (fabs((DOUBLE) ullSum - pLevel->dbNeedleSum)
+                / (dbCount * 255.0));
+        }
+
+        return 1.0f;
+    }
+
+    return (FLOAT) (1.0 - dbCovariance / sqrt(dbVarHay * dbVarNeedle));
+}
+
+static FLOAT
+ScorePosition(
+    IN PSEARCH      pSearch,
+    IN PSEARCHLEVEL pLevel,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN FLOAT        fBound
+    )
+{
+    switch (pSearch->metric)
+    {
+        case WU_MATCH_SAD:
+            return DifferenceScore(pLevel, uX, uY, FALSE, fBound);
+
+        case WU_MATCH_SSD:
+            return DifferenceScore(pLevel, uX, uY, TRUE, fBound);
+
+        case WU_MATCH_NCC:
+            return CorrelationScore(pLevel, uX, uY);
+    }
+
+    return FLT_MAX;
+}
+
+static BOOL
+PrepareNeedleLevel(
+    IN PSEARCHLEVEL         pLevel,
+    IN CONST PWUIMAGEDATA   pNeedle,
+    IN CONST SEARCHLEVEL*   pFinerLevel,
+    IN CONST BYTE*          abMask,
+    IN DWORD                dwFlags
+    )
+{
+    CONST DWORD* adwPixels = (CONST DWORD*) pNeedle->abData;
+    CONST DWORD* adwFiner  = NULL;
+    SIZE_T       cbPixels  = 0;
+    SIZE_T       i         = 0;
+    SIZE_T       iTop      = 0;
+    SIZE_T       iBottom   = 0;
+    UINT         uFinerX   = 0;
+    UINT         uNextX    = 0;
+    UINT         x         = 0;
+    UINT         y         = 0;
+    UINT         c         = 0;
+    DWORD        dwMask    = 0;
+    DWORD        dwPixel   = 0;
+
+    pLevel->uNeedleWidth  = pNeedle->uWidth;
+    pLevel->uNeedleHeight = pNeedle->uHeight;
+
+    cbPixels = (SIZE_T) pNeedle->uWidth * pNeedle->uHeight * sizeof(DWORD);
+
+    pLevel->adwNeedle = HeapAlloc(GetProcessHeap(), 0, cbPixels);
+    pLevel->adwMask   = HeapAlloc(GetProcessHeap(), 0, cbPixels);
+
+    if ((NULL == pLevel->adwNeedle) || (NULL == pLevel->adwMask))
+    {
+        return FALSE;
+    }
+
+    for (y = 0; y < pNeedle->uHeight; ++y)
+    {
+        for (x = 0; x < pNeedle->uWidth; ++x)
+        {
+            i       = (SIZE_T) y * pNeedle->uWidth + x;
+            dwPixel = adwPixels[i];
+
+            if (NULL == pFinerLevel)
+            {
+                dwMask = COLOR_MASK;
+
+                if ((abMask != NULL) && (0 == abMask[i]))
+                {
+                    dwMask = 0;
+                }
+
+                if ((dwFlags & WU_FIND_USE_ALPHA)
+                    && ((dwPixel >> 24) < ALPHA_THRESHOLD))
+                {
+                    dwMask = 0;
+                }
+            }
+            else
+            {
+                /* a coarse pixel counts only if all its sources count */
+                adwFiner = pFinerLevel->adwMask;
+                uFinerX  = min(x * 2, pFinerLevel->uNeedleWidth - 1);
+                uNextX   = min(uFinerX + 1, pFinerLevel->uNeedleWidth - 1);
+                iTop     = (SIZE_T) pFinerLevel->uNeedleWidth
+                    * min(y * 2, pFinerLevel->uNeedleHeight - 1);
+                iBottom  = (SIZE_T) pFinerLevel->uNeedleWidth
+                    * min(y * 2 + 1, pFinerLevel->uNeedleHeight - 1);
+
+                dwMask = adwFiner[iTop + uFinerX] & adwFiner[iTop + uNextX]
+                    & adwFiner[iBottom + uFinerX] & adwFiner[iBottom + uNextX];
+            }
+
+            pLevel->adwMask[i]   = dwMask;
+            pLevel->adwNeedle[i] = dwPixel & dwMask;
+
+            if (dwMask != 0)
+            {
+                pLevel->cCompared++;
+
+                for (c = 0; c < CHANNELS_COMPARED; ++c)
+                {
+                    pLevel->dbNeedleSum   += (dwPixel >> (c * 8)) & 0xFF;
+                    pLevel->dbNeedleSqSum += (DOUBLE) ((dwPixel >> (c * 8))
+                        & 0xFF) * ((dwPixel >> (c * 8)) & 0xFF);
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+ScoreBandProc(
+    IN UINT     iBand,
+    IN LPVOID   pContext
+    )
+{
+    PSEARCH      pSearch = (PSEARCH) pContext;
+    PSEARCHLEVEL pLevel  = &pSearch->aLevels[pSearch->cLevels - 1];
+    UINT         uTop    = iBand * ROWS_PER_BAND;
+    UINT         uBottom = min(uTop + ROWS_PER_BAND, pSearch->cPositionsY);
+    UINT         x       = 0;
+    UINT         y       = 0;
+
+    /*
+        Not bounded like the refinement: a score cut short is not exact,
+        and runs of equal cut-off scores would hide the real local minima
+        from IsLocalMinimum.
+    */
+    for (y = uTop; y < uBottom; ++y)
+    {
+        for (x = 0; x < pSearch->cPositionsX; ++x)
+        {
+            pSearch->afScores[(SIZE_T) y * pSearch->cPositionsX + x] =
+                ScorePosition(pSearch, pLevel, x, y, FLT_MAX);
+        }
+    }
+}
+
+/*
+    A tie goes to the neighbour first in scan order, so that a flat run
+    of equal scores (plain UI areas) yields a single candidate instead of
+    one per position, which would crowd out the real minima.
+*/
+static BOOL
+IsLocalMinimum(
+    IN PSEARCH  pSearch,
+    IN UINT     uX,
+    IN UINT     uY
+    )
+{
+    FLOAT fScore     = pSearch->afScores[(SIZE_T) uY * pSearch->cPositionsX
+                                         + uX];
+    FLOAT fNeighbour = 0.0f;
+    UINT  x          = 0;
+    UINT  y          = 0;
+
+    for (y = (uY > 0) ? uY - 1 : 0;
+         y <= min(uY + 1, pSearch->cPositionsY - 1);
+         ++y)
+    {
+        for (x = (uX > 0) ? uX - 1 : 0;
+             x <= min(uX + 1, pSearch->cPositionsX - 1);
+             ++x)
+        {
+            fNeighbour = pSearch->afScores[(SIZE_T) y * pSearch->cPositionsX
+                                           + x];
+
+            if ((fNeighbour < fScore)
+                || ((fNeighbour == fScore)
+                    && ((y < uY) || ((y == uY) && (x < uX)))))
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+    Keeps aCandidates sorted by score, at most cMaxCandidates long and
+    without two candidates closer than uRadius on both axes.
+*/
+static VOID
+InsertCandidate(
+    IN CANDIDATE*   aCandidates,
+    IN OUT UINT*    pcCandidates,
+    IN UINT         cMaxCandidates,
+    IN UINT         uRadius,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN FLOAT        fScore
+    )
+{
+    UINT cCandidates = *pcCandidates;
+    UINT cKept       = 0;
+    UINT i           = 0;
+
+    for (i = 0; i < cCandidates; ++i)
+    {
+        if ((AbsDiff(aCandidates[i].x, uX) < uRadius)
+            && (AbsDiff(aCandidates[i].y, uY) < uRadius)
+            && (aCandidates[i].fScore <= fScore))
+        {
+            return;
+        }
+    }
+
+    /* drop the worse neighbours this candidate replaces */
+    for (i = 0; i < cCandidates; ++i)
+    {
+        if ((AbsDiff(aCandidates[i].x, uX) >= uRadius)
+            || (AbsDiff(aCandidates[i].y, uY) >= uRadius))
+        {
+            aCandidates[cKept++] = aCandidates[i];
+        }
+    }
+
+    cCandidates = cKept;
+
+    if ((cCandidates == cMaxCandidates)
+        && (aCandidates[cCandidates - 1].fScore <= fScore))
+    {
+        *pcCandidates = cCandidates;
+        return;
+    }
+
+    if (cCandidates == cMaxCandidates)
+    {
+        --cCandidates;
+    }
+
+    for (i = cCandidates; (i > 0) && (aCandidates[i - 1].fScore > fScore); --i)
+    {
+        aCandidates[i] = aCandidates[i - 1];
+    }
+
+    aCandidates[i].x      = uX;
+    aCandidates[i].y      = uY;
+    aCandidates[i].fScore = fScore;
+
+    *pcCandidates = cCandidates + 1;
+}
+
+/* Follows one coarse candidate down to level 0 */
+static VOID
+RefineCandidateProc(
+    IN UINT     iCandidate,
+    IN LPVOID   pContext
+    )
+{
+    PSEARCH      pSearch    = (PSEARCH) pContext;
+    PCANDIDATE   pCandidate = &pSearch->aCandidates[iCandidate];
+    PSEARCHLEVEL pLevel     = NULL;
+    UINT         iLevel     = pSearch->cLevels - 1;
+    UINT         uMaxX      = 0;
+    UINT         uMaxY      = 0;
+    UINT         uCenterX   = 0;
+    UINT         uCenterY   = 0;
+    UINT         uBestX     = 0;
+    UINT         uBestY     = 0;
+    FLOAT        fBest      = 0.0f;
+    FLOAT        fScore     = 0.0f;
+    UINT         x          = 0;
+    UINT         y          = 0;
+
+    uBestX = pCandidate->x;
+    uBestY = pCandidate->y;
+    fBest  = pCandidate->fScore;
+
+    while (iLevel-- > 0)
+    {
+        pLevel = &pSearch->aLevels[iLevel];
+
+        uMaxX    = pLevel->pHaystack->uWidth - pLevel->uNeedleWidth;
+        uMaxY    = pLevel->pHaystack->uHeight - pLevel->uNeedleHeight;
+        uCenterX = min(uBestX * 2, uMaxX);
+        uCenterY = min(uBestY * 2, uMaxY);
+        fBest    = FLT_MAX;
+
+        for (y = (uCenterY > REFINE_RADIUS) ? uCenterY - REFINE_RADIUS : 0;
+             y <= min(uCenterY + REFINE_RADIUS, uMaxY);
+             ++y)
+        {
+            for (x = (uCenterX > REFINE_RADIUS) ? uCenterX - REFINE_RADIUS : 0;
+                 x <= min(uCenterX + REFINE_RADIUS, uMaxX);
+                 ++x)
+            {
+                fScore = ScorePosition(pSearch, pLevel, x, y, fBest);
+
+                if (fScore < fBest)
+                {
+                    fBest  = fScore;
+                    uBestX = x;
+                    uBestY = y;
+                }
+            }
+        }
+    }
+
+    pCandidate->x      = uBestX;
+    pCandidate->y      = uBestY;
+    pCandidate->fScore = fBest;
+}
+
+static VOID
+FreeSearch(
+    IN PSEARCH  pSearch
+    )
+{
+    UINT i = 0;
+
+    for (i = 0; i < MAX_SEARCH_LEVELS; ++i)
+    {
+        if (pSearch->aLevels[i].adwNeedle != NULL)
+        {
+            HeapFree(GetProcessHeap(), 0, pSearch->aLevels[i].adwNeedle);
+        }
+
+        if (pSearch->aLevels[i].adwMask != NULL)
+        {
+            HeapFree(GetProcessHeap(), 0, pSearch->aLevels[i].adwMask);
+        }
+    }
+
+    if (pSearch->afScores != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pSearch->afScores);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pSearch);
+}
+
+static UINT
+CountSearchLevels(
+    IN CONST PWUIMAGEDATA   pNeedle
+    )
+{
+    UINT cLevels = 1;
+
+    while ((cLevels < MAX_SEARCH_LEVELS)
+        && (((pNeedle->uWidth + (1u << cLevels) - 1) >> cLevels)
+                >= MIN_LEVEL_NEEDLE_SIZE)
+        && (((pNeedle->uHeight + (1u << cLevels) - 1) >> cLevels)
+                >= MIN_LEVEL_NEEDLE_SIZE))
+    {
+        ++cLevels;
+    }
+
+    return cLevels;
+}
+
+WUAPI UINT
+WuFindImageData(
+    IN  CONST PWUIMAGEDATA  pHaystack,
+    IN  CONST PWUIMAGEDATA  pNeedle,
+    IN  CONST BYTE*         abMask,
+    IN  WU_MATCH_METRIC     metric,
+    IN  FLOAT               fThreshold,
+    IN  DWORD               dwFlags,
+    OUT PWUIMAGEMATCH       aMatches,
+    IN  UINT                cMaxMatches
+    )
+{
+    PSEARCH         pSearch          = NULL;
+    PWUIMAGEPYRAMID pHaystackPyramid = NULL;
+    PWUIMAGEPYRAMID pNeedlePyramid   = NULL;
+    PSEARCHLEVEL    pCoarsest        = NULL;
+    FLOAT           fMaxDistance     = 0.0f;
+    UINT            cMaxCandidates   = 0;
+    UINT            uRadius          = 0;
+    UINT            cMatches         = 0;
+    UINT            x                = 0;
+    UINT            y                = 0;
+    UINT            i                = 0;
+
+    if ((NULL == pHaystack) || (NULL == pHaystack->abData)
+        || (NULL == pNeedle) || (NULL == pNeedle->abData)
+        || (NULL == aMatches) || (0 == cMaxMatches))
+    {
+        return 0;
+    }
+
+    if ((metric != WU_MATCH_SAD) && (metric != WU_MATCH_SSD)
+        && (metric != WU_MATCH_NCC))
+    {
+        return 0;
+    }
+
+    if ((0 == pNeedle->uWidth) || (0 == pNeedle->uHeight)
+        || (pNeedle->uWidth > MAX_NEEDLE_WIDTH)
+        || (pNeedle->uWidth > pHaystack->uWidth)
+        || (pNeedle->uHeight > pHaystack->uHeight))
+    {
+        return 0;
+    }
+
+    fMaxDistance = (WU_MATCH_NCC == metric) ? 1.0f - fThreshold : fThreshold;
+
+    pSearch = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(SEARCH));
+
+    if (NULL == pSearch)
+    {
+        return 0;
+    }
+
+    pSearch->metric  = metric;
+    pSearch->cLevels = CountSearchLevels(pNeedle);
+
+    pHaystackPyramid = WuBuildImagePyramid(
+        pHaystack,
+        WU_PYRAMID_FILTER_BOX,
+        pSearch->cLevels,
+        0);
+
+    pNeedlePyramid = WuBuildImagePyramid(
+        pNeedle,
+        WU_PYRAMID_FILTER_BOX,
+        pSearch->cLevels,
+        0);
+
+    if ((NULL == pHaystackPyramid) || (NULL == pNeedlePyramid))
+    {
+        goto cleanup;
+    }
+
+    for (i = 0; i < pSearch->cLevels; ++i)
+    {
+        pSearch->aLevels[i].pHaystack = &pHaystackPyramid->aLevels[i];
+
+        if (PrepareNeedleLevel(
+                &pSearch->aLevels[i],
+                &pNeedlePyramid->aLevels[i],
+                (0 == i) ? NULL : &pSearch->aLevels[i - 1],
+                abMask,
+                dwFlags) == FALSE)
+        {
+            goto cleanup;
+        }
+
+        if ((0 == i) && (0 == pSearch->aLevels[0].cCompared))
+        {
+            goto cleanup;   /* everything is masked out */
+        }
+
+        /* heavily masked needles lose their shape when downsampled */
+        if ((i > 0) && (pSearch->aLevels[i].cCompared < MIN_COMPARED_PIXELS))
+        {
+            pSearch->cLevels = i;
+            break;
+        }
+    }
+
+    /* exhaustive search of the coarsest level */
+    pCoarsest = &pSearch->aLevels[pSearch->cLevels - 1];
+
+    pSearch->cPositionsX = pCoarsest->pHaystack->uWidth
+        - pCoarsest->uNeedleWidth + 1;
+    pSearch->cPositionsY = pCoarsest->pHaystack->uHeight
+        - pCoarsest->uNeedleHeight + 1;
+
+    pSearch->afScores = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) pSearch->cPositionsX * pSearch->cPositionsY * sizeof(FLOAT));
+
+    if (NULL == pSearch->afScores)
+    {
+        goto cleanup;
+    }
+
+    _WuParallelFor(
+        (pSearch->cPositionsY + ROWS_PER_BAND - 1) / ROWS_PER_BAND,
+        ScoreBandProc,
+        pSearch);
+
+    /*
+        Coarse minima are only approximate (the needle and haystack
+        pyramids need not be in phase), so nearby minima are all kept
+        here and merged after refinement.
+    */
+    cMaxCandidates = min(MAX_CANDIDATES,
+        max(MIN_CANDIDATES, cMaxMatches * CANDIDATES_PER_MATCH));
+
+    for (y = 0; y < pSearch->cPositionsY; ++y)
+    {
+        for (x = 0; x < pSearch->cPositionsX; ++x)
+        {
+            if (IsLocalMinimum(pSearch, x, y) == TRUE)
+            {
+                InsertCandidate(
+                    pSearch->aCandidates,
+                    &pSearch->cCandidates,
+                    cMaxCandidates,
+                    1,
+                    x, y,
+                    pSearch->afScores[(SIZE_T) y * pSearch->cPositionsX + x]);
+            }
+        }
+    }
+
+    if (pSearch->cLevels > 1)
+    {
+        _WuParallelFor(pSearch->cCandidates, RefineCandidateProc, pSearch);
+    }
+
+    /* final ranking at full resolution, overlapping matches collapse */
+    uRadius = max(1, min(pNeedle->uWidth, pNeedle->uHeight) / 2);
+
+    for (i = 0; i < pSearch->cCandidates; ++i)
+    {
+        if (pSearch->aCandidates[i].fScore <= fMaxDistance)
+        {
+            InsertCandidate(
+                pSearch->aRanked,
+                &pSearch->cRanked,
+                MAX_CANDIDATES,
+                uRadius,
+                pSearch->aCandidates[i].x,
+                pSearch->aCandidates[i].y,
+                pSearch->aCandidates[i].fScore);
+        }
+    }
+
+    cMatches = min(pSearch->cRanked, cMaxMatches);
+
+    for (i = 0; i < cMatches; ++i)
+    {
+        aMatches[i].x      = pSearch->aRanked[i].x;
+        aMatches[i].y      = pSearch->aRanked[i].y;
+        aMatches[i].fScore = (WU_MATCH_NCC == metric)
+            ? 1.0f - pSearch->aRanked[i].fScore
+            : pSearch->aRanked[i].fScore;
+    }
+
+cleanup:
+    WuDestroyImagePyramid(pNeedlePyramid);
+    WuDestroyImagePyramid(pHaystackPyramid);
+
+    FreeSearch(pSearch);
+
+    return cMatches;
+}
@@ -0,0 +1,636 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       tiled.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+#define TILE_SIZE               WU_TILED_IMAGE_TILE_SIZE
+#define TILE_MAX_BYTES          \
+    (TILE_SIZE * TILE_SIZE * WU_IMAGEDATA_BYTES_PER_PIXEL)
+
+#define DEFAULT_RESIDENT_TILES  64      /* 16 MiB of 256x256 tiles */
+
+#define NO_TILE                 MAXUINT
+#define NO_SLOT                 MAXUINT
+
+#define TEMP_FILE_PREFIX        L"wut"
+
+typedef struct tagTILESLOT {
+    UINT        uTile;          /* NO_TILE while the slot is free */
+    UINT        cLocks;
+    BOOL        bDirty;
+    ULONGLONG   uLastUse;
+    WUIMAGEDATA view;
+} TILESLOT, *PTILESLOT;
+
+/*
+    Every tile owns a fixed TILE_MAX_BYTES region of the backing file, at
+    offset uTile * TILE_MAX_BYTES. Only the resident tiles live in memory;
+    the least recently used unlocked slot is written back and reused when
+    a tile that is not resident gets locked.
+*/
+struct tagWUTILEDIMAGE {
+    UINT                uWidth;
+    UINT                uHeight;
+    UINT                cTilesX;
+    UINT                cTilesY;
+    HANDLE              hFile;
+    CRITICAL_SECTION    csCache;
+    UINT*               auTileSlot;     /* tile -> slot, or NO_SLOT */
+    BYTE*               abTileStored;   /* tile has been written to file */
+    PTILESLOT           aSlots;
+    UINT                cSlots;
+    BYTE*               abSlotPixels;
+    ULONGLONG           uUseClock;
+};
+
+static HANDLE
+CreateBackingFile(
+    VOID
+    )
+{
+    WCHAR  szTempDirectory[MAX_PATH];
+    WCHAR  szTempPath[MAX_PATH];
+    DWORD  cchTempDirectory = 0;
+    HANDLE hFile            = INVALID_HANDLE_VALUE;
+
+    cchTempDirectory = GetTempPathW(MAX_PATH, szTempDirectory);
+
+    if ((0 == cchTempDirectory) || (cchTempDirectory >= MAX_PATH))
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (GetTempFileNameW(szTempDirectory, TEMP_FILE_PREFIX, 0,
+            szTempPath) == 0)
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    /* the file disappears together with the last handle */
+    hFile = CreateFileW(
+        szTempPath,
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+        NULL);
+
+    /* GetTempFileNameW already created it, do not leave it behind */
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        DeleteFileW(szTempPath);
+    }
+
+    return hFile;
+}
+
+static BOOL
+TransferTile(
+    IN     PWUTILEDIMAGE    pTiledImage,
+    IN     UINT             uTile,
+    IN OUT BYTE*            pbPixels,
+    IN     DWORD            cbPixels,
+    IN     BOOL             bWrite
+    )
+{
+    LARGE_INTEGER liOffset;
+    DWORD         cbTransferred = 0;
+    BOOL          bResult       = FALSE;
+
+    liOffset.QuadPart = (LONGLONG) uTile * TILE_MAX_BYTES;
+
+    if (SetFilePointerEx(pTiledImage->hFile, liOffset, NULL,
+            FILE_BEGIN) == FALSE)
+    {
+        return FALSE;
+    }
+
+    if (TRUE == bWrite)
+    {
+        bResult = WriteFile(
+            pTiledImage->hFile,
+            pbPixels,
+            cbPixels,
+            &cbTransferred,
+            NULL);
+    }
+    else
+    {
+        bResult = ReadFile(
+            pTiledImage->hFile,
+            pbPixels,
+            cbPixels,
+            &cbTransferred,
+            NULL);
+    }
+
+    return (bResult && (cbTransferred == cbPixels));
+}
+
+static DWORD
+GetTileByteSize(
+    IN PTILESLOT    pSlot
+    )
+{
+    return pSlot->view.uWidth * pSlot->view.uHeight
+        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+}
+
+static BOOL
+WriteBackSlot(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN PTILESLOT        pSlot
+    )
+{
+    if ((NO_TILE == pSlot->uTile) || (FALSE == pSlot->bDirty))
+    {
+        return TRUE;
+    }
+
+    if (TransferTile(pTiledImage, pSlot->uTile, pSlot->view.abData,
+            GetTileByteSize(pSlot), TRUE) == FALSE)
+    {
+        return FALSE;
+    }
+
+    pTiledImage->abTileStored[pSlot->uTile] = TRUE;
+    pSlot->bDirty = FALSE;
+
+    return TRUE;
+}
+
+static PTILESLOT
+FindVictimSlot(
+    IN PWUTILEDIMAGE    pTiledImage
+    )
+{
+    PTILESLOT pVictim = NULL;
+    PTILESLOT pSlot   = NULL;
+    UINT      i       = 0;
+
+    for (i = 0; i < pTiledImage->cSlots; ++i)
+    {
+        pSlot = &pTiledImage->aSlots[i];
+
+        if (NO_TILE == pSlot->uTile)
+        {
+            return pSlot;
+        }
+
+        if ((0 == pSlot->cLocks)
+            && ((NULL == pVictim) || (pSlot->uLastUse < pVictim->uLastUse)))
+        {
+            pVictim = pSlot;
+        }
+    }
+
+    return pVictim;     /* NULL if every resident tile is locked */
+}
+
+static PTILESLOT
+PageInTile(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN UINT             uTileX,
+    IN UINT             uTileY
+    )
+{
+    PTILESLOT pSlot = NULL;
+    UINT      uTile = uTileY * pTiledImage->cTilesX + uTileX;
+
+    pSlot = FindVictimSlot(pTiledImage);
+
+    if (NULL == pSlot)
+    {
+        return NULL;
+    }
+
+    if (WriteBackSlot(pTiledImage, pSlot) == FALSE)
+    {
+        return NULL;
+    }
+
+    if (pSlot->uTile != NO_TILE)
+    {
+        pTiledImage->auTileSlot[pSlot->uTile] = NO_SLOT;
+        pSlot->uTile = NO_TILE;
+    }
+
+    pSlot->view.uWidth  = min(TILE_SIZE, pTiledImage->uWidth
+        - uTileX * TILE_SIZE);
+    pSlot->view.uHeight = min(TILE_SIZE, pTiledImage->uHeight
+        - uTileY * TILE_SIZE);
+
+    if (TRUE == pTiledImage->abTileStored[uTile])
+    {
+        if (TransferTile(pTiledImage, uTile, pSlot->view.abData,
+                GetTileByteSize(pSlot), FALSE) == FALSE)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        /* never written: no need to touch the file */
+        ZeroMemory(pSlot->view.abData, GetTileByteSize(pSlot));
+    }
+
+    pSlot->uTile  = uTile;
+    pSlot->bDirty = FALSE;
+
+    pTiledImage->auTileSlot[uTile] = (UINT) (pSlot - pTiledImage->aSlots);
+
+    return pSlot;
+}
+
+WUAPI PWUTILEDIMAGE
+WuCreateTiledImage(
+    IN UINT uWidth,
+    IN UINT uHeight,
+    IN UINT cMaxResidentTiles
+    )
+{
+    PWUTILEDIMAGE pTiledImage = NULL;
+    ULONGLONG     cTiles      = 0;
+    UINT          i           = 0;
+
+    if ((0 == uWidth) || (0 == uHeight))
+    {
+        return NULL;
+    }
+
+    if (0 == cMaxResidentTiles)
+    {
+        cMaxResidentTiles = DEFAULT_RESIDENT_TILES;
+    }
+
+    cTiles = (ULONGLONG) ((uWidth + (ULONGLONG) TILE_SIZE - 1) / TILE_SIZE)
+        * ((uHeight + (ULONGLONG) TILE_SIZE - 1) / TILE_SIZE);
+
+    if (cTiles >= NO_TILE)
+    {
+        return NULL;
+    }
+
+    pTiledImage = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(struct tagWUTILEDIMAGE));
+
+    if (NULL == pTiledImage)
+    {
+        return NULL;
+    }
+
+    pTiledImage->uWidth  = uWidth;
+    pTiledImage->uHeight = uHeight;
+    pTiledImage->cTilesX = (UINT) ((uWidth + (ULONGLONG) TILE_SIZE - 1)
+        / TILE_SIZE);
+    pTiledImage->cTilesY = (UINT) ((uHeight + (ULONGLONG) TILE_SIZE - 1)
+        / TILE_SIZE);
+    pTiledImage->cSlots  = (UINT) min(cMaxResidentTiles, cTiles);
+    pTiledImage->hFile   = CreateBackingFile();
+
+    if (INVALID_HANDLE_VALUE == pTiledImage->hFile)
+    {
+        HeapFree(GetProcessHeap(), 0, pTiledImage);
+        return NULL;
+    }
+
+    InitializeCriticalSection(&pTiledImage->csCache);
+
+    pTiledImage->auTileSlot = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) cTiles * sizeof(UINT));
+
+    pTiledImage->abTileStored = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        (SIZE_T) cTiles);
+
+    pTiledImage->aSlots = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        (SIZE_T) pTiledImage->cSlots * sizeof(TILESLOT));
+
+    pTiledImage->abSlotPixels = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        (SIZE_T) pTiledImage->cSlots * TILE_MAX_BYTES);
+
+    if ((NULL == pTiledImage->auTileSlot)
+        || (NULL == pTiledImage->abTileStored)
+        || (NULL == pTiledImage->aSlots)
+        || (NULL == pTiledImage->abSlotPixels))
+    {
+        WuDestroyTiledImage(pTiledImage);
+        return NULL;
+    }
+
+    for (i = 0; i < (UINT) cTiles; ++i)
+    {
+        pTiledImage->auTileSlot[i] = NO_SLOT;
+    }
+
+    for (i = 0; i < pTiledImage->cSlots; ++i)
+    {
+        pTiledImage->aSlots[i].uTile       = NO_TILE;
+        pTiledImage->aSlots[i].view.abData = pTiledImage->abSlotPixels
+            + (SIZE_T) i * TILE_MAX_BYTES;
+    }
+
+    return pTiledImage;
+}
+
+WUAPI VOID
+WuTiledImageGetSize(
+    IN  PWUTILEDIMAGE   pTiledImage,
+    OUT PUINT           puWidth,
+    OUT PUINT           puHeight
+    )
+{
+    if (NULL == pTiledImage)
+    {
+        return;
+    }
+
+    if (puWidth != NULL)
+    {
+        *puWidth = pTiledImage->uWidth;
+    }
+
+    if (puHeight != NULL)
+    {
+        *puHeight = pTiledImage->uHeight;
+    }
+}
+
+WUAPI PWUIMAGEDATA
+WuTiledImageLockTile(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN UINT             uTileX,
+    IN UINT             uTileY,
+    IN DWORD            dwFlags
+    )
+{
+    PTILESLOT pSlot = NULL;
+    UINT      uSlot = NO_SLOT;
+
+    if (NULL == pTiledImage)
+    {
+        return NULL;
+    }
+
+    if ((uTileX >= pTiledImage->cTilesX) || (uTileY >= pTiledImage->cTilesY))
+    {
+        return NULL;
+    }
+
+    EnterCriticalSection(&pTiledImage->csCache);
+
+    uSlot = pTiledImage->auTileSlot[uTileY * pTiledImage->cTilesX + uTileX];
+
+    if (uSlot != NO_SLOT)
+    {
+        pSlot = &pTiledImage->aSlots[uSlot];
+    }
+    else
+    {
+        pSlot = PageInTile(pTiledImage, uTileX, uTileY);
+    }
+
+    if (pSlot != NULL)
+    {
+        pSlot->cLocks++;
+        pSlot->uLastUse = ++pTiledImage->uUseClock;
+
+        if (dwFlags & WU_TILE_LOCK_WRITE)
+        {
+            pSlot->bDirty = TRUE;
+        }
+    }
+
+    LeaveCriticalSection(&pTiledImage->csCache);
+
+    return (pSlot != NULL) ? &pSlot->view : NULL;
+}
+
+WUAPI VOID
+WuTiledImageUnlockTile(
+    IN PWUTILEDIMAGE    pTiledImage,
+    IN UINT             uTileX,
+    IN UINT             uTileY
+    )
+{
+    UINT uSlot = NO_SLOT;
+
+    if (NULL == pTiledImage)
+    {
+        return;
+    }
+
+    if ((uTileX >= pTiledImage->cTilesX) || (uTileY >= pTiledImage->cTilesY))
+    {
+        return;
+    }
+
+    EnterCriticalSection(&pTiledImage->csCache);
+
+    uSlot = pTiledImage->auTileSlot[uTileY * pTiledImage->cTilesX + uTileX];
+
+    if ((uSlot != NO_SLOT) && (pTiledImage->aSlots[uSlot].cLocks > 0))
+    {
+        pTiledImage->aSlots[uSlot].cLocks--;
+    }
+
+    LeaveCriticalSection(&pTiledImage->csCache);
+}
+
+static BOOL
+TransferRect(
+    IN     PWUTILEDIMAGE    pTiledImage,
+    IN     UINT             uX,
+    IN     UINT             uY,
+    IN OUT PWUIMAGEDATA     pImageData,
+    IN     BOOL             bWrite
+    )
+{
+    PWUIMAGEDATA pTile   = NULL;
+    UINT         uTileX  = 0;
+    UINT         uTileY  = 0;
+    UINT         uLeft   = 0;
+    UINT         uTop    = 0;
+    UINT         uRight  = 0;
+    UINT         uBottom = 0;
+    UINT         y       = 0;
+    BYTE*        pbImage = NULL;
+    BYTE*        pbTile  = NULL;
+    SIZE_T       cbSpan  = 0;
+
+    if ((NULL == pTiledImage) || (NULL == pImageData)
+        || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    if ((uX >= pTiledImage->uWidth) || (uY >= pTiledImage->uHeight)
+        || (pImageData->uWidth > pTiledImage->uWidth - uX)
+        || (pImageData->uHeight > pTiledImage->uHeight - uY))
+    {
+        return FALSE;
+    }
+
+    for (uTileY = uY / TILE_SIZE;
+         uTileY <= (uY + pImageData->uHeight - 1) / TILE_SIZE;
+         ++uTileY)
+    {
+        for (uTileX = uX / TILE_SIZE;
+             uTileX <= (uX + pImageData->uWidth - 1) / TILE_SIZE;
+             ++uTileX)
+        {
+            pTile = WuTiledImageLockTile(
+                pTiledImage,
+                uTileX, uTileY,
+                bWrite ? WU_TILE_LOCK_WRITE : 0);
+
+            if (NULL == pTile)
+            {
+                return FALSE;
+            }
+
+            /* intersection of the rect and the tile, in canvas pixels */
+            uLeft   = max(uX, uTileX * TILE_SIZE);
+            uTop    = max(uY, uTileY * TILE_SIZE);
+            uRight  = min(uX + pImageData->uWidth,
+                uTileX * TILE_SIZE + pTile->uWidth);
+            uBottom = min(uY + pImageData->uHeight,
+                uTileY * TILE_SIZE + pTile->uHeight);
+
+            cbSpan = (SIZE_T) (uRight - uLeft) * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+            for (y = uTop; y < uBottom; ++y)
+            {
+                pbImage = pImageData->abData
+                    + ((SIZE_T) (y - uY) * pImageData->uWidth + (uLeft - uX))
+                        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+                pbTile = pTile->abData
+                    + ((SIZE_T) (y - uTileY * TILE_SIZE) * pTile->uWidth
+                        + (uLeft - uTileX * TILE_SIZE))
+                        * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+                if (TRUE == bWrite)
+                {
+                    CopyMemory(pbTile, pbImage, cbSpan);
+                }
+                else
+                {
+                    CopyMemory(pbImage, pbTile, cbSpan);
+                }
+            }
+
+            WuTiledImageUnlockTile(pTiledImage, uTileX, uTileY);
+        }
+    }
+
+    return TRUE;
+}
+
+WUAPI BOOL
+WuTiledImageReadRect(
+    IN  PWUTILEDIMAGE   pTiledImage,
+    IN  UINT            uX,
+    IN  UINT            uY,
+    OUT PWUIMAGEDATA    pImageData
+    )
+{
+    return TransferRect(pTiledImage, uX, uY, pImageData, FALSE);
+}
+
+WUAPI BOOL
+WuTiledImageWriteRect(
+    IN PWUTILEDIMAGE        pTiledImage,
+    IN UINT                 uX,
+    IN UINT                 uY,
+    IN CONST PWUIMAGEDATA   pImageData
+    )
+{
+    return TransferRect(pTiledImage, uX, uY, pImageData, TRUE);
+}
+
+WUAPI BOOL
+WuTiledImageFlush(
+    IN PWUTILEDIMAGE    pTiledImage
+    )
+{
+    BOOL bResult = TRUE;
+    UINT i       = 0;
+
+    if (NULL == pTiledImage)
+    {
+        return FALSE;
+    }
+
+    EnterCriticalSection(&pTiledImage->csCache);
+
+    for (i = 0; i < pTiledImage->cSlots; ++i)
+    {
+        if (WriteBackSlot(pTiledImage, &pTiledImage->aSlots[i]) == FALSE)
+        {
+            bResult = FALSE;
+        }
+    }
+
+    LeaveCriticalSection(&pTiledImage->csCache);
+
+    return bResult;
+}
+
+WUAPI VOID
+WuDestroyTiledImage(
+    IN PWUTILEDIMAGE    pTiledImage
+    )
+{
+    if (NULL == pTiledImage)
+    {
+        return;
+    }
+
+    if (pTiledImage->abSlotPixels != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pTiledImage->abSlotPixels);
+    }
+
+    if (pTiledImage->aSlots != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pTiledImage->aSlots);
+    }
+
+    if (pTiledImage->abTileStored != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pTiledImage->abTileStored);
+    }
+
+    if (pTiledImage->auTileSlot != NULL)
+    {
+        HeapFree(GetProcessHeap(), 0, pTiledImage->auTileSlot);
+    }
+
+    DeleteCriticalSection(&pTiledImage->csCache);
+
+    /* FILE_FLAG_DELETE_ON_CLOSE removes the backing file */
+    CloseHandle(pTiledImage->hFile);
+
+    HeapFree(GetProcessHeap(), 0, pTiledImage);
+}
@@ -0,0 +1,494 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       transform.c
+ *
+ ***************************************************************************/
+
+#include "winutilz.h"
+
+#include "internal.h"
+
+/*
+    Rotations are done in BLOCK_SIZE x BLOCK_SIZE pixel tiles so that both
+    the source rows and the destination rows of a tile stay in L1 cache
+    (32 * 32 * 4 bytes = 4 KiB each). Every tile is split into 4x4 pixel
+    blocks which are transposed in registers.
+*/
+#define BLOCK_SIZE  32
+
+typedef enum {
+    TRANSPOSE_MODE_ROTATE_90,       /* (x, y) -> (h - 1 - y, x)     */
+    TRANSPOSE_MODE_ROTATE_270       /* (x, y) -> (y, w - 1 - x)     */
+} TRANSPOSE_MODE;
+
+/*
+    Transposes a 4x4 block of 32-bit pixels. apSrcRows[i] points to the
+    first pixel of source row i, apDstRows[i] receives output row i.
+*/
+static WU_INLINE VOID
+Transpose4x4(
+    IN  CONST DWORD*    apSrcRows[4],
+    OUT DWORD*          apDstRows[4]
+    )
+{
+#ifdef _WU_HAVE_SSE2
+    __m128i r0, r1, r2, r3;
+    __m128i t0, t1, t2, t3;
+
+    r0 = _mm_loadu_si128((CONST __m128i*) apSrcRows[0]);
+    r1 = _mm_loadu_si128((CONST __m128i*) apSrcRows[1]);
+    r2 = _mm_loadu_si128((CONST __m128i*) apSrcRows[2]);
+    r3 = _mm_loadu_si128((CONST __m128i*) apSrcRows[3]);
+
+    t0 = _mm_unpacklo_epi32(r0, r1);    /* a0 b0 a1 b1 */
+    t1 = _mm_unpacklo_epi32(r2, r3);    /* c0 d0 c1 d1 */
+    t2 = _mm_unpackhi_epi32(r0, r1);    /* a2 b2 a3 b3 */
+    t3 = _mm_unpackhi_epi32(r2, r3);    /* c2 d2 c3 d3 */
+
+    _mm_storeu_si128((__m128i*) apDstRows[0], _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*) apDstRows[1], _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*) apDstRows[2], _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i*) apDstRows[3], _mm_unpackhi_epi64(t2, t3));
+#else /* _WU_HAVE_SSE2 */
+    UINT i = 0;
+
+    for (i = 0; i < 4; ++i)
+    {
+        apDstRows[i][0] = apSrcRows[0][i];
+        apDstRows[i][1] = apSrcRows[1][i];
+        apDstRows[i][2] = apSrcRows[2][i];
+        apDstRows[i][3] = apSrcRows[3][i];
+    }
+#endif /* _WU_HAVE_SSE2 */
+}
+
+static VOID
+TransposeTile(
+    IN  CONST DWORD*    pdwSrc,
+    IN  UINT            uSrcWidth,
+    IN  UINT            uSrcHeight,
+    OUT DWORD*          pdwDst,
+    IN  TRANSPOSE_MODE  mode,
+    IN  UINT            uTileX,
+    IN  UINT            uTileY,
+    IN  UINT            uTileWidth,
+    IN  UINT            uTileHeight
+    )
+{
+    CONST DWORD* apSrcRows[4];
+    DWORD*       apDstRows[4];
+    UINT         uDstWidth = uSrcHeight;
+    UINT         x         = 0;
+    UINT         y         = 0;
+    UINT         i         = 0;
+    UINT         uDstX     = 0;
+    UINT         uDstY     = 0;
+
+    for (y = uTileY; y + 4 <= uTileY + uTileHeight; y += 4)
+    {
+        for (x = uTileX; x + 4 <= uTileX + uTileWidth; x += 4)
+        {
+            for (i = 0; i < 4; ++i)
+            {
+                if (TRANSPOSE_MODE_ROTATE_90 == mode)
+                {
+                    /* reversed row order mirrors the transposed block */
+                    apSrcRows[i] = pdwSrc
+                        + (SIZE_T) (y + 3 - i) * uSrcWidth + x;
+
+                    uDstX = uSrcHeight - 4 - y;
+                    uDstY = x + i;
+                }
+                else
+                {
+                    apSrcRows[i] = pdwSrc + (SIZE_T) (y + i) * uSrcWidth + x;
+
+                    uDstX = y;
+                    uDstY = uSrcWidth - 1 - (x + i);
+                }
+
+                apDstRows[i] = pdwDst + (SIZE_T) uDstY * uDstWidth + uDstX;
+            }
+
+            Transpose4x4(apSrcRows, apDstRows);
+        }
+
+        /* columns left over on the right edge of the tile */
+        for (; x < uTileX + uTileWidth; ++x)
+        {
+            for (i = 0; i < 4; ++i)
+            {
+                if (TRANSPOSE_MODE_ROTATE_90 == mode)
+                {
+                    uDstX = uSrcHeight - 1 - (y + i);
+                    uDstY = x;
+                }
+                else
+                {
+                    uDstX = y + i;
+                    uDstY = uSrcWidth - 1 - x;
+                }
+
+                pdwDst[(SIZE_T) uDstY * uDstWidth + uDstX] =
+                    pdwSrc[(SIZE_T) (y + i) * uSrcWidth + x];
+            }
+        }
+    }
+
+    /* rows left over on the bottom edge of the tile */
+    for (; y < uTileY + uTileHeight; ++y)
+    {
+        for (x = uTileX; x < uTileX + uTileWidth; ++x)
+        {
+            if (TRANSPOSE_MODE_ROTATE_90 == mode)
+            {
+                uDstX = uSrcHeight - 1 - y;
+                uDstY = x;
+            }
+            else
+            {
+                uDstX = y;
+                uDstY = uSrcWidth - 1 - x;
+            }
+
+            pdwDst[(SIZE_T) uDstY * uDstWidth + uDstX] =
+                pdwSrc[(SIZE_T) y * uSrcWidth + x];
+        }
+    }
+}
+
+static VOID
+TransposeBlocked(
+    IN  CONST PWUIMAGEDATA  pSrc,
+    OUT BYTE*               pbDst,
+    IN  TRANSPOSE_MODE      mode
+    )
+{
+    UINT uTileX      = 0;
+    UINT uTileY      = 0;
+    UINT uTileWidth  = 0;
+    UINT uTileHeight = 0;
+
+    for (uTileY = 0; uTileY < pSrc->uHeight; uTileY += BLOCK_SIZE)
+    {
+        uTileHeight = min(BLOCK_SIZE, pSrc->uHeight - uTileY);
+
+        for (uTileX = 0; uTileX < pSrc->uWidth; uTileX += BLOCK_SIZE)
+        {
+            uTileWidth = min(BLOCK_SIZE, pSrc->uWidth - uTileX);
+
+            TransposeTile(
+                (CONST DWORD*) pSrc->abData,
+                pSrc->uWidth,
+                pSrc->uHeight,
+                (DWORD*) pbDst,
+                mode,
+                uTileX, uTileY,
+                uTileWidth, uTileHeight);
+        }
+    }
+}
+
+/*
+    Reverses cPixels 32-bit pixels from pdwSrc into pdwDst. The two ranges
+    must either not overlap or be the same range (in-place reversal).
+*/
+static VOID
+ReversePixels(
+    IN  CONST DWORD*    pdwSrc,
+    OUT DWORD*          pdwDst,
+    IN  SIZE_T          cPixels
+    )
+{
+    SIZE_T i = 0;
+    SIZE_T j = cPixels;
+    DWORD  dwLeft;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i left, right;
+
+    /* swap 4 pixels from each end per iteration */
+    while (j - i >= 8)
+    {
+        left  = _mm_loadu_si128((CONST __m128i*) (pdwSrc + i));
+        right = _mm_loadu_si128((CONST __m128i*) (pdwSrc + j - 4));
+
+        left  = _mm_shuffle_epi32(left,  _MM_SHUFFLE(0, 1, 2, 3));
+        right = _mm_shuffle_epi32(right, _MM_SHUFFLE(0, 1, 2, 3));
+
+        _mm_storeu_si128((__m128i*) (pdwDst + i), right);
+        _mm_storeu_si128((__m128i*) (pdwDst + j - 4), left);
+
+        i += 4;
+        j -= 4;
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    while (j > i + 1)
+    {
+        dwLeft        = pdwSrc[i];
+        pdwDst[i]     = pdwSrc[j - 1];
+        pdwDst[j - 1] = dwLeft;
+
+        ++i;
+        --j;
+    }
+
+    if (j == i + 1)
+    {
+        pdwDst[i] = pdwSrc[i];  /* middle pixel of an odd range */
+    }
+}
+
+static VOID
+SwapRows(
+    IN OUT BYTE*    pbFirst,
+    IN OUT BYTE*    pbSecond,
+    IN     SIZE_T   cbRow
+    )
+{
+    SIZE_T i = 0;
+    BYTE   bTemp;
+
+#ifdef _WU_HAVE_SSE2
+    __m128i first, second;
+
+    for (; i + 16 <= cbRow; i += 16)
+    {
+        first  = _mm_loadu_si128((CONST __m128i*) (pbFirst + i));
+        second = _mm_loadu_si128((CONST __m128i*) (pbSecond + i));
+
+        _mm_storeu_si128((__m128i*) (pbFirst + i), second);
+        _mm_storeu_si128((__m128i*) (pbSecond + i), first);
+    }
+#endif /* _WU_HAVE_SSE2 */
+
+    for (; i < cbRow; ++i)
+    {
+        bTemp       = pbFirst[i];
+        pbFirst[i]  = pbSecond[i];
+        pbSecond[i] = bTemp;
+    }
+}
+
+static VOID
+FlipInto(
+    IN  CONST PWUIMAGEDATA  pSrc,
+    OUT BYTE*               pbDst,
+    IN  WU_IMAGE_FLIP       flip
+    )
+{
+    SIZE_T cbRow = (SIZE_T) pSrc->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+    UINT   y     = 0;
+
+    for (y = 0; y < pSrc->uHeight; ++y)
+    {
+        if (WU_IMAGE_FLIP_HORIZONTAL == flip)
+        {
+            ReversePixels(
+                (CONST DWORD*) (pSrc->abData + y * cbRow),
+                (DWORD*) (pbDst + y * cbRow),
+                pSrc->uWidth);
+        }
+        else
+        {
+            CopyMemory(
+                pbDst + (pSrc->uHeight - 1 - y) * cbRow,
+                pSrc->abData + y * cbRow,
+                cbRow);
+        }
+    }
+}
+
+WUAPI PWUIMAGEDATA
+WuRotateImageData(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_ROTATION    rotation
+    )
+{
+    PWUIMAGEDATA pRotated = NULL;
+    SIZE_T       cPixels  = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return NULL;
+    }
+
+    switch (rotation)
+    {
+        case WU_IMAGE_ROTATE_90:
+        case WU_IMAGE_ROTATE_270:
+            pRotated = _WuCreateUninitializedImageData(
+                pImageData->uHeight,
+                pImageData->uWidth);
+            break;
+        case WU_IMAGE_ROTATE_180:
+            pRotated = _WuCreateUninitializedImageData(
+                pImageData->uWidth,
+                pImageData->uHeight);
+            break;
+        default:
+            return NULL;
+    }
+
+    if (NULL == pRotated)
+    {
+        return NULL;
+    }
+
+    switch (rotation)
+    {
+        case WU_IMAGE_ROTATE_90:
+            TransposeBlocked(
+                pImageData,
+                pRotated->abData,
+                TRANSPOSE_MODE_ROTATE_90);
+            break;
+        case WU_IMAGE_ROTATE_270:
+            TransposeBlocked(
+                pImageData,
+                pRotated->abData,
+                TRANSPOSE_MODE_ROTATE_270);
+            break;
+        case WU_IMAGE_ROTATE_180:
+            cPixels = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+
+            ReversePixels(
+                (CONST DWORD*) pImageData->abData,
+                (DWORD*) pRotated->abData,
+                cPixels);
+            break;
+    }
+
+    return pRotated;
+}
+
+WUAPI BOOL
+WuRotateImageDataInPlace(
+    IN PWUIMAGEDATA         pImageData,
+    IN WU_IMAGE_ROTATION    rotation
+    )
+{
+    PWUIMAGEDATA pRotated = NULL;
+    SIZE_T       cPixels  = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    if (WU_IMAGE_ROTATE_180 == rotation)
+    {
+        cPixels = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+
+        ReversePixels(
+            (CONST DWORD*) pImageData->abData,
+            (DWORD*) pImageData->abData,
+            cPixels);
+
+        return TRUE;
+    }
+
+    /*
+        A quarter turn of a non-square image changes its size, and abData
+        may be borrowed (views, capture frames, pyramid levels), so it is
+        refused rather than reallocated; WuRotateImageData handles it.
+    */
+    if (pImageData->uWidth != pImageData->uHeight)
+    {
+        return FALSE;
+    }
+
+    pRotated = WuRotateImageData(pImageData, rotation);
+
+    if (NULL == pRotated)
+    {
+        return FALSE;
+    }
+
+    cPixels = (SIZE_T) pImageData->uWidth * pImageData->uHeight;
+
+    CopyMemory(
+        pImageData->abData,
+        pRotated->abData,
+        cPixels * WU_IMAGEDATA_BYTES_PER_PIXEL);
+
+    WuDestroyImageData(pRotated);
+
+    return TRUE;
+}
+
+WUAPI PWUIMAGEDATA
+WuFlipImageData(
+    IN CONST PWUIMAGEDATA   pImageData,
+    IN WU_IMAGE_FLIP        flip
+    )
+{
+    PWUIMAGEDATA pFlipped = NULL;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return NULL;
+    }
+
+    if ((flip != WU_IMAGE_FLIP_HORIZONTAL) && (flip != WU_IMAGE_FLIP_VERTICAL))
+    {
+        return NULL;
+    }
+
+    pFlipped = _WuCreateUninitializedImageData(
+        pImageData->uWidth,
+        pImageData->uHeight);
+
+    if (NULL == pFlipped)
+    {
+        return NULL;
+    }
+
+    FlipInto(pImageData, pFlipped->abData, flip);
+
+    return pFlipped;
+}
+
+WUAPI BOOL
+WuFlipImageDataInPlace(
+    IN PWUIMAGEDATA     pImageData,
+    IN WU_IMAGE_FLIP    flip
+    )
+{
+    SIZE_T cbRow = 0;
+    UINT   y     = 0;
+
+    if ((NULL == pImageData) || (NULL == pImageData->abData))
+    {
+        return FALSE;
+    }
+
+    cbRow = (SIZE_T) pImageData->uWidth * WU_IMAGEDATA_BYTES_PER_PIXEL;
+
+    switch (flip)
+    {
+        case WU_IMAGE_FLIP_HORIZONTAL:
+            FlipInto(pImageData, pImageData->abData, flip);
+            break;
+        case WU_IMAGE_FLIP_VERTICAL:
+            for (y = 0; y < pImageData->uHeight / 2; ++y)
+            {
+                SwapRows(
+                    pImageData->abData + y * cbRow,
+                    pImageData->abData
+                        + (pImageData->uHeight - 1 - y) * cbRow,
+                    cbRow);
+            }
+            break;
+        default:
+            return FALSE;
+    }
+
+    return TRUE;
+}
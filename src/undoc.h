@@ -94,6 +94,25 @@ NtResumeProcess(
     IN HANDLE   hProcessHandle
     );
 
+extern NTSYSAPI NTSTATUS NTAPI
+RtlGetCompressionWorkSpaceSize(
+    IN  USHORT  uCompressionFormatAndEngine,
+    OUT PULONG  pcbCompressBufferWorkSpace,
+    OUT PULONG  pcbCompressFragmentWorkSpace
+    );
+
+extern NTSYSAPI NTSTATUS NTAPI
+RtlCompressBuffer(
+    IN  USHORT  uCompressionFormatAndEngine,
+    IN  PUCHAR  pbUncompressedBuffer,
+    IN  ULONG   cbUncompressedBuffer,
+    OUT PUCHAR  pbCompressedBuffer,
+    IN  ULONG   cbCompressedBuffer,
+    IN  ULONG   cbUncompressedChunkSize,
+    OUT PULONG  pcbFinalCompressedSize,
+    IN  PVOID   pWorkSpace
+    );
+
 /*
     +-------------------------------------------------------------------+
     |   WINBRAND.DLL                                                    |
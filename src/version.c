@@ -23,7 +23,7 @@
 static WUVERSIONA g_wuVersionA = INIT_WUVERSION(PROJECT_VERSION_A);
 static WUVERSIONW g_wuVersionW = INIT_WUVERSION(PROJECT_VERSION_W);
 
-WUAPI CONST PWUVERSIONW
+WUAPI PWUVERSIONW
 WuGetVersionExW(
     LPVOID  lpReserved
     )
@@ -31,7 +31,7 @@ WuGetVersionExW(
     return &g_wuVersionW;
 }
 
-WUAPI CONST PWUVERSIONA
+WUAPI PWUVERSIONA
 WuGetVersionExA(
     LPVOID  lpReserved
     )
@@ -0,0 +1,98 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#include <string.h>
+
+PWUIMAGEDATA
+TestCreateImage(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwSeed
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    DWORD*       pdwPixel   = NULL;
+    DWORD        dwState    = dwSeed | 1;
+    UINT         x          = 0;
+    UINT         y          = 0;
+
+    pImageData = WuCreateEmptyImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    pdwPixel = (DWORD*) pImageData->abData;
+
+    for (y = 0; y < uHeight; ++y)
+    {
+        for (x = 0; x < uWidth; ++x)
+        {
+            /* xorshift32 */
+            dwState ^= dwState << 13;
+            dwState ^= dwState >> 17;
+            dwState ^= dwState << 5;
+
+            *pdwPixel++ = 0xFF000000
+                | ((x * 255 / max(uWidth, 1)) << 16)
+                | ((y * 255 / max(uHeight, 1)) << 8)
+                | (dwState & 0xFF);
+        }
+    }
+
+    return pImageData;
+}
+
+BOOL
+TestImagesEqual(
+    IN CONST PWUIMAGEDATA   pLeft,
+    IN CONST PWUIMAGEDATA   pRight
+    )
+{
+    if ((pLeft->uWidth != pRight->uWidth)
+        || (pLeft->uHeight != pRight->uHeight))
+    {
+        return FALSE;
+    }
+
+    return memcmp(pLeft->abData, pRight->abData,
+        (SIZE_T) pLeft->uWidth * pLeft->uHeight
+            * WU_IMAGEDATA_BYTES_PER_PIXEL) == 0;
+}
+
+INT
+main(
+    VOID
+    )
+{
+    UINT cFailed = 0;
+    UINT i       = 0;
+
+    for (i = 0; i < g_cTestCases; ++i)
+    {
+        if (g_aTestCases[i].pfnTest() == TRUE)
+        {
+            printf("ok      %s\n", g_aTestCases[i].szName);
+        }
+        else
+        {
+            printf("FAILED  %s\n", g_aTestCases[i].szName);
+            ++cFailed;
+        }
+    }
+
+    printf("%u of %u failed\n", cFailed, g_cTestCases);
+
+    return (INT) cFailed;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test.h
+ *
+ ***************************************************************************/
+
+#ifndef TEST_H_INCLUDED
+#define TEST_H_INCLUDED
+
+#include <windows.h>
+
+#include <stdio.h>
+
+#include <winutilz.h>
+
+/*
+    Every test_<file>.c defines g_aTestCases; test.c runs them in order
+    and the process exit code is the number of failed cases.
+*/
+typedef BOOL (*TESTPROC)(VOID);
+
+typedef struct tagTESTCASE {
+    LPCSTR      szName;
+    TESTPROC    pfnTest;
+} TESTCASE, *PTESTCASE;
+
+extern CONST TESTCASE g_aTestCases[];
+extern CONST UINT     g_cTestCases;
+
+/* Fails the current case, which must clean up through a cleanup label */
+#define TEST_CHECK(expr)                                            \
+    do                                                              \
+    {                                                               \
+        if (!(expr))                                                \
+        {                                                           \
+            fprintf(stderr, "%s(%d): check failed: %s\n",           \
+                __FILE__, __LINE__, #expr);                         \
+            goto cleanup;                                           \
+        }                                                           \
+    } while (0)
+
+/***************************************************************************
+ *  test.c
+ ***************************************************************************/
+
+/* Deterministic image of mixed gradients and noise */
+PWUIMAGEDATA
+TestCreateImage(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwSeed
+    );
+
+BOOL
+TestImagesEqual(
+    IN CONST PWUIMAGEDATA   pLeft,
+    IN CONST PWUIMAGEDATA   pRight
+    );
+
+#endif /* TEST_H_INCLUDED */
@@ -0,0 +1,258 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test_delta.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#define FRAME_WIDTH     300         /* not a multiple of the tile size */
+#define FRAME_HEIGHT    200
+#define TILE_SIZE       64
+
+static VOID
+SetPixel(
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         uX,
+    IN UINT         uY,
+    IN DWORD        dwPixel
+    )
+{
+    ((DWORD*) pImageData->abData)[(SIZE_T) uY * pImageData->uWidth + uX] =
+        dwPixel;
+}
+
+static BOOL
+TestFirstFrameIsWhole(
+    VOID
+    )
+{
+    PWUFRAMEDIFF  pDiff   = NULL;
+    PWUIMAGEDATA  pFrame  = NULL;
+    PWUIMAGEDATA  pTarget = NULL;
+    PWUFRAMEDELTA pDelta  = NULL;
+    BOOL          bResult = FALSE;
+
+    pDiff   = WuCreateFrameDiff(TILE_SIZE);
+    pFrame  = TestCreateImage(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    pTarget = WuCreateEmptyImageData(FRAME_WIDTH, FRAME_HEIGHT);
+
+    TEST_CHECK((pDiff != NULL) && (pFrame != NULL) && (pTarget != NULL));
+
+    pDelta = WuFrameDiffCompare(pDiff, pFrame, 0);
+
+    TEST_CHECK(pDelta != NULL);
+    TEST_CHECK(pDelta->cDirtyTiles == pDelta->cTiles);
+    TEST_CHECK(pDelta->cbPixels
+        == (SIZE_T) FRAME_WIDTH * FRAME_HEIGHT * 4);
+
+    TEST_CHECK(WuApplyFrameDelta(pTarget, pDelta) == TRUE);
+    TEST_CHECK(TestImagesEqual(pTarget, pFrame) == TRUE);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyFrameDiff(pDiff);
+    WuDestroyImageData(pFrame);
+    WuDestroyImageData(pTarget);
+
+    return bResult;
+}
+
+static BOOL
+TestIdenticalFramesGiveEmptyDelta(
+    VOID
+    )
+{
+    PWUFRAMEDIFF  pDiff   = NULL;
+    PWUIMAGEDATA  pFrame  = NULL;
+    PWUFRAMEDELTA pDelta  = NULL;
+    BOOL          bResult = FALSE;
+
+    pDiff  = WuCreateFrameDiff(TILE_SIZE);
+    pFrame = TestCreateImage(FRAME_WIDTH, FRAME_HEIGHT, 2);
+
+    TEST_CHECK((pDiff != NULL) && (pFrame != NULL));
+    TEST_CHECK(WuFrameDiffCompare(pDiff, pFrame, 0) != NULL);
+
+    pDelta = WuFrameDiffCompare(pDiff, pFrame, 0);
+
+    TEST_CHECK(pDelta != NULL);
+    TEST_CHECK(0 == pDelta->cDirtyTiles);
+    TEST_CHECK(0 == pDelta->cRects);
+    TEST_CHECK(0 == pDelta->cbPixels);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyFrameDiff(pDiff);
+    WuDestroyImageData(pFrame);
+
+    return bResult;
+}
+
+static BOOL
+TestSingleChangedPixelGivesOneRect(
+    VOID
+    )
+{
+    PWUFRAMEDIFF  pDiff   = NULL;
+    PWUIMAGEDATA  pFrame  = NULL;
+    PWUFRAMEDELTA pDelta  = NULL;
+    PWUDIRTYRECT  pRect   = NULL;
+    BOOL          bResult = FALSE;
+
+    pDiff  = WuCreateFrameDiff(TILE_SIZE);
+    pFrame = TestCreateImage(FRAME_WIDTH, FRAME_HEIGHT, 3);
+
+    TEST_CHECK((pDiff != NULL) && (pFrame != NULL));
+    TEST_CHECK(WuFrameDiffCompare(pDiff, pFrame, 0) != NULL);
+
+    /* in the last, partial tile column */
+    SetPixel(pFrame, 290, 100, 0xFF123456);
+
+    pDelta = WuFrameDiffCompare(pDiff, pFrame, 0);
+
+    TEST_CHECK(pDelta != NULL);
+    TEST_CHECK(1 == pDelta->cDirtyTiles);
+    TEST_CHECK(1 == pDelta->cRects);
+
+    pRect = &pDelta->aRects[0];
+
+    TEST_CHECK((256 == pRect->uX) && (64 == pRect->uY));
+    TEST_CHECK((44 == pRect->uWidth) && (64 == pRect->uHeight));
+    TEST_CHECK(pDelta->cbPixels
+        == (SIZE_T) pRect->uWidth * pRect->uHeight * 4);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyFrameDiff(pDiff);
+    WuDestroyImageData(pFrame);
+
+    return bResult;
+}
+
+static BOOL
+TestRoundTrip(
+    VOID
+    )
+{
+    PWUFRAMEDIFF  pDiff    = NULL;
+    PWUIMAGEDATA  pFrame   = NULL;
+    PWUIMAGEDATA  pReplica = NULL;
+    PWUFRAMEDELTA pDelta   = NULL;
+    UINT          uFrame   = 0;
+    UINT          i        = 0;
+    BOOL          bResult  = FALSE;
+
+    pDiff    = WuCreateFrameDiff(TILE_SIZE);
+    pFrame   = TestCreateImage(FRAME_WIDTH, FRAME_HEIGHT, 4);
+    pReplica = WuCreateEmptyImageData(FRAME_WIDTH, FRAME_HEIGHT);
+
+    TEST_CHECK((pDiff != NULL) && (pFrame != NULL) && (pReplica != NULL));
+
+    /* the replica only ever sees deltas */
+    for (uFrame = 0; uFrame < 8; ++uFrame)
+    {
+        for (i = 0; i < uFrame * 5; ++i)
+        {
+            SetPixel(pFrame,
+                (uFrame * 37 + i * 53) % FRAME_WIDTH,
+                (uFrame * 11 + i * 29) % FRAME_HEIGHT,
+                0xFF000000 | (uFrame << 16) | i);
+        }
+
+        pDelta = WuFrameDiffCompare(pDiff, pFrame, 0);
+
+        TEST_CHECK(pDelta != NULL);
+        TEST_CHECK(WuApplyFrameDelta(pReplica, pDelta) == TRUE);
+        TEST_CHECK(TestImagesEqual(pReplica, pFrame) == TRUE);
+    }
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyFrameDiff(pDiff);
+    WuDestroyImageData(pFrame);
+    WuDestroyImageData(pReplica);
+
+    return bResult;
+}
+
+static BOOL
+TestMalformedDeltaIsRejected(
+    VOID
+    )
+{
+    PWUFRAMEDIFF  pDiff   = NULL;
+    PWUIMAGEDATA  pFrame  = NULL;
+    PWUIMAGEDATA  pTarget = NULL;
+    PWUIMAGEDATA  pBlank  = NULL;
+    PWUFRAMEDELTA pDelta  = NULL;
+    WUFRAMEDELTA  forged;
+    WUDIRTYRECT   rect;
+    BOOL          bResult = FALSE;
+
+    pDiff   = WuCreateFrameDiff(TILE_SIZE);
+    pFrame  = TestCreateImage(FRAME_WIDTH, FRAME_HEIGHT, 5);
+    pTarget = WuCreateEmptyImageData(FRAME_WIDTH, FRAME_HEIGHT);
+    pBlank  = WuCreateEmptyImageData(FRAME_WIDTH, FRAME_HEIGHT);
+
+    TEST_CHECK((pDiff != NULL) && (pFrame != NULL)
+        && (pTarget != NULL) && (pBlank != NULL));
+
+    pDelta = WuFrameDiffCompare(pDiff, pFrame, 0);
+
+    TEST_CHECK(pDelta != NULL);
+
+    /* truncated pixels: nothing may be read past cbPixels or applied */
+    forged          = *pDelta;
+    forged.cbPixels = pDelta->cbPixels - 1;
+
+    TEST_CHECK(WuApplyFrameDelta(pTarget, &forged) == FALSE);
+    TEST_CHECK(TestImagesEqual(pTarget, pBlank) == TRUE);
+
+    /* a rectangle reaching past the frame */
+    rect.uX      = FRAME_WIDTH - 1;
+    rect.uY      = 0;
+    rect.uWidth  = 2;
+    rect.uHeight = 1;
+
+    forged.cRects   = 1;
+    forged.aRects   = &rect;
+    forged.cbPixels = pDelta->cbPixels;
+
+    TEST_CHECK(WuApplyFrameDelta(pTarget, &forged) == FALSE);
+
+    /* a frame of another size */
+    forged        = *pDelta;
+    forged.uWidth = FRAME_WIDTH + 1;
+
+    TEST_CHECK(WuApplyFrameDelta(pTarget, &forged) == FALSE);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyFrameDiff(pDiff);
+    WuDestroyImageData(pFrame);
+    WuDestroyImageData(pTarget);
+    WuDestroyImageData(pBlank);
+
+    return bResult;
+}
+
+CONST TESTCASE g_aTestCases[] = {
+    { "first_frame_is_whole",           TestFirstFrameIsWhole },
+    { "identical_frames_empty_delta",   TestIdenticalFramesGiveEmptyDelta },
+    { "single_pixel_one_rect",          TestSingleChangedPixelGivesOneRect },
+    { "round_trip",                     TestRoundTrip },
+    { "malformed_delta_rejected",       TestMalformedDeltaIsRejected },
+};
+
+CONST UINT g_cTestCases = sizeof(g_aTestCases) / sizeof(g_aTestCases[0]);
@@ -0,0 +1,522 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test_dib.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#define DIB_BUFFER_SIZE     1024
+
+#define HEADER_SIZE         sizeof(BITMAPINFOHEADER)
+#define V5_HEADER_SIZE      124     /* sizeof(BITMAPV5HEADER) */
+
+static BYTE g_abDib[DIB_BUFFER_SIZE];
+
+static VOID
+WriteDword(
+    OUT BYTE*   pb,
+    IN  DWORD   dwValue
+    )
+{
+    pb[0] = (BYTE) dwValue;
+    pb[1] = (BYTE) (dwValue >> 8);
+    pb[2] = (BYTE) (dwValue >> 16);
+    pb[3] = (BYTE) (dwValue >> 24);
+}
+
+/* Clears g_abDib and writes a header of cbHeader bytes, returns cbHeader */
+static SIZE_T
+WriteHeader(
+    IN LONG     lWidth,
+    IN LONG     lHeight,
+    IN WORD     wBitCount,
+    IN DWORD    dwCompression,
+    IN DWORD    cbHeader,
+    IN DWORD    cClrUsed
+    )
+{
+    BITMAPINFOHEADER header;
+
+    ZeroMemory(g_abDib, sizeof(g_abDib));
+    ZeroMemory(&header, sizeof(header));
+
+    header.biSize        = cbHeader;
+    header.biWidth       = lWidth;
+    header.biHeight      = lHeight;
+    header.biPlanes      = 1;
+    header.biBitCount    = wBitCount;
+    header.biCompression = dwCompression;
+    header.biClrUsed     = cClrUsed;
+
+    CopyMemory(g_abDib, &header, sizeof(header));
+
+    return cbHeader;
+}
+
+static DWORD
+GetPixel(
+    IN CONST WUIMAGEDATA*   pImageData,
+    IN UINT                 uX,
+    IN UINT                 uY
+    )
+{
+    return ((CONST DWORD*) pImageData->abData)[
+        (SIZE_T) uY * pImageData->uWidth + uX];
+}
+
+/* Converts the first cbDib bytes of g_abDib from an exact-size copy */
+static PWUIMAGEDATA
+ConvertExact(
+    IN SIZE_T   cbDib
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    BYTE*        pbDib      = NULL;
+
+    /* at least one byte, so that an empty buffer is not a NULL one */
+    pbDib = (BYTE*) HeapAlloc(GetProcessHeap(), 0, max(cbDib, 1));
+
+    if (NULL == pbDib)
+    {
+        return NULL;
+    }
+
+    CopyMemory(pbDib, g_abDib, cbDib);
+
+    pImageData = WuImageDataFromPackedDib(pbDib, cbDib);
+
+    HeapFree(GetProcessHeap(), 0, pbDib);
+
+    return pImageData;
+}
+
+static BOOL
+TestBottomUpRows(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    UINT         x          = 0;
+    UINT         y          = 0;
+    BOOL         bResult    = FALSE;
+
+    cbOffset = WriteHeader(5, 3, 32, BI_RGB, HEADER_SIZE, 0);
+
+    for (y = 0; y < 3; ++y)
+    {
+        for (x = 0; x < 5; ++x)
+        {
+            WriteDword(g_abDib + cbOffset + (y * 5 + x) * 4,
+                       (y << 16) | (x << 8) | 0x12);
+        }
+    }
+
+    pImageData = ConvertExact(cbOffset + 5 * 3 * 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK((5 == pImageData->uWidth) && (3 == pImageData->uHeight));
+
+    /* the first stored row is the bottom one, alpha is forced opaque */
+    for (y = 0; y < 3; ++y)
+    {
+        for (x = 0; x < 5; ++x)
+        {
+            TEST_CHECK(GetPixel(pImageData, x, y)
+                == (0xFF000000 | ((2 - y) << 16) | (x << 8) | 0x12));
+        }
+    }
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestTopDownRows(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BYTE*        pbPixel    = NULL;
+    UINT         x          = 0;
+    UINT         y          = 0;
+    BOOL         bResult    = FALSE;
+
+    /* 24 bpp rows of 3 pixels are padded from 9 to 12 bytes */
+    cbOffset = WriteHeader(3, -2, 24, BI_RGB, HEADER_SIZE, 0);
+
+    for (y = 0; y < 2; ++y)
+    {
+        for (x = 0; x < 3; ++x)
+        {
+            pbPixel    = g_abDib + cbOffset + y * 12 + x * 3;
+            pbPixel[0] = (BYTE) x;
+            pbPixel[1] = (BYTE) y;
+            pbPixel[2] = 0x07;
+        }
+    }
+
+    pImageData = ConvertExact(cbOffset + 2 * 12);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK((3 == pImageData->uWidth) && (2 == pImageData->uHeight));
+
+    for (y = 0; y < 2; ++y)
+    {
+        for (x = 0; x < 3; ++x)
+        {
+            TEST_CHECK(GetPixel(pImageData, x, y)
+                == (0xFF070000 | (y << 8) | x));
+        }
+    }
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestPalette1Bpp(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BOOL         bResult    = FALSE;
+
+    /* biClrUsed of 0 means the full two-entry palette */
+    cbOffset = WriteHeader(10, 1, 1, BI_RGB, HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + cbOffset, 0x00000000);
+    WriteDword(g_abDib + cbOffset + 4, 0x00FFFFFF);
+
+    cbOffset += 2 * sizeof(RGBQUAD);
+
+    /* 1010 0000 01.. */
+    g_abDib[cbOffset]     = 0xA0;
+    g_abDib[cbOffset + 1] = 0x40;
+
+    pImageData = ConvertExact(cbOffset + 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0xFFFFFFFF);
+    TEST_CHECK(GetPixel(pImageData, 1, 0) == 0xFF000000);
+    TEST_CHECK(GetPixel(pImageData, 2, 0) == 0xFFFFFFFF);
+    TEST_CHECK(GetPixel(pImageData, 7, 0) == 0xFF000000);
+    TEST_CHECK(GetPixel(pImageData, 8, 0) == 0xFF000000);
+    TEST_CHECK(GetPixel(pImageData, 9, 0) == 0xFFFFFFFF);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestPalette4Bpp(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BOOL         bResult    = FALSE;
+
+    cbOffset = WriteHeader(5, 2, 4, BI_RGB, HEADER_SIZE, 3);
+
+    /* the reserved byte of an entry must not leak into alpha */
+    WriteDword(g_abDib + cbOffset, 0x00112233);
+    WriteDword(g_abDib + cbOffset + 4, 0x00445566);
+    WriteDword(g_abDib + cbOffset + 8, 0x778899AA);
+
+    cbOffset += 3 * sizeof(RGBQUAD);
+
+    /* bottom row 0, 1, 2, 15, 1; top row all 2 */
+    g_abDib[cbOffset]     = 0x01;
+    g_abDib[cbOffset + 1] = 0x2F;
+    g_abDib[cbOffset + 2] = 0x10;
+    g_abDib[cbOffset + 4] = 0x22;
+    g_abDib[cbOffset + 5] = 0x22;
+    g_abDib[cbOffset + 6] = 0x20;
+
+    pImageData = ConvertExact(cbOffset + 2 * 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 1) == 0xFF112233);
+    TEST_CHECK(GetPixel(pImageData, 1, 1) == 0xFF445566);
+    TEST_CHECK(GetPixel(pImageData, 2, 1) == 0xFF8899AA);
+    TEST_CHECK(GetPixel(pImageData, 4, 1) == 0xFF445566);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0xFF8899AA);
+    TEST_CHECK(GetPixel(pImageData, 4, 0) == 0xFF8899AA);
+
+    /* past biClrUsed */
+    TEST_CHECK(GetPixel(pImageData, 3, 1) == 0xFF000000);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestPalette8Bpp(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BOOL         bResult    = FALSE;
+
+    cbOffset = WriteHeader(3, 1, 8, BI_RGB, HEADER_SIZE, 2);
+
+    WriteDword(g_abDib + cbOffset, 0x00102030);
+    WriteDword(g_abDib + cbOffset + 4, 0x00405060);
+
+    cbOffset += 2 * sizeof(RGBQUAD);
+
+    g_abDib[cbOffset]     = 1;
+    g_abDib[cbOffset + 1] = 0;
+    g_abDib[cbOffset + 2] = 200;
+
+    pImageData = ConvertExact(cbOffset + 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0xFF405060);
+    TEST_CHECK(GetPixel(pImageData, 1, 0) == 0xFF102030);
+    TEST_CHECK(GetPixel(pImageData, 2, 0) == 0xFF000000);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestRgb555(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BOOL         bResult    = FALSE;
+
+    cbOffset = WriteHeader(4, 1, 16, BI_RGB, HEADER_SIZE, 0);
+
+    /* red, green, blue and white with the unused top bit set */
+    g_abDib[cbOffset]     = 0x00;
+    g_abDib[cbOffset + 1] = 0x7C;
+    g_abDib[cbOffset + 2] = 0xE0;
+    g_abDib[cbOffset + 3] = 0x03;
+    g_abDib[cbOffset + 4] = 0x1F;
+    g_abDib[cbOffset + 5] = 0x00;
+    g_abDib[cbOffset + 6] = 0xFF;
+    g_abDib[cbOffset + 7] = 0xFF;
+
+    pImageData = ConvertExact(cbOffset + 8);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0xFFFF0000);
+    TEST_CHECK(GetPixel(pImageData, 1, 0) == 0xFF00FF00);
+    TEST_CHECK(GetPixel(pImageData, 2, 0) == 0xFF0000FF);
+    TEST_CHECK(GetPixel(pImageData, 3, 0) == 0xFFFFFFFF);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestV5AlphaBitfields(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    UINT         x          = 0;
+    BOOL         bResult    = FALSE;
+
+    /* V5 masks live inside the header, R G B A */
+    cbOffset = WriteHeader(6, -1, 32, BI_BITFIELDS, V5_HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + HEADER_SIZE, 0x00FF0000);
+    WriteDword(g_abDib + HEADER_SIZE + 4, 0x0000FF00);
+    WriteDword(g_abDib + HEADER_SIZE + 8, 0x000000FF);
+    WriteDword(g_abDib + HEADER_SIZE + 12, 0xFF000000);
+
+    for (x = 0; x < 6; ++x)
+    {
+        WriteDword(g_abDib + cbOffset + x * 4, ((x * 40) << 24) | 0x123456);
+    }
+
+    pImageData = ConvertExact(cbOffset + 6 * 4);
+
+    TEST_CHECK(pImageData != NULL);
+
+    for (x = 0; x < 6; ++x)
+    {
+        TEST_CHECK(GetPixel(pImageData, x, 0)
+            == (((x * 40) << 24) | 0x123456));
+    }
+
+    WuDestroyImageData(pImageData);
+
+    /* R in the low byte and 4-bit alpha go through the generic path */
+    cbOffset = WriteHeader(1, 1, 32, BI_BITFIELDS, V5_HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + HEADER_SIZE, 0x000000FF);
+    WriteDword(g_abDib + HEADER_SIZE + 4, 0x0000FF00);
+    WriteDword(g_abDib + HEADER_SIZE + 8, 0x00FF0000);
+    WriteDword(g_abDib + HEADER_SIZE + 12, 0x0F000000);
+    WriteDword(g_abDib + cbOffset, 0x08332211);
+
+    pImageData = ConvertExact(cbOffset + 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0x88112233);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestTruncatedBuffersRejected(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    SIZE_T       cbDib      = 0;
+    BOOL         bResult    = FALSE;
+
+    /* palette, then 3 rows of 4 bytes; every shorter buffer must fail */
+    cbOffset = WriteHeader(7, 3, 4, BI_RGB, HEADER_SIZE, 16);
+
+    for (cbDib = 0; cbDib < cbOffset + 16 * sizeof(RGBQUAD) + 3 * 4; ++cbDib)
+    {
+        pImageData = ConvertExact(cbDib);
+
+        TEST_CHECK(NULL == pImageData);
+    }
+
+    pImageData = ConvertExact(cbDib);
+
+    TEST_CHECK(pImageData != NULL);
+
+    WuDestroyImageData(pImageData);
+
+    /* masks after a 40-byte header, then one 16 bpp row */
+    cbOffset = WriteHeader(2, 1, 16, BI_BITFIELDS, HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + cbOffset, 0xF800);
+    WriteDword(g_abDib + cbOffset + 4, 0x07E0);
+    WriteDword(g_abDib + cbOffset + 8, 0x001F);
+
+    for (cbDib = 0; cbDib < cbOffset + 3 * sizeof(DWORD) + 4; ++cbDib)
+    {
+        pImageData = ConvertExact(cbDib);
+
+        TEST_CHECK(NULL == pImageData);
+    }
+
+    pImageData = ConvertExact(cbDib);
+
+    TEST_CHECK(pImageData != NULL);
+
+    WuDestroyImageData(pImageData);
+
+    /* a header claiming to be larger than the buffer */
+    WriteHeader(1, 1, 32, BI_RGB, V5_HEADER_SIZE, 0);
+
+    pImageData = ConvertExact(HEADER_SIZE + 4);
+
+    TEST_CHECK(NULL == pImageData);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+static BOOL
+TestZeroColorMaskRejected(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    SIZE_T       cbOffset   = 0;
+    BOOL         bResult    = FALSE;
+
+    /* no green mask: used to divide by zero when scaling the channel */
+    cbOffset = WriteHeader(1, 1, 16, BI_BITFIELDS, HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + cbOffset, 0x7C00);
+    WriteDword(g_abDib + cbOffset + 4, 0x0000);
+    WriteDword(g_abDib + cbOffset + 8, 0x001F);
+    WriteDword(g_abDib + cbOffset + 12, 0xFFFF);
+
+    pImageData = ConvertExact(cbOffset + 3 * sizeof(DWORD) + 4);
+
+    TEST_CHECK(NULL == pImageData);
+
+    /* an absent alpha mask is fine and gives opaque pixels */
+    cbOffset = WriteHeader(1, 1, 16, BI_BITFIELDS, V5_HEADER_SIZE, 0);
+
+    WriteDword(g_abDib + HEADER_SIZE, 0x7C00);
+    WriteDword(g_abDib + HEADER_SIZE + 4, 0x03E0);
+    WriteDword(g_abDib + HEADER_SIZE + 8, 0x001F);
+    WriteDword(g_abDib + cbOffset, 0x7C00);
+
+    pImageData = ConvertExact(cbOffset + 4);
+
+    TEST_CHECK(pImageData != NULL);
+    TEST_CHECK(GetPixel(pImageData, 0, 0) == 0xFFFF0000);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImageData);
+
+    return bResult;
+}
+
+CONST TESTCASE g_aTestCases[] = {
+    { "bottom_up_rows",                 TestBottomUpRows },
+    { "top_down_rows",                  TestTopDownRows },
+    { "palette_1bpp",                   TestPalette1Bpp },
+    { "palette_4bpp",                   TestPalette4Bpp },
+    { "palette_8bpp",                   TestPalette8Bpp },
+    { "rgb_555",                        TestRgb555 },
+    { "v5_alpha_bitfields",             TestV5AlphaBitfields },
+    { "truncated_buffers_rejected",     TestTruncatedBuffersRejected },
+    { "zero_color_mask_rejected",       TestZeroColorMaskRejected },
+};
+
+CONST UINT g_cTestCases = sizeof(g_aTestCases) / sizeof(g_aTestCases[0]);
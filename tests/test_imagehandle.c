@@ -0,0 +1,136 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test_imagehandle.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#define IMAGE_WIDTH     33
+#define IMAGE_HEIGHT    17
+
+/*
+    Locked pixels must outlive a copy-on-write of the handle and the
+    release of the other handle sharing them (AddressSanitizer reports
+    the use after free otherwise)
+*/
+static BOOL
+TestLockSurvivesCopyOnWrite(
+    VOID
+    )
+{
+    PWUIMAGEDATA pExpected = NULL;
+    PWUIMAGEDATA pLocked   = NULL;
+    PWUIMAGEDATA pWritable = NULL;
+    HWUIMAGE     hImage    = NULL;
+    HWUIMAGE     hShared   = NULL;
+    BOOL         bResult   = FALSE;
+
+    pExpected = TestCreateImage(IMAGE_WIDTH, IMAGE_HEIGHT, 1);
+    hImage    = WuCreateImageHandle(
+        TestCreateImage(IMAGE_WIDTH, IMAGE_HEIGHT, 1));
+    hShared   = WuShareImageHandle(hImage);
+
+    TEST_CHECK((pExpected != NULL) && (hShared != NULL));
+
+    pLocked = WuLockImageHandleData(hShared);
+
+    TEST_CHECK(pLocked != NULL);
+
+    pWritable = WuImageHandleGetWritableData(hShared);
+
+    TEST_CHECK((pWritable != NULL) && (pWritable != pLocked));
+
+    FillMemory(pWritable->abData, (SIZE_T) IMAGE_WIDTH * IMAGE_HEIGHT
+        * WU_IMAGEDATA_BYTES_PER_PIXEL, 0xFF);
+
+    /* the lock now holds the only reference to the original pixels */
+    WuReleaseImageHandle(hImage);
+    hImage = NULL;
+
+    TEST_CHECK(TestImagesEqual(pLocked, pExpected) == TRUE);
+
+    WuUnlockImageHandleData(hShared, pLocked);
+    pLocked = NULL;
+
+    TEST_CHECK(WuImageHandleGetData(hShared) == pWritable);
+
+    bResult = TRUE;
+
+cleanup:
+    if (pLocked != NULL)
+    {
+        WuUnlockImageHandleData(hShared, pLocked);
+    }
+
+    WuReleaseImageHandle(hShared);
+    WuReleaseImageHandle(hImage);
+    WuDestroyImageData(pExpected);
+
+    return bResult;
+}
+
+/* Locked pixels are shared, so writes go to a copy until the last unlock */
+static BOOL
+TestLockKeepsDataReadOnly(
+    VOID
+    )
+{
+    PWUIMAGEDATA pFirst    = NULL;
+    PWUIMAGEDATA pSecond   = NULL;
+    PWUIMAGEDATA pWritable = NULL;
+    HWUIMAGE     hImage    = NULL;
+    BOOL         bResult   = FALSE;
+
+    hImage = WuCreateImageHandle(
+        TestCreateImage(IMAGE_WIDTH, IMAGE_HEIGHT, 2));
+
+    TEST_CHECK(hImage != NULL);
+
+    pFirst  = WuLockImageHandleData(hImage);
+    pSecond = WuLockImageHandleData(hImage);
+
+    TEST_CHECK((pFirst != NULL) && (pFirst == pSecond));
+
+    WuUnlockImageHandleData(hImage, pSecond);
+    pSecond = NULL;
+
+    pWritable = WuImageHandleGetWritableData(hImage);
+
+    TEST_CHECK((pWritable != NULL) && (pWritable != pFirst));
+
+    WuUnlockImageHandleData(hImage, pFirst);
+    pFirst = NULL;
+
+    /* sole owner again, no further copy */
+    TEST_CHECK(WuImageHandleGetWritableData(hImage) == pWritable);
+
+    bResult = TRUE;
+
+cleanup:
+    if (pSecond != NULL)
+    {
+        WuUnlockImageHandleData(hImage, pSecond);
+    }
+
+    if (pFirst != NULL)
+    {
+        WuUnlockImageHandleData(hImage, pFirst);
+    }
+
+    WuReleaseImageHandle(hImage);
+
+    return bResult;
+}
+
+CONST TESTCASE g_aTestCases[] = {
+    { "lock_survives_copy_on_write",    TestLockSurvivesCopyOnWrite },
+    { "lock_keeps_data_read_only",      TestLockKeepsDataReadOnly },
+};
+
+CONST UINT g_cTestCases = sizeof(g_aTestCases) / sizeof(g_aTestCases[0]);
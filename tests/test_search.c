@@ -0,0 +1,256 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test_search.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#define NEEDLE_SIZE         64
+#define MAX_MATCHES         4
+
+#define UI_BACKGROUND       0xFF3A6EA5
+#define UI_BORDER           0xFF808080
+#define UI_TEXT             0xFF202020
+#define UI_TITLE_HEIGHT     24
+#define UI_LINE_HEIGHT      16
+#define UI_GLYPH_HEIGHT     9
+#define UI_MAX_WINDOWS      64
+
+static CONST DWORD g_adwUiPalette[] = {
+    0xFFFFFFFF, 0xFFF3F3F3, 0xFF2B579A, 0xFF0078D7,
+    0xFF202020, 0xFFE81123, 0xFF107C10, 0xFFFFB900
+};
+
+#define UI_PALETTE_SIZE     (sizeof(g_adwUiPalette) / sizeof(DWORD))
+
+static DWORD
+NextRandom(
+    IN OUT DWORD*   pdwState
+    )
+{
+    DWORD dwState = *pdwState;
+
+    dwState ^= dwState << 13;
+    dwState ^= dwState >> 17;
+    dwState ^= dwState << 5;
+
+    *pdwState = dwState;
+
+    return dwState;
+}
+
+static VOID
+FillArea(
+    IN PWUIMAGEDATA pImageData,
+    IN UINT         uLeft,
+    IN UINT         uTop,
+    IN UINT         uRight,
+    IN UINT         uBottom,
+    IN DWORD        dwColor
+    )
+{
+    DWORD* pdwRow = NULL;
+    UINT   x      = 0;
+    UINT   y      = 0;
+
+    uRight  = min(uRight, pImageData->uWidth);
+    uBottom = min(uBottom, pImageData->uHeight);
+
+    for (y = uTop; y < uBottom; ++y)
+    {
+        pdwRow = (DWORD*) pImageData->abData + (SIZE_T) y * pImageData->uWidth;
+
+        for (x = uLeft; x < uRight; ++x)
+        {
+            pdwRow[x] = dwColor;
+        }
+    }
+}
+
+/* Lines of glyph-sized stroke clusters separated by word gaps */
+static VOID
+DrawTextLines(
+    IN     PWUIMAGEDATA pImageData,
+    IN     UINT         uLeft,
+    IN     UINT         uTop,
+    IN     UINT         uRight,
+    IN     UINT         uBottom,
+    IN OUT DWORD*       pdwState
+    )
+{
+    UINT x       = 0;
+    UINT y       = 0;
+    UINT uGlyph  = 0;
+    UINT uStroke = 0;
+
+    for (y = uTop + 4; y + UI_GLYPH_HEIGHT < uBottom; y += UI_LINE_HEIGHT)
+    {
+        for (x = uLeft + 6; x + 8 < uRight; x += uGlyph)
+        {
+            uGlyph = 4 + NextRandom(pdwState) % 5;
+
+            if (NextRandom(pdwState) % 6 == 0)
+            {
+                continue;
+            }
+
+            for (uStroke = 0; uStroke < uGlyph - 1; ++uStroke)
+            {
+                if (NextRandom(pdwState) & 1)
+                {
+                    FillArea(pImageData, x + uStroke, y, x + uStroke + 1,
+                        y + UI_GLYPH_HEIGHT, UI_TEXT);
+                }
+            }
+        }
+    }
+}
+
+/*
+    Desktop-like haystack: large flat areas (background, client areas,
+    title bars) and repetitive text, where many positions score alike.
+*/
+static PWUIMAGEDATA
+CreateUiImage(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwSeed
+    )
+{
+    PWUIMAGEDATA pImageData = NULL;
+    DWORD        dwState    = dwSeed | 1;
+    UINT         cWindows   = 0;
+    UINT         uLeft      = 0;
+    UINT         uTop       = 0;
+    UINT         uRight     = 0;
+    UINT         uBottom    = 0;
+    UINT         i          = 0;
+
+    pImageData = WuCreateEmptyImageData(uWidth, uHeight);
+
+    if (NULL == pImageData)
+    {
+        return NULL;
+    }
+
+    FillArea(pImageData, 0, 0, uWidth, uHeight, UI_BACKGROUND);
+
+    cWindows = min(UI_MAX_WINDOWS, uWidth / 256 * (uHeight / 256) + 1);
+
+    for (i = 0; i < cWindows; ++i)
+    {
+        uLeft   = NextRandom(&dwState) % uWidth;
+        uTop    = NextRandom(&dwState) % uHeight;
+        uRight  = uLeft + 48 + NextRandom(&dwState) % (uWidth / 2 + 1);
+        uBottom = uTop + 48 + NextRandom(&dwState) % (uHeight / 2 + 1);
+
+        FillArea(pImageData, uLeft, uTop, uRight, uBottom, UI_BORDER);
+        FillArea(pImageData, uLeft + 1, uTop + 1, uRight - 1, uBottom - 1,
+            g_adwUiPalette[NextRandom(&dwState) % 2]);
+        FillArea(pImageData, uLeft + 1, uTop + 1, uRight - 1,
+            uTop + UI_TITLE_HEIGHT,
+            g_adwUiPalette[NextRandom(&dwState) % UI_PALETTE_SIZE]);
+
+        DrawTextLines(pImageData, uLeft + 1, uTop + UI_TITLE_HEIGHT,
+            min(uRight - 1, uWidth), min(uBottom - 1, uHeight), &dwState);
+    }
+
+    return pImageData;
+}
+
+static PWUIMAGEDATA
+CutNeedle(
+    IN CONST PWUIMAGEDATA   pHaystack,
+    IN UINT                 uLeft,
+    IN UINT                 uTop
+    )
+{
+    PWUIMAGEDATA pNeedle = NULL;
+    UINT         y       = 0;
+
+    pNeedle = WuCreateEmptyImageData(NEEDLE_SIZE, NEEDLE_SIZE);
+
+    if (NULL == pNeedle)
+    {
+        return NULL;
+    }
+
+    for (y = 0; y < NEEDLE_SIZE; ++y)
+    {
+        CopyMemory(
+            pNeedle->abData + (SIZE_T) y * NEEDLE_SIZE
+                * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            pHaystack->abData + ((SIZE_T) (uTop + y) * pHaystack->uWidth
+                + uLeft) * WU_IMAGEDATA_BYTES_PER_PIXEL,
+            (SIZE_T) NEEDLE_SIZE * WU_IMAGEDATA_BYTES_PER_PIXEL);
+    }
+
+    return pNeedle;
+}
+
+/* The needle is cut from the haystack, the best match must be its origin */
+static BOOL
+FindPlantedNeedle(
+    IN UINT     uWidth,
+    IN UINT     uHeight,
+    IN DWORD    dwSeed
+    )
+{
+    WUIMAGEMATCH aMatches[MAX_MATCHES];
+    PWUIMAGEDATA pHaystack = NULL;
+    PWUIMAGEDATA pNeedle   = NULL;
+    UINT         uLeft     = (uWidth - NEEDLE_SIZE) * 3 / 7;
+    UINT         uTop      = (uHeight - NEEDLE_SIZE) * 5 / 9;
+    UINT         cMatches  = 0;
+    BOOL         bResult   = FALSE;
+
+    pHaystack = CreateUiImage(uWidth, uHeight, dwSeed);
+    pNeedle   = (NULL == pHaystack) ? NULL
+        : CutNeedle(pHaystack, uLeft, uTop);
+
+    TEST_CHECK(pNeedle != NULL);
+
+    cMatches = WuFindImageData(pHaystack, pNeedle, NULL, WU_MATCH_SAD, 1.0f,
+        0, aMatches, MAX_MATCHES);
+
+    TEST_CHECK(cMatches > 0);
+    TEST_CHECK((aMatches[0].x == uLeft) && (aMatches[0].y == uTop));
+    TEST_CHECK(0.0f == aMatches[0].fScore);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pHaystack);
+    WuDestroyImageData(pNeedle);
+
+    return bResult;
+}
+
+static BOOL
+TestFindNeedleInUi1080p(
+    VOID
+    )
+{
+    return FindPlantedNeedle(1920, 1080, 0x1080);
+}
+
+static BOOL
+TestFindNeedleInUi4k(
+    VOID
+    )
+{
+    return FindPlantedNeedle(3840, 2160, 0x2160);
+}
+
+CONST TESTCASE g_aTestCases[] = {
+    { "find_needle_in_ui_1080p",        TestFindNeedleInUi1080p },
+    { "find_needle_in_ui_4k",           TestFindNeedleInUi4k },
+};
+
+CONST UINT g_cTestCases = sizeof(g_aTestCases) / sizeof(g_aTestCases[0]);
@@ -0,0 +1,154 @@
+/***************************************************************************
+ * 
+ *  Copyright (c) 2025 haloperidozz
+ *
+ *  This source code is licensed under the MIT license found in the
+ *  LICENSE file in the root directory of this source tree.
+ * 
+ *  File:       test_transform.c
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+#define SQUARE_SIZE     37          /* not a multiple of the tile size */
+
+static DWORD
+GetPixel(
+    IN CONST WUIMAGEDATA*   pImageData,
+    IN UINT                 uX,
+    IN UINT                 uY
+    )
+{
+    return ((CONST DWORD*) pImageData->abData)[
+        (SIZE_T) uY * pImageData->uWidth + uX];
+}
+
+static BOOL
+TestRotateSquareInPlace(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImage   = NULL;
+    PWUIMAGEDATA pRotated = NULL;
+    BYTE*        abData   = NULL;
+    BOOL         bResult  = FALSE;
+
+    pImage   = TestCreateImage(SQUARE_SIZE, SQUARE_SIZE, 1);
+    pRotated = (NULL == pImage) ? NULL
+        : WuRotateImageData(pImage, WU_IMAGE_ROTATE_90);
+
+    TEST_CHECK(pRotated != NULL);
+
+    abData = pImage->abData;
+
+    TEST_CHECK(WuRotateImageDataInPlace(pImage, WU_IMAGE_ROTATE_90) == TRUE);
+    TEST_CHECK(pImage->abData == abData);
+    TEST_CHECK(TestImagesEqual(pImage, pRotated) == TRUE);
+
+    /* and back */
+    TEST_CHECK(WuRotateImageDataInPlace(pImage, WU_IMAGE_ROTATE_270)
+        == TRUE);
+    TEST_CHECK(WuRotateImageDataInPlace(pRotated, WU_IMAGE_ROTATE_270)
+        == TRUE);
+    TEST_CHECK(TestImagesEqual(pImage, pRotated) == TRUE);
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImage);
+    WuDestroyImageData(pRotated);
+
+    return bResult;
+}
+
+static BOOL
+TestRotateNonSquareInPlaceRefused(
+    VOID
+    )
+{
+    PWUIMAGEDATA pImage    = NULL;
+    PWUIMAGEDATA pOriginal = NULL;
+    BYTE*        abData    = NULL;
+    BOOL         bResult   = FALSE;
+
+    pImage    = TestCreateImage(40, 24, 2);
+    pOriginal = TestCreateImage(40, 24, 2);
+
+    TEST_CHECK((pImage != NULL) && (pOriginal != NULL));
+
+    abData = pImage->abData;
+
+    TEST_CHECK(WuRotateImageDataInPlace(pImage, WU_IMAGE_ROTATE_90)
+        == FALSE);
+    TEST_CHECK(WuRotateImageDataInPlace(pImage, WU_IMAGE_ROTATE_270)
+        == FALSE);
+    TEST_CHECK(pImage->abData == abData);
+    TEST_CHECK(TestImagesEqual(pImage, pOriginal) == TRUE);
+
+    /* a half turn keeps the size and still works */
+    TEST_CHECK(WuRotateImageDataInPlace(pImage, WU_IMAGE_ROTATE_180)
+        == TRUE);
+    TEST_CHECK(GetPixel(pImage, 0, 0) == GetPixel(pOriginal, 39, 23));
+    TEST_CHECK(GetPixel(pImage, 39, 0) == GetPixel(pOriginal, 0, 23));
+
+    bResult = TRUE;
+
+cleanup:
+    WuDestroyImageData(pImage);
+    WuDestroyImageData(pOriginal);
+
+    return bResult;
+}
+
+/* Pixels the function does not own must never be freed or replaced */
+static BOOL
+TestRotateBorrowedPixels(
+    VOID
+    )
+{
+    DWORD       adwPixels[4 * 2];
+    WUIMAGEDATA view;
+    UINT        i       = 0;
+    BOOL        bResult = FALSE;
+
+    for (i = 0; i < 8; ++i)
+    {
+        adwPixels[i] = 0xFF000000 | i;
+    }
+
+    view.uWidth  = 4;
+    view.uHeight = 2;
+    view.abData  = (BYTE*) adwPixels;
+
+    TEST_CHECK(WuRotateImageDataInPlace(&view, WU_IMAGE_ROTATE_90)
+        == FALSE);
+    TEST_CHECK(view.abData == (BYTE*) adwPixels);
+    TEST_CHECK((4 == view.uWidth) && (2 == view.uHeight));
+
+    view.uWidth  = 2;
+    view.uHeight = 2;
+
+    TEST_CHECK(WuRotateImageDataInPlace(&view, WU_IMAGE_ROTATE_90)
+        == TRUE);
+    TEST_CHECK(view.abData == (BYTE*) adwPixels);
+
+    /* 0 1 / 2 3 turned clockwise is 2 0 / 3 1 */
+    TEST_CHECK(adwPixels[0] == 0xFF000002);
+    TEST_CHECK(adwPixels[1] == 0xFF000000);
+    TEST_CHECK(adwPixels[2] == 0xFF000003);
+    TEST_CHECK(adwPixels[3] == 0xFF000001);
+
+    bResult = TRUE;
+
+cleanup:
+    return bResult;
+}
+
+CONST TESTCASE g_aTestCases[] = {
+    { "rotate_square_in_place",         TestRotateSquareInPlace },
+    { "rotate_non_square_refused",      TestRotateNonSquareInPlaceRefused },
+    { "rotate_borrowed_pixels",         TestRotateBorrowedPixels },
+};
+
+CONST UINT g_cTestCases = sizeof(g_aTestCases) / sizeof(g_aTestCases[0]);